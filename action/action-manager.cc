@@ -2,6 +2,8 @@
 
 #include <glog/logging.h>
 
+#include "core/trace-recorder.h"
+
 namespace troll {
 
 ActionManager::ActionManager(Core* core) {
@@ -60,6 +62,12 @@ void ActionManager::Execute(const Action& action) const {
         << " is not registered with ActionManager and has no valid Executor.";
     return;
   }
+  ++actions_executed_;
+
+  TraceRecorder::ScopedEvent trace_event(
+      "action", TraceRecorder::enabled()
+                    ? Action::descriptor()->FindFieldByNumber(type)->name()
+                    : "");
   it->second->Execute(action);
 }
 
@@ -18,11 +18,15 @@ class ActionManager {
   void Execute(const Action& action) const;
   Action Reverse(const Action& action) const;
 
+  // Number of actions executed since creation.
+  int actions_executed() const { return actions_executed_; }
+
   ActionManager(const ActionManager&) = delete;
   ActionManager& operator=(const ActionManager&) = delete;
 
  private:
   std::unordered_map<Action::ActionCase, std::unique_ptr<Executor>> executors_;
+  mutable int actions_executed_ = 0;
 };
 
 }  // namespace troll
@@ -3,6 +3,7 @@
 #include <range/v3/view/remove_if.hpp>
 #include <range/v3/view/transform.hpp>
 
+#include "core/frame-profiler.h"
 #include "core/geometry.h"
 #include "core/scene-manager.h"
 
@@ -11,11 +12,10 @@ namespace troll {
 Response SceneNodeEvaluator::Eval(const Query& query) const {
   Response response;
 
-  const auto node_ids = core_->scene_manager()->GetSceneNodesByPattern(
+  const auto handles = core_->scene_manager()->GetSceneNodeHandlesByPattern(
       query.scene_node().pattern());
-  auto&& nodes = node_ids |
-                 ranges::view::transform([this](const std::string& node_id) {
-                   return core_->scene_manager()->GetSceneNodeById(node_id);
+  auto&& nodes = handles | ranges::view::transform([this](NodeHandle handle) {
+                   return core_->scene_manager()->GetSceneNode(handle);
                  }) |
                  ranges::view::remove_if(
                      [](const SceneNode* node) { return node == nullptr; });
@@ -30,22 +30,34 @@ Response SceneNodeEvaluator::Eval(const Query& query) const {
 Response SceneNodeOverlapEvaluator::Eval(const Query& query) const {
   Response response;
 
-  const auto* first_node = core_->scene_manager()->GetSceneNodeById(
+  const auto first_node = core_->scene_manager()->GetSceneNodeHandle(
       query.scene_node_overlap().first_node_id());
-  const auto* second_node = core_->scene_manager()->GetSceneNodeById(
+  const auto second_node = core_->scene_manager()->GetSceneNodeHandle(
       query.scene_node_overlap().second_node_id());
-  if (first_node == nullptr || second_node == nullptr) return response;
+  if (!first_node.valid() || !second_node.valid()) return response;
 
   const auto first_aabb =
-      core_->scene_manager()->GetSceneNodeBoundingBox(*first_node);
+      core_->scene_manager()->GetSceneNodeBoundingBox(first_node);
   const auto second_aabb =
-      core_->scene_manager()->GetSceneNodeBoundingBox(*second_node);
+      core_->scene_manager()->GetSceneNodeBoundingBox(second_node);
 
   if (geo::Collide(first_aabb, second_aabb)) {
-    *response.mutable_overlap() = geo::Intersection(first_aabb, second_aabb);
+    *response.mutable_overlap() =
+        geo::ToBox(geo::Intersection(first_aabb, second_aabb));
   }
 
   return response;
 }
 
+Response FrameProfileEvaluator::Eval(const Query& query) const {
+  Response response;
+  if (core_->frame_profiler() == nullptr) {
+    response.mutable_frame_profile();
+    return response;
+  }
+
+  *response.mutable_frame_profile() = core_->frame_profiler()->GetProfile();
+  return response;
+}
+
 }  // namespace troll
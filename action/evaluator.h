@@ -34,6 +34,16 @@ class SceneNodeOverlapEvaluator : public Evaluator {
   Core* core_;
 };
 
+class FrameProfileEvaluator : public Evaluator {
+ public:
+  FrameProfileEvaluator(Core* core) : core_(core) {}
+
+  virtual Response Eval(const Query& query) const;
+
+ private:
+  Core* core_;
+};
+
 }  // namespace troll
 
 #endif  // TROLL_ACTION_EVALUATOR_H_
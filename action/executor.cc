@@ -14,26 +14,29 @@
 namespace troll {
 
 namespace {
-// Returns all scene node ids described by a node expression in an action.
-std::vector<std::string> ResolveSceneNodes(const std::string& node_expression,
-                                           Core* core) {
-  std::vector<std::string> node_ids;
+// Returns handles of all scene nodes described by a node expression in an
+// action. A plain scene node id that does not exist resolves to an invalid
+// handle.
+std::vector<NodeHandle> ResolveSceneNodes(const std::string& node_expression,
+                                          Core* core) {
+  std::vector<NodeHandle> nodes;
   if (!node_expression.empty() && node_expression[0] == '$') {
     SceneNodePattern query;
-    if (!query.Parse(node_expression)) return node_ids;
+    if (!query.Parse(node_expression)) return nodes;
 
     if (query.mode == SceneNodePattern::RetrievalMode::GLOBAL) {
-      node_ids = core->scene_manager()->GetSceneNodesByPattern(query.pattern);
+      nodes =
+          core->scene_manager()->GetSceneNodeHandlesByPattern(query.pattern);
     } else if (query.mode == SceneNodePattern::RetrievalMode::LOCAL) {
       auto&& context_nodes = core->collision_checker()->collision_context();
-      node_ids = core->scene_manager()->GetSceneNodesByPattern(query.pattern,
-                                                               context_nodes);
+      nodes = core->scene_manager()->GetSceneNodeHandlesByPattern(
+          query.pattern, context_nodes);
     }
   } else {
-    node_ids.push_back(node_expression);
+    nodes.push_back(core->scene_manager()->GetSceneNodeHandle(node_expression));
   }
 
-  return node_ids;
+  return nodes;
 }
 }  // namespace
 
@@ -53,12 +56,14 @@ void EmitExecutor::Execute(const Action& action) const {
     return;
   }
 
-  auto&& node_ids =
-      ResolveSceneNodes(action.emit().scene_node_pattern(), core_);
+  auto&& nodes = ResolveSceneNodes(action.emit().scene_node_pattern(), core_);
 
   Event event = action.emit().event();
-  for (const auto& id : node_ids) {
-    event.add_scene_node_id(id);
+  for (const auto handle : nodes) {
+    const auto* node = core_->scene_manager()->GetSceneNode(handle);
+    if (node != nullptr) {
+      event.add_scene_node_id(node->id());
+    }
   }
   core_->event_dispatcher()->Emit(event);
 }
@@ -80,51 +85,51 @@ void CreateSceneNodeExecutor::Execute(const Action& action) const {
 }
 
 void DestroySceneNodeExecutor::Execute(const Action& action) const {
-  auto&& node_ids =
-      ResolveSceneNodes(action.destroy_scene_node().scene_node().id(), core_);
+  const auto& node_expression = action.destroy_scene_node().scene_node().id();
+  auto&& nodes = ResolveSceneNodes(node_expression, core_);
 
-  for (const auto& id : node_ids) {
-    if (core_->scene_manager()->GetSceneNodeById(id) == nullptr) {
+  for (const auto handle : nodes) {
+    if (core_->scene_manager()->GetSceneNode(handle) == nullptr) {
       LOG(WARNING)
           << "DestroySceneNodeExecutor: Cannot destroy SceneNode with id='"
-          << id << "' that does not exist.";
+          << node_expression << "' that does not exist.";
       return;
     }
-    core_->scene_manager()->RemoveSceneNode(id);
+    core_->scene_manager()->RemoveSceneNode(handle);
   }
 }
 
 void PositionSceneNodeExecutor::Execute(const Action& action) const {
-  auto&& node_ids =
-      ResolveSceneNodes(action.position_scene_node().scene_node_id(), core_);
+  const auto& node_expression = action.position_scene_node().scene_node_id();
+  auto&& nodes = ResolveSceneNodes(node_expression, core_);
 
-  for (const auto& id : node_ids) {
-    auto* node = core_->scene_manager()->GetSceneNodeById(id);
+  for (const auto handle : nodes) {
+    auto* node = core_->scene_manager()->GetSceneNode(handle);
     if (node == nullptr) {
       LOG(WARNING) << "PositionSceneNodeExecutor: Cannot set position for "
                       "SceneNode with id='"
-                   << id << "', because it does not exist.";
+                   << node_expression << "', because it does not exist.";
       return;
     }
 
-    core_->scene_manager()->Dirty(*node);
+    core_->scene_manager()->Dirty(handle);
     *node->mutable_position() = action.position_scene_node().vec();
   }
 }
 
 void MoveSceneNodeExecutor::Execute(const Action& action) const {
-  auto&& node_ids =
-      ResolveSceneNodes(action.move_scene_node().scene_node_id(), core_);
+  const auto& node_expression = action.move_scene_node().scene_node_id();
+  auto&& nodes = ResolveSceneNodes(node_expression, core_);
 
-  for (const auto& id : node_ids) {
-    auto* node = core_->scene_manager()->GetSceneNodeById(id);
+  for (const auto handle : nodes) {
+    auto* node = core_->scene_manager()->GetSceneNode(handle);
     if (node == nullptr) {
       LOG(WARNING) << "MoveSceneNodeExecutor: Cannot move SceneNode with id='"
-                   << id << "' that does not exist.";
+                   << node_expression << "' that does not exist.";
       return;
     }
 
-    core_->scene_manager()->Dirty(*node);
+    core_->scene_manager()->Dirty(handle);
     auto* pos = node->mutable_position();
     const auto& move = action.move_scene_node().vec();
     pos->set_x(pos->x() + move.x());
@@ -157,23 +162,30 @@ void OnDetachingExecutor::Execute(const Action& action) const {
 }
 
 void PlayAnimationScriptExecutor::Execute(const Action& action) const {
-  auto&& node_ids =
-      ResolveSceneNodes(action.play_animation_script().scene_node_id(), core_);
+  const auto& node_expression = action.play_animation_script().scene_node_id();
+  auto&& nodes = ResolveSceneNodes(node_expression, core_);
 
-  for (const auto& id : node_ids) {
-    if (core_->scene_manager()->GetSceneNodeById(id) == nullptr) {
+  const AnimationProgram* program = nullptr;
+  for (const auto handle : nodes) {
+    if (core_->scene_manager()->GetSceneNode(handle) == nullptr) {
       LOG(WARNING)
           << "PlayAnimationScriptExecutor: Cannot apply animation script '"
           << action.play_animation_script().script_id()
-          << "' on SceneNode with id='" << id << "' that does not exist.";
+          << "' on SceneNode with id='" << node_expression
+          << "' that does not exist.";
       return;
     }
 
-    const auto& script = action.play_animation_script().has_script()
-                             ? action.play_animation_script().script()
-                             : core_->resource_manager()->GetAnimationScript(
-                                   action.play_animation_script().script_id());
-    core_->animator_manager()->Play(script, id);
+    // Inline scripts are compiled once and cached by the resource manager. The
+    // program is looked up once for all the nodes of the action.
+    if (program == nullptr) {
+      program = action.play_animation_script().has_script()
+                    ? &core_->resource_manager()->CompileAnimationScript(
+                          action.play_animation_script().script())
+                    : &core_->resource_manager()->GetAnimationProgram(
+                          action.play_animation_script().script_id());
+    }
+    core_->animator_manager()->Play(*program, handle);
   }
 }
 
@@ -184,23 +196,24 @@ Action PlayAnimationScriptExecutor::Reverse(const Action& action) const {
 }
 
 void StopAnimationScriptExecutor::Execute(const Action& action) const {
-  auto&& node_ids =
-      ResolveSceneNodes(action.stop_animation_script().scene_node_id(), core_);
+  const auto& node_expression = action.stop_animation_script().scene_node_id();
+  auto&& nodes = ResolveSceneNodes(node_expression, core_);
 
-  for (const auto& id : node_ids) {
-    if (core_->scene_manager()->GetSceneNodeById(id) == nullptr) {
+  for (const auto handle : nodes) {
+    if (core_->scene_manager()->GetSceneNode(handle) == nullptr) {
       LOG(WARNING)
           << "StopAnimationScriptExecutor: Cannot stop animation script '"
           << action.stop_animation_script().script_id()
-          << "' on SceneNode with id='" << id << "' that does not exist.";
+          << "' on SceneNode with id='" << node_expression
+          << "' that does not exist.";
       return;
     }
 
     if (action.stop_animation_script().has_script_id()) {
       core_->animator_manager()->Stop(
-          action.stop_animation_script().script_id(), id);
+          action.stop_animation_script().script_id(), handle);
     } else {
-      core_->animator_manager()->StopNodeAnimations(id);
+      core_->animator_manager()->StopNodeAnimations(handle);
     }
   }
 }
@@ -212,20 +225,21 @@ Action StopAnimationScriptExecutor::Reverse(const Action& action) const {
 }
 
 void PauseAnimationScriptExecutor::Execute(const Action& action) const {
-  auto&& node_ids =
-      ResolveSceneNodes(action.pause_animation_script().scene_node_id(), core_);
+  const auto& node_expression = action.pause_animation_script().scene_node_id();
+  auto&& nodes = ResolveSceneNodes(node_expression, core_);
 
-  for (const auto& id : node_ids) {
-    if (core_->scene_manager()->GetSceneNodeById(id) == nullptr) {
+  for (const auto handle : nodes) {
+    if (core_->scene_manager()->GetSceneNode(handle) == nullptr) {
       LOG(WARNING)
           << "PauseAnimationScriptExecutor: Cannot pause animation script '"
           << action.pause_animation_script().script_id()
-          << "' on SceneNode with id='" << id << "' that does not exist.";
+          << "' on SceneNode with id='" << node_expression
+          << "' that does not exist.";
       return;
     }
 
     core_->animator_manager()->Pause(
-        action.pause_animation_script().script_id(), id);
+        action.pause_animation_script().script_id(), handle);
   }
 }
 
@@ -236,20 +250,22 @@ Action PauseAnimationScriptExecutor::Reverse(const Action& action) const {
 }
 
 void ResumeAnimationScriptExecutor::Execute(const Action& action) const {
-  auto&& node_ids = ResolveSceneNodes(
-      action.resume_animation_script().scene_node_id(), core_);
+  const auto& node_expression =
+      action.resume_animation_script().scene_node_id();
+  auto&& nodes = ResolveSceneNodes(node_expression, core_);
 
-  for (const auto& id : node_ids) {
-    if (core_->scene_manager()->GetSceneNodeById(id) == nullptr) {
+  for (const auto handle : nodes) {
+    if (core_->scene_manager()->GetSceneNode(handle) == nullptr) {
       LOG(WARNING)
           << "ResumeAnimationScriptExecutor: Cannot resume animation script '"
           << action.resume_animation_script().script_id()
-          << "' on SceneNode with id='" << id << "' that does not exist.";
+          << "' on SceneNode with id='" << node_expression
+          << "' that does not exist.";
       return;
     }
 
     core_->animator_manager()->Resume(
-        action.resume_animation_script().script_id(), id);
+        action.resume_animation_script().script_id(), handle);
   }
 }
 
@@ -9,6 +9,8 @@ QueryManager::QueryManager(Core* core) {
                       std::make_unique<SceneNodeEvaluator>(core));
   evaluators_.emplace(Query::kSceneNodeOverlap,
                       std::make_unique<SceneNodeOverlapEvaluator>(core));
+  evaluators_.emplace(Query::kFrameProfile,
+                      std::make_unique<FrameProfileEvaluator>(core));
 }
 
 Response QueryManager::Eval(const Query& query) const {
@@ -0,0 +1,829 @@
+#include "animation/animation-tracks.h"
+
+#include <algorithm>
+
+#include "animation/animator-manager.h"
+#include "animation/performer.h"
+#include "core/event-dispatcher.h"
+#include "core/events.h"
+#include "core/resource-manager.h"
+#include "core/scene-manager.h"
+#include "proto/event.pb.h"
+#include "sound/audio-mixer.h"
+
+namespace troll {
+
+namespace {
+// Progresses a track that executes every |delay| until it executed |repeat|
+// times, like RepeatablePerformerBase. Returns true if the track finished.
+template <class Track, class Execute>
+bool ProgressRepeatable(int time_since_last_frame, Track* track,
+                        Execute&& execute) {
+  const auto repeatable_execute = [track, &execute]() {
+    return execute() && ++track->run_number == track->repeat;
+  };
+
+  if (track->delay == 0) {
+    return repeatable_execute();
+  }
+
+  track->wait_time += time_since_last_frame;
+  while (track->delay <= track->wait_time) {
+    track->wait_time -= track->delay;
+
+    if (repeatable_execute()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Progresses a track that executes every |delay| until execution returns true,
+// like OneOffPerformerBase. Returns true if the track finished.
+template <class Track, class Execute>
+bool ProgressOneOff(int time_since_last_frame, Track* track,
+                    Execute&& execute) {
+  track->wait_time += time_since_last_frame;
+  while (track->delay <= track->wait_time) {
+    track->wait_time -= track->delay;
+
+    if (execute()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class Track, class AnimationType>
+Track MakeRepeatableTrack(int step, const AnimationType& animation) {
+  Track track;
+  track.step = step;
+  track.delay = animation.delay();
+  track.repeat = animation.repeat();
+  return track;
+}
+
+template <class Track, class Predicate>
+void EraseIf(std::vector<Track>* tracks, Predicate&& predicate) {
+  tracks->erase(std::remove_if(tracks->begin(), tracks->end(), predicate),
+                tracks->end());
+}
+}  // namespace
+
+int AnimationTracks::StartStep(const AnimationProgram& program,
+                               const AnimationProgram::Step& program_step,
+                               SceneNode* scene_node) {
+  int step_id = steps_.size();
+  if (free_steps_.empty()) {
+    steps_.emplace_back();
+  } else {
+    step_id = free_steps_.back();
+    free_steps_.pop_back();
+    const int generation = steps_[step_id].generation;
+    steps_[step_id] = Step();
+    steps_[step_id].generation = generation;
+  }
+
+  auto& step = steps_[step_id];
+  step.wait_for_all = program_step.wait_for_all;
+
+  const auto& animation = *program_step.animation;
+  for (const auto* instruction = program.begin(program_step);
+       instruction != program.end(program_step); ++instruction) {
+    switch (instruction->op) {
+      case Op::TRANSLATION: {
+        const auto& translation = animation.translation();
+        auto track = MakeRepeatableTrack<VectorTrack>(step_id, translation);
+        track.x = translation.vec().x();
+        track.y = translation.vec().y();
+        track.z = translation.vec().z();
+        step.track(Op::TRANSLATION) = translations_.size();
+        step.time_until_due = std::min(step.time_until_due, track.delay);
+        translations_.push_back(track);
+        break;
+      }
+      case Op::ROTATION:
+        step.track(Op::ROTATION) = rotations_.size();
+        step.time_until_due =
+            std::min(step.time_until_due, animation.rotation().delay());
+        rotations_.push_back(MakeRepeatableTrack<RepeatableTrack>(
+            step_id, animation.rotation()));
+        break;
+      case Op::SCALING:
+        step.track(Op::SCALING) = scalings_.size();
+        step.time_until_due =
+            std::min(step.time_until_due, animation.scaling().delay());
+        scalings_.push_back(MakeRepeatableTrack<RepeatableTrack>(
+            step_id, animation.scaling()));
+        break;
+      case Op::FRAME_RANGE: {
+        const auto& frame_range = animation.frame_range();
+        auto track =
+            MakeRepeatableTrack<FrameRangeTrack>(step_id, frame_range);
+        track.start_frame = frame_range.start_frame();
+        track.end_frame = frame_range.end_frame();
+        track.vertical_align = frame_range.vertical_align();
+        track.horizontal_align = frame_range.horizontal_align();
+
+        track.current_frame = track.start_frame;
+        track.frame_step = track.start_frame < track.end_frame ? 1 : -1;
+        SetSceneNodeFrame(track.current_frame, track.vertical_align,
+                          track.horizontal_align, scene_node, core_);
+        track.current_frame += track.frame_step;
+        step.track(Op::FRAME_RANGE) = frame_ranges_.size();
+        step.time_until_due = std::min(step.time_until_due, track.delay);
+        frame_ranges_.push_back(track);
+        break;
+      }
+      case Op::FRAME_LIST: {
+        const auto& frame_list = animation.frame_list();
+        auto track = MakeRepeatableTrack<FrameListTrack>(step_id, frame_list);
+        track.first_frame = frames_.size();
+        track.frame_count = frame_list.frame_size();
+        track.vertical_align = frame_list.vertical_align();
+        track.horizontal_align = frame_list.horizontal_align();
+        frames_.insert(frames_.end(), frame_list.frame().begin(),
+                       frame_list.frame().end());
+
+        SetSceneNodeFrame(
+            frames_[track.first_frame + track.current_frame_index++],
+            track.vertical_align, track.horizontal_align, scene_node, core_);
+        step.track(Op::FRAME_LIST) = frame_lists_.size();
+        step.time_until_due = std::min(step.time_until_due, track.delay);
+        frame_lists_.push_back(track);
+        break;
+      }
+      case Op::FLASH:
+        step.track(Op::FLASH) = flashes_.size();
+        step.time_until_due =
+            std::min(step.time_until_due, animation.flash().delay());
+        flashes_.push_back(
+            MakeRepeatableTrack<FlashTrack>(step_id, animation.flash()));
+        break;
+      case Op::GO_TO: {
+        GotoTrack track;
+        track.step = step_id;
+        track.delay = animation.go_to().delay();
+        track.step_size = animation.go_to().step();
+        track.destination = animation.go_to().destination();
+        step.track(Op::GO_TO) = gotos_.size();
+        step.time_until_due = std::min(step.time_until_due, track.delay);
+        gotos_.push_back(track);
+        break;
+      }
+      case Op::TIMER: {
+        TimerTrack track;
+        track.step = step_id;
+        track.delay = animation.timer().delay();
+        step.track(Op::TIMER) = timers_.size();
+        step.time_until_due =
+            std::min(step.time_until_due, std::max(track.delay, 0));
+        timers_.push_back(track);
+        break;
+      }
+      case Op::RUN_SCRIPT: {
+        RunScriptTrack track;
+        track.step = step_id;
+        track.script_id = animation.run_script().script_id();
+        track.script = instruction->script;
+        step.track(Op::RUN_SCRIPT) = run_scripts_.size();
+        step.time_until_due = 0;
+        run_scripts_.push_back(std::move(track));
+        break;
+      }
+      case Op::SFX: {
+        const auto& audio = animation.sfx().audio();
+        SfxTrack track;
+        track.step = step_id;
+        track.repeat = animation.sfx().repeat();
+        if (!audio.track().empty()) {
+          track.audio_id = audio.track(0).id();
+          track.is_music = true;
+        } else if (!audio.sfx().empty()) {
+          track.audio_id = audio.sfx(0).id();
+          track.is_sound = true;
+        }
+        step.track(Op::SFX) = sfx_.size();
+        step.time_until_due = 0;
+        sfx_.push_back(std::move(track));
+        break;
+      }
+    }
+    ++step.unfinished_tracks;
+  }
+
+  // Starting a script may start other steps, so |step| is not used after this.
+  if (steps_[step_id].track(Op::RUN_SCRIPT) != -1) {
+    StartRunScript(step_id, scene_node);
+  }
+  if (steps_[step_id].track(Op::SFX) != -1) {
+    StartSfx(step_id);
+  }
+  return step_id;
+}
+
+void AnimationTracks::ReleaseStep(int step) {
+  auto& released_step = steps_[step];
+  released_step.released = true;
+  released_step.scheduled_round = -1;
+  ++released_step.generation;
+  released_steps_.push_back(step);
+}
+
+void AnimationTracks::StopStep(int step, const SceneNode& scene_node) {
+  if (const auto* track = GetRunScriptTrack(step)) {
+    core_->animator_manager()->Stop(track->script_id, scene_node.id());
+  }
+  if (const auto* track = GetSfxTrack(step)) {
+    if (track->is_music) {
+      core_->audio_mixer()->StopMusic();
+    } else if (track->is_sound) {
+      core_->audio_mixer()->StopSound(track->audio_id);
+    }
+  }
+}
+
+void AnimationTracks::PauseStep(int step, const SceneNode& scene_node) {
+  if (const auto* track = GetRunScriptTrack(step)) {
+    core_->animator_manager()->Pause(track->script_id, scene_node.id());
+  }
+}
+
+void AnimationTracks::ResumeStep(int step, const SceneNode& scene_node) {
+  if (const auto* track = GetRunScriptTrack(step)) {
+    core_->animator_manager()->Resume(track->script_id, scene_node.id());
+  }
+}
+
+void AnimationTracks::Schedule(int step, NodeHandle handle,
+                               SceneNode* scene_node,
+                               int time_since_last_progress) {
+  if (handle.index >= node_rounds_.size()) {
+    node_rounds_.resize(handle.index + 1, -1);
+    node_passes_.resize(handle.index + 1, -1);
+  }
+  if (node_rounds_[handle.index] != round_) {
+    node_rounds_[handle.index] = round_;
+    core_->scene_manager()->Dirty(handle);
+  }
+
+  auto& scheduled_step = steps_[step];
+  scheduled_step.scene_node = scene_node;
+  scheduled_step.node_index = handle.index;
+  scheduled_step.scheduled_round = round_;
+  scheduled_step.progress_time = time_since_last_progress;
+  ResetTimeUntilDue(&scheduled_step);
+  scheduled_steps_.push_back(step);
+  if (scheduled_step.wait_for_all && scheduled_step.unfinished_tracks == 0) {
+    empty_steps_.push_back(step);
+  }
+}
+
+void AnimationTracks::Progress() {
+  CompactReleasedSteps();
+  finished_steps_ = 0;
+
+  // Like Animator, animations without parts that wait for all of them finish
+  // as soon as they make progress.
+  for (const int step_id : empty_steps_) {
+    auto& step = steps_[step_id];
+    if (step.scheduled_round == round_ && !step.finished) {
+      FinishStep(&step);
+    }
+  }
+  empty_steps_.clear();
+
+  ProgressTranslations();
+  ProgressNoOps(Op::ROTATION, &rotations_);
+  ProgressNoOps(Op::SCALING, &scalings_);
+  ProgressFrameRanges();
+  ProgressFrameLists();
+  ProgressFlashes();
+  ProgressGotos();
+  ProgressTimers();
+  ProgressRunScripts();
+  scheduled_steps_.clear();
+  ++round_;
+}
+
+
+void AnimationTracks::ProgressStep(int step_id, NodeHandle handle,
+                                   SceneNode* scene_node,
+                                   int time_since_last_frame) {
+  auto& step = steps_[step_id];
+  if (step.finished) return;
+
+  step.scene_node = scene_node;
+  step.node_index = handle.index;
+  ResetTimeUntilDue(&step);
+  core_->scene_manager()->Dirty(handle);
+  if (step.wait_for_all && step.unfinished_tracks == 0) {
+    FinishStep(&step);
+    return;
+  }
+
+  // Kinds are in the order of instructions, which is the order performers
+  // are progressed in. Like Animator, tracks after one that finishes a step
+  // that waits for any of them make no progress.
+  for (int kind = 0; kind < kTrackKinds && !step.finished; ++kind) {
+    const int index = step.tracks[kind];
+    if (index == -1) continue;
+
+    switch (static_cast<Op>(kind)) {
+      case Op::TRANSLATION:
+        if (!translations_[index].finished) {
+          ProgressTranslation(time_since_last_frame, index);
+        }
+        break;
+      case Op::ROTATION:
+        if (!rotations_[index].finished) {
+          ProgressNoOp(time_since_last_frame, &rotations_[index]);
+        }
+        break;
+      case Op::SCALING:
+        if (!scalings_[index].finished) {
+          ProgressNoOp(time_since_last_frame, &scalings_[index]);
+        }
+        break;
+      case Op::FRAME_RANGE:
+        if (!frame_ranges_[index].finished) {
+          ProgressFrameRange(time_since_last_frame, &frame_ranges_[index]);
+        }
+        break;
+      case Op::FRAME_LIST:
+        if (!frame_lists_[index].finished) {
+          ProgressFrameList(time_since_last_frame, &frame_lists_[index]);
+        }
+        break;
+      case Op::FLASH:
+        if (!flashes_[index].finished) {
+          ProgressFlash(time_since_last_frame, &flashes_[index]);
+        }
+        break;
+      case Op::GO_TO:
+        if (!gotos_[index].finished) {
+          ProgressGoto(time_since_last_frame, index);
+        }
+        break;
+      case Op::TIMER:
+        if (!timers_[index].finished) {
+          ProgressTimer(time_since_last_frame, &timers_[index]);
+        }
+        break;
+      case Op::RUN_SCRIPT:
+        if (!run_scripts_[index].finished) {
+          ProgressRunScript(&run_scripts_[index]);
+        }
+        break;
+      case Op::SFX:
+        break;
+    }
+  }
+}
+
+template <class Track>
+bool AnimationTracks::IsActive(const Track& track) const {
+  const auto& step = steps_[track.step];
+  return step.scheduled_round == round_ && !step.finished && !track.finished;
+}
+
+template <class Track, class Function>
+void AnimationTracks::ForEachScheduledTrack(Op op, std::vector<Track>* tracks,
+                                            Function&& function) {
+  // Going through all tracks of a kind is cheaper than looking them up from
+  // the scheduled steps, unless few of the steps are scheduled.
+  if (tracks->size() <= 2 * scheduled_steps_.size()) {
+    for (int i = 0; i < tracks->size(); ++i) {
+      if (IsActive((*tracks)[i])) function(i);
+    }
+    return;
+  }
+
+  for (const int step : scheduled_steps_) {
+    // Tracks of released steps may have been compacted away.
+    if (steps_[step].scheduled_round != round_) continue;
+
+    const int index = steps_[step].track(op);
+    if (index != -1 && IsActive((*tracks)[index])) function(index);
+  }
+}
+
+template <class Track>
+bool AnimationTracks::ReserveNode(const Track& track) {
+  int& node_pass = node_passes_[steps_[track.step].node_index];
+  if (node_pass == pass_) return false;
+
+  node_pass = pass_;
+  return true;
+}
+
+template <class Track>
+void AnimationTracks::FinishTrack(Track* track) {
+  // Like Animator, a step that waits for all tracks drops the finished ones,
+  // while any finished track finishes the other steps.
+  auto& step = steps_[track->step];
+  if (!step.wait_for_all) {
+    FinishStep(&step);
+    return;
+  }
+
+  track->finished = true;
+  if (--step.unfinished_tracks == 0) {
+    FinishStep(&step);
+  }
+}
+
+template <class Track>
+void AnimationTracks::UpdateTimeUntilDue(const Track& track, int time) {
+  if (track.finished) return;
+
+  auto& step = steps_[track.step];
+  step.time_until_due = std::min(step.time_until_due, time);
+}
+
+void AnimationTracks::ResetTimeUntilDue(Step* step) {
+  step->time_until_due = step->track(Op::SFX) != -1 ? 0 : kNotDue;
+}
+
+void AnimationTracks::FinishStep(Step* step) {
+  step->finished = true;
+  ++finished_steps_;
+}
+
+AnimationTracks::RunScriptTrack* AnimationTracks::GetRunScriptTrack(
+    int step) {
+  const int index = steps_[step].track(Op::RUN_SCRIPT);
+  if (index == -1 || run_scripts_[index].finished) return nullptr;
+  return &run_scripts_[index];
+}
+
+AnimationTracks::SfxTrack* AnimationTracks::GetSfxTrack(int step) {
+  const int index = steps_[step].track(Op::SFX);
+  if (index == -1 || sfx_[index].finished) return nullptr;
+  return &sfx_[index];
+}
+
+void AnimationTracks::StartRunScript(int step, SceneNode* scene_node) {
+  // Copied because playing the script may add tracks.
+  const auto& track = run_scripts_[steps_[step].track(Op::RUN_SCRIPT)];
+  const std::string script_id = track.script_id;
+  const auto& script =
+      track.script != nullptr
+          ? *track.script
+          : core_->resource_manager()->GetAnimationProgram(script_id);
+  core_->animator_manager()->Play(script, scene_node->id());
+
+  const int generation = steps_[step].generation;
+  core_->event_dispatcher()->Register(
+      Events::OnAnimationScriptTermination(scene_node->id(), script_id)
+          .event_id(),
+      [this, step, generation](const Event&) {
+        if (steps_[step].generation == generation) {
+          steps_[step].script_finished = true;
+        }
+      });
+}
+
+void AnimationTracks::StartSfx(int step) {
+  const auto& track = sfx_[steps_[step].track(Op::SFX)];
+  if (track.is_music) {
+    core_->audio_mixer()->PlayMusic(track.audio_id, track.repeat, []() {});
+  } else if (track.is_sound) {
+    core_->audio_mixer()->PlaySound(track.audio_id, track.repeat, []() {});
+  }
+}
+
+void AnimationTracks::AddTranslation(int index) {
+  auto& track = translations_[index];
+  batch_.Add(steps_[track.step].scene_node, track.x, track.y, track.z);
+  --track.moves;
+  if (batch_.full()) {
+    FlushTranslations();
+  }
+}
+
+void AnimationTracks::FlushTranslations() {
+  batch_.Translate();
+  batch_.Clear();
+}
+
+void AnimationTracks::ProgressTranslations() {
+  // Each track counts how many times it moves its node in this frame. The
+  // first move of each node is applied in the first pass, along with timing,
+  // and any other moves in later passes.
+  ++pass_;
+  moving_tracks_.clear();
+  ForEachScheduledTrack(Op::TRANSLATION, &translations_, [this](int i) {
+    auto& track = translations_[i];
+    track.moves = 0;
+    const bool finished = ProgressRepeatable(
+        steps_[track.step].progress_time, &track, [&track]() {
+          ++track.moves;
+          return true;
+        });
+    if (track.moves > 0 && ReserveNode(track)) {
+      AddTranslation(i);
+    }
+    if (track.moves > 0) {
+      moving_tracks_.push_back(i);
+    }
+    if (finished) {
+      FinishTrack(&track);
+    }
+    UpdateTimeUntilDue(track, track.delay - track.wait_time);
+  });
+  FlushTranslations();
+
+  while (!moving_tracks_.empty()) {
+    ++pass_;
+    int remaining = 0;
+    for (const int index : moving_tracks_) {
+      if (ReserveNode(translations_[index])) {
+        AddTranslation(index);
+      }
+      if (translations_[index].moves > 0) {
+        moving_tracks_[remaining++] = index;
+      }
+    }
+    moving_tracks_.resize(remaining);
+    FlushTranslations();
+  }
+}
+
+void AnimationTracks::ProgressTranslation(int time_since_last_frame,
+                                          int index) {
+  auto& track = translations_[index];
+  track.moves = 0;
+  const bool finished =
+      ProgressRepeatable(time_since_last_frame, &track, [&track]() {
+        ++track.moves;
+        return true;
+      });
+  // Moves are applied one at a time, like the passes above.
+  while (track.moves > 0) {
+    AddTranslation(index);
+    FlushTranslations();
+  }
+  if (finished) {
+    FinishTrack(&track);
+  }
+  UpdateTimeUntilDue(track, track.delay - track.wait_time);
+}
+
+void AnimationTracks::ProgressNoOps(Op op,
+                                    std::vector<RepeatableTrack>* tracks) {
+  ForEachScheduledTrack(op, tracks, [this, tracks](int index) {
+    auto& track = (*tracks)[index];
+    ProgressNoOp(steps_[track.step].progress_time, &track);
+  });
+}
+
+void AnimationTracks::ProgressNoOp(int time_since_last_frame,
+                                   RepeatableTrack* track) {
+  // Like their performers, rotation and scaling only count their repetitions.
+  if (ProgressRepeatable(time_since_last_frame, track,
+                         []() { return true; })) {
+    FinishTrack(track);
+  }
+  UpdateTimeUntilDue(*track, track->delay - track->wait_time);
+}
+
+void AnimationTracks::ProgressFrameRanges() {
+  ForEachScheduledTrack(Op::FRAME_RANGE, &frame_ranges_, [this](int index) {
+    auto& track = frame_ranges_[index];
+    ProgressFrameRange(steps_[track.step].progress_time, &track);
+  });
+}
+
+void AnimationTracks::ProgressFrameRange(int time_since_last_frame,
+                                         FrameRangeTrack* track) {
+  auto* scene_node = steps_[track->step].scene_node;
+  if (ProgressRepeatable(
+          time_since_last_frame, track, [this, track, scene_node]() {
+            if (track->current_frame == track->end_frame) {
+              track->current_frame = track->start_frame;
+            }
+            SetSceneNodeFrame(track->current_frame, track->vertical_align,
+                              track->horizontal_align, scene_node, core_);
+            track->current_frame += track->frame_step;
+            return track->current_frame == track->end_frame;
+          })) {
+    FinishTrack(track);
+  }
+  UpdateTimeUntilDue(*track, track->delay - track->wait_time);
+}
+
+void AnimationTracks::ProgressFrameLists() {
+  ForEachScheduledTrack(Op::FRAME_LIST, &frame_lists_, [this](int index) {
+    auto& track = frame_lists_[index];
+    ProgressFrameList(steps_[track.step].progress_time, &track);
+  });
+}
+
+void AnimationTracks::ProgressFrameList(int time_since_last_frame,
+                                        FrameListTrack* track) {
+  auto* scene_node = steps_[track->step].scene_node;
+  if (ProgressRepeatable(
+          time_since_last_frame, track, [this, track, scene_node]() {
+            if (track->current_frame_index == track->frame_count) {
+              track->current_frame_index = 0;
+            }
+            SetSceneNodeFrame(
+                frames_[track->first_frame + track->current_frame_index++],
+                track->vertical_align, track->horizontal_align, scene_node,
+                core_);
+            return track->current_frame_index == track->frame_count;
+          })) {
+    FinishTrack(track);
+  }
+  UpdateTimeUntilDue(*track, track->delay - track->wait_time);
+}
+
+void AnimationTracks::ProgressFlashes() {
+  ForEachScheduledTrack(Op::FLASH, &flashes_, [this](int index) {
+    auto& track = flashes_[index];
+    ProgressFlash(steps_[track.step].progress_time, &track);
+  });
+}
+
+void AnimationTracks::ProgressFlash(int time_since_last_frame,
+                                    FlashTrack* track) {
+  auto* scene_node = steps_[track->step].scene_node;
+  if (ProgressRepeatable(time_since_last_frame, track, [track, scene_node]() {
+        track->visible = !track->visible;
+        scene_node->set_visible(track->visible);
+        return true;
+      })) {
+    FinishTrack(track);
+  }
+  UpdateTimeUntilDue(*track, track->delay - track->wait_time);
+}
+
+void AnimationTracks::AddGoto(int index) {
+  auto& track = gotos_[index];
+  track.wait_time -= track.delay;
+  const auto& destination = track.destination;
+  batch_.Add(steps_[track.step].scene_node, destination.x(), destination.y(),
+             destination.z(), track.step_size);
+  batch_tracks_.push_back(index);
+  if (batch_.full()) {
+    FlushGotos();
+  }
+}
+
+void AnimationTracks::FlushGotos() {
+  batch_.Goto();
+  for (int i = 0; i < batch_.size(); ++i) {
+    if (!batch_.arrived(i)) continue;
+
+    auto& track = gotos_[batch_tracks_[i]];
+    track.arrived = true;
+    *steps_[track.step].scene_node->mutable_position() = track.destination;
+    FinishTrack(&track);
+  }
+  batch_.Clear();
+  batch_tracks_.clear();
+}
+
+void AnimationTracks::ProgressGotos() {
+  // Like ProgressOneOff(), each goto moves every |delay| until it arrives.
+  // The first move of each node is applied in the first pass, along with
+  // timing, and any other moves in later passes.
+  ++pass_;
+  moving_tracks_.clear();
+  ForEachScheduledTrack(Op::GO_TO, &gotos_, [this](int i) {
+    auto& track = gotos_[i];
+    track.wait_time += steps_[track.step].progress_time;
+    if (track.delay > track.wait_time) return;
+
+    if (ReserveNode(track)) {
+      AddGoto(i);
+    }
+    moving_tracks_.push_back(i);
+  });
+  FlushGotos();
+
+  const auto is_done = [this](int index) {
+    const auto& track = gotos_[index];
+    return track.arrived || track.delay > track.wait_time;
+  };
+  EraseIf(&moving_tracks_, is_done);
+
+  while (!moving_tracks_.empty()) {
+    ++pass_;
+    for (const int index : moving_tracks_) {
+      if (ReserveNode(gotos_[index])) {
+        AddGoto(index);
+      }
+    }
+    FlushGotos();
+    EraseIf(&moving_tracks_, is_done);
+  }
+
+  // Gotos that arrived finished their step, while the others are due again
+  // after the moves of all passes.
+  ForEachScheduledTrack(Op::GO_TO, &gotos_, [this](int index) {
+    const auto& track = gotos_[index];
+    UpdateTimeUntilDue(track, track.delay - track.wait_time);
+  });
+}
+
+void AnimationTracks::ProgressGoto(int time_since_last_frame, int index) {
+  auto& track = gotos_[index];
+  track.wait_time += time_since_last_frame;
+  while (!track.arrived && track.delay <= track.wait_time) {
+    AddGoto(index);
+    FlushGotos();
+  }
+  UpdateTimeUntilDue(track, track.delay - track.wait_time);
+}
+
+void AnimationTracks::ProgressTimers() {
+  ForEachScheduledTrack(Op::TIMER, &timers_, [this](int index) {
+    auto& track = timers_[index];
+    ProgressTimer(steps_[track.step].progress_time, &track);
+  });
+}
+
+void AnimationTracks::ProgressTimer(int time_since_last_frame,
+                                    TimerTrack* track) {
+  if (ProgressOneOff(time_since_last_frame, track, []() { return true; })) {
+    FinishTrack(track);
+  }
+  UpdateTimeUntilDue(*track, std::max(track->delay - track->wait_time, 0));
+}
+
+void AnimationTracks::ProgressRunScripts() {
+  ForEachScheduledTrack(Op::RUN_SCRIPT, &run_scripts_, [this](int index) {
+    ProgressRunScript(&run_scripts_[index]);
+  });
+}
+
+void AnimationTracks::ProgressRunScript(RunScriptTrack* track) {
+  // Like RunScriptPerformer, it checks every frame whether the script
+  // terminated.
+  if (steps_[track->step].script_finished) {
+    FinishTrack(track);
+  }
+  UpdateTimeUntilDue(*track, 0);
+}
+
+void AnimationTracks::CompactReleasedSteps() {
+  const int used_steps = steps_.size() - free_steps_.size();
+  if (released_steps_.empty() ||
+      2 * static_cast<int>(released_steps_.size()) < used_steps) {
+    return;
+  }
+
+  const auto is_released = [this](const auto& track) {
+    return steps_[track.step].released;
+  };
+  EraseIf(&translations_, is_released);
+  EraseIf(&rotations_, is_released);
+  EraseIf(&scalings_, is_released);
+  EraseIf(&frame_ranges_, is_released);
+  EraseIf(&frame_lists_, is_released);
+  EraseIf(&flashes_, is_released);
+  EraseIf(&gotos_, is_released);
+  EraseIf(&timers_, is_released);
+  EraseIf(&run_scripts_, is_released);
+  EraseIf(&sfx_, is_released);
+
+  // Frames of the remaining frame lists keep their order, so they are moved
+  // towards the front in place.
+  int next_frame = 0;
+  for (auto& track : frame_lists_) {
+    std::copy(frames_.begin() + track.first_frame,
+              frames_.begin() + track.first_frame + track.frame_count,
+              frames_.begin() + next_frame);
+    track.first_frame = next_frame;
+    next_frame += track.frame_count;
+  }
+  frames_.resize(next_frame);
+
+  IndexTracks(translations_, Op::TRANSLATION);
+  IndexTracks(rotations_, Op::ROTATION);
+  IndexTracks(scalings_, Op::SCALING);
+  IndexTracks(frame_ranges_, Op::FRAME_RANGE);
+  IndexTracks(frame_lists_, Op::FRAME_LIST);
+  IndexTracks(flashes_, Op::FLASH);
+  IndexTracks(gotos_, Op::GO_TO);
+  IndexTracks(timers_, Op::TIMER);
+  IndexTracks(run_scripts_, Op::RUN_SCRIPT);
+  IndexTracks(sfx_, Op::SFX);
+
+  for (const int step : released_steps_) {
+    steps_[step].released = false;
+    free_steps_.push_back(step);
+  }
+  released_steps_.clear();
+}
+
+template <class Track>
+void AnimationTracks::IndexTracks(const std::vector<Track>& tracks, Op op) {
+  for (int i = 0; i < tracks.size(); ++i) {
+    steps_[tracks[i].step].track(op) = i;
+  }
+}
+
+}  // namespace troll
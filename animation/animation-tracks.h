@@ -0,0 +1,348 @@
+#ifndef TROLL_ANIMATION_ANIMATION_TRACKS_H_
+#define TROLL_ANIMATION_ANIMATION_TRACKS_H_
+
+#include <array>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "animation/kinematics.h"
+#include "core/animation-program.h"
+#include "core/core.h"
+#include "core/node-handle.h"
+#include "proto/animation.pb.h"
+#include "proto/primitives.pb.h"
+#include "proto/scene-node.pb.h"
+
+namespace troll {
+
+// Data oriented alternative to Animator and its performers. Each animation of a
+// script that runs is a step, which is compiled into one track per part of the
+// animation. Tracks of the same kind (translation, frame range, timer, etc.)
+// are kept in a contiguous array with their parameters copied from the proto,
+// so that a frame is progressed in one tight loop per kind, instead of a
+// virtual call per performer of every script.
+//
+// Tracks behave exactly like the performers of the same kind. Scheduled steps
+// are progressed kind by kind, which is only the order of Animator when each
+// of them animates a different scene node. Steps of scene nodes that several
+// scripts animate are instead progressed one at a time with ProgressStep().
+// Only the tracks of scheduled steps are visited, so steps that wait until
+// they are due cost nothing in the frames they skip.
+//
+// Translations and gotos move their scene nodes in KinematicBatch passes. A
+// node is moved at most once per pass and its moves keep their order, so
+// nodes that are moved by several tracks, or several times in a frame, end
+// up where performers would move them.
+class AnimationTracks {
+ public:
+  AnimationTracks(Core* core) : core_(core) {}
+  ~AnimationTracks() = default;
+
+  // Compiles a step of |program| into tracks of a new step and starts them on
+  // |scene_node|. Returns the step id.
+  int StartStep(const AnimationProgram& program,
+                const AnimationProgram::Step& program_step,
+                SceneNode* scene_node);
+
+  // Drops the tracks of |step| without stopping them. The step id must not be
+  // used again.
+  void ReleaseStep(int step);
+
+  // Stops, pauses or resumes the unfinished tracks of |step|.
+  void StopStep(int step, const SceneNode& scene_node);
+  void PauseStep(int step, const SceneNode& scene_node);
+  void ResumeStep(int step, const SceneNode& scene_node);
+
+  // Marks |step| to make progress on |scene_node| by |time_since_last_progress|
+  // in the next Progress(). The scene node is marked dirty the first time one
+  // of its steps is scheduled.
+  void Schedule(int step, NodeHandle handle, SceneNode* scene_node,
+                int time_since_last_progress);
+
+  // Progresses all scheduled steps. Whether a step finished is then reported
+  // by is_finished().
+  void Progress();
+
+  // Progresses only |step| on |scene_node|, with its tracks in the order of
+  // the performers of Animator. Tracks of released steps are only removed by
+  // Progress().
+  void ProgressStep(int step, NodeHandle handle, SceneNode* scene_node,
+                    int time_since_last_frame);
+
+  // Returns true if |step| finished during a Progress().
+  bool is_finished(int step) const { return steps_[step].finished; }
+
+  // Returns the time until |step| has to make progress again, like
+  // Animator::time_until_due() for the performers of the step. Steps without
+  // tracks that make progress, or that finished and wait to be stopped, are
+  // due every frame.
+  int time_until_due(int step) const {
+    const auto& due_step = steps_[step];
+    if (due_step.finished || due_step.time_until_due == kNotDue) return 0;
+    return due_step.time_until_due;
+  }
+
+  // Number of steps that finished during the last Progress().
+  int finished_steps() const { return finished_steps_; }
+
+  AnimationTracks(const AnimationTracks&) = delete;
+  AnimationTracks& operator=(const AnimationTracks&) = delete;
+
+ private:
+  using Op = AnimationProgram::Op;
+  static constexpr int kTrackKinds = static_cast<int>(Op::SFX) + 1;
+  static constexpr int kNotDue = std::numeric_limits<int>::max();
+
+  struct Step {
+    Step() { tracks.fill(-1); }
+
+    // Scene node the step is progressed on and the index of its handle. Only
+    // valid while scheduled.
+    SceneNode* scene_node = nullptr;
+    int node_index = -1;
+
+    // The step makes progress in the Progress() call of this round, by the
+    // time it was scheduled with.
+    int scheduled_round = -1;
+    int progress_time = 0;
+
+    // Least time until one of the unfinished tracks is due, as of the last
+    // time the step started or made progress, or kNotDue.
+    int time_until_due = kNotDue;
+
+    // Incremented when the step is released, so that callbacks of released
+    // steps are ignored.
+    int generation = 0;
+
+    // Tracks that did not finish yet, for steps that wait for all of them.
+    int unfinished_tracks = 0;
+
+    bool wait_for_all = false;
+    bool finished = false;
+    bool released = false;
+
+    // Index of the track of each kind of the step or -1. A step has at most
+    // one track of each kind.
+    std::array<int, kTrackKinds> tracks;
+    int& track(Op op) { return tracks[static_cast<int>(op)]; }
+
+    // Set when the script of the run script track terminates.
+    bool script_finished = false;
+  };
+
+  // Every track refers to its step and is finished when it is removed from a
+  // step that waits for all tracks. Finished tracks no longer make progress
+  // and are not stopped, like performers that Animator removes.
+
+  // Common state of tracks that are repeatable and have a delay.
+  struct RepeatableTrack {
+    int step;
+    bool finished = false;
+
+    int delay;
+    int repeat;
+    int wait_time = 0;
+    int run_number = 0;
+  };
+
+  struct VectorTrack : RepeatableTrack {
+    double x;
+    double y;
+    double z;
+
+    // Times the vector is still added to the node in this frame.
+    int moves = 0;
+  };
+
+  struct FrameRangeTrack : RepeatableTrack {
+    int start_frame;
+    int end_frame;
+    VerticalAlign vertical_align;
+    HorizontalAlign horizontal_align;
+
+    int current_frame = 0;
+    int frame_step = 0;
+  };
+
+  struct FrameListTrack : RepeatableTrack {
+    // Frames of the track are frames_[first_frame, first_frame + frame_count).
+    int first_frame;
+    int frame_count;
+    VerticalAlign vertical_align;
+    HorizontalAlign horizontal_align;
+
+    int current_frame_index = 0;
+  };
+
+  struct FlashTrack : RepeatableTrack {
+    bool visible = true;
+  };
+
+  struct GotoTrack {
+    int step;
+    bool finished = false;
+
+    int delay;
+    int wait_time = 0;
+    double step_size;
+    Vector destination;
+
+    // Set when the node reaches the destination.
+    bool arrived = false;
+  };
+
+  struct TimerTrack {
+    int step;
+    bool finished = false;
+
+    int delay;
+    int wait_time = 0;
+  };
+
+  struct RunScriptTrack {
+    int step;
+    bool finished = false;
+
+    std::string script_id;
+    // Program of the script if it was resolved when compiled.
+    const AnimationProgram* script;
+  };
+
+  // Like SfxPerformer, sfx tracks never finish on their own.
+  struct SfxTrack {
+    int step;
+    bool finished = false;
+
+    // Audio is either a music track, a sound effect or none.
+    std::string audio_id;
+    bool is_music = false;
+    bool is_sound = false;
+    int repeat;
+  };
+
+  // Returns true if the track should make progress this frame.
+  template <class Track>
+  bool IsActive(const Track& track) const;
+
+  // Records that |track| finished this frame.
+  template <class Track>
+  void FinishTrack(Track* track);
+
+  // Records that an unfinished |track| is due again in |time|.
+  template <class Track>
+  void UpdateTimeUntilDue(const Track& track, int time);
+
+  // Resets the time until |step| is due before it makes progress. Sfx tracks
+  // do not make progress but are due every frame, like SfxPerformer.
+  void ResetTimeUntilDue(Step* step);
+
+  void FinishStep(Step* step);
+
+  // Returns the unfinished run script or sfx track of |step| or null.
+  RunScriptTrack* GetRunScriptTrack(int step);
+  SfxTrack* GetSfxTrack(int step);
+
+  void StartRunScript(int step, SceneNode* scene_node);
+  void StartSfx(int step);
+
+  // Returns true if the node of |track| was not moved in the current pass and
+  // reserves it for the track.
+  template <class Track>
+  bool ReserveNode(const Track& track);
+
+  // Adds a move of the track at |index| to the kinematic batch, which is
+  // applied when it is full or flushed.
+  void AddTranslation(int index);
+  void AddGoto(int index);
+  void FlushTranslations();
+  void FlushGotos();
+
+  // Progress the tracks of |op| of the scheduled steps, each by the time of
+  // its step.
+  void ProgressTranslations();
+  void ProgressNoOps(Op op, std::vector<RepeatableTrack>* tracks);
+  void ProgressFrameRanges();
+  void ProgressFrameLists();
+  void ProgressFlashes();
+  void ProgressGotos();
+  void ProgressTimers();
+  void ProgressRunScripts();
+
+  // Calls |function| with the index of each track in |tracks|, which are the
+  // tracks of |op|, that makes progress in this round.
+  template <class Track, class Function>
+  void ForEachScheduledTrack(Op op, std::vector<Track>* tracks,
+                             Function&& function);
+
+  // Progress a single track, for both progressing all tracks of a kind and
+  // progressing a step on its own.
+  void ProgressNoOp(int time_since_last_frame, RepeatableTrack* track);
+  void ProgressFrameRange(int time_since_last_frame, FrameRangeTrack* track);
+  void ProgressFrameList(int time_since_last_frame, FrameListTrack* track);
+  void ProgressFlash(int time_since_last_frame, FlashTrack* track);
+  void ProgressTimer(int time_since_last_frame, TimerTrack* track);
+  void ProgressRunScript(RunScriptTrack* track);
+
+  // Progress the translation or goto track at |index| on its own, without
+  // batching it with the moves of other tracks.
+  void ProgressTranslation(int time_since_last_frame, int index);
+  void ProgressGoto(int time_since_last_frame, int index);
+
+  // Removes tracks of released steps and makes their ids available again, once
+  // there are as many released steps as steps in use, so that steps which
+  // are released every frame do not copy all tracks every frame.
+  void CompactReleasedSteps();
+
+  // Updates the track indices of steps to the tracks of |op|.
+  template <class Track>
+  void IndexTracks(const std::vector<Track>& tracks, Op op);
+
+  Core* core_;
+
+  std::vector<Step> steps_;
+  std::vector<int> free_steps_;
+  std::vector<int> released_steps_;
+  // Scheduled steps that wait for all of their tracks but have none.
+  std::vector<int> empty_steps_;
+
+  // Steps scheduled for the next Progress().
+  std::vector<int> scheduled_steps_;
+
+  // Incremented by every Progress() call.
+  int round_ = 0;
+
+  // Kinematic passes move each node at most once. Incremented by every pass.
+  int pass_ = 0;
+
+  // Indexed by node handle index, the round that last scheduled each node and
+  // the pass that last moved it.
+  std::vector<int> node_rounds_;
+  std::vector<int> node_passes_;
+
+  KinematicBatch batch_;
+  // Tracks of the moves in batch_.
+  std::vector<int> batch_tracks_;
+  // Tracks with moves left in this frame, in track order.
+  std::vector<int> moving_tracks_;
+  int finished_steps_ = 0;
+
+  // Tracks by kind, in the order performers are progressed by Animator.
+  std::vector<VectorTrack> translations_;
+  std::vector<RepeatableTrack> rotations_;
+  std::vector<RepeatableTrack> scalings_;
+  std::vector<FrameRangeTrack> frame_ranges_;
+  std::vector<FrameListTrack> frame_lists_;
+  std::vector<FlashTrack> flashes_;
+  std::vector<GotoTrack> gotos_;
+  std::vector<TimerTrack> timers_;
+  std::vector<RunScriptTrack> run_scripts_;
+  std::vector<SfxTrack> sfx_;
+
+  // Frames of all frame list tracks.
+  std::vector<int> frames_;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_ANIMATION_ANIMATION_TRACKS_H_
@@ -0,0 +1,474 @@
+#include "animation/animation-tracks.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <string>
+#include <vector>
+
+#include "animation/animator-manager.h"
+#include "core/collision-checker.h"
+#include "core/event-dispatcher.h"
+#include "core/events.h"
+#include "core/scene-manager.h"
+#include "proto/animation.pb.h"
+#include "proto/scene-node.pb.h"
+#include "troll-test/test-core.h"
+#include "troll-test/test-util.h"
+#include "troll-test/testing-resource-manager.h"
+
+namespace troll {
+
+// Scene with a single node, whose animation scripts run on |backend|.
+class AnimationWorld {
+ public:
+  AnimationWorld(AnimationBackend backend)
+      : animator_manager_(&core_, backend) {
+    testing_resource_manager_.SetTestSprite(ParseProto<Sprite>(R"(
+        id: 'sprite_a'
+        film { width: 10  height: 10 }
+        film { width: 20  height: 16 }
+        film { width: 30  height: 12 }
+        film { width: 40  height: 24 })"));
+    testing_resource_manager_.SetTestAnimationScript(
+        ParseProto<AnimationScript>(R"(
+            id: 'script_b'
+            animation {
+              translation {
+                vec { y: 2 }
+                delay: 20
+                repeat: 3
+              }
+            })"));
+
+    core_.set_resource_manager(&resource_manager_);
+    core_.set_scene_manager(&scene_manager_);
+    core_.set_collision_checker(&collision_checker_);
+    core_.set_event_dispatcher(&event_dispatcher_);
+    core_.set_animator_manager(&animator_manager_);
+
+    scene_manager_.AddSceneNode(
+        ParseProto<SceneNode>("id: 'node_a' sprite_id: 'sprite_a'"));
+  }
+
+  // Plays |scripts| on the node, progresses a frame for each of |frame_times|
+  // and returns the state of the node and the number of events after each
+  // frame. If |replay| is set, the scripts are played again every frame.
+  std::vector<std::string> Run(const std::vector<AnimationScript>& scripts,
+                               const std::vector<int>& frame_times,
+                               bool replay = false) {
+    std::vector<std::string> trace;
+    for (const auto& script : scripts) {
+      event_dispatcher_.RegisterPermanent(
+          Events::OnAnimationScriptTermination("node_a", script.id())
+              .event_id(),
+          [&trace, &script](const Event&) {
+            trace.push_back(script.id() + " terminated");
+          });
+      animator_manager_.Play(script, "node_a");
+    }
+
+    for (const int time : frame_times) {
+      animator_manager_.Progress(time);
+      event_dispatcher_.ProcessTriggeredEvents();
+      trace.push_back(scene_manager_.GetSceneNodeById("node_a")->DebugString());
+      trace.push_back(std::to_string(event_dispatcher_.events_fired()));
+
+      if (replay) {
+        for (const auto& script : scripts) {
+          animator_manager_.Play(script, "node_a");
+        }
+      }
+    }
+    return trace;
+  }
+
+ private:
+  TestCore core_;
+  ResourceManager resource_manager_;
+  SceneManager scene_manager_ =
+      SceneManager(&resource_manager_, nullptr, &core_);
+  CollisionChecker collision_checker_ =
+      CollisionChecker(&scene_manager_, nullptr, &core_);
+  EventDispatcher event_dispatcher_;
+  AnimatorManager animator_manager_;
+
+  TestingResourceManager testing_resource_manager_ =
+      TestingResourceManager(&resource_manager_);
+};
+
+// Returns the traces of running |script_texts| together on the same node with
+// performers and with tracks.
+std::pair<std::vector<std::string>, std::vector<std::string>> RunTogether(
+    const std::vector<std::string>& script_texts, bool replay = false) {
+  std::vector<AnimationScript> scripts;
+  for (const auto& script_text : script_texts) {
+    scripts.push_back(ParseProto<AnimationScript>(script_text));
+  }
+  const std::vector<int> frame_times = {0,  7,  10, 16, 33, 5,   100,
+                                        16, 16, 16, 4,  250, 16, 16};
+  return {AnimationWorld(AnimationBackend::PERFORMERS)
+              .Run(scripts, frame_times, replay),
+          AnimationWorld(AnimationBackend::TRACKS)
+              .Run(scripts, frame_times, replay)};
+}
+
+std::pair<std::vector<std::string>, std::vector<std::string>> RunBoth(
+    const std::string& script_text, bool replay = false) {
+  return RunTogether({script_text}, replay);
+}
+
+SCENARIO("Tracks animate like performers", "[animation_tracks]") {
+  GIVEN("repeatable animations") {
+    WHEN("a translation runs with a delay") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            translation {
+              vec { x: 1  y: -2 }
+              delay: 10
+              repeat: 12
+            }
+          })");
+      THEN("the node moves the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("a translation runs without delay") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation { translation { vec { x: 3 } } })");
+      THEN("the node moves the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("a frame range runs with alignments") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            frame_range {
+              start_frame: 1
+              end_frame: 4
+              delay: 10
+              repeat: 3
+              vertical_align: BOTTOM
+              horizontal_align: RIGHT
+            }
+          })");
+      THEN("the node frames change the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("a frame range runs in descending order") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            frame_range {
+              start_frame: 3
+              end_frame: 0
+              delay: 20
+              vertical_align: VCENTRE
+              horizontal_align: HCENTRE
+            }
+          })");
+      THEN("the node frames change the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("a frame list runs") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            frame_list {
+              frame: [ 2, 0, 3, 1 ]
+              delay: 15
+              repeat: 2
+              vertical_align: BOTTOM
+              horizontal_align: HCENTRE
+            }
+          })");
+      THEN("the node frames change the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("a flash runs") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            flash {
+              delay: 10
+              repeat: 5
+            }
+          })");
+      THEN("the node flashes the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("rotation and scaling run") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            rotation {
+              vec { x: 1 }
+              delay: 10
+              repeat: 3
+            }
+          }
+          animation {
+            id: 'scaled'
+            scaling {
+              vec { x: 1 }
+              delay: 20
+              repeat: 2
+            }
+          })");
+      THEN("they finish the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+  }
+
+  GIVEN("one-off animations") {
+    WHEN("a goto runs") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            go_to {
+              destination { x: 50  y: 20 }
+              step: 7
+              delay: 10
+            }
+          })");
+      THEN("the node moves the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("timers run between other animations") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            id: 'wait'
+            timer { delay: 30 }
+          }
+          animation {
+            id: 'move'
+            translation {
+              vec { x: 1 }
+              delay: 10
+              repeat: 2
+            }
+          }
+          repeat: 3)");
+      THEN("the script progresses the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+  }
+
+  GIVEN("composite animations") {
+    WHEN("any part finishes the animation") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            termination: ANY
+            translation {
+              vec { x: 1 }
+              delay: 10
+            }
+            frame_list {
+              frame: [ 0, 1, 2 ]
+              delay: 10
+              repeat: 2
+            }
+            timer { delay: 500 }
+          }
+          animation { flash { delay: 5 } })");
+      THEN("the parts run the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("all parts need to finish the animation") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            id: 'all'
+            termination: ALL
+            translation {
+              vec { x: 1 }
+              delay: 10
+              repeat: 2
+            }
+            frame_range {
+              start_frame: 0
+              end_frame: 3
+              delay: 25
+              repeat: 1
+            }
+            timer { delay: 60 }
+          }
+          animation { translation { vec { y: 1 } } }
+          repeat: 2)");
+      THEN("the parts run the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("an animation has no parts and waits for all of them") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation { termination: ALL }
+          animation { translation { vec { x: 1 } repeat: 1 } })");
+      THEN("it finishes the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+  }
+
+  GIVEN("animations that run other scripts") {
+    WHEN("a script runs another one") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            translation {
+              vec { x: 1 }
+              delay: 10
+              repeat: 1
+            }
+          }
+          animation {
+            termination: ALL
+            run_script { script_id: 'script_b' }
+            timer { delay: 10 }
+          }
+          animation { translation { vec { x: 5 } repeat: 1 } })");
+      THEN("both scripts run the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+  }
+
+  GIVEN("short scripts that are played every frame") {
+    WHEN("they start and finish while others run") {
+      const auto traces = RunBoth(R"(
+          id: 'script_a'
+          animation {
+            id: 'first'
+            translation {
+              vec { x: 1 }
+              repeat: 1
+            }
+          }
+          animation {
+            translation {
+              vec { y: 1 }
+              delay: 20
+              repeat: 2
+            }
+            frame_list {
+              frame: [ 1, 2 ]
+              delay: 20
+            }
+          })",
+                                  true);
+      THEN("all of them run the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+  }
+
+  GIVEN("several scripts that animate the same node") {
+    WHEN("a goto runs with a translation of another script") {
+      const auto traces = RunTogether({R"(
+          id: 'script_a'
+          animation {
+            go_to {
+              destination { x: 50  y: 20 }
+              step: 7
+              delay: 10
+            }
+          })",
+                                       R"(
+          id: 'script_c'
+          animation {
+            translation {
+              vec { x: -2  y: 3 }
+              delay: 10
+              repeat: 20
+            }
+          })"});
+      THEN("the node moves the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("frames are set by both scripts") {
+      const auto traces = RunTogether({R"(
+          id: 'script_a'
+          animation {
+            frame_list {
+              frame: [ 2, 0, 3 ]
+              delay: 10
+              repeat: 2
+              vertical_align: BOTTOM
+            }
+          })",
+                                       R"(
+          id: 'script_c'
+          animation {
+            frame_range {
+              start_frame: 0
+              end_frame: 3
+              delay: 10
+              repeat: 3
+              horizontal_align: RIGHT
+            }
+          })"});
+      THEN("the node ends with the same frames") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+
+    WHEN("a script starts its next animation while another one runs") {
+      const auto traces = RunTogether({R"(
+          id: 'script_a'
+          animation {
+            id: 'wait'
+            timer { delay: 20 }
+          }
+          animation {
+            frame_list {
+              frame: [ 3 ]
+              vertical_align: VCENTRE
+            }
+          }
+          repeat: 4)",
+                                       R"(
+          id: 'script_c'
+          animation {
+            frame_list {
+              frame: [ 1, 2 ]
+              delay: 10
+              horizontal_align: HCENTRE
+            }
+            go_to {
+              destination { x: -30  y: 10 }
+              step: 3
+              delay: 5
+            }
+          })"});
+      THEN("the node is animated the same") {
+        REQUIRE(traces.first == traces.second);
+      }
+    }
+  }
+}
+
+}  // namespace troll
@@ -2,77 +2,210 @@
 
 #include <algorithm>
 
-#include <range/v3/view/filter.hpp>
-#include <range/v3/view/transform.hpp>
-
 #include "core/event-dispatcher.h"
 #include "core/events.h"
+#include "core/resource-manager.h"
+#include "core/scene-manager.h"
 
 namespace troll {
 
-namespace {
-// Returns lambda that returns true if input script matches script id and
-// scene node ids of this function.
-auto MatchScriptSceneNode(const std::string& script_id,
-                          const std::string& scene_node_id) {
-  return [&](const std::unique_ptr<ScriptAnimator>& script) {
-    return script->script_id() == script_id &&
-           script->scene_node_id() == scene_node_id;
-  };
+void AnimatorManager::Play(const AnimationScript& script,
+                           const std::string& scene_node_id) {
+  Play(core_->resource_manager()->CompileAnimationScript(script),
+       scene_node_id);
 }
 
-// Returns lambda that returns true if input script matches scene node id of
-// this function.
-auto MatchSceneNode(const std::string& scene_node_id) {
-  return [&](const std::unique_ptr<ScriptAnimator>& script) {
-    return script->scene_node_id() == scene_node_id;
-  };
+void AnimatorManager::Play(const AnimationScript& script,
+                           NodeHandle scene_node) {
+  Play(core_->resource_manager()->CompileAnimationScript(script), scene_node);
 }
-}  // namespace
 
-void AnimatorManager::Play(const AnimationScript& script,
+void AnimatorManager::Play(const AnimationProgram& script,
                            const std::string& scene_node_id) {
-  running_scripts_.push_back(
-      std::make_unique<ScriptAnimator>(script, scene_node_id, core_));
-  running_scripts_.back()->Start();
+  StartScript(script, scene_node_id);
 }
 
-void AnimatorManager::Stop(const std::string& script_id,
-                           const std::string& scene_node_id) const {
-  for (const auto& script :
-       running_scripts_ | ranges::view::filter(
-                              MatchScriptSceneNode(script_id, scene_node_id))) {
-    script->Stop();
+void AnimatorManager::Play(const AnimationProgram& script,
+                           NodeHandle scene_node) {
+  StartScript(script, scene_node);
+}
+
+template <class SceneNodeRef>
+void AnimatorManager::StartScript(const AnimationProgram& script,
+                                  SceneNodeRef scene_node) {
+  // Programs are retained until their scripts are freed, so that inline ones
+  // are not evicted while they run.
+  script.Retain();
+  if (free_scripts_.empty()) {
+    running_scripts_.push_back(std::make_unique<ScriptAnimator>(
+        script, scene_node, core_, &performer_pool_, tracks_.get()));
+  } else {
+    running_scripts_.push_back(std::move(free_scripts_.back()));
+    free_scripts_.pop_back();
+    running_scripts_.back()->Reset(script, scene_node);
+  }
+
+  // Scripts that are played while starting this one run after it.
+  auto* started_script = running_scripts_.back().get();
+  *started_script->timing() = {};
+  started_script->timing()->sequence = next_sequence_++;
+  LinkNodeScript(started_script);
+  started_script->Start();
+
+  if (started_script->is_finished()) {
+    has_finished_scripts_ = true;
+  } else {
+    started_script->timing()->progressed_until = start_time();
+    WakeScript(started_script);
   }
 }
 
-void AnimatorManager::Pause(const std::string& script_id,
-                            const std::string& scene_node_id) const {
-  for (const auto& script :
-       running_scripts_ | ranges::view::filter(
-                              MatchScriptSceneNode(script_id, scene_node_id))) {
-    script->Pause();
+void AnimatorManager::LinkNodeScript(ScriptAnimator* script) {
+  const auto scene_node = script->scene_node();
+  if (!scene_node.valid()) return;
+
+  if (scene_node.index >= node_scripts_.size()) {
+    node_scripts_.resize(scene_node.index + 1);
+  }
+  auto& node_scripts = node_scripts_[scene_node.index];
+  *script->node_link() = {node_scripts.last, nullptr};
+  if (node_scripts.last != nullptr) {
+    node_scripts.last->node_link()->next = script;
+  } else {
+    node_scripts.first = script;
   }
+  node_scripts.last = script;
 }
 
-void AnimatorManager::Resume(const std::string& script_id,
-                             const std::string& scene_node_id) const {
-  for (const auto& script :
-       running_scripts_ | ranges::view::filter(
-                              MatchScriptSceneNode(script_id, scene_node_id))) {
-    script->Resume();
+void AnimatorManager::UnlinkNodeScript(ScriptAnimator* script) {
+  const auto scene_node = script->scene_node();
+  if (!scene_node.valid()) return;
+
+  auto& node_scripts = node_scripts_[scene_node.index];
+  auto* link = script->node_link();
+  if (link->prev != nullptr) {
+    link->prev->node_link()->next = link->next;
+  } else {
+    node_scripts.first = link->next;
+  }
+  if (link->next != nullptr) {
+    link->next->node_link()->prev = link->prev;
+  } else {
+    node_scripts.last = link->prev;
+  }
+  *link = {};
+}
+
+template <class Function>
+void AnimatorManager::ForEachNodeScript(NodeHandle scene_node,
+                                        Function function) {
+  if (!scene_node.valid() || scene_node.index >= node_scripts_.size()) return;
+
+  for (auto* script = node_scripts_[scene_node.index].first; script != nullptr;
+       script = script->node_link()->next) {
+    if (script->scene_node() == scene_node) function(script);
+  }
+}
+
+void AnimatorManager::StopScript(ScriptAnimator* script) {
+  script->Stop();
+  UnscheduleScript(script);
+  has_finished_scripts_ = true;
+}
+
+void AnimatorManager::PauseScript(ScriptAnimator* script) {
+  const bool was_running = script->is_running();
+  script->Pause();
+  UnscheduleScript(script);
+  if (script->is_finished()) {
+    has_finished_scripts_ = true;
+  } else if (was_running) {
+    // Scripts that already made progress in the frame that is progressing
+    // are paused after it.
+    auto* timing = script->timing();
+    timing->paused_at = std::max(start_time(), timing->progressed_until);
   }
 }
 
-void AnimatorManager::StopNodeAnimations(
-    const std::string& scene_node_id) const {
-  for (const auto& script :
-       running_scripts_ | ranges::view::filter(MatchSceneNode(scene_node_id))) {
-    script->Stop();
+void AnimatorManager::ResumeScript(ScriptAnimator* script) {
+  const bool was_paused = script->is_paused();
+  script->Resume();
+  if (script->is_finished()) {
+    UnscheduleScript(script);
+    has_finished_scripts_ = true;
+    return;
+  }
+
+  // Time that passed while the script was paused is skipped.
+  auto* timing = script->timing();
+  if (was_paused) {
+    const int64_t resumed_at = std::max(start_time(), timing->paused_at);
+    timing->progressed_until += resumed_at - timing->paused_at;
+  }
+  if (timing->ticket == 0) {
+    WakeScript(script);
   }
 }
 
-void AnimatorManager::StopAll() { running_scripts_.clear(); }
+void AnimatorManager::Stop(const std::string& script_id,
+                           const std::string& scene_node_id) {
+  Stop(script_id, core_->scene_manager()->GetSceneNodeHandle(scene_node_id));
+}
+
+void AnimatorManager::Stop(const std::string& script_id,
+                           NodeHandle scene_node) {
+  ForEachNodeScript(scene_node, [this, &script_id](ScriptAnimator* script) {
+    if (script->script_id() == script_id) StopScript(script);
+  });
+}
+
+void AnimatorManager::Pause(const std::string& script_id,
+                            const std::string& scene_node_id) {
+  Pause(script_id, core_->scene_manager()->GetSceneNodeHandle(scene_node_id));
+}
+
+void AnimatorManager::Pause(const std::string& script_id,
+                            NodeHandle scene_node) {
+  ForEachNodeScript(scene_node, [this, &script_id](ScriptAnimator* script) {
+    if (script->script_id() == script_id) PauseScript(script);
+  });
+}
+
+void AnimatorManager::Resume(const std::string& script_id,
+                             const std::string& scene_node_id) {
+  Resume(script_id, core_->scene_manager()->GetSceneNodeHandle(scene_node_id));
+}
+
+void AnimatorManager::Resume(const std::string& script_id,
+                             NodeHandle scene_node) {
+  ForEachNodeScript(scene_node, [this, &script_id](ScriptAnimator* script) {
+    if (script->script_id() == script_id) ResumeScript(script);
+  });
+}
+
+void AnimatorManager::StopNodeAnimations(const std::string& scene_node_id) {
+  StopNodeAnimations(
+      core_->scene_manager()->GetSceneNodeHandle(scene_node_id));
+}
+
+void AnimatorManager::StopNodeAnimations(NodeHandle scene_node) {
+  ForEachNodeScript(scene_node,
+                    [this](ScriptAnimator* script) { StopScript(script); });
+}
+
+void AnimatorManager::StopAll() {
+  for (auto& script : running_scripts_) {
+    script->program().Release();
+    *script->timing() = {};
+    *script->node_link() = {};
+    free_scripts_.push_back(std::move(script));
+  }
+  running_scripts_.clear();
+  node_scripts_.clear();
+  timers_.Clear();
+  frame_scripts_.clear();
+  due_scripts_.clear();
+}
 
 void AnimatorManager::PauseAll() { paused_ = true; }
 
@@ -81,24 +214,200 @@ void AnimatorManager::ResumeAll() { paused_ = false; }
 void AnimatorManager::Progress(int time_since_last_frame) {
   if (paused_) return;
 
-  // Use index based iteration because new scripts might be added during
-  // iteration as side effects.
+  ProgressScripts(time_since_last_frame);
+
+  // Clean up finished scripts and fire events. Finished scripts are kept for
+  // reuse and running ones keep their order.
+  if (!has_finished_scripts_) return;
+  has_finished_scripts_ = false;
+
+  int running = 0;
   for (int i = 0; i < running_scripts_.size(); ++i) {
-    running_scripts_[i]->Progress(time_since_last_frame);
-  }
-
-  // Clean up finished scripts and fire events.
-  std::vector<std::string> events;
-  const auto it = std::remove_if(
-      running_scripts_.begin(), running_scripts_.end(),
-      [this, &events](auto&& script) {
-        if (script->is_finished()) {
-          core_->event_dispatcher()->Emit(Events::OnAnimationScriptTermination(
-              script->scene_node_id(), script->script_id()));
-        }
-        return script->is_finished();
-      });
-  running_scripts_.erase(it, running_scripts_.end());
+    auto& script = running_scripts_[i];
+    if (script->is_finished()) {
+      core_->event_dispatcher()->Emit(Events::OnAnimationScriptTermination(
+          script->scene_node_id(), script->script_id()));
+      UnscheduleScript(script.get());
+      UnlinkNodeScript(script.get());
+      script->program().Release();
+      free_scripts_.push_back(std::move(script));
+    } else {
+      if (running != i) running_scripts_[running] = std::move(script);
+      ++running;
+    }
+  }
+  running_scripts_.resize(running);
+}
+
+void AnimatorManager::ProgressScripts(int time_since_last_frame) {
+  frame_start_ = timers_.now();
+  progressing_ = true;
+  last_frame_time_ = time_since_last_frame;
+  timers_.Advance(frame_start_ + time_since_last_frame, &due_scripts_);
+
+  const int64_t now = timers_.now();
+  int waiting = 0;
+  for (const auto& frame_script : frame_scripts_) {
+    if (frame_script.time <= now) {
+      due_scripts_.push_back(frame_script);
+    } else {
+      frame_scripts_[waiting++] = frame_script;
+    }
+  }
+  frame_scripts_.resize(waiting);
+
+  // Scripts that start or resume while progressing and are due in this frame
+  // make progress in another round, after the scripts of the current one.
+  while (!due_scripts_.empty()) {
+    // Scripts that are due every frame, or after the same delay, are usually
+    // due in the order they are played in already.
+    round_scripts_.swap(due_scripts_);
+    const auto by_sequence = [](const DueScript& a, const DueScript& b) {
+      return a.sequence < b.sequence;
+    };
+    if (!std::is_sorted(round_scripts_.begin(), round_scripts_.end(),
+                        by_sequence)) {
+      std::sort(round_scripts_.begin(), round_scripts_.end(), by_sequence);
+    }
+
+    if (tracks_ != nullptr) {
+      ProgressTracks(now);
+    } else {
+      ProgressPerformers(now);
+    }
+    round_scripts_.clear();
+  }
+  progressing_ = false;
+}
+
+void AnimatorManager::ProgressTracks(int64_t now) {
+  // Scripts of scene nodes that other scripts animate too are progressed on
+  // their own and in order, as progressing tracks kind by kind would reorder
+  // the changes of their node.
+  int scheduled = 0;
+  for (const auto& due_script : round_scripts_) {
+    if (!TakeDueScript(due_script)) continue;
+
+    auto* script = due_script.script;
+    auto* timing = script->timing();
+    const auto* node_link = script->node_link();
+    timing->progress_alone =
+        node_link->prev != nullptr || node_link->next != nullptr;
+    if (!timing->progress_alone) {
+      script->ScheduleProgress(now - timing->progressed_until);
+      timing->progressed_until = now;
+    }
+    round_scripts_[scheduled++] = due_script;
+  }
+  round_scripts_.resize(scheduled);
+
+  tracks_->Progress();
+  const bool finished_steps = tracks_->finished_steps() > 0;
+  for (const auto& due_script : round_scripts_) {
+    auto* script = due_script.script;
+    auto* timing = script->timing();
+    if (timing->progress_alone) {
+      const int elapsed = now - timing->progressed_until;
+      timing->progressed_until = now;
+      script->Progress(elapsed);
+    } else if (finished_steps) {
+      script->CompleteProgress();
+    }
+    RescheduleScript(script);
+  }
+}
+
+void AnimatorManager::ProgressPerformers(int64_t now) {
+  for (const auto& due_script : round_scripts_) {
+    if (!TakeDueScript(due_script)) continue;
+
+    auto* script = due_script.script;
+    auto* timing = script->timing();
+    const int elapsed = now - timing->progressed_until;
+    timing->progressed_until = now;
+
+    // A node must appear at most once in a batch, so only scripts that are
+    // alone on their node are batched. Other scripts complete the batch
+    // first, so that scripts still complete in the order they are due.
+    const auto* node_link = script->node_link();
+    if (node_link->prev == nullptr && node_link->next == nullptr &&
+        script->BatchProgress(elapsed, &kinematics_)) {
+      batched_scripts_.push_back(script);
+      if (kinematics_.full()) CompleteBatchedScripts();
+      continue;
+    }
+
+    CompleteBatchedScripts();
+    script->Progress(elapsed);
+    RescheduleScript(script);
+  }
+  CompleteBatchedScripts();
+}
+
+void AnimatorManager::CompleteBatchedScripts() {
+  if (batched_scripts_.empty()) return;
+
+  kinematics_.translations.Translate();
+  kinematics_.gotos.Goto();
+  for (auto* script : batched_scripts_) {
+    script->CompleteBatchProgress(kinematics_);
+    RescheduleScript(script);
+  }
+  kinematics_.Clear();
+  batched_scripts_.clear();
+}
+
+bool AnimatorManager::TakeDueScript(const DueScript& due_script) {
+  auto* timing = due_script.script->timing();
+  if (timing->ticket != due_script.ticket) return false;
+
+  timing->ticket = 0;
+  timing->timer = -1;
+  return due_script.script->is_running();
+}
+
+void AnimatorManager::RescheduleScript(ScriptAnimator* script) {
+  if (script->is_running()) {
+    // Scripts that were resumed while progressing are scheduled already.
+    if (script->timing()->ticket == 0) ScheduleScript(script);
+  } else if (script->is_finished()) {
+    has_finished_scripts_ = true;
+  }
+}
+
+void AnimatorManager::ScheduleScript(ScriptAnimator* script) {
+  auto* timing = script->timing();
+  timing->ticket = next_ticket_++;
+  const int time_until_due = script->time_until_due();
+  const DueScript due_script = {timing->sequence, timing->ticket,
+                                timing->progressed_until + time_until_due,
+                                script};
+  if (time_until_due <= last_frame_time_) {
+    frame_scripts_.push_back(due_script);
+  } else {
+    timing->timer = timers_.Schedule(due_script.time, due_script);
+  }
+}
+
+void AnimatorManager::WakeScript(ScriptAnimator* script) {
+  auto* timing = script->timing();
+  if (progressing_ && timing->progressed_until + script->time_until_due() <=
+                          timers_.now()) {
+    timing->ticket = next_ticket_++;
+    due_scripts_.push_back(
+        {timing->sequence, timing->ticket, timing->progressed_until, script});
+  } else {
+    ScheduleScript(script);
+  }
+}
+
+void AnimatorManager::UnscheduleScript(ScriptAnimator* script) {
+  auto* timing = script->timing();
+  if (timing->timer != -1) {
+    timers_.Cancel(timing->timer);
+    timing->timer = -1;
+  }
+  timing->ticket = 0;
 }
 
 }  // namespace troll
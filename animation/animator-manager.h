@@ -1,31 +1,69 @@
 #ifndef TROLL_ANIMATION_ANIMATOR_MANAGER_H_
 #define TROLL_ANIMATION_ANIMATOR_MANAGER_H_
 
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 
+#include "animation/animation-tracks.h"
+#include "animation/kinematics.h"
+#include "animation/performer-pool.h"
 #include "animation/script-animator.h"
+#include "animation/timer-wheel.h"
+#include "core/animation-program.h"
 #include "core/core.h"
+#include "core/node-handle.h"
 #include "proto/animation.pb.h"
 #include "proto/scene.pb.h"
 
 namespace troll {
 
+// Implementation that runs the animations of scripts. Both animate scene nodes
+// the same way.
+enum class AnimationBackend {
+  // Each animation runs on an Animator with a Performer per part. Animations
+  // that only translate or walk a node that no other script animates are
+  // moved in SIMD batches. It suits scenes whose scripts are mostly idle, or
+  // that animate many nodes with more than one script each.
+  PERFORMERS,
+  // Animations of all scripts are compiled into AnimationTracks, which move
+  // nodes in SIMD batches even when animations have other parts too. It
+  // suits scenes of a few hundred to a few thousand nodes that translate or
+  // walk every frame, each animated by a single script. With tens of
+  // thousands of nodes, the tracks no longer fit in the cache and it is
+  // slower than PERFORMERS.
+  TRACKS,
+};
+
+// Scripts make progress only when they are due, see
+// ScriptAnimator::time_until_due(). Until then they wait on a timer wheel and
+// the time of the frames they skip is passed to them at once, so that a frame
+// costs as much as the scripts that are due in it.
 class AnimatorManager {
  public:
-  AnimatorManager(Core* core) : core_(core) {}
+  AnimatorManager(Core* core,
+                  AnimationBackend backend = AnimationBackend::PERFORMERS)
+      : core_(core),
+        tracks_(backend == AnimationBackend::TRACKS
+                    ? std::make_unique<AnimationTracks>(core)
+                    : nullptr) {}
   ~AnimatorManager() = default;
 
+  // Scripts that are given as protos are compiled by the resource manager.
   void Play(const AnimationScript& script, const std::string& scene_node_id);
-  void Stop(const std::string& script_id,
-            const std::string& scene_node_id) const;
-  void Pause(const std::string& script_id,
-             const std::string& scene_node_id) const;
-  void Resume(const std::string& script_id,
-              const std::string& scene_node_id) const;
+  void Play(const AnimationScript& script, NodeHandle scene_node);
+  void Play(const AnimationProgram& script, const std::string& scene_node_id);
+  void Play(const AnimationProgram& script, NodeHandle scene_node);
+  void Stop(const std::string& script_id, const std::string& scene_node_id);
+  void Stop(const std::string& script_id, NodeHandle scene_node);
+  void Pause(const std::string& script_id, const std::string& scene_node_id);
+  void Pause(const std::string& script_id, NodeHandle scene_node);
+  void Resume(const std::string& script_id, const std::string& scene_node_id);
+  void Resume(const std::string& script_id, NodeHandle scene_node);
 
-  void StopNodeAnimations(const std::string& scene_node_id) const;
+  void StopNodeAnimations(const std::string& scene_node_id);
+  void StopNodeAnimations(NodeHandle scene_node);
 
   void StopAll();
   void PauseAll();
@@ -37,10 +75,132 @@ class AnimatorManager {
   AnimatorManager& operator=(const AnimatorManager&) = delete;
 
  private:
+  // Starts |script| on a scene node referenced by id or handle, reusing a
+  // finished ScriptAnimator if there is one.
+  template <class SceneNodeRef>
+  void StartScript(const AnimationProgram& script, SceneNodeRef scene_node);
+
+  // Adds |script| to the scripts of its scene node, or removes it. Scripts
+  // without a scene node are not indexed.
+  void LinkNodeScript(ScriptAnimator* script);
+  void UnlinkNodeScript(ScriptAnimator* script);
+
+  // Calls |function| on each running script of |scene_node|, in the order they
+  // were played in.
+  template <class Function>
+  void ForEachNodeScript(NodeHandle scene_node, Function function);
+
+  // Stops, pauses or resumes |script| and keeps its timer in sync.
+  void StopScript(ScriptAnimator* script);
+  void PauseScript(ScriptAnimator* script);
+  void ResumeScript(ScriptAnimator* script);
+
+  // Progresses the scripts that are due.
+  void ProgressScripts(int time_since_last_frame);
+
+  // Progresses the scripts of the current round, which run on tracks, up to
+  // |now|.
+  void ProgressTracks(int64_t now);
+
+  // Progresses the scripts of the current round, which run on performers, up
+  // to |now|. Moves of scripts that are alone on their node are batched.
+  void ProgressPerformers(int64_t now);
+
+  // Moves the nodes of the batched scripts and completes their progress.
+  void CompleteBatchedScripts();
+
+  // Schedules |script| again after it made progress, or marks it for clean up
+  // if it finished.
+  void RescheduleScript(ScriptAnimator* script);
+
+  // Puts a running |script| on the timer wheel for the time it is next due,
+  // or on the scripts that are checked every frame if it is due that soon.
+  void ScheduleScript(ScriptAnimator* script);
+
+  // Schedules a |script| that starts or resumes, which makes progress in the
+  // frame that is progressing, if any, when it is due in it.
+  void WakeScript(ScriptAnimator* script);
+
+  // Removes |script| from the timer wheel or the list it is due on.
+  void UnscheduleScript(ScriptAnimator* script);
+
+  // Time of the manager clock that scripts which start now make progress
+  // from. Scripts that start while a frame is progressing make progress in it,
+  // like they did when they were played before it.
+  int64_t start_time() const {
+    return progressing_ ? frame_start_ : timers_.now();
+  }
+
+  // Script that is due, with the order it was played in. Scripts that are
+  // unscheduled or scheduled again get another ticket, so that the entries
+  // they leave behind are skipped.
+  struct DueScript {
+    int64_t sequence = 0;
+    int64_t ticket = 0;
+    // Time the script is due at.
+    int64_t time = 0;
+    ScriptAnimator* script = nullptr;
+  };
+
+  // Takes |due_script| off the schedule. Returns false if the entry was left
+  // behind by the script or the script is not running.
+  bool TakeDueScript(const DueScript& due_script);
+
   Core* core_;
 
   bool paused_ = false;
+
+  // Tracks that scripts run on, if the TRACKS backend is used, or the pool of
+  // their performers otherwise. Declared before scripts, which release their
+  // tracks and performers when destroyed.
+  std::unique_ptr<AnimationTracks> tracks_;
+  PerformerPool performer_pool_;
+
   std::vector<std::unique_ptr<ScriptAnimator>> running_scripts_;
+
+  // First and last running scripts of each scene node, indexed by node handle
+  // index, so that scripts of a node are found without going through all
+  // running scripts. Scripts of a node are chained by their NodeLink. Slots
+  // of deleted nodes are reused, so scripts of a slot are matched against the
+  // full handle.
+  struct NodeScripts {
+    ScriptAnimator* first = nullptr;
+    ScriptAnimator* last = nullptr;
+  };
+  std::vector<NodeScripts> node_scripts_;
+
+  // Finished script animators that are kept for reuse, so that scripts that
+  // start and finish frequently do not allocate.
+  std::vector<std::unique_ptr<ScriptAnimator>> free_scripts_;
+
+  // Running scripts that wait until they are due, on the manager clock. The
+  // clock is the time of all frames that were progressed.
+  TimerWheel<DueScript> timers_;
+  int64_t next_sequence_ = 0;
+  int64_t next_ticket_ = 1;
+
+  // Scripts that are due within about a frame are checked every frame instead
+  // of waiting on the timer wheel, which saves scheduling the scripts that make
+  // progress in most frames. Scripts that are due every frame make progress
+  // even in frames that take no time.
+  std::vector<DueScript> frame_scripts_;
+  int last_frame_time_ = 0;
+
+  // Scripts that are due in the frame that is progressing, and the ones that
+  // make progress in the current round of it.
+  std::vector<DueScript> due_scripts_;
+  std::vector<DueScript> round_scripts_;
+  int64_t frame_start_ = 0;
+
+  // Translations and gotos of the scripts that were batched in the current
+  // round, in the order they are due.
+  KinematicBatches kinematics_;
+  std::vector<ScriptAnimator*> batched_scripts_;
+  bool progressing_ = false;
+
+  // Set when scripts finish, so that they are cleaned up at the end of the next
+  // frame.
+  bool has_finished_scripts_ = false;
 };
 
 }  // namespace troll
@@ -0,0 +1,314 @@
+#include "animation/animator-manager.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <absl/strings/str_cat.h>
+#include <benchmark/benchmark.h>
+
+#include "core/collision-checker.h"
+#include "core/event-dispatcher.h"
+#include "core/resource-manager.h"
+#include "core/scene-manager.h"
+#include "proto/animation.pb.h"
+#include "proto/scene-node.pb.h"
+#include "troll-test/test-core.h"
+#include "troll-test/testing-resource-manager.h"
+
+namespace {
+// Number of heap allocations made by the benchmark binary, which is counted by
+// replacing the global operator new.
+std::atomic<int64_t> allocation_count = 0;
+}  // namespace
+
+void* operator new(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace troll {
+namespace {
+
+// Returns a script that moves a node back and forth and cycles through its
+// frames forever.
+AnimationScript MakeScript() {
+  AnimationScript script;
+  script.set_id("patrol");
+  script.set_repeat(-1);
+  for (const int x : {1, -1}) {
+    auto* animation = script.add_animation();
+    auto* translation = animation->mutable_translation();
+    translation->mutable_vec()->set_x(x);
+    translation->set_delay(16);
+    translation->set_repeat(20);
+
+    auto* frame_range = animation->mutable_frame_range();
+    frame_range->set_start_frame(0);
+    frame_range->set_end_frame(4);
+    frame_range->set_delay(100);
+  }
+  return script;
+}
+
+// Returns a script of two single step moves, like bullets that are fired and
+// finish within a couple of frames.
+AnimationScript MakeBulletScript() {
+  AnimationScript script;
+  script.set_id("bullet");
+  for (const int y : {4, 8}) {
+    auto* translation = script.add_animation()->mutable_translation();
+    translation->mutable_vec()->set_y(y);
+    translation->set_repeat(1);
+  }
+  return script;
+}
+
+// Returns a script that walks a node from (x, y) to the right and back forever,
+// like enemies that patrol a platform.
+AnimationScript MakeWalkScript(double x, double y) {
+  AnimationScript script;
+  script.set_id("walk");
+  script.set_repeat(-1);
+  for (const double destination_x : {x + 12, x}) {
+    auto* go_to = script.add_animation()->mutable_go_to();
+    go_to->mutable_destination()->set_x(destination_x);
+    go_to->mutable_destination()->set_y(y);
+    go_to->set_step(1.5);
+    go_to->set_delay(16);
+  }
+  return script;
+}
+
+// Returns a script that cycles through the frames of a node every few seconds
+// forever, like idle animations of scenery, and waits |wait| ms first.
+AnimationScript MakeIdleScript(int wait) {
+  AnimationScript script;
+  script.set_id("idle");
+  script.set_repeat(-1);
+  script.add_animation()->mutable_timer()->set_delay(wait);
+
+  auto* frame_range = script.add_animation()->mutable_frame_range();
+  frame_range->set_start_frame(0);
+  frame_range->set_end_frame(4);
+  frame_range->set_delay(100);
+  frame_range->set_repeat(1);
+
+  script.add_animation()->mutable_timer()->set_delay(3000 - wait);
+  return script;
+}
+
+// Scene of |nodes| nodes placed apart so that they never collide, which are
+// animated on |backend|.
+class AnimationScene {
+ public:
+  explicit AnimationScene(
+      int nodes, AnimationBackend backend = AnimationBackend::PERFORMERS)
+      : animator_manager_(&core_, backend) {
+    core_.set_resource_manager(&resource_manager_);
+    core_.set_scene_manager(&scene_manager_);
+    core_.set_collision_checker(&collision_checker_);
+    core_.set_event_dispatcher(&event_dispatcher_);
+    core_.set_animator_manager(&animator_manager_);
+
+    Sprite sprite;
+    sprite.set_id("sprite_a");
+    for (int i = 0; i < 4; ++i) {
+      auto* film = sprite.add_film();
+      film->set_width(16);
+      film->set_height(16);
+    }
+    TestingResourceManager(&resource_manager_).SetTestSprite(sprite);
+
+    for (int i = 0; i < nodes; ++i) {
+      SceneNode node;
+      node.set_id(absl::StrCat("node_", i));
+      node.set_sprite_id("sprite_a");
+      node.mutable_position()->set_x(i % 128 * 32);
+      node.mutable_position()->set_y(i / 128 * 32);
+      handles_.push_back(scene_manager_.AddSceneNode(node));
+    }
+  }
+
+  // Animated nodes are marked for collision checking and may emit events,
+  // which are not part of animation.
+  void EndFrame() {
+    collision_checker_.CheckCollisions();
+    event_dispatcher_.ProcessTriggeredEvents();
+  }
+
+  // Loads |script| like the resource manager loads scripts of a game and
+  // returns its compiled program.
+  const AnimationProgram& LoadAnimationScript(const AnimationScript& script) {
+    TestingResourceManager(&resource_manager_).SetTestAnimationScript(script);
+    return resource_manager_.GetAnimationProgram(script.id());
+  }
+
+  AnimatorManager* animator_manager() { return &animator_manager_; }
+  const SceneNode* GetSceneNode(NodeHandle handle) const {
+    return scene_manager_.GetSceneNode(handle);
+  }
+  const std::vector<NodeHandle>& handles() const { return handles_; }
+
+ private:
+  TestCore core_;
+  ResourceManager resource_manager_;
+  SceneManager scene_manager_ =
+      SceneManager(&resource_manager_, nullptr, &core_);
+  CollisionChecker collision_checker_ =
+      CollisionChecker(&scene_manager_, nullptr, &core_);
+  EventDispatcher event_dispatcher_;
+  AnimatorManager animator_manager_;
+
+  std::vector<NodeHandle> handles_;
+};
+
+// Arguments are the number of nodes, each running its own script, and whether
+// scripts run on tracks instead of performers.
+void BM_AnimatorManagerProgress(benchmark::State& state) {
+  const auto backend = state.range(1) ? AnimationBackend::TRACKS
+                                      : AnimationBackend::PERFORMERS;
+  AnimationScene scene(state.range(0), backend);
+  const auto script = MakeScript();
+  for (const auto handle : scene.handles()) {
+    scene.animator_manager()->Play(script, handle);
+  }
+
+  for (auto _ : state) {
+    scene.animator_manager()->Progress(16);
+
+    state.PauseTiming();
+    scene.EndFrame();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AnimatorManagerProgress)
+    ->ArgsProduct({benchmark::CreateRange(256, 16384, 4), {0, 1}});
+
+// Arguments are the number of nodes, each walking between two points, and
+// whether scripts run on tracks.
+void BM_AnimatorManagerGoto(benchmark::State& state) {
+  const auto backend = state.range(1) ? AnimationBackend::TRACKS
+                                      : AnimationBackend::PERFORMERS;
+  AnimationScene scene(state.range(0), backend);
+  for (const auto handle : scene.handles()) {
+    const auto& position = scene.GetSceneNode(handle)->position();
+    scene.animator_manager()->Play(
+        MakeWalkScript(position.x(), position.y()), handle);
+  }
+
+  for (auto _ : state) {
+    scene.animator_manager()->Progress(16);
+
+    state.PauseTiming();
+    scene.EndFrame();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AnimatorManagerGoto)
+    ->ArgsProduct({benchmark::CreateRange(256, 16384, 4), {0, 1}});
+
+// Arguments are the number of nodes, each idle most of the time, and whether
+// scripts run on tracks.
+void BM_AnimatorManagerIdle(benchmark::State& state) {
+  const auto backend = state.range(1) ? AnimationBackend::TRACKS
+                                      : AnimationBackend::PERFORMERS;
+  AnimationScene scene(state.range(0), backend);
+  for (int i = 0; i < scene.handles().size(); ++i) {
+    scene.animator_manager()->Play(MakeIdleScript(i % 64 * 40),
+                                   scene.handles()[i]);
+  }
+
+  for (auto _ : state) {
+    scene.animator_manager()->Progress(16);
+
+    state.PauseTiming();
+    scene.EndFrame();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AnimatorManagerIdle)
+    ->ArgsProduct({benchmark::CreateRange(256, 16384, 4), {0, 1}});
+
+// Arguments are the number of nodes, each running its own script, and whether
+// scripts run on tracks. Every frame stops and restarts the scripts of 64
+// nodes, like a collision handler that stops the animations of the nodes it
+// hits.
+void BM_AnimatorManagerStop(benchmark::State& state) {
+  const auto backend = state.range(1) ? AnimationBackend::TRACKS
+                                      : AnimationBackend::PERFORMERS;
+  AnimationScene scene(state.range(0), backend);
+  const auto& script = scene.LoadAnimationScript(MakeScript());
+  for (const auto handle : scene.handles()) {
+    scene.animator_manager()->Play(script, handle);
+  }
+
+  int next_node = 0;
+  for (auto _ : state) {
+    for (int i = 0; i < 64; ++i) {
+      const auto handle = scene.handles()[next_node];
+      next_node = (next_node + 97) % scene.handles().size();
+      scene.animator_manager()->Stop("patrol", handle);
+      scene.animator_manager()->Play(script, handle);
+    }
+    scene.animator_manager()->Progress(16);
+
+    state.PauseTiming();
+    scene.EndFrame();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_AnimatorManagerStop)
+    ->ArgsProduct({benchmark::CreateRange(256, 16384, 4), {0, 1}});
+
+// Arguments are the number of short scripts started every frame, one per
+// node, and whether scripts run on tracks. Reports heap allocations of
+// animation per frame.
+void BM_AnimationChurn(benchmark::State& state) {
+  const auto backend = state.range(1) ? AnimationBackend::TRACKS
+                                      : AnimationBackend::PERFORMERS;
+  AnimationScene scene(state.range(0), backend);
+  const auto& script = scene.LoadAnimationScript(MakeBulletScript());
+
+  // Warm up, so that steady state allocations are measured.
+  for (int i = 0; i < 4; ++i) {
+    for (const auto handle : scene.handles()) {
+      scene.animator_manager()->Play(script, handle);
+    }
+    scene.animator_manager()->Progress(16);
+    scene.EndFrame();
+  }
+
+  int64_t allocations = 0;
+  for (auto _ : state) {
+    const int64_t start_count = allocation_count.load();
+    for (const auto handle : scene.handles()) {
+      scene.animator_manager()->Play(script, handle);
+    }
+    scene.animator_manager()->Progress(16);
+    allocations += allocation_count.load() - start_count;
+
+    state.PauseTiming();
+    scene.EndFrame();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["allocs_per_frame"] =
+      benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_AnimationChurn)
+    ->ArgsProduct({benchmark::CreateRange(256, 4096, 4), {0, 1}});
+
+}  // namespace
+}  // namespace troll
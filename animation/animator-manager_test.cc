@@ -3,6 +3,9 @@
 #define CATCH_CONFIG_MAIN
 #include <catch.hpp>
 
+#include <string>
+#include <vector>
+
 #include "core/collision-checker.h"
 #include "core/event-dispatcher.h"
 #include "core/scene-manager.h"
@@ -27,6 +30,7 @@ class AnimatorManagerFixture {
     core_.set_scene_manager(&scene_manager_);
     core_.set_collision_checker(&collision_checker_);
     core_.set_event_dispatcher(&event_dispatcher_);
+    core_.set_animator_manager(&animator_manager_);
   }
 
  protected:
@@ -36,8 +40,10 @@ class AnimatorManagerFixture {
       SceneManager(&resource_manager_, nullptr, &core_);
   CollisionChecker collision_checker_ =
       CollisionChecker(&scene_manager_, nullptr, &core_);
-  AnimatorManager animator_manager_ = AnimatorManager(&core_);
+  // Declared before the manager, as performers unregister their event
+  // handlers when destroyed.
   EventDispatcher event_dispatcher_;
+  AnimatorManager animator_manager_ = AnimatorManager(&core_);
 
   TestingResourceManager testing_resource_manager_ =
       TestingResourceManager(&resource_manager_);
@@ -310,6 +316,34 @@ SCENARIO_METHOD(AnimatorManagerFixture, "Play many scripts on a node",
                          "id: 'node_a' sprite_id: 'sprite_a' "
                          "position { x: 2  y: 1  z: 1 }")));
 
+        AND_WHEN("a script is stopped and played again") {
+          animator_manager_.Stop("script_b", "node_a");
+          animator_manager_.Progress(10);
+          animator_manager_.Play(script_b, "node_a");
+
+          THEN("the scripts of the node are still found") {
+            animator_manager_.Progress(10);
+            REQUIRE_THAT(*scene_manager_.GetSceneNodeById("node_a"),
+                         EqualsProto(ParseProto<SceneNode>(
+                             "id: 'node_a' sprite_id: 'sprite_a' "
+                             "position { x: 6  y: 2  z: 3 }")));
+
+            animator_manager_.Stop("script_c", "node_a");
+            animator_manager_.Progress(10);
+            REQUIRE_THAT(*scene_manager_.GetSceneNodeById("node_a"),
+                         EqualsProto(ParseProto<SceneNode>(
+                             "id: 'node_a' sprite_id: 'sprite_a' "
+                             "position { x: 8  y: 3  z: 3 }")));
+
+            animator_manager_.StopNodeAnimations("node_a");
+            animator_manager_.Progress(10);
+            REQUIRE_THAT(*scene_manager_.GetSceneNodeById("node_a"),
+                         EqualsProto(ParseProto<SceneNode>(
+                             "id: 'node_a' sprite_id: 'sprite_a' "
+                             "position { x: 8  y: 3  z: 3 }")));
+          }
+        }
+
         AND_WHEN("an animation is paused") {
           animator_manager_.Pause("script_a", "node_a");
 
@@ -338,6 +372,124 @@ SCENARIO_METHOD(AnimatorManagerFixture, "Play many scripts on a node",
   }
 }
 
+SCENARIO_METHOD(AnimatorManagerFixture, "Play scripts that wait",
+                "[animator_manager]") {
+  GIVEN("a script that waits before it moves a node") {
+    const auto script = ParseProto<AnimationScript>(R"(
+        id: 'script_a'
+        animation { timer { delay: 100 } }
+        animation {
+          translation {
+            vec { x: 1 }
+            delay: 30
+            repeat: 2
+          }
+        })");
+    scene_manager_.AddSceneNode(
+        ParseProto<SceneNode>("id: 'node_a' sprite_id: 'sprite_a'"));
+    animator_manager_.Play(script, "node_a");
+
+    // Returns the x of the node after each of |frames| frames of 16ms.
+    auto run = [this](int frames) {
+      std::vector<double> trace;
+      for (int i = 0; i < frames; ++i) {
+        animator_manager_.Progress(16);
+        trace.push_back(
+            scene_manager_.GetSceneNodeById("node_a")->position().x());
+      }
+      return trace;
+    };
+
+    WHEN("frames pass") {
+      const auto trace = run(12);
+
+      THEN("the node moves once the timer and the delays are over") {
+        REQUIRE(trace == std::vector<double>{0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                             2, 2});
+      }
+    }
+
+    WHEN("the script is paused while it waits") {
+      run(3);
+      animator_manager_.Pause("script_a", "node_a");
+      run(4);
+      animator_manager_.Resume("script_a", "node_a");
+
+      THEN("the time it was paused does not count") {
+        REQUIRE(run(9) == std::vector<double>{0, 0, 0, 0, 0, 1, 1, 2, 2});
+      }
+    }
+  }
+}
+
+SCENARIO_METHOD(AnimatorManagerFixture, "Batch the moves of scripts",
+                "[animator_manager]") {
+  GIVEN("more nodes than a batch holds that translate and walk") {
+    const auto script = ParseProto<AnimationScript>(R"(
+        id: 'script_a'
+        animation {
+          translation {
+            vec { x: 1.5  y: -0.7 }
+            delay: 10
+            repeat: 4
+          }
+        }
+        animation {
+          go_to {
+            destination { x: 40  y: -30 }
+            step: 3.3
+            delay: 10
+          }
+        }
+        animation {
+          translation {
+            vec { y: 1 }
+            repeat: 3
+          }
+        })");
+    const auto idle_script = ParseProto<AnimationScript>(R"(
+        id: 'script_i'
+        animation { timer { delay: 100000 } })");
+
+    // Scripts of the batched nodes are alone on their node, while the
+    // unbatched nodes run an idle script too.
+    constexpr int kNodes = KinematicBatch::kCapacity + 6;
+    for (const auto* prefix : {"batched_", "unbatched_"}) {
+      for (int i = 0; i < kNodes; ++i) {
+        auto node = ParseProto<SceneNode>("sprite_id: 'sprite_a'");
+        node.set_id(prefix + std::to_string(i));
+        node.mutable_position()->set_x(i * 0.9);
+        scene_manager_.AddSceneNode(node);
+        animator_manager_.Play(script, node.id());
+      }
+    }
+    for (int i = 0; i < kNodes; ++i) {
+      animator_manager_.Play(idle_script, "unbatched_" + std::to_string(i));
+    }
+
+    WHEN("frames of different lengths pass") {
+      const std::vector<int> frame_times = {16, 7, 0, 10, 40};
+
+      THEN("batched nodes move like nodes that are not batched") {
+        for (int i = 0; i < 60; ++i) {
+          animator_manager_.Progress(frame_times[i % frame_times.size()]);
+          for (int j = 0; j < kNodes; ++j) {
+            const auto& unbatched = scene_manager_.GetSceneNodeById(
+                "unbatched_" + std::to_string(j))->position();
+            REQUIRE_THAT(scene_manager_.GetSceneNodeById(
+                             "batched_" + std::to_string(j))->position(),
+                         EqualsProto(unbatched));
+          }
+        }
+        REQUIRE_THAT(*scene_manager_.GetSceneNodeById("batched_0"),
+                     EqualsProto(ParseProto<SceneNode>(
+                         "id: 'batched_0' sprite_id: 'sprite_a' "
+                         "position { x: 40  y: -27  z: 0 }")));
+      }
+    }
+  }
+}
+
 SCENARIO_METHOD(AnimatorManagerFixture, "Play many scripts on node that die",
                 "[animator_manager]") {
   GIVEN("a script") {
@@ -386,4 +538,63 @@ SCENARIO_METHOD(AnimatorManagerFixture, "Play many scripts on node that die",
   }
 }
 
+SCENARIO_METHOD(AnimatorManagerFixture, "Stop scripts that run other scripts",
+                "[animator_manager]") {
+  GIVEN("a parent script that runs a child script") {
+    for (const auto* id : {"script_c", "script_d", "script_x"}) {
+      auto child = ParseProto<AnimationScript>(R"(
+          animation { timer { delay: 1000 } })");
+      child.set_id(id);
+      testing_resource_manager_.SetTestAnimationScript(child);
+    }
+    const auto script_p = ParseProto<AnimationScript>(R"(
+        id: 'script_p'
+        animation { run_script { script_id: 'script_c' } })");
+    // Moves the node only after its own child script terminates.
+    const auto script_r = ParseProto<AnimationScript>(R"(
+        id: 'script_r'
+        animation { run_script { script_id: 'script_d' } }
+        animation { translation { vec { x: 1 } } })");
+    const auto& script_c = resource_manager_.GetAnimationProgram("script_c");
+    const auto& script_x = resource_manager_.GetAnimationProgram("script_x");
+    scene_manager_.AddSceneNode(
+        ParseProto<SceneNode>("id: 'node_a' sprite_id: 'sprite_a'"));
+    animator_manager_.Play(script_p, "node_a");
+
+    const auto run = [this]() {
+      event_dispatcher_.ProcessTriggeredEvents();
+      animator_manager_.Progress(10);
+      animator_manager_.Progress(10);
+      return scene_manager_.GetSceneNodeById("node_a")->position().x();
+    };
+
+    WHEN("the parent is stopped and its animator is reused in the frame") {
+      animator_manager_.Stop("script_p", "node_a");
+      animator_manager_.Progress(0);
+      animator_manager_.Play(script_x, "node_a");
+      animator_manager_.Play(script_r, "node_a");
+
+      THEN("the termination of the child does not reach the new script") {
+        REQUIRE(run() == 0);
+      }
+    }
+
+    WHEN("all scripts are stopped and the child is played again") {
+      animator_manager_.StopAll();
+      animator_manager_.Play(script_x, "node_a");
+      animator_manager_.Play(script_r, "node_a");
+      animator_manager_.Play(script_c, "node_a");
+
+      AND_WHEN("the child terminates") {
+        animator_manager_.Stop("script_c", "node_a");
+        animator_manager_.Progress(0);
+
+        THEN("its termination does not reach the new script") {
+          REQUIRE(run() == 0);
+        }
+      }
+    }
+  }
+}
+
 }  // namespace troll
@@ -1,5 +1,7 @@
 #include "animation/animator.h"
 
+#include <algorithm>
+
 #include <range/v3/algorithm/any_of.hpp>
 #include <range/v3/algorithm/remove_if.hpp>
 
@@ -7,44 +9,70 @@ namespace troll {
 
 void Animator::Start(const Animation& animation, SceneNode* scene_node,
                      Core* core) {
+  instructions_.clear();
+  AnimationProgram::CompileAnimation(animation, &instructions_);
+  Start(animation, instructions_.data(),
+        instructions_.data() + instructions_.size(), scene_node, core);
+}
+
+void Animator::Start(const AnimationProgram& program,
+                     const AnimationProgram::Step& step, SceneNode* scene_node,
+                     Core* core) {
+  Start(*step.animation, program.begin(step), program.end(step), scene_node,
+        core);
+}
+
+void Animator::Start(const Animation& animation,
+                     const AnimationProgram::Instruction* begin,
+                     const AnimationProgram::Instruction* end,
+                     SceneNode* scene_node, Core* core) {
+  using Op = AnimationProgram::Op;
+
+  // Performers of a previous animation are returned to the pool.
+  performers_.clear();
+  timer_ = -1;
   wait_for_all_ = animation.termination() == Animation::ALL;
 
-  if (animation.has_translation()) {
-    performers_.push_back(
-        std::make_unique<TranslationPerformer>(animation.translation()));
-  }
-  if (animation.has_rotation()) {
-    performers_.push_back(
-        std::make_unique<RotationPerformer>(animation.rotation()));
-  }
-  if (animation.has_scaling()) {
-    performers_.push_back(
-        std::make_unique<ScalingPerformer>(animation.scaling()));
-  }
-  if (animation.has_frame_range()) {
-    performers_.push_back(
-        std::make_unique<FrameRangePerformer>(animation.frame_range(), core));
-  }
-  if (animation.has_frame_list()) {
-    performers_.push_back(
-        std::make_unique<FrameListPerformer>(animation.frame_list(), core));
-  }
-  if (animation.has_flash()) {
-    performers_.push_back(std::make_unique<FlashPerformer>(animation.flash()));
-  }
-  if (animation.has_go_to()) {
-    performers_.push_back(std::make_unique<GotoPerformer>(animation.go_to()));
-  }
-  if (animation.has_timer()) {
-    performers_.push_back(std::make_unique<TimerPerformer>(animation.timer()));
-  }
-  if (animation.has_run_script()) {
-    performers_.push_back(
-        std::make_unique<RunScriptPerformer>(animation.run_script(), core));
-  }
-  if (animation.has_sfx()) {
-    performers_.push_back(
-        std::make_unique<SfxPerformer>(animation.sfx(), core));
+  for (const auto* instruction = begin; instruction != end; ++instruction) {
+    switch (instruction->op) {
+      case Op::TRANSLATION:
+        performers_.push_back(
+            pool_->Create<TranslationPerformer>(animation.translation()));
+        break;
+      case Op::ROTATION:
+        performers_.push_back(
+            pool_->Create<RotationPerformer>(animation.rotation()));
+        break;
+      case Op::SCALING:
+        performers_.push_back(
+            pool_->Create<ScalingPerformer>(animation.scaling()));
+        break;
+      case Op::FRAME_RANGE:
+        performers_.push_back(
+            pool_->Create<FrameRangePerformer>(animation.frame_range(), core));
+        break;
+      case Op::FRAME_LIST:
+        performers_.push_back(
+            pool_->Create<FrameListPerformer>(animation.frame_list(), core));
+        break;
+      case Op::FLASH:
+        performers_.push_back(pool_->Create<FlashPerformer>(animation.flash()));
+        break;
+      case Op::GO_TO:
+        performers_.push_back(pool_->Create<GotoPerformer>(animation.go_to()));
+        break;
+      case Op::TIMER:
+        timer_ = std::max(animation.timer().delay(), 0);
+        break;
+      case Op::RUN_SCRIPT:
+        performers_.push_back(pool_->Create<RunScriptPerformer>(
+            animation.run_script(), core, instruction->script));
+        break;
+      case Op::SFX:
+        performers_.push_back(
+            pool_->Create<SfxPerformer>(animation.sfx(), core));
+        break;
+    }
   }
 
   for (auto& performer : performers_) {
@@ -80,23 +108,63 @@ bool Animator::Progress(int time_since_last_frame, SceneNode* scene_node) {
   return finished;
 }
 
+bool Animator::Batch(int time_since_last_frame, SceneNode* scene_node,
+                     KinematicBatches* batches) {
+  return performers_.size() == 1 && timer_ == -1 &&
+         performers_.front()->Batch(time_since_last_frame, scene_node,
+                                    batches);
+}
+
+bool Animator::CompleteBatch(const KinematicBatches& batches,
+                             SceneNode* scene_node) {
+  const bool finished =
+      performers_.front()->CompleteBatch(batches, scene_node);
+  if (finished) {
+    Stop(*scene_node);
+  }
+  return finished;
+}
+
+int Animator::time_until_due() const {
+  if (performers_.empty()) return std::max(timer_, 0);
+
+  int time = timer_ != -1 ? timer_ : performers_.front()->time_until_due();
+  for (const auto& performer : performers_) {
+    time = std::min(time, performer->time_until_due());
+  }
+  return time;
+}
+
 bool Animator::ProgressAny(int time_since_last_frame, SceneNode* scene_node) {
-  return ranges::any_of(
+  const bool finished = ranges::any_of(
       performers_, [time_since_last_frame,
-                    scene_node](const std::unique_ptr<Performer>& performer) {
+                    scene_node](const PerformerPool::Ptr& performer) {
         return performer->Progress(time_since_last_frame, scene_node);
       });
+  // Performers that follow the timer in instruction order only report whether
+  // they finished, so progressing the timer last keeps the order of effects.
+  return finished || ProgressTimer(time_since_last_frame);
 }
 
 bool Animator::ProgressAll(int time_since_last_frame, SceneNode* scene_node) {
   const auto it = std::remove_if(
       performers_.begin(), performers_.end(),
       [time_since_last_frame,
-       scene_node](const std::unique_ptr<Performer>& performer) {
+       scene_node](const PerformerPool::Ptr& performer) {
         return performer->Progress(time_since_last_frame, scene_node);
       });
   performers_.erase(it, performers_.end());
-  return performers_.empty();
+  if (ProgressTimer(time_since_last_frame)) {
+    timer_ = -1;
+  }
+  return performers_.empty() && timer_ == -1;
+}
+
+bool Animator::ProgressTimer(int time_since_last_frame) {
+  if (timer_ == -1) return false;
+
+  timer_ = std::max(timer_ - time_since_last_frame, 0);
+  return timer_ == 0;
 }
 
 }  // namespace troll
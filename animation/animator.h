@@ -4,7 +4,9 @@
 #include <memory>
 #include <vector>
 
+#include "animation/performer-pool.h"
 #include "animation/performer.h"
+#include "core/animation-program.h"
 #include "proto/animation.pb.h"
 #include "proto/scene-node.pb.h"
 
@@ -14,8 +16,17 @@ namespace troll {
 // scene node. See also, "proto/animation.proto".
 class Animator {
  public:
-  // Initialises the animator state.
+  // Performers are created from |pool|, which must outlive the animator.
+  explicit Animator(PerformerPool* pool) : pool_(pool) {}
+  ~Animator() = default;
+
+  // Initialises the animator state. An animator can be started again with a
+  // different animation, which reuses its allocations.
   void Start(const Animation& animation, SceneNode* scene_node, Core* core);
+  // Starts a step of a compiled program, without inspecting its animation.
+  void Start(const AnimationProgram& program,
+             const AnimationProgram::Step& step, SceneNode* scene_node,
+             Core* core);
 
   // Stops all performers of this animation.
   void Stop(const SceneNode& scene_node);
@@ -29,18 +40,51 @@ class Animator {
   // Returns true if the Animator finished.
   bool Progress(int time_since_last_frame, SceneNode* scene_node);
 
+  // Progress in two phases for animations that only translate or walk their
+  // node, see Performer::Batch(). Batch() returns false, without making
+  // progress, if the animation has to progress with Progress() instead.
+  // CompleteBatch() returns true if the Animator finished.
+  bool Batch(int time_since_last_frame, SceneNode* scene_node,
+             KinematicBatches* batches);
+  bool CompleteBatch(const KinematicBatches& batches, SceneNode* scene_node);
+
+  // Returns the time until the first of its performers is due, see
+  // Performer::time_until_due().
+  int time_until_due() const;
+
  private:
+  // Creates and starts performers for instructions [begin, end) of
+  // |animation|.
+  void Start(const Animation& animation,
+             const AnimationProgram::Instruction* begin,
+             const AnimationProgram::Instruction* end, SceneNode* scene_node,
+             Core* core);
+
   // Returns true if any of the performers finished during progress.
   bool ProgressAny(int time_since_last_frame, SceneNode* scene_node);
 
   // Returns true iff all the performers finished during progress.
   bool ProgressAll(int time_since_last_frame, SceneNode* scene_node);
 
+  // Returns true if the timer of the animation is due.
+  bool ProgressTimer(int time_since_last_frame);
+
+  PerformerPool* pool_;
+
   // If true, the animator finishes when all performers are finished. Otherwise,
   // the animator is finished when any performer is finished.
   bool wait_for_all_ = false;
 
-  std::vector<std::unique_ptr<Performer>> performers_;
+  std::vector<PerformerPool::Ptr> performers_;
+
+  // Time until the timer of the animation is due, or -1 if it has none or it
+  // is already due. Timers are not performers, as they only wait: a script
+  // whose step only has a timer is scheduled by AnimatorManager at the time
+  // the timer is due and is not progressed before then.
+  int timer_ = -1;
+
+  // Instructions of animations that are started without a program.
+  std::vector<AnimationProgram::Instruction> instructions_;
 };
 
 }  // namespace troll
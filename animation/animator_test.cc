@@ -3,6 +3,8 @@
 #define CATCH_CONFIG_MAIN
 #include <catch.hpp>
 
+#include <memory>
+
 #include "core/scene-manager.h"
 #include "proto/animation.pb.h"
 #include "proto/scene-node.pb.h"
@@ -29,6 +31,7 @@ class AnimatorFixture {
   ResourceManager resource_manager_;
   SceneManager scene_manager_ =
       SceneManager(&resource_manager_, nullptr, &core_);
+  PerformerPool performer_pool_;
 
   TestingResourceManager testing_resource_manager_ =
       TestingResourceManager(&resource_manager_);
@@ -52,7 +55,7 @@ SCENARIO_METHOD(AnimatorFixture,
           repeat: 2
         })");
 
-    Animator animator;
+    Animator animator(&performer_pool_);
     animator.Start(composite_animation, &scene_node_, &core_);
 
     WHEN("some progress is done") {
@@ -96,7 +99,7 @@ SCENARIO_METHOD(AnimatorFixture,
           repeat: 2
         })");
 
-    Animator animator;
+    Animator animator(&performer_pool_);
     animator.Start(composite_animation, &scene_node_, &core_);
 
     WHEN("the first animation is finished") {
@@ -143,7 +146,7 @@ SCENARIO_METHOD(
          delay: 30
         })");
 
-    Animator animator;
+    Animator animator(&performer_pool_);
     animator.Start(composite_animation, &scene_node_, &core_);
 
     WHEN("the non-repeatable animation is finished (timer)") {
@@ -159,4 +162,86 @@ SCENARIO_METHOD(
   }
 }
 
+SCENARIO_METHOD(AnimatorFixture, "Timer animation", "[animator]") {
+  GIVEN("a timer animation") {
+    const auto timer_animation =
+        ParseProto<Animation>("timer { delay: 1000 }");
+
+    Animator animator(&performer_pool_);
+    animator.Start(timer_animation, &scene_node_, &core_);
+
+    WHEN("it starts, it needs to pass time equal to delay to terminate") {
+      REQUIRE(animator.time_until_due() == 1000);
+      REQUIRE_FALSE(animator.Progress(500, &scene_node_));
+      REQUIRE_FALSE(animator.Progress(200, &scene_node_));
+      REQUIRE(animator.time_until_due() == 300);
+      REQUIRE(animator.Progress(300, &scene_node_));
+      REQUIRE_THAT(scene_node_, EqualsProto(ParseProto<SceneNode>(
+                                    "id: 'node_a' sprite_id: 'sprite_a' ")));
+    }
+  }
+
+  GIVEN("a timer that bounds a translation") {
+    const auto composite_animation = ParseProto<Animation>(R"(
+        termination: ANY
+        translation {
+          vec { x: 1 }
+          delay: 10
+        }
+        timer { delay: 25 })");
+
+    Animator animator(&performer_pool_);
+    animator.Start(composite_animation, &scene_node_, &core_);
+
+    WHEN("the timer is due") {
+      REQUIRE(animator.time_until_due() == 10);
+      REQUIRE_FALSE(animator.Progress(20, &scene_node_));
+      REQUIRE(animator.time_until_due() == 5);
+      REQUIRE(animator.Progress(10, &scene_node_));
+
+      THEN("the translation is applied until then") {
+        REQUIRE_THAT(scene_node_, EqualsProto(ParseProto<SceneNode>(R"(
+            id: 'node_a' sprite_id: 'sprite_a'
+            position { x: 3 y: 0 z: 0 })")));
+      }
+    }
+  }
+}
+
+SCENARIO_METHOD(AnimatorFixture, "Animators reuse pooled performers",
+                "[animator]") {
+  GIVEN("an animator that runs a composite animation") {
+    const auto composite_animation = ParseProto<Animation>(R"(
+        translation { vec { x: 1 } }
+        rotation { vec { x: 1 } })");
+
+    auto animator = std::make_unique<Animator>(&performer_pool_);
+    animator->Start(composite_animation, &scene_node_, &core_);
+    const int allocated_blocks = performer_pool_.allocated_blocks();
+    const int free_blocks = performer_pool_.free_blocks();
+
+    THEN("its performers are taken from its pool") {
+      REQUIRE(allocated_blocks > 0);
+      REQUIRE(free_blocks == allocated_blocks - 2);
+    }
+
+    WHEN("the animator is restarted") {
+      animator->Start(composite_animation, &scene_node_, &core_);
+
+      THEN("the performers of the previous animation are reused") {
+        REQUIRE(performer_pool_.allocated_blocks() == allocated_blocks);
+        REQUIRE(performer_pool_.free_blocks() == free_blocks);
+      }
+    }
+
+    WHEN("the animator is destroyed") {
+      animator.reset();
+
+      THEN("its performers are returned to the pool") {
+        REQUIRE(performer_pool_.free_blocks() == free_blocks + 2);
+      }
+    }
+  }
+}
+
 }  // namespace troll
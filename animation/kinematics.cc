@@ -0,0 +1,155 @@
+#include "animation/kinematics.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TROLL_KINEMATICS_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TROLL_KINEMATICS_SSE2
+#endif
+
+namespace troll {
+
+namespace {
+#if defined(TROLL_KINEMATICS_AVX)
+constexpr int kSimdLanes = 4;
+using SimdDoubles = __m256d;
+
+SimdDoubles Load(const double* values) { return _mm256_loadu_pd(values); }
+void Store(double* values, SimdDoubles lanes) {
+  _mm256_storeu_pd(values, lanes);
+}
+SimdDoubles Splat(double value) { return _mm256_set1_pd(value); }
+
+SimdDoubles Add(SimdDoubles a, SimdDoubles b) { return _mm256_add_pd(a, b); }
+SimdDoubles Sub(SimdDoubles a, SimdDoubles b) { return _mm256_sub_pd(a, b); }
+SimdDoubles Mul(SimdDoubles a, SimdDoubles b) { return _mm256_mul_pd(a, b); }
+SimdDoubles Div(SimdDoubles a, SimdDoubles b) { return _mm256_div_pd(a, b); }
+SimdDoubles Sqrt(SimdDoubles a) { return _mm256_sqrt_pd(a); }
+
+// Returns lanes with all bits set where |a| > |b|.
+SimdDoubles GreaterThan(SimdDoubles a, SimdDoubles b) {
+  return _mm256_cmp_pd(a, b, _CMP_GT_OQ);
+}
+// Returns the lanes of |a| where |mask| is set and of |b| elsewhere.
+SimdDoubles Select(SimdDoubles mask, SimdDoubles a, SimdDoubles b) {
+  return _mm256_blendv_pd(b, a, mask);
+}
+int LaneBits(SimdDoubles mask) { return _mm256_movemask_pd(mask); }
+#elif defined(TROLL_KINEMATICS_SSE2)
+constexpr int kSimdLanes = 2;
+using SimdDoubles = __m128d;
+
+SimdDoubles Load(const double* values) { return _mm_loadu_pd(values); }
+void Store(double* values, SimdDoubles lanes) { _mm_storeu_pd(values, lanes); }
+SimdDoubles Splat(double value) { return _mm_set1_pd(value); }
+
+SimdDoubles Add(SimdDoubles a, SimdDoubles b) { return _mm_add_pd(a, b); }
+SimdDoubles Sub(SimdDoubles a, SimdDoubles b) { return _mm_sub_pd(a, b); }
+SimdDoubles Mul(SimdDoubles a, SimdDoubles b) { return _mm_mul_pd(a, b); }
+SimdDoubles Div(SimdDoubles a, SimdDoubles b) { return _mm_div_pd(a, b); }
+SimdDoubles Sqrt(SimdDoubles a) { return _mm_sqrt_pd(a); }
+
+// Returns lanes with all bits set where |a| > |b|.
+SimdDoubles GreaterThan(SimdDoubles a, SimdDoubles b) {
+  return _mm_cmpgt_pd(a, b);
+}
+// Returns the lanes of |a| where |mask| is set and of |b| elsewhere.
+SimdDoubles Select(SimdDoubles mask, SimdDoubles a, SimdDoubles b) {
+  return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+int LaneBits(SimdDoubles mask) { return _mm_movemask_pd(mask); }
+#endif
+
+// Directions that are not longer than this are not normalised, like in
+// geo::VectorNormalise().
+constexpr double kMinNormalisedLength = 1e-08;
+
+// Adds |delta| to |values|, which hold |size| doubles.
+void AddValues(int size, const double* delta, double* values) {
+  int i = 0;
+#if defined(TROLL_KINEMATICS_AVX) || defined(TROLL_KINEMATICS_SSE2)
+  for (; i + kSimdLanes <= size; i += kSimdLanes) {
+    Store(values + i, Add(Load(values + i), Load(delta + i)));
+  }
+#endif
+  for (; i < size; ++i) {
+    values[i] += delta[i];
+  }
+}
+
+// Moves |size| positions by |step| towards |target|. Operations follow
+// GotoPerformer one by one, so that positions end up exactly the same.
+void MoveTowards(int size, const double* target_x, const double* target_y,
+                 const double* target_z, const double* step, double* x,
+                 double* y, double* z, uint8_t* arrived) {
+  int i = 0;
+#if defined(TROLL_KINEMATICS_AVX) || defined(TROLL_KINEMATICS_SSE2)
+  const auto min_length = Splat(kMinNormalisedLength);
+  const auto one = Splat(1.0);
+  for (; i + kSimdLanes <= size; i += kSimdLanes) {
+    const auto lane_x = Load(x + i);
+    const auto lane_y = Load(y + i);
+    const auto lane_z = Load(z + i);
+    const auto dx = Sub(Load(target_x + i), lane_x);
+    const auto dy = Sub(Load(target_y + i), lane_y);
+    const auto dz = Sub(Load(target_z + i), lane_z);
+    const auto length =
+        Sqrt(Add(Add(Mul(dx, dx), Mul(dy, dy)), Mul(dz, dz)));
+    const auto scale =
+        Select(GreaterThan(length, min_length), Div(one, length), one);
+
+    const auto lane_step = Load(step + i);
+    Store(x + i, Add(lane_x, Mul(Mul(dx, scale), lane_step)));
+    Store(y + i, Add(lane_y, Mul(Mul(dy, scale), lane_step)));
+    Store(z + i, Add(lane_z, Mul(Mul(dz, scale), lane_step)));
+
+    const int moving = LaneBits(GreaterThan(length, lane_step));
+    for (int lane = 0; lane < kSimdLanes; ++lane) {
+      arrived[i + lane] = (moving & (1 << lane)) == 0;
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    const double dx = target_x[i] - x[i];
+    const double dy = target_y[i] - y[i];
+    const double dz = target_z[i] - z[i];
+    const double length = std::sqrt(dx * dx + dy * dy + dz * dz);
+    const double scale = length > kMinNormalisedLength ? 1.0 / length : 1.0;
+
+    x[i] += dx * scale * step[i];
+    y[i] += dy * scale * step[i];
+    z[i] += dz * scale * step[i];
+    arrived[i] = !(length > step[i]);
+  }
+}
+}  // namespace
+
+void KinematicBatch::Translate() {
+  AddValues(size(), target_x_.data(), x_.data());
+  AddValues(size(), target_y_.data(), y_.data());
+  AddValues(size(), target_z_.data(), z_.data());
+  WriteBack();
+}
+
+void KinematicBatch::Goto() {
+  MoveTowards(size(), target_x_.data(), target_y_.data(), target_z_.data(),
+              step_.data(), x_.data(), y_.data(), z_.data(), arrived_.data());
+  WriteBack();
+}
+
+void KinematicBatch::WriteBack() {
+  for (int i = 0; i < size(); ++i) {
+    if (arrived_[i]) continue;
+
+    auto* position = nodes_[i]->mutable_position();
+    position->set_x(x_[i]);
+    position->set_y(y_[i]);
+    position->set_z(z_[i]);
+  }
+}
+
+}  // namespace troll
@@ -0,0 +1,96 @@
+#ifndef TROLL_ANIMATION_KINEMATICS_H_
+#define TROLL_ANIMATION_KINEMATICS_H_
+
+#include <array>
+#include <cstdint>
+
+#include "proto/scene-node.pb.h"
+
+namespace troll {
+
+// Moves a batch of scene nodes at once. Positions of the nodes are gathered
+// into contiguous arrays when added, moved with SIMD and written back to the
+// nodes, instead of updating each node through the Vector operators that build
+// temporary messages.
+//
+// A node must appear at most once in a batch, as all moves read the positions
+// gathered when the nodes were added.
+class KinematicBatch {
+ public:
+  // Batches are applied before they hold more nodes than this, so that the
+  // nodes they gather are still cached when their positions are written back.
+  static constexpr int kCapacity = 64;
+
+  KinematicBatch() = default;
+  ~KinematicBatch() = default;
+
+  void Clear() { size_ = 0; }
+
+  // Adds |scene_node| with a translation vector or a goto destination (x, y,
+  // z) and the goto step size. The batch must not be full.
+  void Add(SceneNode* scene_node, double x, double y, double z,
+           double step = 0.0) {
+    const auto& position = scene_node->position();
+    nodes_[size_] = scene_node;
+    x_[size_] = position.x();
+    y_[size_] = position.y();
+    z_[size_] = position.z();
+    target_x_[size_] = x;
+    target_y_[size_] = y;
+    target_z_[size_] = z;
+    step_[size_] = step;
+    arrived_[size_] = false;
+    ++size_;
+  }
+
+  // Adds its vector to the position of each node, like TranslationPerformer.
+  void Translate();
+
+  // Moves each node by its step towards its destination, like GotoPerformer.
+  // Nodes that are within a step of their destination are not moved and are
+  // reported by arrived(), so that the caller places them on it.
+  void Goto();
+
+  int size() const { return size_; }
+  bool full() const { return size_ == kCapacity; }
+  bool arrived(int index) const { return arrived_[index]; }
+
+  KinematicBatch(const KinematicBatch&) = delete;
+  KinematicBatch& operator=(const KinematicBatch&) = delete;
+
+ private:
+  // Writes positions back to the nodes, except to those that arrived.
+  void WriteBack();
+
+  int size_ = 0;
+  std::array<SceneNode*, kCapacity> nodes_;
+
+  std::array<double, kCapacity> x_;
+  std::array<double, kCapacity> y_;
+  std::array<double, kCapacity> z_;
+
+  std::array<double, kCapacity> target_x_;
+  std::array<double, kCapacity> target_y_;
+  std::array<double, kCapacity> target_z_;
+  std::array<double, kCapacity> step_;
+
+  std::array<uint8_t, kCapacity> arrived_;
+};
+
+// Translations and gotos of performers that are due together, see
+// Performer::Batch().
+struct KinematicBatches {
+  void Clear() {
+    translations.Clear();
+    gotos.Clear();
+  }
+
+  bool full() const { return translations.full() || gotos.full(); }
+
+  KinematicBatch translations;
+  KinematicBatch gotos;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_ANIMATION_KINEMATICS_H_
@@ -0,0 +1,113 @@
+#include "animation/kinematics.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <vector>
+
+#include "animation/performer.h"
+#include "proto/animation.pb.h"
+#include "proto/scene-node.pb.h"
+#include "troll-test/test-util.h"
+
+namespace troll {
+
+namespace {
+// Returns nodes at positions that are not multiples of the SIMD width, so that
+// both vector and scalar lanes are covered.
+std::vector<SceneNode> MakeNodes() {
+  std::vector<SceneNode> nodes;
+  for (int i = 0; i < 7; ++i) {
+    auto& node = nodes.emplace_back();
+    node.mutable_position()->set_x(i * 13.7);
+    node.mutable_position()->set_y(100 - i * 9.1);
+    node.mutable_position()->set_z(i % 2);
+  }
+  return nodes;
+}
+}  // namespace
+
+SCENARIO("Kinematic batches move nodes like performers", "[kinematics]") {
+  GIVEN("nodes scattered around") {
+    auto nodes = MakeNodes();
+    auto expected_nodes = MakeNodes();
+
+    WHEN("they are translated") {
+      std::vector<VectorAnimation> translations;
+      for (int i = 0; i < nodes.size(); ++i) {
+        auto& translation = translations.emplace_back();
+        translation.mutable_vec()->set_x(0.1 * i);
+        translation.mutable_vec()->set_y(-3.3);
+        translation.set_delay(1);
+      }
+
+      KinematicBatch batch;
+      for (int frame = 0; frame < 3; ++frame) {
+        batch.Clear();
+        for (int i = 0; i < nodes.size(); ++i) {
+          const auto& vec = translations[i].vec();
+          batch.Add(&nodes[i], vec.x(), vec.y(), vec.z());
+          TranslationPerformer(translations[i]).Progress(1, &expected_nodes[i]);
+        }
+        batch.Translate();
+      }
+
+      THEN("they end up at the same positions") {
+        for (int i = 0; i < nodes.size(); ++i) {
+          REQUIRE_THAT(nodes[i], EqualsProto(expected_nodes[i]));
+        }
+      }
+    }
+
+    WHEN("they go towards destinations") {
+      std::vector<GotoAnimation> gotos;
+      for (int i = 0; i < nodes.size(); ++i) {
+        auto& go_to = gotos.emplace_back();
+        go_to.mutable_destination()->set_x(50);
+        go_to.mutable_destination()->set_y(40 + i);
+        go_to.set_step(3.5 * i);
+        go_to.set_delay(1);
+      }
+
+      KinematicBatch batch;
+      std::vector<bool> arrived(nodes.size());
+      std::vector<bool> expected_arrived(nodes.size());
+      for (int frame = 0; frame < 30; ++frame) {
+        batch.Clear();
+        std::vector<int> moving;
+        for (int i = 0; i < nodes.size(); ++i) {
+          if (arrived[i]) continue;
+          moving.push_back(i);
+          batch.Add(&nodes[i], 50, 40 + i, 0, gotos[i].step());
+          expected_arrived[i] =
+              GotoPerformer(gotos[i]).Progress(1, &expected_nodes[i]);
+        }
+        batch.Goto();
+
+        for (int j = 0; j < moving.size(); ++j) {
+          const int i = moving[j];
+          arrived[i] = batch.arrived(j);
+          if (arrived[i]) {
+            *nodes[i].mutable_position() = gotos[i].destination();
+          }
+        }
+        REQUIRE(arrived == expected_arrived);
+      }
+
+      THEN("they follow the same paths") {
+        for (int i = 0; i < nodes.size(); ++i) {
+          REQUIRE_THAT(nodes[i], EqualsProto(expected_nodes[i]));
+        }
+      }
+
+      THEN("nodes that move arrive in time") {
+        REQUIRE_FALSE(arrived[0]);
+        for (int i = 1; i < nodes.size(); ++i) {
+          REQUIRE(arrived[i]);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace troll
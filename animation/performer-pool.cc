@@ -0,0 +1,34 @@
+#include "animation/performer-pool.h"
+
+namespace troll {
+
+void PerformerPool::Deleter::operator()(Performer* performer) const {
+  performer->~Performer();
+  pool->Free(performer);
+}
+
+void* PerformerPool::Allocate() {
+  if (free_list_ == nullptr) {
+    chunks_.push_back(std::make_unique<Block[]>(kChunkSize));
+    auto* chunk = chunks_.back().get();
+    for (int i = kChunkSize - 1; i >= 0; --i) {
+      chunk[i].next = free_list_;
+      free_list_ = &chunk[i];
+    }
+    free_blocks_ += kChunkSize;
+  }
+
+  Block* block = free_list_;
+  free_list_ = block->next;
+  --free_blocks_;
+  return block->storage;
+}
+
+void PerformerPool::Free(void* block) {
+  auto* free_block = static_cast<Block*>(block);
+  free_block->next = free_list_;
+  free_list_ = free_block;
+  ++free_blocks_;
+}
+
+}  // namespace troll
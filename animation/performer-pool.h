@@ -0,0 +1,79 @@
+#ifndef TROLL_ANIMATION_PERFORMER_POOL_H_
+#define TROLL_ANIMATION_PERFORMER_POOL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "animation/performer.h"
+
+namespace troll {
+
+// Recycles the memory of performers, which are created for every step of every
+// running animation script. Blocks of finished performers are kept in a free
+// list and reused by the next ones instead of going back to the heap, so that
+// steady animation churn does not allocate.
+//
+// AnimatorManager owns the pool of the animators it runs. Performers must be
+// destroyed before their pool.
+class PerformerPool {
+ public:
+  PerformerPool() = default;
+  ~PerformerPool() = default;
+
+  // Returns the block of a performer to the pool it was created from.
+  struct Deleter {
+    PerformerPool* pool = nullptr;
+    void operator()(Performer* performer) const;
+  };
+  using Ptr = std::unique_ptr<Performer, Deleter>;
+
+  template <class T, class... Args>
+  Ptr Create(Args&&... args) {
+    static_assert(std::is_base_of<Performer, T>::value,
+                  "PerformerPool only creates performers.");
+    static_assert(sizeof(T) <= kBlockSize && alignof(T) <= kBlockAlign,
+                  "Performer does not fit in a pool block.");
+    return Ptr(new (Allocate()) T(std::forward<Args>(args)...), {this});
+  }
+
+  // Number of blocks allocated from the heap and number of them that are not
+  // used by any performer.
+  int allocated_blocks() const { return chunks_.size() * kChunkSize; }
+  int free_blocks() const { return free_blocks_; }
+
+  PerformerPool(const PerformerPool&) = delete;
+  PerformerPool& operator=(const PerformerPool&) = delete;
+
+ private:
+  static constexpr std::size_t kBlockSize =
+      std::max({sizeof(TranslationPerformer), sizeof(RotationPerformer),
+                sizeof(ScalingPerformer), sizeof(FrameRangePerformer),
+                sizeof(FrameListPerformer), sizeof(FlashPerformer),
+                sizeof(GotoPerformer), sizeof(RunScriptPerformer),
+                sizeof(SfxPerformer)});
+  static constexpr std::size_t kBlockAlign = alignof(std::max_align_t);
+
+  // Number of blocks allocated at once when the free list is empty.
+  static constexpr int kChunkSize = 256;
+
+  union Block {
+    Block* next;
+    alignas(kBlockAlign) unsigned char storage[kBlockSize];
+  };
+
+  void* Allocate();
+  void Free(void* block);
+
+  std::vector<std::unique_ptr<Block[]>> chunks_;
+  Block* free_list_ = nullptr;
+  int free_blocks_ = 0;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_ANIMATION_PERFORMER_POOL_H_
@@ -1,6 +1,7 @@
 #include "animation/performer.h"
 
 #include "animation/animator-manager.h"
+#include "animation/kinematics.h"
 #include "core/event-dispatcher.h"
 #include "core/events.h"
 #include "core/geometry.h"
@@ -17,6 +18,21 @@ bool TranslationPerformer::Execute(SceneNode* scene_node) {
   return true;
 }
 
+bool TranslationPerformer::Batch(int time_since_last_frame,
+                                 SceneNode* scene_node,
+                                 KinematicBatches* batches) {
+  if (!TakeSingleExecution(time_since_last_frame)) return false;
+
+  const auto& vec = animation_.vec();
+  batches->translations.Add(scene_node, vec.x(), vec.y(), vec.z());
+  return true;
+}
+
+bool TranslationPerformer::CompleteBatch(const KinematicBatches& batches,
+                                         SceneNode* scene_node) {
+  return CountRun();
+}
+
 bool RotationPerformer::Execute(SceneNode* scene_node) {
   // TODO(bourdenas): Implement SceneNode rotation.
   return true;
@@ -27,13 +43,13 @@ bool ScalingPerformer::Execute(SceneNode* scene_node) {
   return true;
 }
 
-namespace {
 // Handles key frame changes on nodes taking care of sprite film alignments.
 void SetSceneNodeFrame(int frame_index, VerticalAlign v_align,
                        HorizontalAlign h_align, SceneNode* node, Core* core) {
-  const auto prev_aabb = core->scene_manager()->GetSceneNodeBoundingBox(*node);
+  const auto& sprite = core->resource_manager()->GetSprite(node->sprite_id());
+  const auto& prev_aabb = sprite.film(node->frame_index());
+  const auto& next_aabb = sprite.film(frame_index);
   node->set_frame_index(frame_index);
-  const auto next_aabb = core->scene_manager()->GetSceneNodeBoundingBox(*node);
 
   if (h_align == HorizontalAlign::RIGHT) {
     node->mutable_position()->set_x(node->position().x() + prev_aabb.width() -
@@ -51,7 +67,6 @@ void SetSceneNodeFrame(int frame_index, VerticalAlign v_align,
         node->position().y() + (prev_aabb.height() - next_aabb.height()) / 2);
   }
 }
-}  // namespace
 
 void FrameRangePerformer::Start(SceneNode* scene_node) {
   current_frame_ = animation_.start_frame();
@@ -120,20 +135,47 @@ bool GotoPerformer::Execute(SceneNode* scene_node) {
   return true;
 }
 
-bool TimerPerformer::Execute(SceneNode* _unused) { return true; }
+bool GotoPerformer::Batch(int time_since_last_frame, SceneNode* scene_node,
+                          KinematicBatches* batches) {
+  if (!TakeSingleExecution(time_since_last_frame)) return false;
+
+  const auto& destination = animation_.destination();
+  batch_index_ = batches->gotos.size();
+  batches->gotos.Add(scene_node, destination.x(), destination.y(),
+                     destination.z(), animation_.step());
+  return true;
+}
+
+bool GotoPerformer::CompleteBatch(const KinematicBatches& batches,
+                                  SceneNode* scene_node) {
+  // Nodes that arrive are placed on the destination, like in Execute().
+  if (!batches.gotos.arrived(batch_index_)) return false;
+
+  *scene_node->mutable_position() = animation_.destination();
+  return true;
+}
+
+RunScriptPerformer::~RunScriptPerformer() { UnregisterTermination(); }
 
 void RunScriptPerformer::Start(SceneNode* scene_node) {
-  core_->animator_manager()->Play(
-      core_->resource_manager()->GetAnimationScript(animation_.script_id()),
-      scene_node->id());
-  core_->event_dispatcher()->Register(
-      Events::OnAnimationScriptTermination(scene_node->id(),
-                                           animation_.script_id())
-          .event_id(),
-      [this](const Event&) { finished_ = true; });
+  const auto& script =
+      script_ != nullptr
+          ? *script_
+          : core_->resource_manager()->GetAnimationProgram(
+                animation_.script_id());
+  core_->animator_manager()->Play(script, scene_node->id());
+  event_id_ = Events::OnAnimationScriptTermination(scene_node->id(),
+                                                   animation_.script_id())
+                  .event_id();
+  handler_id_ =
+      core_->event_dispatcher()->Register(event_id_, [this](const Event&) {
+        finished_ = true;
+        handler_id_ = -1;
+      });
 }
 
 void RunScriptPerformer::Stop(const SceneNode& scene_node) {
+  UnregisterTermination();
   core_->animator_manager()->Stop(animation_.script_id(), scene_node.id());
 }
 
@@ -147,6 +189,13 @@ void RunScriptPerformer::Resume(const SceneNode& scene_node) {
 
 bool RunScriptPerformer::Execute(SceneNode* scene_node) { return finished_; }
 
+void RunScriptPerformer::UnregisterTermination() {
+  if (handler_id_ == -1) return;
+
+  core_->event_dispatcher()->Unregister(event_id_, handler_id_);
+  handler_id_ = -1;
+}
+
 void SfxPerformer::Start(SceneNode* scene_node) {
   auto&& on_done = [this]() { finished_ = false; };
   if (!animation_.audio().track().empty()) {
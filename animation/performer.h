@@ -1,14 +1,23 @@
 #ifndef TROLL_ANIMATION_PERFORMER_H_
 #define TROLL_ANIMATION_PERFORMER_H_
 
+#include <string>
 #include <vector>
 
+#include "core/animation-program.h"
 #include "core/core.h"
 #include "proto/animation.pb.h"
 #include "proto/scene-node.pb.h"
 
 namespace troll {
 
+struct KinematicBatches;
+
+// Sets |frame_index| on |node| and moves it so that the new frame keeps the
+// specified alignment with the previous one.
+void SetSceneNodeFrame(int frame_index, VerticalAlign v_align,
+                       HorizontalAlign h_align, SceneNode* node, Core* core);
+
 // Performers makes progress on a specific tasks of an animation, e.g.
 // translation, rotation, frame change, etc.
 class Performer {
@@ -31,6 +40,28 @@ class Performer {
   // Returns true if the Animation was executed to end.
   virtual bool Progress(int time_since_last_frame, SceneNode* scene_node) = 0;
 
+  // Returns the time until the performer executes, if it only waits for its
+  // delay until then. Frames before it can be skipped and their time passed
+  // to the next Progress() call at once. Returns 0 if the performer has to
+  // make progress every frame.
+  virtual int time_until_due() const { return 0; }
+
+  // Adds the execution that is due after |time_since_last_frame| to |batches|
+  // instead of executing it, for performers that only move their node.
+  // Returns false, without making progress, if the performer cannot be
+  // batched or is not due exactly once.
+  virtual bool Batch(int time_since_last_frame, SceneNode* scene_node,
+                     KinematicBatches* batches) {
+    return false;
+  }
+
+  // Completes the execution that Batch() added, once |batches| moved their
+  // nodes. Returns true if the Animation was executed to end.
+  virtual bool CompleteBatch(const KinematicBatches& batches,
+                             SceneNode* scene_node) {
+    return false;
+  }
+
  protected:
   // Actual exectution of the animation aspect. Returns true if animation is
   // finished.
@@ -61,10 +92,33 @@ class RepeatablePerformerBase : public Performer {
     return false;
   }
 
+  int time_until_due() const override {
+    return animation_.delay() - wait_time_;
+  }
+
  protected:
   // Returns true if animation is finished cannot be repeated anymore.
   bool RepeatableExecute(SceneNode* scene_node) {
-    return Execute(scene_node) && ++run_number_ == animation_.repeat();
+    return Execute(scene_node) && CountRun();
+  }
+
+  // Counts an execution that finished a run. Returns true if the animation
+  // cannot be repeated anymore.
+  bool CountRun() { return ++run_number_ == animation_.repeat(); }
+
+  // Takes the time of a single execution off the wait time. Returns false,
+  // without taking it, if |time_since_last_frame| does not make the performer
+  // due exactly once.
+  bool TakeSingleExecution(int time_since_last_frame) {
+    if (animation_.delay() == 0) return true;
+
+    const int wait_time = wait_time_ + time_since_last_frame;
+    if (animation_.delay() < 0 || wait_time < animation_.delay() ||
+        wait_time >= 2 * animation_.delay()) {
+      return false;
+    }
+    wait_time_ = wait_time - animation_.delay();
+    return true;
   }
 
   const AnimationType& animation_;
@@ -93,7 +147,25 @@ class OneOffPerformerBase : public Performer {
     return false;
   }
 
+  int time_until_due() const override {
+    return animation_.delay() - wait_time_;
+  }
+
  protected:
+  // Takes the time of a single execution off the wait time. Returns false,
+  // without taking it, if |time_since_last_frame| does not make the performer
+  // due exactly once. Without a delay, the performer executes until it is
+  // finished in a single progress.
+  bool TakeSingleExecution(int time_since_last_frame) {
+    const int wait_time = wait_time_ + time_since_last_frame;
+    if (animation_.delay() <= 0 || wait_time < animation_.delay() ||
+        wait_time >= 2 * animation_.delay()) {
+      return false;
+    }
+    wait_time_ = wait_time - animation_.delay();
+    return true;
+  }
+
   const AnimationType& animation_;
 
  private:
@@ -121,6 +193,11 @@ class TranslationPerformer : public RepeatablePerformerBase<VectorAnimation> {
   TranslationPerformer(const VectorAnimation& animation)
       : RepeatablePerformerBase<VectorAnimation>(animation) {}
 
+  bool Batch(int time_since_last_frame, SceneNode* scene_node,
+             KinematicBatches* batches) override;
+  bool CompleteBatch(const KinematicBatches& batches,
+                     SceneNode* scene_node) override;
+
  protected:
   bool Execute(SceneNode* scene_node) override;
 };
@@ -196,10 +273,18 @@ class GotoPerformer : public OneOffPerformerBase<GotoAnimation> {
   GotoPerformer(const GotoAnimation& animation)
       : OneOffPerformerBase<GotoAnimation>(animation) {}
 
+  bool Batch(int time_since_last_frame, SceneNode* scene_node,
+             KinematicBatches* batches) override;
+  bool CompleteBatch(const KinematicBatches& batches,
+                     SceneNode* scene_node) override;
+
  protected:
   bool Execute(SceneNode* scene_node) override;
 
  private:
+  // Index of the node in the gotos of the batches it was added to.
+  int batch_index_ = -1;
+
   // Direction vector from current position to destination.
   Vector direction_;
 
@@ -207,19 +292,15 @@ class GotoPerformer : public OneOffPerformerBase<GotoAnimation> {
   double distance_;
 };
 
-class TimerPerformer : public OneOffPerformerBase<TimerAnimation> {
- public:
-  TimerPerformer(const TimerAnimation& animation)
-      : OneOffPerformerBase<TimerAnimation>(animation) {}
-
- protected:
-  bool Execute(SceneNode* _unused) override;
-};
-
 class RunScriptPerformer : public InstantPerformerBase<RunScriptAnimation> {
  public:
-  RunScriptPerformer(const RunScriptAnimation& animation, Core* core)
-      : InstantPerformerBase<RunScriptAnimation>(animation), core_(core) {}
+  // |script| is the program of the script to run if it is already resolved.
+  RunScriptPerformer(const RunScriptAnimation& animation, Core* core,
+                     const AnimationProgram* script = nullptr)
+      : InstantPerformerBase<RunScriptAnimation>(animation),
+        core_(core),
+        script_(script) {}
+  ~RunScriptPerformer() override;
 
   void Start(SceneNode* scene_node) override;
   void Stop(const SceneNode& scene_node) override;
@@ -230,7 +311,16 @@ class RunScriptPerformer : public InstantPerformerBase<RunScriptAnimation> {
   bool Execute(SceneNode* scene_node) override;
 
  private:
+  // Unregisters the handler of the termination of the script, if it did not
+  // fire yet, so that it does not outlive the performer.
+  void UnregisterTermination();
+
   Core* core_;
+  const AnimationProgram* script_;
+
+  // Termination event of the script and the id of its handler or -1.
+  std::string event_id_;
+  int handler_id_ = -1;
 
   bool finished_ = false;
 };
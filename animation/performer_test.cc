@@ -466,21 +466,4 @@ SCENARIO_METHOD(PerformerFixture, "Goto animation", "[performers]") {
   }
 }
 
-SCENARIO_METHOD(PerformerFixture, "Timer animation", "[performers]") {
-  GIVEN("a timer animation") {
-    const auto timer = ParseProto<TimerAnimation>("delay: 1000");
-
-    TimerPerformer performer(timer);
-
-    WHEN("it starts, it needs to pass time equal to delay to terminate") {
-      performer.Start(&scene_node_);
-      REQUIRE_FALSE(performer.Progress(500, &scene_node_));
-      REQUIRE_FALSE(performer.Progress(200, &scene_node_));
-      REQUIRE(performer.Progress(300, &scene_node_));
-      REQUIRE_THAT(scene_node_, EqualsProto(ParseProto<SceneNode>(
-                                    "id: 'node_a' sprite_id: 'sprite_a' ")));
-    }
-  }
-}
-
 }  // namespace troll
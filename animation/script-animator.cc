@@ -2,15 +2,74 @@
 
 #include "core/event-dispatcher.h"
 #include "core/events.h"
+#include "core/resource-manager.h"
 #include "core/scene-manager.h"
 #include "proto/scene-node.pb.h"
 
 namespace troll {
 
+ScriptAnimator::ScriptAnimator(const AnimationScript& script,
+                               std::string scene_node_id, Core* core,
+                               PerformerPool* performers,
+                               AnimationTracks* tracks)
+    : ScriptAnimator(core->resource_manager()->CompileAnimationScript(script),
+                     std::move(scene_node_id), core, performers, tracks) {}
+
+ScriptAnimator::ScriptAnimator(const AnimationScript& script,
+                               NodeHandle scene_node, Core* core,
+                               PerformerPool* performers,
+                               AnimationTracks* tracks)
+    : ScriptAnimator(core->resource_manager()->CompileAnimationScript(script),
+                     scene_node, core, performers, tracks) {}
+
+ScriptAnimator::ScriptAnimator(const AnimationProgram& script,
+                               std::string scene_node_id, Core* core,
+                               PerformerPool* performers,
+                               AnimationTracks* tracks)
+    : core_(core), tracks_(tracks), current_animator_(performers) {
+  Reset(script, std::move(scene_node_id));
+}
+
+ScriptAnimator::ScriptAnimator(const AnimationProgram& script,
+                               NodeHandle scene_node, Core* core,
+                               PerformerPool* performers,
+                               AnimationTracks* tracks)
+    : core_(core), tracks_(tracks), current_animator_(performers) {
+  Reset(script, scene_node);
+}
+
+ScriptAnimator::~ScriptAnimator() {
+  if (current_step_ != -1) {
+    tracks_->ReleaseStep(current_step_);
+  }
+}
+
+void ScriptAnimator::Reset(const AnimationProgram& script,
+                           std::string scene_node_id) {
+  Reset(script, core_->scene_manager()->GetSceneNodeHandle(scene_node_id));
+  scene_node_id_ = std::move(scene_node_id);
+}
+
+void ScriptAnimator::Reset(const AnimationProgram& script,
+                           NodeHandle scene_node) {
+  script_ = &script;
+  scene_node_ = scene_node;
+  const auto* node = core_->scene_manager()->GetSceneNode(scene_node_);
+  scene_node_id_ = node != nullptr ? node->id() : "";
+
+  state_ = State::INIT;
+  next_animation_index_ = 0;
+  run_number_ = 0;
+  if (current_step_ != -1) {
+    tracks_->ReleaseStep(current_step_);
+    current_step_ = -1;
+  }
+}
+
 void ScriptAnimator::Start() {
-  auto* scene_node = core_->scene_manager()->GetSceneNodeById(scene_node_id_);
+  auto* scene_node = core_->scene_manager()->GetSceneNode(scene_node_);
   if (scene_node != nullptr) {
-    core_->scene_manager()->Dirty(*scene_node);
+    core_->scene_manager()->Dirty(scene_node_);
   }
 
   if (!MoveToNextAnimation(scene_node)) {
@@ -22,83 +81,155 @@ void ScriptAnimator::Start() {
 }
 
 void ScriptAnimator::Stop() {
-  const auto* scene_node =
-      core_->scene_manager()->GetSceneNodeById(scene_node_id_);
+  const auto* scene_node = core_->scene_manager()->GetSceneNode(scene_node_);
   if (scene_node != nullptr) {
-    current_animator_->Stop(*scene_node);
-    core_->scene_manager()->Dirty(*scene_node);
+    if (tracks_ == nullptr) {
+      current_animator_.Stop(*scene_node);
+    } else if (current_step_ != -1) {
+      tracks_->StopStep(current_step_, *scene_node);
+    }
+    core_->scene_manager()->Dirty(scene_node_);
   }
   state_ = State::FINISHED;
 }
 
 void ScriptAnimator::Pause() {
-  const auto* scene_node =
-      core_->scene_manager()->GetSceneNodeById(scene_node_id_);
+  const auto* scene_node = core_->scene_manager()->GetSceneNode(scene_node_);
   if (scene_node == nullptr) {
     state_ = State::FINISHED;
     return;
   }
 
-  current_animator_->Pause(*scene_node);
-  core_->scene_manager()->Dirty(*scene_node);
+  if (tracks_ == nullptr) {
+    current_animator_.Pause(*scene_node);
+  } else if (current_step_ != -1) {
+    tracks_->PauseStep(current_step_, *scene_node);
+  }
+  core_->scene_manager()->Dirty(scene_node_);
   state_ = State::PAUSED;
 }
 
 void ScriptAnimator::Resume() {
-  const auto* scene_node =
-      core_->scene_manager()->GetSceneNodeById(scene_node_id_);
+  const auto* scene_node = core_->scene_manager()->GetSceneNode(scene_node_);
   if (scene_node == nullptr) {
     state_ = State::FINISHED;
     return;
   }
 
-  current_animator_->Resume(*scene_node);
-  core_->scene_manager()->Dirty(*scene_node);
+  if (tracks_ == nullptr) {
+    current_animator_.Resume(*scene_node);
+  } else if (current_step_ != -1) {
+    tracks_->ResumeStep(current_step_, *scene_node);
+  }
+  core_->scene_manager()->Dirty(scene_node_);
   state_ = State::RUNNING;
 }
 
 void ScriptAnimator::Progress(int time_since_last_frame) {
   if (!is_running()) return;
 
-  auto* scene_node = core_->scene_manager()->GetSceneNodeById(scene_node_id_);
+  auto* scene_node = core_->scene_manager()->GetSceneNode(scene_node_);
   if (scene_node == nullptr) {
     Stop();
     return;
   }
 
-  core_->scene_manager()->Dirty(*scene_node);
-  if (current_animator_->Progress(time_since_last_frame, scene_node)) {
-    const int index = next_animation_index_ > 0
-                          ? next_animation_index_ - 1
-                          : script_.animation().size() - 1;
-    const auto& animation_id = script_.animation(index).id();
-    if (!animation_id.empty()) {
-      core_->event_dispatcher()->Emit(Events::OnAnimationScriptPartTermination(
-          scene_node->id(), script_.id(), animation_id));
-    }
+  if (tracks_ != nullptr) {
+    tracks_->ProgressStep(current_step_, scene_node_, scene_node,
+                          time_since_last_frame);
+    CompleteProgress();
+    return;
+  }
 
-    if (!MoveToNextAnimation(scene_node)) {
-      Stop();
-    }
+  core_->scene_manager()->Dirty(scene_node_);
+  if (current_animator_.Progress(time_since_last_frame, scene_node)) {
+    FinishAnimation(scene_node);
+  }
+}
+
+bool ScriptAnimator::BatchProgress(int time_since_last_frame,
+                                   KinematicBatches* batches) {
+  if (!is_running() || tracks_ != nullptr) return false;
+
+  auto* scene_node = core_->scene_manager()->GetSceneNode(scene_node_);
+  if (scene_node == nullptr ||
+      !current_animator_.Batch(time_since_last_frame, scene_node, batches)) {
+    return false;
+  }
+  core_->scene_manager()->Dirty(scene_node_);
+  return true;
+}
+
+void ScriptAnimator::CompleteBatchProgress(const KinematicBatches& batches) {
+  auto* scene_node = core_->scene_manager()->GetSceneNode(scene_node_);
+  if (current_animator_.CompleteBatch(batches, scene_node)) {
+    FinishAnimation(scene_node);
+  }
+}
+
+int ScriptAnimator::time_until_due() const {
+  if (tracks_ == nullptr) return current_animator_.time_until_due();
+  return current_step_ != -1 ? tracks_->time_until_due(current_step_) : 0;
+}
+
+void ScriptAnimator::ScheduleProgress(int time_since_last_progress) {
+  if (!is_running()) return;
+
+  auto* scene_node = core_->scene_manager()->GetSceneNode(scene_node_);
+  if (scene_node == nullptr) {
+    Stop();
+    return;
+  }
+
+  tracks_->Schedule(current_step_, scene_node_, scene_node,
+                    time_since_last_progress);
+}
+
+void ScriptAnimator::CompleteProgress() {
+  if (!is_running() || !tracks_->is_finished(current_step_)) return;
+
+  // Finished steps are stopped like Animator stops finished animations.
+  auto* scene_node = core_->scene_manager()->GetSceneNode(scene_node_);
+  tracks_->StopStep(current_step_, *scene_node);
+  FinishAnimation(scene_node);
+}
+
+void ScriptAnimator::FinishAnimation(SceneNode* scene_node) {
+  const int index = next_animation_index_ > 0 ? next_animation_index_ - 1
+                                               : script_->size() - 1;
+  const auto& animation_id = script_->step(index).animation->id();
+  if (!animation_id.empty()) {
+    core_->event_dispatcher()->Emit(Events::OnAnimationScriptPartTermination(
+        scene_node->id(), script_->id(), animation_id));
+  }
+
+  if (!MoveToNextAnimation(scene_node)) {
+    Stop();
   }
 }
 
 bool ScriptAnimator::MoveToNextAnimation(SceneNode* scene_node) {
   if (scene_node == nullptr ||
-      (next_animation_index_ == script_.animation().size() &&
-       ++run_number_ == script_.repeat())) {
+      (next_animation_index_ == script_->size() &&
+       ++run_number_ == script_->repeat())) {
     return false;
   }
 
-  if (next_animation_index_ == script_.animation().size()) {
+  if (next_animation_index_ == script_->size()) {
     core_->event_dispatcher()->Emit(
-        Events::OnAnimationScriptRewind(scene_node->id(), script_.id()));
+        Events::OnAnimationScriptRewind(scene_node->id(), script_->id()));
     next_animation_index_ = 0;
   }
 
-  current_animator_ = std::make_unique<Animator>();
-  current_animator_->Start(script_.animation(next_animation_index_++),
-                           scene_node, core_);
+  const auto& step = script_->step(next_animation_index_++);
+  if (tracks_ == nullptr) {
+    current_animator_.Start(*script_, step, scene_node, core_);
+  } else {
+    if (current_step_ != -1) {
+      tracks_->ReleaseStep(current_step_);
+    }
+    current_step_ = tracks_->StartStep(*script_, step, scene_node);
+  }
   return true;
 }
 
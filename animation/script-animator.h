@@ -1,40 +1,119 @@
 #ifndef TROLL_ANIMATION_SCRIPT_ANIMATOR_H_
 #define TROLL_ANIMATION_SCRIPT_ANIMATOR_H_
 
-#include <memory>
+#include <cstdint>
 #include <string>
 
+#include "animation/animation-tracks.h"
 #include "animation/animator.h"
+#include "core/animation-program.h"
 #include "core/core.h"
+#include "core/node-handle.h"
 #include "proto/animation.pb.h"
 
 namespace troll {
 
 // Runs an animation script, i.e. a sequence of animations on a single
-// scene-node.
+// scene-node. Animations run on an Animator with performers from |performers|,
+// or on |tracks| if it is not null.
+//
+// Scripts run from their compiled program, which must outlive the animator.
+// Scripts that are given as protos are compiled by the resource manager.
 class ScriptAnimator {
  public:
   ScriptAnimator(const AnimationScript& script, std::string scene_node_id,
-                 Core* core)
-      : script_(script),
-        scene_node_id_(std::move(scene_node_id)),
-        core_(core) {}
+                 Core* core, PerformerPool* performers,
+                 AnimationTracks* tracks = nullptr);
+  ScriptAnimator(const AnimationScript& script, NodeHandle scene_node,
+                 Core* core, PerformerPool* performers,
+                 AnimationTracks* tracks = nullptr);
+  ScriptAnimator(const AnimationProgram& script, std::string scene_node_id,
+                 Core* core, PerformerPool* performers,
+                 AnimationTracks* tracks = nullptr);
+  ScriptAnimator(const AnimationProgram& script, NodeHandle scene_node,
+                 Core* core, PerformerPool* performers,
+                 AnimationTracks* tracks = nullptr);
+  ~ScriptAnimator();
+
+  // Reinitialises the animator to run |script| on another scene node as if it
+  // was newly constructed, reusing its allocations. It must not be running.
+  void Reset(const AnimationProgram& script, std::string scene_node_id);
+  void Reset(const AnimationProgram& script, NodeHandle scene_node);
 
   void Start();
   void Stop();
   void Pause();
   void Resume();
 
+  // Scripts that run on tracks are progressed on their own, see
+  // AnimationTracks::ProgressStep().
   void Progress(int time_since_last_frame);
 
+  // Progress in two phases for scripts that run on tracks, so that the tracks
+  // of many scripts are progressed together. ScheduleProgress() is called on
+  // each script, then AnimationTracks::Progress() and then CompleteProgress()
+  // on each script. Only scripts whose scene node no other script animates
+  // make the same progress as with Progress().
+  void ScheduleProgress(int time_since_last_progress);
+  void CompleteProgress();
+
+  // Progress in two phases for scripts that run on performers and only
+  // translate or walk their node, so that the moves of many scripts are
+  // applied together. BatchProgress() returns false, without making progress,
+  // if the script has to progress with Progress() instead. Otherwise
+  // CompleteBatchProgress() is called once |batches| moved their nodes.
+  bool BatchProgress(int time_since_last_frame, KinematicBatches* batches);
+  void CompleteBatchProgress(const KinematicBatches& batches);
+
+  // Returns the time until the script has to make progress again, see
+  // Performer::time_until_due() and AnimationTracks::time_until_due().
+  int time_until_due() const;
+
+  // State that AnimatorManager keeps with each script it runs, in order to
+  // progress the script only when it is due.
+  struct Timing {
+    // Order the script was played in, which scripts make progress in.
+    int64_t sequence = 0;
+    // Time of the manager clock that the script made progress until.
+    int64_t progressed_until = 0;
+    // Time of the manager clock that the script was paused at.
+    int64_t paused_at = 0;
+    // Timer of the script on the timer wheel of the manager or -1.
+    int64_t timer = -1;
+    // Ticket that the script is due with, on the timer wheel or on a list of
+    // scripts of the manager, or 0 if it is not scheduled.
+    int64_t ticket = 0;
+    // Set for a round of a manager with tracks, if the script is progressed on
+    // its own because other scripts animate its scene node.
+    bool progress_alone = false;
+  };
+  Timing* timing() { return &timing_; }
+
+  // Neighbours of the script in the list of scripts that AnimatorManager
+  // keeps for its scene node.
+  struct NodeLink {
+    ScriptAnimator* prev = nullptr;
+    ScriptAnimator* next = nullptr;
+  };
+  NodeLink* node_link() { return &node_link_; }
+
   bool is_running() const { return state_ == State::RUNNING; }
   bool is_finished() const { return state_ == State::FINISHED; }
   bool is_paused() const { return state_ == State::PAUSED; }
 
-  const std::string& script_id() const { return script_.id(); }
+  const AnimationProgram& program() const { return *script_; }
+  const std::string& script_id() const { return script_->id(); }
   const std::string& scene_node_id() const { return scene_node_id_; }
+  NodeHandle scene_node() const { return scene_node_; }
+
+  ScriptAnimator(const ScriptAnimator&) = delete;
+  ScriptAnimator& operator=(const ScriptAnimator&) = delete;
 
  private:
+  // Emits the termination event of the current animation and moves to the
+  // next one.
+  void FinishAnimation(SceneNode* scene_node);
+
   // Returns true if there is a next animation in the script, false if the
   // script is finished.
   bool MoveToNextAnimation(SceneNode* scene_node);
@@ -46,14 +125,25 @@ class ScriptAnimator {
     FINISHED,
   };
 
-  const AnimationScript script_;
-  std::string scene_node_id_;
+  // Members that are read whenever the script makes progress come first, so
+  // that they share cache lines.
+  const AnimationProgram* script_;
+  NodeHandle scene_node_;
   Core* core_;
 
   State state_ = State::INIT;
-  std::unique_ptr<Animator> current_animator_;
+  AnimationTracks* tracks_;
+  // Step of the current animation on |tracks_| or -1.
+  int current_step_ = -1;
   int next_animation_index_ = 0;
   int run_number_ = 0;
+
+  Timing timing_;
+  NodeLink node_link_;
+
+  Animator current_animator_;
+  // Kept only for emitting events after the scene node is gone.
+  std::string scene_node_id_;
 };
 
 }  // namespace troll
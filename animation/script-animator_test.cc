@@ -38,6 +38,7 @@ class ScriptAnimatorFixture {
   CollisionChecker collision_checker_ =
       CollisionChecker(&scene_manager_, nullptr, &core_);
   EventDispatcher event_dispatcher_;
+  PerformerPool performer_pool_;
 
   TestingResourceManager testing_resource_manager_ =
       TestingResourceManager(&resource_manager_);
@@ -55,7 +56,8 @@ SCENARIO_METHOD(ScriptAnimatorFixture, "Script with single animation",
         })");
 
     WHEN("started for running indefinitely") {
-      ScriptAnimator script_animator(script, "node_a", &core_);
+      ScriptAnimator script_animator(script, "node_a", &core_,
+                                     &performer_pool_);
       script_animator.Start();
 
       THEN("script runs forever") {
@@ -87,7 +89,8 @@ SCENARIO_METHOD(ScriptAnimatorFixture, "Script with single animation",
 
     WHEN("started for running a few times") {
       script.mutable_animation(0)->mutable_translation()->set_repeat(3);
-      ScriptAnimator script_animator(script, "node_a", &core_);
+      ScriptAnimator script_animator(script, "node_a", &core_,
+                                     &performer_pool_);
       script_animator.Start();
 
       THEN("script runs until it repeats enough times") {
@@ -157,7 +160,8 @@ SCENARIO_METHOD(ScriptAnimatorFixture, "Script with multiple legs",
         })");
 
     WHEN("started") {
-      ScriptAnimator script_animator(script, "node_a", &core_);
+      ScriptAnimator script_animator(script, "node_a", &core_,
+                                     &performer_pool_);
       script_animator.Start();
 
       THEN("script is running") {
@@ -201,7 +205,8 @@ SCENARIO_METHOD(ScriptAnimatorFixture, "Script with multiple legs",
     }
 
     WHEN("started") {
-      ScriptAnimator script_animator(script, "node_a", &core_);
+      ScriptAnimator script_animator(script, "node_a", &core_,
+                                     &performer_pool_);
       script_animator.Start();
 
       THEN("script is running") {
@@ -274,7 +279,8 @@ SCENARIO_METHOD(ScriptAnimatorFixture, "Script is repeated",
         })");
 
     WHEN("started") {
-      ScriptAnimator script_animator(script, "node_a", &core_);
+      ScriptAnimator script_animator(script, "node_a", &core_,
+                                     &performer_pool_);
       script_animator.Start();
 
       THEN("runs its two legs but does not finish") {
@@ -338,7 +344,8 @@ SCENARIO_METHOD(ScriptAnimatorFixture, "Scripts on nodes that die",
       })");
 
     WHEN("started on a non-existing scene node") {
-      ScriptAnimator script_animator(script, "non_existent_node", &core_);
+      ScriptAnimator script_animator(script, "non_existent_node", &core_,
+                                     &performer_pool_);
       script_animator.Start();
 
       THEN("animation does not start") {
@@ -361,7 +368,8 @@ SCENARIO_METHOD(ScriptAnimatorFixture, "Scripts on nodes that die",
     }
 
     WHEN("started") {
-      ScriptAnimator script_animator(script, "node_a", &core_);
+      ScriptAnimator script_animator(script, "node_a", &core_,
+                                     &performer_pool_);
       script_animator.Start();
 
       THEN("animation runs") {
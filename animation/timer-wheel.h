@@ -0,0 +1,209 @@
+#ifndef TROLL_ANIMATION_TIMER_WHEEL_H_
+#define TROLL_ANIMATION_TIMER_WHEEL_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace troll {
+
+// Hierarchical timer wheel of values that are due at a time in milliseconds.
+// The first wheel has a slot per millisecond and each next wheel has a slot
+// per turn of the previous one. Timers are kept in the slot of the finest
+// wheel that reaches their time and move to finer wheels as time advances, so
+// that scheduling and cancelling take constant time and advancing time only
+// visits the timers that are due, plus the ones that move down a wheel.
+//
+// Timers that are further away than the coarsest wheel reaches wait in its
+// last slot and are placed again when they move down.
+template <class T>
+class TimerWheel {
+ public:
+  TimerWheel() {
+    heads_.fill(-1);
+    tails_.fill(-1);
+  }
+  ~TimerWheel() = default;
+
+  // Schedules |value| to be due at |time|. Timers that are due at or before the
+  // current time are due at the next Advance(). Returns an id of the timer.
+  int64_t Schedule(int64_t time, T value) {
+    int timer;
+    if (free_timers_.empty()) {
+      timer = timers_.size();
+      timers_.emplace_back();
+    } else {
+      timer = free_timers_.back();
+      free_timers_.pop_back();
+    }
+    auto& entry = timers_[timer];
+    entry.value = std::move(value);
+    entry.time = time;
+    Link(timer, std::max(time, now_ + 1));
+    ++size_;
+    return int64_t{entry.generation} << 32 | timer;
+  }
+
+  // Cancels the timer of |id|. Timers that are already due or cancelled are
+  // ignored, so that their ids need not be forgotten when they are due.
+  void Cancel(int64_t id) {
+    const int timer = id & 0xffffffff;
+    if (timer >= timers_.size() || timers_[timer].slot == -1 ||
+        timers_[timer].generation != static_cast<uint32_t>(id >> 32)) {
+      return;
+    }
+    Unlink(timer);
+    Free(timer);
+  }
+
+  // Advances the current time to |time| and appends the values of timers that
+  // are due until then to |due|, in order of their time. Timers that are due
+  // at the same time keep the order they were placed on their slot in.
+  void Advance(int64_t time, std::vector<T>* due) {
+    while (now_ < time) {
+      if (size_ == 0) {
+        now_ = time;
+        return;
+      }
+      ++now_;
+
+      // Timers of the next turn of each wheel move down when the finer wheel
+      // completes a turn.
+      int64_t turns = now_;
+      for (int level = 1; level < kLevels && (turns & kSlotMask) == 0;
+           ++level) {
+        turns >>= kSlotBits;
+        Cascade(level * kSlots + (turns & kSlotMask));
+      }
+
+      int timer = TakeSlot(now_ & kSlotMask);
+      while (timer != -1) {
+        const int next = timers_[timer].next;
+        if (timers_[timer].time <= now_) {
+          due->push_back(std::move(timers_[timer].value));
+          Free(timer);
+        } else {
+          Link(timer, timers_[timer].time);
+        }
+        timer = next;
+      }
+    }
+  }
+
+  // Cancels all timers.
+  void Clear() {
+    for (int timer = 0; timer < timers_.size(); ++timer) {
+      if (timers_[timer].slot != -1) Free(timer);
+    }
+    heads_.fill(-1);
+    tails_.fill(-1);
+  }
+
+  int64_t now() const { return now_; }
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+ private:
+  static constexpr int kSlotBits = 6;
+  static constexpr int kSlots = 1 << kSlotBits;
+  static constexpr int64_t kSlotMask = kSlots - 1;
+  // Four wheels reach 2^24 ms, which is more than four hours ahead.
+  static constexpr int kLevels = 4;
+
+  struct Timer {
+    T value;
+    int64_t time = 0;
+
+    // Incremented when the timer is freed, so that ids of freed timers can be
+    // told apart from the ones that reuse them.
+    uint32_t generation = 0;
+
+    // Slot of the timer and its neighbours in the slot, or -1.
+    int slot = -1;
+    int prev = -1;
+    int next = -1;
+  };
+
+  // Adds |timer| to the slot of the finest wheel that reaches |time|, which
+  // must not be before the current time.
+  void Link(int timer, int64_t time) {
+    int64_t delta = time - now_;
+    int level = 0;
+    while (level < kLevels - 1 && delta >> ((level + 1) * kSlotBits) != 0) {
+      ++level;
+    }
+    if (delta >> (kLevels * kSlotBits) != 0) {
+      time = now_ + (int64_t{1} << (kLevels * kSlotBits)) - 1;
+    }
+    const int slot =
+        level * kSlots + ((time >> (level * kSlotBits)) & kSlotMask);
+
+    auto& entry = timers_[timer];
+    entry.slot = slot;
+    entry.prev = tails_[slot];
+    entry.next = -1;
+    if (entry.prev != -1) {
+      timers_[entry.prev].next = timer;
+    } else {
+      heads_[slot] = timer;
+    }
+    tails_[slot] = timer;
+  }
+
+  void Unlink(int timer) {
+    auto& entry = timers_[timer];
+    if (entry.prev != -1) {
+      timers_[entry.prev].next = entry.next;
+    } else {
+      heads_[entry.slot] = entry.next;
+    }
+    if (entry.next != -1) {
+      timers_[entry.next].prev = entry.prev;
+    } else {
+      tails_[entry.slot] = entry.prev;
+    }
+    entry.slot = -1;
+  }
+
+  void Free(int timer) {
+    timers_[timer].slot = -1;
+    ++timers_[timer].generation;
+    free_timers_.push_back(timer);
+    --size_;
+  }
+
+  // Empties |slot| and returns the first of its timers, which stay chained.
+  int TakeSlot(int slot) {
+    const int timer = heads_[slot];
+    heads_[slot] = -1;
+    tails_[slot] = -1;
+    return timer;
+  }
+
+  // Places the timers of |slot| again, on finer wheels.
+  void Cascade(int slot) {
+    int timer = TakeSlot(slot);
+    while (timer != -1) {
+      const int next = timers_[timer].next;
+      Link(timer, std::max(timers_[timer].time, now_));
+      timer = next;
+    }
+  }
+
+  int64_t now_ = 0;
+  int size_ = 0;
+
+  // First and last timers of each slot.
+  std::array<int, kLevels * kSlots> heads_;
+  std::array<int, kLevels * kSlots> tails_;
+  std::vector<Timer> timers_;
+  std::vector<int> free_timers_;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_ANIMATION_TIMER_WHEEL_H_
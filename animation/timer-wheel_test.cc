@@ -0,0 +1,140 @@
+#include "animation/timer-wheel.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace troll {
+
+SCENARIO("Timers are due at their time", "[timer_wheel]") {
+  GIVEN("a timer wheel") {
+    TimerWheel<int> wheel;
+    std::vector<int> due;
+
+    WHEN("timers are scheduled on different wheels") {
+      wheel.Schedule(5, 1);
+      wheel.Schedule(70, 2);
+      wheel.Schedule(5000, 3);
+      wheel.Schedule(300000, 4);
+      REQUIRE(wheel.size() == 4);
+
+      THEN("each is due once its time is reached") {
+        wheel.Advance(4, &due);
+        REQUIRE(due.empty());
+        wheel.Advance(5, &due);
+        REQUIRE(due == std::vector<int>{1});
+
+        wheel.Advance(69, &due);
+        REQUIRE(due == std::vector<int>{1});
+        wheel.Advance(100, &due);
+        REQUIRE(due == std::vector<int>{1, 2});
+
+        wheel.Advance(4999, &due);
+        REQUIRE(due == std::vector<int>{1, 2});
+        wheel.Advance(5000, &due);
+        REQUIRE(due == std::vector<int>{1, 2, 3});
+
+        wheel.Advance(299999, &due);
+        REQUIRE(due == std::vector<int>{1, 2, 3});
+        wheel.Advance(300016, &due);
+        REQUIRE(due == std::vector<int>{1, 2, 3, 4});
+        REQUIRE(wheel.empty());
+      }
+    }
+
+    WHEN("a timer is cancelled") {
+      wheel.Schedule(10, 1);
+      const int64_t timer = wheel.Schedule(10, 2);
+      wheel.Schedule(10, 3);
+      wheel.Cancel(timer);
+
+      THEN("it is never due") {
+        wheel.Advance(20, &due);
+        std::sort(due.begin(), due.end());
+        REQUIRE(due == std::vector<int>{1, 3});
+      }
+    }
+
+    WHEN("a timer is cancelled after it is due") {
+      const int64_t timer = wheel.Schedule(10, 1);
+      wheel.Advance(10, &due);
+      wheel.Schedule(20, 2);
+      wheel.Cancel(timer);
+
+      THEN("timers that reuse it are not cancelled") {
+        wheel.Advance(20, &due);
+        REQUIRE(due == std::vector<int>{1, 2});
+      }
+    }
+
+    WHEN("a timer is scheduled in the past") {
+      wheel.Advance(100, &due);
+      wheel.Schedule(50, 1);
+
+      THEN("it is due at the next advance") {
+        REQUIRE(due.empty());
+        wheel.Advance(101, &due);
+        REQUIRE(due == std::vector<int>{1});
+      }
+    }
+  }
+}
+
+SCENARIO("Timer wheels agree with a sorted list of timers", "[timer_wheel]") {
+  GIVEN("timers that are scheduled and cancelled at random") {
+    std::mt19937 random(17);
+    TimerWheel<int> wheel;
+    // Time and value of timers that are not due yet, by timer id.
+    std::unordered_map<int64_t, std::pair<int64_t, int>> expected_timers;
+    std::vector<int64_t> ids;
+
+    int64_t now = 0;
+    int next_value = 0;
+    bool agree = true;
+    for (int frame = 0; frame < 2000; ++frame) {
+      for (int i = random() % 4; i > 0; --i) {
+        // Mostly short delays, with some on the coarser wheels.
+        const int64_t delay = random() % 3 == 0 ? random() % 300000
+                                                : random() % 200;
+        const int64_t id = wheel.Schedule(now + delay, next_value);
+        expected_timers[id] = {now + delay, next_value++};
+        ids.push_back(id);
+      }
+      if (!ids.empty() && random() % 3 == 0) {
+        const int index = random() % ids.size();
+        wheel.Cancel(ids[index]);
+        ids.erase(ids.begin() + index);
+      }
+
+      now += random() % 40 + 1;
+      std::vector<int> due;
+      wheel.Advance(now, &due);
+
+      std::vector<int> expected_due;
+      for (int i = 0; i < ids.size();) {
+        if (expected_timers[ids[i]].first <= now) {
+          expected_due.push_back(expected_timers[ids[i]].second);
+          ids.erase(ids.begin() + i);
+        } else {
+          ++i;
+        }
+      }
+      std::sort(due.begin(), due.end());
+      std::sort(expected_due.begin(), expected_due.end());
+      agree = agree && due == expected_due;
+    }
+
+    THEN("the same timers are due in each frame") {
+      REQUIRE(agree);
+      REQUIRE(wheel.size() == ids.size());
+    }
+  }
+}
+
+}  // namespace troll
@@ -0,0 +1,51 @@
+#include "core/animation-program.h"
+
+#include <utility>
+
+namespace troll {
+
+AnimationProgram::AnimationProgram(AnimationScript script)
+    : script_(std::move(script)) {
+  steps_.reserve(script_.animation_size());
+  for (const auto& animation : script_.animation()) {
+    Step step;
+    step.animation = &animation;
+    step.wait_for_all = animation.termination() == Animation::ALL;
+    step.first_instruction = instructions_.size();
+    CompileAnimation(animation, &instructions_);
+    step.end_instruction = instructions_.size();
+    steps_.push_back(step);
+  }
+}
+
+void AnimationProgram::CompileAnimation(
+    const Animation& animation, std::vector<Instruction>* instructions) {
+  // Instructions follow the order in which Animator performs the parts.
+  const auto add = [instructions](Op op) {
+    instructions->push_back(Instruction{op});
+  };
+  if (animation.has_translation()) add(Op::TRANSLATION);
+  if (animation.has_rotation()) add(Op::ROTATION);
+  if (animation.has_scaling()) add(Op::SCALING);
+  if (animation.has_frame_range()) add(Op::FRAME_RANGE);
+  if (animation.has_frame_list()) add(Op::FRAME_LIST);
+  if (animation.has_flash()) add(Op::FLASH);
+  if (animation.has_go_to()) add(Op::GO_TO);
+  if (animation.has_timer()) add(Op::TIMER);
+  if (animation.has_run_script()) add(Op::RUN_SCRIPT);
+  if (animation.has_sfx()) add(Op::SFX);
+}
+
+void AnimationProgram::Link(const ScriptResolver& resolve_script) {
+  for (const auto& step : steps_) {
+    for (int i = step.first_instruction; i < step.end_instruction; ++i) {
+      auto& instruction = instructions_[i];
+      if (instruction.op == Op::RUN_SCRIPT) {
+        instruction.script =
+            resolve_script(step.animation->run_script().script_id());
+      }
+    }
+  }
+}
+
+}  // namespace troll
@@ -0,0 +1,99 @@
+#ifndef TROLL_CORE_ANIMATION_PROGRAM_H_
+#define TROLL_CORE_ANIMATION_PROGRAM_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "proto/animation.pb.h"
+
+namespace troll {
+
+// Immutable compiled form of an AnimationScript, which is shared by all
+// animators that run the script instead of each one copying it. Each
+// animation of the script is a step and the parts of a step are listed as
+// instructions in the order they are performed, so that animators do not
+// inspect the proto to find them.
+class AnimationProgram {
+ public:
+  enum class Op : uint8_t {
+    TRANSLATION,
+    ROTATION,
+    SCALING,
+    FRAME_RANGE,
+    FRAME_LIST,
+    FLASH,
+    GO_TO,
+    TIMER,
+    RUN_SCRIPT,
+    SFX,
+  };
+
+  struct Instruction {
+    Op op;
+
+    // Program of the script that a RUN_SCRIPT instruction runs. Null if the
+    // script was not known when the program was linked.
+    const AnimationProgram* script = nullptr;
+  };
+
+  struct Step {
+    // Animation of the step, which holds the parameters of its parts.
+    const Animation* animation;
+    bool wait_for_all;
+
+    // Instructions of the step are [first_instruction, end_instruction).
+    int first_instruction;
+    int end_instruction;
+  };
+
+  using ScriptResolver =
+      std::function<const AnimationProgram*(const std::string& script_id)>;
+
+  explicit AnimationProgram(AnimationScript script);
+  ~AnimationProgram() = default;
+
+  // Appends the instructions of the parts of |animation| to |instructions|.
+  static void CompileAnimation(const Animation& animation,
+                               std::vector<Instruction>* instructions);
+
+  // Resolves the programs of scripts that are run by this one. Called by the
+  // owner of the program after all scripts it knows of are compiled.
+  void Link(const ScriptResolver& resolve_script);
+
+  const AnimationScript& script() const { return script_; }
+  const std::string& id() const { return script_.id(); }
+  int repeat() const { return script_.repeat(); }
+
+  // Counts the scripts that run the program. Owners of programs may evict the
+  // ones that no script runs, so programs are retained while they are run.
+  void Retain() const { ++users_; }
+  void Release() const { --users_; }
+  int users() const { return users_; }
+
+  int size() const { return steps_.size(); }
+  const Step& step(int index) const { return steps_[index]; }
+
+  const Instruction* begin(const Step& step) const {
+    return instructions_.data() + step.first_instruction;
+  }
+  const Instruction* end(const Step& step) const {
+    return instructions_.data() + step.end_instruction;
+  }
+
+  AnimationProgram(const AnimationProgram&) = delete;
+  AnimationProgram& operator=(const AnimationProgram&) = delete;
+
+ private:
+  AnimationScript script_;
+  std::vector<Step> steps_;
+  std::vector<Instruction> instructions_;
+
+  // The only mutable state, as the program is shared by animators.
+  mutable int users_ = 0;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_ANIMATION_PROGRAM_H_
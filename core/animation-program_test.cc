@@ -0,0 +1,167 @@
+#include "core/animation-program.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <vector>
+
+#include "core/resource-manager.h"
+#include "troll-test/test-util.h"
+#include "troll-test/testing-resource-manager.h"
+
+namespace troll {
+
+namespace {
+using Op = AnimationProgram::Op;
+
+std::vector<Op> Ops(const AnimationProgram& program, int step) {
+  std::vector<Op> ops;
+  const auto& program_step = program.step(step);
+  for (const auto* instruction = program.begin(program_step);
+       instruction != program.end(program_step); ++instruction) {
+    ops.push_back(instruction->op);
+  }
+  return ops;
+}
+}  // namespace
+
+SCENARIO("Animation scripts are compiled into programs",
+         "[animation_program]") {
+  GIVEN("a script with composite animations") {
+    const AnimationProgram program(ParseProto<AnimationScript>(R"(
+        id: 'script_a'
+        animation {
+          termination: ALL
+          timer { delay: 30 }
+          frame_list { frame: [ 1, 2 ] }
+          translation { vec { x: 1 } }
+        }
+        animation { }
+        animation {
+          sfx { audio { sfx { id: 'sfx_a' } } }
+          run_script { script_id: 'script_b' }
+        }
+        repeat: 2)"));
+
+    THEN("each animation becomes a step") {
+      REQUIRE(program.id() == "script_a");
+      REQUIRE(program.repeat() == 2);
+      REQUIRE(program.size() == 3);
+      REQUIRE(program.step(0).wait_for_all);
+      REQUIRE_FALSE(program.step(2).wait_for_all);
+      REQUIRE(program.step(1).animation == &program.script().animation(1));
+    }
+
+    THEN("parts are listed in the order they are performed") {
+      REQUIRE(Ops(program, 0) ==
+              std::vector<Op>{Op::TRANSLATION, Op::FRAME_LIST, Op::TIMER});
+      REQUIRE(Ops(program, 1).empty());
+      REQUIRE(Ops(program, 2) == std::vector<Op>{Op::RUN_SCRIPT, Op::SFX});
+    }
+
+    THEN("scripts that are run are not resolved before linking") {
+      REQUIRE(program.begin(program.step(2))->script == nullptr);
+    }
+  }
+
+  GIVEN("a resource manager with loaded scripts") {
+    ResourceManager resource_manager;
+    TestingResourceManager testing_resource_manager(&resource_manager);
+    testing_resource_manager.SetTestAnimationScript(
+        ParseProto<AnimationScript>(R"(
+            id: 'script_a'
+            animation { run_script { script_id: 'script_b' } })"));
+    testing_resource_manager.SetTestAnimationScript(
+        ParseProto<AnimationScript>(R"(
+            id: 'script_b'
+            animation { timer { delay: 10 } })"));
+
+    WHEN("a loaded script runs another loaded script") {
+      const auto& program = resource_manager.GetAnimationProgram("script_a");
+
+      THEN("the program of the other script is linked") {
+        REQUIRE(program.begin(program.step(0))->script ==
+                &resource_manager.GetAnimationProgram("script_b"));
+      }
+    }
+
+    WHEN("inline scripts are compiled") {
+      const auto script = ParseProto<AnimationScript>(R"(
+          id: 'inline'
+          animation { run_script { script_id: 'script_b' } })");
+      const auto& program = resource_manager.CompileAnimationScript(script);
+
+      THEN("equal scripts share the same program") {
+        REQUIRE(&resource_manager.CompileAnimationScript(script) == &program);
+      }
+
+      THEN("different scripts get different programs") {
+        auto other = script;
+        other.set_repeat(3);
+        REQUIRE(&resource_manager.CompileAnimationScript(other) != &program);
+      }
+
+      THEN("they are linked to loaded scripts") {
+        REQUIRE(program.begin(program.step(0))->script ==
+                &resource_manager.GetAnimationProgram("script_b"));
+      }
+
+      AND_WHEN("many other inline scripts are compiled") {
+        program.Retain();
+        auto other = script;
+        for (int i = 0; i < 1000; ++i) {
+          other.set_repeat(i + 1);
+          resource_manager.CompileAnimationScript(other);
+        }
+
+        THEN("programs are kept until the end of the frame") {
+          REQUIRE(testing_resource_manager.inline_program_count() == 1001);
+        }
+
+        AND_WHEN("the frame ends") {
+          resource_manager.EvictInlinePrograms();
+
+          THEN("programs that are not run are evicted") {
+            REQUIRE(testing_resource_manager.inline_program_count() == 1);
+          }
+
+          THEN("programs that are run are kept") {
+            REQUIRE(&resource_manager.CompileAnimationScript(script) ==
+                    &program);
+          }
+        }
+      }
+    }
+
+    WHEN("an inline script is pinned") {
+      auto script = ParseProto<AnimationScript>(R"(
+          id: 'inline'
+          animation { timer { delay: 10 } })");
+      resource_manager.PinAnimationScript(script);
+      const auto& program = resource_manager.CompileAnimationScript(script);
+
+      THEN("its program is looked up by the address of the script") {
+        auto copy = script;
+        REQUIRE(&resource_manager.CompileAnimationScript(copy) == &program);
+        script.set_repeat(3);
+        REQUIRE(&resource_manager.CompileAnimationScript(script) == &program);
+      }
+
+      THEN("its program is not evicted") {
+        resource_manager.EvictInlinePrograms();
+        REQUIRE(testing_resource_manager.inline_program_count() == 1);
+        REQUIRE(program.users() == 1);
+      }
+
+      AND_WHEN("it is unpinned") {
+        resource_manager.UnpinAnimationScript(script);
+
+        THEN("its program is no longer run") {
+          REQUIRE(program.users() == 0);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace troll
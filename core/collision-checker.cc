@@ -1,156 +1,682 @@
 #include "core/collision-checker.h"
 
-#include <unordered_set>
+#include <algorithm>
+#include <cstdlib>
 
-#include <range/v3/action/sort.hpp>
-#include <range/v3/algorithm/any_of.hpp>
-#include <range/v3/view/indirect.hpp>
-#include <range/v3/view/unique.hpp>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TROLL_COLLISION_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TROLL_COLLISION_SSE2
+#endif
 
 #include "action/action-manager.h"
 #include "core/geometry.h"
 #include "core/resource-manager.h"
+#include "core/thread-pool.h"
 
 namespace troll {
 
+CollisionChecker::~CollisionChecker() {
+  for (const auto* script : pinned_scripts_) {
+    core_->resource_manager()->UnpinAnimationScript(*script);
+  }
+}
+
 void CollisionChecker::RegisterCollision(const CollisionAction& collision) {
-  collision_directory_.push_back(collision);
+  PinAnimationScripts(
+      rules_.Register(CollisionRules::RuleType::COLLISION, collision));
 }
 
 void CollisionChecker::RegisterOverlap(const CollisionAction& overlap) {
-  overlap_directory_.push_back(overlap);
+  PinAnimationScripts(
+      rules_.Register(CollisionRules::RuleType::OVERLAP, overlap));
 }
 
 void CollisionChecker::RegisterDetachment(const CollisionAction& detaching) {
-  detachment_directory_.push_back(detaching);
+  PinAnimationScripts(
+      rules_.Register(CollisionRules::RuleType::DETACHMENT, detaching));
+}
+
+void CollisionChecker::PinAnimationScripts(const CollisionAction& rule) {
+  for (const auto& action : rule.action()) {
+    if (!action.play_animation_script().has_script()) continue;
+
+    const auto& script = action.play_animation_script().script();
+    core_->resource_manager()->PinAnimationScript(script);
+    pinned_scripts_.push_back(&script);
+  }
+}
+
+void CollisionChecker::Dirty(NodeHandle handle) {
+  dirty_nodes_.push_back(handle);
 }
 
-void CollisionChecker::Dirty(const SceneNode& node) {
-  dirty_nodes_.push_back(&node);
+namespace {
+// Returns a copy of |node| with only the fields needed for matching collision
+// actions.
+SceneNode MakeNodeStub(const SceneNode& node) {
+  SceneNode stub;
+  stub.set_id(node.id());
+  stub.set_sprite_id(node.sprite_id());
+  return stub;
+}
+}  // namespace
+
+void CollisionChecker::RemoveSceneNode(NodeHandle handle) {
+  grid_.Remove(handle);
+  dirty_nodes_.erase(
+      std::remove(dirty_nodes_.begin(), dirty_nodes_.end(), handle),
+      dirty_nodes_.end());
+
+  const auto [begin, end] = GetCachedPairs(handle);
+  if (begin == end) return;
+
+  // Pairs with a deleted node are never tested again, so they detach now.
+  const auto* node = scene_manager_->GetSceneNode(handle);
+  if (node != nullptr &&
+      !rules_.empty(CollisionRules::RuleType::DETACHMENT)) {
+    for (auto it = begin; it != end; ++it) {
+      const auto* other = scene_manager_->GetSceneNode(it->second);
+      if (other == nullptr) continue;
+      removed_pairs_.push_back(
+          {{handle, it->second}, MakeNodeStub(*node), MakeNodeStub(*other)});
+    }
+  }
+  collision_cache_.erase(
+      std::remove_if(collision_cache_.begin(), collision_cache_.end(),
+                     [handle](const NodePair& pair) {
+                       return pair.first == handle || pair.second == handle;
+                     }),
+      collision_cache_.end());
 }
 
 namespace {
-std::pair<const SceneNode*, const SceneNode*> MakeOrderedPair(
-    const SceneNode* left, const SceneNode* right) {
+std::pair<NodeHandle, NodeHandle> MakeOrderedPair(NodeHandle left,
+                                                  NodeHandle right) {
   return (left < right) ? std::make_pair(left, right)
                         : std::make_pair(right, left);
 }
+
+template <class T>
+void SortUnique(std::vector<T>* values) {
+  std::sort(values->begin(), values->end());
+  values->erase(std::unique(values->begin(), values->end()), values->end());
+}
 }  // namespace
 
 void CollisionChecker::CheckCollisions() {
-  const auto& scene_nodes = scene_manager_->GetSceneNodes();
-  std::set<std::pair<const SceneNode*, const SceneNode*>> collision_pairs;
-  std::set<std::pair<const SceneNode*, const SceneNode*>> detach_pairs;
+  pairs_tested_ = 0;
+  collision_pairs_.clear();
+  detach_pairs_.clear();
+  swept_pairs_.clear();
+  motions_.clear();
+  SortUnique(&dirty_nodes_);
+
+  // Node fields of the broad phase are read from the store, which is not
+  // modified until actions are triggered.
+  const auto& store = scene_manager_->GetSceneNodeStore();
 
-  dirty_nodes_ |= ranges::action::sort;
-  for (const auto& lhs :
-       dirty_nodes_ | ranges::view::unique | ranges::view::indirect) {
-    const auto lhs_aabb = scene_manager_->GetSceneNodeBoundingBox(lhs);
+  // Re-index nodes that moved before querying the grid, so that pairs of dirty
+  // nodes are found from either side. Static nodes are indexed by the
+  // SceneManager instead.
+  for (const auto handle : dirty_nodes_) {
+    if (!scene_manager_->HasSceneNode(handle)) continue;
+    if (store.is_static(handle.index)) {
+      grid_.Remove(handle);
+    } else {
+      const auto& aabb = store.aabb(handle.index);
+
+      // Nodes that moved further than their extent are swept from their
+      // previous position to find what they passed through.
+      if (grid_.Contains(handle)) {
+        const auto& previous = grid_.GetBoundingBox(handle);
+        const int dx = aabb.left - previous.left();
+        const int dy = aabb.top - previous.top();
+        if (std::abs(dx) > aabb.width || std::abs(dy) > aabb.height) {
+          motions_.push_back({handle, dx, dy});
+        }
+      }
+      grid_.Update(handle, geo::ToBox(aabb));
+    }
+
+    // The sprite or layers of a dirty node may have changed.
+    if (handle.index < node_info_.size()) {
+      node_info_[handle.index].version = -1;
+    }
+  }
+
+  std::vector<NodeHandle> candidates;
+  for (const auto lhs_handle : dirty_nodes_) {
+    if (!scene_manager_->HasSceneNode(lhs_handle)) continue;
+
+    const auto lhs_aabb = GetBoundingBox(store, lhs_handle);
+    const auto lhs_info = GetNodeInfo(lhs_handle);
+    const auto [begin, end] = GetCachedPairs(lhs_handle);
+
+    // Nodes that are not tested against any layer never collide.
+    if (lhs_info.mask == 0 && begin == end) continue;
+
+    // Fast moving nodes query the whole area they swept.
+    Rect query = geo::ToRect(lhs_aabb);
+    const auto* lhs_motion = GetMotion(lhs_handle);
+    if (lhs_motion != nullptr) {
+      Rect previous = query;
+      previous.left -= lhs_motion->dx;
+      previous.top -= lhs_motion->dy;
+      query = geo::Union(query, previous);
+    }
+
+    // Nodes previously colliding with lhs are candidates even if they are no
+    // longer in the same cells, so that they can detach.
+    candidates = grid_.Query(geo::ToBox(query));
+    scene_manager_->GetStaticSceneNodes(query, &candidates);
+    for (auto it = begin; it != end; ++it) {
+      candidates.push_back(it->second);
+    }
+    SortUnique(&candidates);
 
-    for (const auto& rhs : scene_nodes) {
+    for (const auto rhs_handle : candidates) {
       // Skip if collision checking with self.
-      if (&lhs == &rhs) continue;
+      if (rhs_handle == lhs_handle) continue;
 
-      const auto rhs_aabb = scene_manager_->GetSceneNodeBoundingBox(rhs);
+      const auto rhs_info = GetNodeInfo(rhs_handle);
+      const auto pair = MakeOrderedPair(lhs_handle, rhs_handle);
 
-      if (!geo::Collide(lhs_aabb, rhs_aabb)) {
-        const auto pair = MakeOrderedPair(&lhs, &rhs);
-        if (collision_cache_.find(pair) != collision_cache_.end()) {
-          detach_pairs.insert(pair);
-        }
+      // Pairs in incompatible layers are not tested, but they detach if their
+      // layers changed while colliding.
+      if ((lhs_info.layer & rhs_info.mask) == 0 ||
+          (rhs_info.layer & lhs_info.mask) == 0) {
+        if (IsCached(pair)) detach_pairs_.push_back(pair);
         continue;
       }
 
-      const auto& lhs_mask = core_->resource_manager()->GetSpriteCollisionMask(
-          lhs.sprite_id(), lhs.frame_index());
-      const auto& rhs_mask = core_->resource_manager()->GetSpriteCollisionMask(
-          rhs.sprite_id(), rhs.frame_index());
-      bool collision = internal::SceneNodePixelsCollide(lhs_aabb, rhs_aabb,
-                                                        lhs_mask, rhs_mask);
-
-      if (!collision) {
-        const auto pair = MakeOrderedPair(&lhs, &rhs);
-        if (collision_cache_.find(pair) != collision_cache_.end()) {
-          detach_pairs.insert(pair);
+      // Pairs that no rule cares about are not tested.
+      if (!rules_.HasRules(lhs_info.keys, rhs_info.keys)) continue;
+
+      const auto rhs_aabb = GetBoundingBox(store, rhs_handle);
+
+      ++pairs_tested_;
+      if (!geo::Collide(lhs_aabb, rhs_aabb)) {
+        if (IsCached(pair)) {
+          detach_pairs_.push_back(pair);
+        } else if (!motions_.empty() &&
+                   SweptCollide(lhs_handle, lhs_aabb, rhs_handle, rhs_aabb)) {
+          swept_pairs_.push_back(pair);
         }
         continue;
       }
 
-      collision_pairs.insert(MakeOrderedPair(&lhs, &rhs));
+      // Pixel masks are tested after all pairs are found, so that they can be
+      // tested in parallel.
+      narrow_phase_.push_back({pair, lhs_aabb, rhs_aabb,
+                               &store.collision_mask(lhs_handle.index),
+                               &store.collision_mask(rhs_handle.index),
+                               &store.collision_pyramid(lhs_handle.index),
+                               &store.collision_pyramid(rhs_handle.index)});
     }
   }
   dirty_nodes_.clear();
 
-  for (const auto [lhs, rhs] : detach_pairs) {
-    collision_cache_.erase(MakeOrderedPair(lhs, rhs));
-    TriggerCollisionAction(*lhs, *rhs, detachment_directory_);
+  RunNarrowPhase();
+
+  // Results are merged in the order pairs were found, regardless of the
+  // threads that tested them.
+  for (int i = 0; i < narrow_phase_.size(); ++i) {
+    const auto& pair = narrow_phase_[i].pair;
+    if (narrow_phase_results_[i]) {
+      collision_pairs_.push_back(pair);
+    } else if (IsCached(pair)) {
+      detach_pairs_.push_back(pair);
+    }
+  }
+  narrow_phase_.clear();
+
+  SortUnique(&collision_pairs_);
+  SortUnique(&detach_pairs_);
+  SortUnique(&swept_pairs_);
+  new_pairs_.clear();
+  for (const auto& pair : collision_pairs_) {
+    if (!IsCached(pair)) new_pairs_.push_back(pair);
+  }
+  UpdateCollisionCache();
+
+  // Actions may delete nodes, which adds to removed pairs.
+  const auto removed_pairs = std::move(removed_pairs_);
+  removed_pairs_.clear();
+  for (const auto& removed_pair : removed_pairs) {
+    TriggerCollisionAction(removed_pair.handles.first,
+                           rules_.GetNodeKeys(removed_pair.lhs),
+                           removed_pair.handles.second,
+                           rules_.GetNodeKeys(removed_pair.rhs),
+                           CollisionRules::RuleType::DETACHMENT);
+  }
+
+  for (const auto& [lhs, rhs] : detach_pairs_) {
+    TriggerCollisionAction(lhs, GetNodeInfo(lhs).keys, rhs,
+                           GetNodeInfo(rhs).keys,
+                           CollisionRules::RuleType::DETACHMENT);
+  }
+
+  for (const auto& [lhs, rhs] : collision_pairs_) {
+    const auto lhs_keys = GetNodeInfo(lhs).keys;
+    const auto rhs_keys = GetNodeInfo(rhs).keys;
+    if (std::binary_search(new_pairs_.begin(), new_pairs_.end(),
+                           NodePair(lhs, rhs))) {
+      TriggerCollisionAction(lhs, lhs_keys, rhs, rhs_keys,
+                             CollisionRules::RuleType::COLLISION);
+    }
+
+    TriggerCollisionAction(lhs, lhs_keys, rhs, rhs_keys,
+                           CollisionRules::RuleType::OVERLAP);
   }
 
-  for (const auto [lhs, rhs] : collision_pairs) {
-    const auto pair = MakeOrderedPair(lhs, rhs);
-    if (collision_cache_.find(pair) == collision_cache_.end()) {
-      collision_cache_.insert(pair);
-      TriggerCollisionAction(*lhs, *rhs, collision_directory_);
+  for (const auto& [lhs, rhs] : swept_pairs_) {
+    const auto lhs_keys = GetNodeInfo(lhs).keys;
+    const auto rhs_keys = GetNodeInfo(rhs).keys;
+    TriggerCollisionAction(lhs, lhs_keys, rhs, rhs_keys,
+                           CollisionRules::RuleType::COLLISION);
+    TriggerCollisionAction(lhs, lhs_keys, rhs, rhs_keys,
+                           CollisionRules::RuleType::OVERLAP);
+  }
+}
+
+void CollisionChecker::RunNarrowPhase() {
+  narrow_phase_results_.resize(narrow_phase_.size());
+  const auto test_range = [this](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      const auto& test = narrow_phase_[i];
+      narrow_phase_results_[i] = internal::SceneNodePixelsCollide(
+          test.lhs_aabb, test.rhs_aabb, *test.lhs_mask, *test.rhs_mask,
+          *test.lhs_pyramid, *test.rhs_pyramid);
     }
+  };
+
+  auto* thread_pool = core_->thread_pool();
+  if (thread_pool == nullptr ||
+      narrow_phase_.size() < kMinParallelNarrowPhase) {
+    test_range(0, narrow_phase_.size());
+    return;
+  }
+  thread_pool->ParallelFor(narrow_phase_.size(), kNarrowPhaseGrain,
+                           test_range);
+}
+
+const CollisionChecker::Motion* CollisionChecker::GetMotion(
+    NodeHandle handle) const {
+  const auto it = std::lower_bound(
+      motions_.begin(), motions_.end(), handle,
+      [](const Motion& motion, NodeHandle handle) {
+        return motion.handle < handle;
+      });
+  return it != motions_.end() && it->handle == handle ? &*it : nullptr;
+}
+
+bool CollisionChecker::SweptCollide(NodeHandle lhs_handle,
+                                    const Box& lhs_aabb,
+                                    NodeHandle rhs_handle,
+                                    const Box& rhs_aabb) const {
+  const auto* lhs_motion = GetMotion(lhs_handle);
+  const auto* rhs_motion = GetMotion(rhs_handle);
+  if (lhs_motion == nullptr && rhs_motion == nullptr) return false;
+
+  // Sweep lhs relative to rhs from their previous positions. Pixel masks are
+  // not tested along the way.
+  Rect lhs_previous = geo::ToRect(lhs_aabb);
+  Rect rhs_previous = geo::ToRect(rhs_aabb);
+  int dx = 0, dy = 0;
+  if (lhs_motion != nullptr) {
+    lhs_previous.left -= lhs_motion->dx;
+    lhs_previous.top -= lhs_motion->dy;
+    dx += lhs_motion->dx;
+    dy += lhs_motion->dy;
+  }
+  if (rhs_motion != nullptr) {
+    rhs_previous.left -= rhs_motion->dx;
+    rhs_previous.top -= rhs_motion->dy;
+    dx -= rhs_motion->dx;
+    dy -= rhs_motion->dy;
+  }
+  return geo::SweptCollide(lhs_previous, dx, dy, rhs_previous);
+}
+
+std::pair<std::vector<CollisionChecker::NodePair>::const_iterator,
+          std::vector<CollisionChecker::NodePair>::const_iterator>
+CollisionChecker::GetCachedPairs(NodeHandle handle) const {
+  return std::equal_range(
+      collision_cache_.begin(), collision_cache_.end(),
+      NodePair(handle, NodeHandle()),
+      [](const NodePair& lhs, const NodePair& rhs) {
+        return lhs.first < rhs.first;
+      });
+}
+
+bool CollisionChecker::IsCached(const NodePair& pair) const {
+  return std::binary_search(collision_cache_.begin(), collision_cache_.end(),
+                            pair);
+}
 
-    TriggerCollisionAction(*lhs, *rhs, overlap_directory_);
+void CollisionChecker::UpdateCollisionCache() {
+  if (!detach_pairs_.empty()) {
+    collision_cache_.erase(
+        std::remove_if(collision_cache_.begin(), collision_cache_.end(),
+                       [this](const NodePair& pair) {
+                         return std::binary_search(
+                             detach_pairs_.begin(), detach_pairs_.end(),
+                             MakeOrderedPair(pair.first, pair.second));
+                       }),
+        collision_cache_.end());
   }
+  if (new_pairs_.empty()) return;
+
+  const auto cached = collision_cache_.size();
+  for (const auto& [lhs, rhs] : new_pairs_) {
+    collision_cache_.emplace_back(lhs, rhs);
+    collision_cache_.emplace_back(rhs, lhs);
+  }
+  std::sort(collision_cache_.begin() + cached, collision_cache_.end());
+  std::inplace_merge(collision_cache_.begin(),
+                     collision_cache_.begin() + cached,
+                     collision_cache_.end());
 }
 
-std::vector<std::string> CollisionChecker::collision_context() const {
+std::vector<NodeHandle> CollisionChecker::collision_context() const {
   return !collision_context_.empty() ? collision_context_.top().nodes()
-                                     : std::vector<std::string>();
+                                     : std::vector<NodeHandle>();
 }
 
 void CollisionChecker::TriggerCollisionAction(
-    const SceneNode& lhs, const SceneNode& rhs,
-    const std::vector<CollisionAction>& collision_directory) {
-  collision_context_.push(CollisionContext({lhs.id(), rhs.id()}));
-  for (const auto& collision : collision_directory) {
-    if (!NodeInCollision(lhs, collision) || !NodeInCollision(rhs, collision)) {
-      continue;
-    }
-    for (const auto& action : collision.action()) {
+    NodeHandle lhs, CollisionRules::NodeKeys lhs_keys, NodeHandle rhs,
+    CollisionRules::NodeKeys rhs_keys, CollisionRules::RuleType type) {
+  std::vector<const CollisionAction*> rules;
+  rules_.GetRules(type, lhs_keys, rhs_keys, &rules);
+  if (rules.empty()) return;
+
+  collision_context_.push(CollisionContext({lhs, rhs}));
+  for (const auto* collision : rules) {
+    for (const auto& action : collision->action()) {
       action_manager_->Execute(action);
     }
   }
   collision_context_.pop();
 }
 
-bool CollisionChecker::NodeInCollision(const SceneNode& node,
-                                       const CollisionAction& collision) const {
-  return ranges::any_of(collision.scene_node_id(),
-                        [&node](const auto& id) { return node.id() == id; }) ||
-         ranges::any_of(collision.sprite_id(), [&node](const auto& sprite_id) {
-           return node.sprite_id() == sprite_id;
-         });
+Box CollisionChecker::GetBoundingBox(const SceneNodeStore& store,
+                                     NodeHandle handle) const {
+  // Static nodes can only move through the SceneManager, which keeps their
+  // store entry up to date.
+  if (store.is_static(handle.index)) {
+    return geo::ToBox(store.aabb(handle.index));
+  }
+  return grid_.GetBoundingBox(handle);
+}
+
+CollisionChecker::NodeInfo CollisionChecker::GetNodeInfo(NodeHandle handle) {
+  if (handle.index >= node_info_.size()) {
+    node_info_.resize(handle.index + 1);
+  }
+  auto& info = node_info_[handle.index];
+  if (info.version != rules_.version()) {
+    const auto& node = *scene_manager_->GetSceneNode(handle);
+    const auto& sprite =
+        core_->resource_manager()->GetSprite(node.sprite_id());
+    info.keys = rules_.GetNodeKeys(node);
+    info.layer = node.has_collision_layer() ? node.collision_layer()
+                                            : sprite.collision_layer();
+    info.mask = node.has_collision_mask() ? node.collision_mask()
+                                          : sprite.collision_mask();
+    info.version = rules_.version();
+  }
+  return info;
 }
 
 namespace internal {
+
+namespace {
+#if defined(TROLL_COLLISION_AVX2)
+constexpr int kSimdLanes = 4;
+using SimdWords = __m256i;
+
+SimdWords LoadLanes(const CollisionMask& mask, int y, int index) {
+  const auto word = [&mask, index](int row) -> long long {
+    return index < mask.words_per_row() ? mask.row(row)[index] : 0;
+  };
+  return _mm256_set_epi64x(word(y + 3), word(y + 2), word(y + 1), word(y));
+}
+
+SimdWords ShiftedWords(const CollisionMask& mask, int y, int x) {
+  const int index = x / CollisionMask::kWordBits;
+  const int shift = x % CollisionMask::kWordBits;
+  // Shift counts of 64 produce zero, which handles word aligned columns.
+  return _mm256_or_si256(
+      _mm256_srl_epi64(LoadLanes(mask, y, index), _mm_cvtsi32_si128(shift)),
+      _mm256_sll_epi64(LoadLanes(mask, y, index + 1),
+                       _mm_cvtsi32_si128(CollisionMask::kWordBits - shift)));
+}
+
+bool AnyLaneOverlaps(SimdWords lhs, SimdWords rhs, uint64_t tail_mask) {
+  const auto overlap = _mm256_and_si256(
+      _mm256_and_si256(lhs, rhs),
+      _mm256_set1_epi64x(static_cast<long long>(tail_mask)));
+  return !_mm256_testz_si256(overlap, overlap);
+}
+#elif defined(TROLL_COLLISION_SSE2)
+constexpr int kSimdLanes = 2;
+using SimdWords = __m128i;
+
+SimdWords LoadLanes(const CollisionMask& mask, int y, int index) {
+  const auto word = [&mask, index](int row) -> long long {
+    return index < mask.words_per_row() ? mask.row(row)[index] : 0;
+  };
+  return _mm_set_epi64x(word(y + 1), word(y));
+}
+
+SimdWords ShiftedWords(const CollisionMask& mask, int y, int x) {
+  const int index = x / CollisionMask::kWordBits;
+  const int shift = x % CollisionMask::kWordBits;
+  // Shift counts of 64 produce zero, which handles word aligned columns.
+  return _mm_or_si128(
+      _mm_srl_epi64(LoadLanes(mask, y, index), _mm_cvtsi32_si128(shift)),
+      _mm_sll_epi64(LoadLanes(mask, y, index + 1),
+                    _mm_cvtsi32_si128(CollisionMask::kWordBits - shift)));
+}
+
+bool AnyLaneOverlaps(SimdWords lhs, SimdWords rhs, uint64_t tail_mask) {
+  const auto overlap = _mm_and_si128(
+      _mm_and_si128(lhs, rhs),
+      _mm_set1_epi64x(static_cast<long long>(tail_mask)));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(overlap, _mm_setzero_si128())) !=
+         0xFFFF;
+}
+#endif
+}  // namespace
+
+bool MaskRegionsOverlap(const CollisionMask& lhs_mask, int lhs_top,
+                        int lhs_left, const CollisionMask& rhs_mask,
+                        int rhs_top, int rhs_left, int width, int height) {
+  constexpr int kWordBits = CollisionMask::kWordBits;
+
+  for (int column = 0; column < width; column += kWordBits) {
+    const uint64_t tail_mask = CollisionMask::TailMask(width - column);
+    const int lhs_x = lhs_left + column;
+    const int rhs_x = rhs_left + column;
+
+    int y = 0;
+#if defined(TROLL_COLLISION_AVX2) || defined(TROLL_COLLISION_SSE2)
+    for (; y + kSimdLanes <= height; y += kSimdLanes) {
+      if (AnyLaneOverlaps(ShiftedWords(lhs_mask, lhs_top + y, lhs_x),
+                          ShiftedWords(rhs_mask, rhs_top + y, rhs_x),
+                          tail_mask)) {
+        return true;
+      }
+    }
+#endif
+    for (; y < height; ++y) {
+      if (lhs_mask.ExtractWord(lhs_top + y, lhs_x) &
+          rhs_mask.ExtractWord(rhs_top + y, rhs_x) & tail_mask) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+namespace {
+// Integer division that rounds towards negative infinity.
+int FloorDiv(int value, int divisor) {
+  const int quotient = value / divisor;
+  return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1
+                                                                : quotient;
+}
+
+// Returns 64 blocks of row |y| starting at column |x|. Blocks outside the
+// level, including negative rows and columns, are empty.
+uint64_t ExtractBlocks(const CollisionMask& blocks, int y, int x) {
+  if (y < 0 || y >= blocks.height()) return 0;
+  if (x >= 0) return blocks.ExtractWord(y, x);
+  return -x < CollisionMask::kWordBits ? blocks.ExtractWord(y, 0) << -x : 0;
+}
+
+// Minimum number of mask words in a region for testing it on block levels
+// before testing pixels. Smaller regions are tested faster pixel by pixel, as
+// the word-wise test usually finds overlapping pixels in the first few rows.
+constexpr int kPyramidMinWords = 128;
+
+enum class BlockOverlap {
+  NONE,
+  PARTIAL,
+  FULL,
+};
+
+// Tests a row of |lhs| blocks between columns |left| and |right| against the
+// |rhs| blocks they overlap, which are one or two per dimension depending on
+// the alignment of the masks. |rhs| coordinates are |lhs| coordinates offset by
+// (|dx|, |dy|) pixels. Blocks are processed 64 at a time.
+template <int kBlockSize>
+BlockOverlap BlockRowOverlap(const CollisionMaskPyramid::Level& lhs,
+                             const CollisionMaskPyramid::Level& rhs, int y,
+                             int left, int right, int dx, int dy) {
+  const int column_offset = FloorDiv(dx, kBlockSize);
+  const bool straddles_columns = dx % kBlockSize != 0;
+  const int rhs_first_row = FloorDiv(y * kBlockSize + dy, kBlockSize);
+  const int rhs_last_row =
+      FloorDiv(y * kBlockSize + dy + kBlockSize - 1, kBlockSize);
+
+  bool partial = false;
+  for (int x = left; x <= right; x += CollisionMask::kWordBits) {
+    const int rhs_x = x + column_offset;
+    const int blocks = right - x + 1;
+    const uint64_t tail_mask = CollisionMask::TailMask(blocks);
+
+    // Returns for each |lhs| block in the word whether any |rhs| block that it
+    // overlaps is set in |rhs_blocks|.
+    const auto overlapped_blocks = [&](const CollisionMask& rhs_blocks) {
+      uint64_t word = ExtractBlocks(rhs_blocks, rhs_first_row, rhs_x);
+      if (rhs_last_row != rhs_first_row) {
+        word |= ExtractBlocks(rhs_blocks, rhs_last_row, rhs_x);
+      }
+      if (!straddles_columns) return word;
+
+      // Also include the next block. The block past the end of the word is
+      // only needed if all bits of the word are used.
+      uint64_t next = word >> 1;
+      if (blocks >= CollisionMask::kWordBits) {
+        const int next_x = rhs_x + CollisionMask::kWordBits;
+        next |= (ExtractBlocks(rhs_blocks, rhs_first_row, next_x) |
+                 ExtractBlocks(rhs_blocks, rhs_last_row, next_x))
+                << (CollisionMask::kWordBits - 1);
+      }
+      return word | next;
+    };
+
+    // Full blocks lie within their masks, so overlapping full blocks share a
+    // set pixel within the region.
+    const uint64_t lhs_full = lhs.full.ExtractWord(y, x) & tail_mask;
+    if (lhs_full != 0 && (lhs_full & overlapped_blocks(rhs.full)) != 0) {
+      return BlockOverlap::FULL;
+    }
+    const uint64_t lhs_any = lhs.any.ExtractWord(y, x) & tail_mask;
+    if (!partial && lhs_any != 0 &&
+        (lhs_any & overlapped_blocks(rhs.any)) != 0) {
+      partial = true;
+    }
+  }
+  return partial ? BlockOverlap::PARTIAL : BlockOverlap::NONE;
+}
+}  // namespace
+
 bool SceneNodePixelsCollide(const Box& lhs_aabb, const Box& rhs_aabb,
-                            const std::vector<bool>& lhs_collision_mask,
-                            const std::vector<bool>& rhs_collision_mask) {
+                            const CollisionMask& lhs_collision_mask,
+                            const CollisionMask& rhs_collision_mask,
+                            const CollisionMaskPyramid& lhs_pyramid,
+                            const CollisionMaskPyramid& rhs_pyramid) {
+  constexpr int kCoarse = CollisionMaskPyramid::kCoarseBlockSize;
+  constexpr int kFine = CollisionMaskPyramid::kFineBlockSize;
+
   const auto intersection = geo::Intersection(lhs_aabb, rhs_aabb);
-  const int lhs_rel_top = intersection.top() - lhs_aabb.top();
-  const int lhs_rel_left = intersection.left() - lhs_aabb.left();
-  const int rhs_rel_top = intersection.top() - rhs_aabb.top();
-  const int rhs_rel_left = intersection.left() - rhs_aabb.left();
-
-  for (int y = 0; y < intersection.height(); ++y) {
-    for (int x = 0; x < intersection.width(); ++x) {
-      const int lhs_mask_index =
-          (lhs_rel_top + y) * lhs_aabb.width() + (lhs_rel_left + x);
-      const int rhs_mask_index =
-          (rhs_rel_top + y) * rhs_aabb.width() + (rhs_rel_left + x);
-
-      if (lhs_collision_mask[lhs_mask_index] == 1 &&
-          rhs_collision_mask[rhs_mask_index] == 1) {
+  if (intersection.width() <= 0 || intersection.height() <= 0) return false;
+
+  // Region of the intersection in |lhs| coordinates and offset of |rhs|.
+  const int top = intersection.top() - lhs_aabb.top();
+  const int left = intersection.left() - lhs_aabb.left();
+  const int bottom = top + intersection.height();
+  const int right = left + intersection.width();
+  const int dx = lhs_aabb.left() - rhs_aabb.left();
+  const int dy = lhs_aabb.top() - rhs_aabb.top();
+
+  const int words = (right - left + CollisionMask::kWordBits - 1) /
+                    CollisionMask::kWordBits;
+  if ((bottom - top) * words < kPyramidMinWords) {
+    return MaskRegionsOverlap(lhs_collision_mask, top, left,
+                              rhs_collision_mask, top + dy, left + dx,
+                              right - left, bottom - top);
+  }
+
+  // Rows of coarse blocks that overlap are refined on fine blocks and only rows
+  // of fine blocks that overlap partially are tested pixel by pixel.
+  for (int y = top / kCoarse; y <= (bottom - 1) / kCoarse; ++y) {
+    const auto coarse_overlap = BlockRowOverlap<kCoarse>(
+        lhs_pyramid.coarse(), rhs_pyramid.coarse(), y, left / kCoarse,
+        (right - 1) / kCoarse, dx, dy);
+    if (coarse_overlap == BlockOverlap::FULL) return true;
+    if (coarse_overlap == BlockOverlap::NONE) continue;
+
+    const int fine_top = std::max(y * kCoarse, top) / kFine;
+    const int fine_bottom = (std::min((y + 1) * kCoarse, bottom) - 1) / kFine;
+    for (int fine_y = fine_top; fine_y <= fine_bottom; ++fine_y) {
+      const auto fine_overlap = BlockRowOverlap<kFine>(
+          lhs_pyramid.fine(), rhs_pyramid.fine(), fine_y, left / kFine,
+          (right - 1) / kFine, dx, dy);
+      if (fine_overlap == BlockOverlap::FULL) return true;
+      if (fine_overlap == BlockOverlap::NONE) continue;
+
+      const int row_top = std::max(fine_y * kFine, top);
+      const int row_bottom = std::min((fine_y + 1) * kFine, bottom);
+      if (MaskRegionsOverlap(lhs_collision_mask, row_top, left,
+                             rhs_collision_mask, row_top + dy, left + dx,
+                             right - left, row_bottom - row_top)) {
         return true;
       }
     }
   }
   return false;
 }
+
+bool SceneNodePixelsCollide(const Box& lhs_aabb, const Box& rhs_aabb,
+                            const CollisionMask& lhs_collision_mask,
+                            const CollisionMask& rhs_collision_mask) {
+  const auto intersection = geo::Intersection(lhs_aabb, rhs_aabb);
+  if (intersection.width() <= 0 || intersection.height() <= 0) return false;
+
+  return MaskRegionsOverlap(
+      lhs_collision_mask, intersection.top() - lhs_aabb.top(),
+      intersection.left() - lhs_aabb.left(), rhs_collision_mask,
+      intersection.top() - rhs_aabb.top(),
+      intersection.left() - rhs_aabb.left(), intersection.width(),
+      intersection.height());
+}
 }  // namespace internal
 
 }  // namespace troll
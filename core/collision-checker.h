@@ -1,13 +1,18 @@
 #ifndef TROLL_CORE_COLLISION_CHECKER_H_
 #define TROLL_CORE_COLLISION_CHECKER_H_
 
-#include <set>
+#include <cstdint>
 #include <stack>
+#include <utility>
 #include <vector>
 
 #include "action/action-manager.h"
+#include "core/collision-mask.h"
+#include "core/collision-rules.h"
 #include "core/core.h"
+#include "core/node-handle.h"
 #include "core/scene-manager.h"
+#include "core/spatial-grid.h"
 #include "proto/action.pb.h"
 #include "proto/scene-node.pb.h"
 
@@ -20,35 +25,117 @@ class CollisionChecker {
       : scene_manager_(scene_manager),
         action_manager_(action_manager),
         core_(core) {}
-  ~CollisionChecker() = default;
+  ~CollisionChecker();
 
   void RegisterCollision(const CollisionAction& collision);
   void RegisterOverlap(const CollisionAction& overlap);
   void RegisterDetachment(const CollisionAction& detaching);
 
-  // Add this node in the checking for collisions during this frame.
-  void Dirty(const SceneNode& node);
+  // Add this node in the checking for collisions during this frame. Nodes are
+  // marked through SceneManager::Dirty(), which also refreshes the fields that
+  // collisions are tested with.
+  void Dirty(NodeHandle handle);
+
+  // Stops tracking a node that is deleted from the scene. Pairs that it was
+  // colliding with are detached on the next CheckCollisions().
+  void RemoveSceneNode(NodeHandle handle);
 
   // Checks SceneNodes which were marked as dirty for collisions and applies
-  // collision actions as consequences.
+  // collision actions as consequences. Nodes that moved further than their
+  // extent since the last check are swept from their previous position, so
+  // that they trigger collisions with nodes they passed through.
   void CheckCollisions();
 
-  // Returns the pair of scene node ids of the current collision.
-  std::vector<std::string> collision_context() const;
+  // Returns the pair of scene nodes of the current collision.
+  std::vector<NodeHandle> collision_context() const;
+
+  // Number of node pairs whose bounding boxes were tested by the last
+  // CheckCollisions() call.
+  int pairs_tested() const { return pairs_tested_; }
 
   CollisionChecker(const CollisionChecker&) = delete;
   CollisionChecker& operator=(const CollisionChecker&) = delete;
 
  private:
-  // Triggers actions associated with collision/detaching of input nodes.
-  void TriggerCollisionAction(
-      const SceneNode& lhs, const SceneNode& rhs,
-      const std::vector<CollisionAction>& collision_directory);
+  // Pins the inline animation scripts of a registered rule, so that playing
+  // them does not hash the scripts every time the rule is triggered.
+  void PinAnimationScripts(const CollisionAction& rule);
+
+  // Triggers actions of rules of |type| that match the input nodes.
+  void TriggerCollisionAction(NodeHandle lhs,
+                              CollisionRules::NodeKeys lhs_keys,
+                              NodeHandle rhs,
+                              CollisionRules::NodeKeys rhs_keys,
+                              CollisionRules::RuleType type);
+
+  // Returns the bounding box that collisions of a node are tested with.
+  // Dynamic nodes are looked up in the grid and static nodes in the |store|.
+  Box GetBoundingBox(const SceneNodeStore& store, NodeHandle handle) const;
+
+  // Rule keys and collision layers of a node.
+  struct NodeInfo {
+    int version = -1;
+    CollisionRules::NodeKeys keys;
+    uint32_t layer = 0;
+    uint32_t mask = 0;
+  };
+
+  // Returns the info of a node of the scene, which is cached until the node
+  // becomes dirty or new rules are registered. The SceneNode is only read when
+  // the cache is refreshed.
+  NodeInfo GetNodeInfo(NodeHandle handle);
+
+  // Translation of a node since the previous CheckCollisions() that was
+  // larger than its extent, so that it could tunnel through other nodes.
+  struct Motion {
+    NodeHandle handle;
+    int dx = 0;
+    int dy = 0;
+  };
+
+  // Returns the motion of |handle| during this frame or nullptr if it did not
+  // move fast.
+  const Motion* GetMotion(NodeHandle handle) const;
+
+  // Returns true if two nodes that do not collide at their current bounding
+  // boxes collided at any point of their motion during this frame.
+  bool SweptCollide(NodeHandle lhs_handle, const Box& lhs_aabb,
+                    NodeHandle rhs_handle, const Box& rhs_aabb) const;
+
+  using NodePair = std::pair<NodeHandle, NodeHandle>;
+
+  // Pair of nodes whose bounding boxes collide and need their pixel masks
+  // tested.
+  struct NarrowPhaseTest {
+    NodePair pair;
+    Box lhs_aabb;
+    Box rhs_aabb;
+    const CollisionMask* lhs_mask;
+    const CollisionMask* rhs_mask;
+    const CollisionMaskPyramid* lhs_pyramid;
+    const CollisionMaskPyramid* rhs_pyramid;
+  };
+
+  // Number of narrow phase tests that a thread runs at a time.
+  static constexpr int kNarrowPhaseGrain = 16;
+  // Fewer tests than this run on the main loop thread. A test takes about
+  // 60-90ns while handing out a loop to workers takes a few microseconds.
+  static constexpr int kMinParallelNarrowPhase = 256;
+
+  // Tests |narrow_phase_| on Core's thread pool, if there is one, and stores
+  // the results in |narrow_phase_results_|. Tests only read resources and
+  // their inputs, so they are safe to run concurrently.
+  void RunNarrowPhase();
 
-  // Returns true if node is part of the CollisionAction description directly
-  // (i.e. by scene_node_id) or indirectly (i.e. by sprite_id).
-  bool NodeInCollision(const SceneNode& node,
-                       const CollisionAction& collision) const;
+  // Returns the range of cached pairs whose first node is |handle|.
+  std::pair<std::vector<NodePair>::const_iterator,
+            std::vector<NodePair>::const_iterator>
+  GetCachedPairs(NodeHandle handle) const;
+
+  bool IsCached(const NodePair& pair) const;
+
+  // Removes |detach_pairs_| from the collision cache and adds |new_pairs_|.
+  void UpdateCollisionCache();
 
   const SceneManager* scene_manager_;
   const ActionManager* action_manager_;
@@ -56,42 +143,92 @@ class CollisionChecker {
 
   class CollisionContext {
    public:
-    explicit CollisionContext(std::vector<std::string> node_ids)
-        : collision_node_ids_(std::move(node_ids)) {}
+    explicit CollisionContext(std::vector<NodeHandle> nodes)
+        : collision_nodes_(std::move(nodes)) {}
 
-    const std::vector<std::string>& nodes() const {
-      return collision_node_ids_;
-    }
+    const std::vector<NodeHandle>& nodes() const { return collision_nodes_; }
 
    private:
-    std::vector<std::string> collision_node_ids_;
+    std::vector<NodeHandle> collision_nodes_;
   };
   std::stack<CollisionContext> collision_context_;
 
-  // Directory of registered collisions.
-  std::vector<CollisionAction> collision_directory_;
-
-  // Directory of registered overlaps.
-  std::vector<CollisionAction> overlap_directory_;
+  // Directory of registered collisions, overlaps and detachments.
+  CollisionRules rules_;
+  // Inline scripts of |rules_| that are pinned in the resource manager.
+  std::vector<const AnimationScript*> pinned_scripts_;
 
-  // Directory of registered detachments.
-  std::vector<CollisionAction> detachment_directory_;
+  // Info of scene nodes by slot index.
+  std::vector<NodeInfo> node_info_;
 
   // Nodes that moved or created during this frame and should be checked for
   // collisions.
-  std::vector<const SceneNode*> dirty_nodes_;
+  std::vector<NodeHandle> dirty_nodes_;
+
+  // Fast moving nodes of this frame sorted by handle.
+  std::vector<Motion> motions_;
+
+  // Broad phase index of dynamic scene nodes. Nodes are re-indexed when they
+  // become dirty, so that only pairs sharing a grid cell reach the narrow
+  // phase. Static nodes are queried from the SceneManager's hierarchy.
+  SpatialGrid grid_;
 
   // Collision cache to remember what nodes were already colliding before this
-  // frame started.
-  std::set<std::pair<const SceneNode*, const SceneNode*>> collision_cache_;
+  // frame started. Each pair is stored in both orders in a sorted vector, so
+  // that the pairs of a node are found with a binary search. Handles of
+  // deleted nodes never match a node that reuses their slot.
+  std::vector<NodePair> collision_cache_;
+
+  // Ordered pairs found colliding, newly colliding and detaching during
+  // CheckCollisions(). They are kept to reuse their allocations.
+  std::vector<NodePair> collision_pairs_;
+  std::vector<NodePair> new_pairs_;
+  std::vector<NodePair> detach_pairs_;
+
+  // Pixel mask tests of the current CheckCollisions() and their results.
+  std::vector<NarrowPhaseTest> narrow_phase_;
+  std::vector<uint8_t> narrow_phase_results_;
+
+  // Pairs that collided only in between the positions of fast moving nodes in
+  // two frames. They trigger collision and overlap actions but are not cached,
+  // as they no longer collide.
+  std::vector<NodePair> swept_pairs_;
+
+  // Pairs that were colliding when one of their nodes was deleted, with
+  // stubs of the nodes that keep only the id and sprite id needed for matching
+  // detachment actions.
+  struct RemovedPair {
+    NodePair handles;
+    SceneNode lhs;
+    SceneNode rhs;
+  };
+  std::vector<RemovedPair> removed_pairs_;
+
+  int pairs_tested_ = 0;
 };
 
 namespace internal {
 // Returns true if the input bounding boxes actaully collide based on supplied
 // collision masks.
 bool SceneNodePixelsCollide(const Box& lhs_aabb, const Box& rhs_aabb,
-                            const std::vector<bool>& lhs_collision_mask,
-                            const std::vector<bool>& rhs_collision_mask);
+                            const CollisionMask& lhs_collision_mask,
+                            const CollisionMask& rhs_collision_mask);
+
+// Same as above, but the block levels of the mask pyramids are tested first.
+// Only rows of blocks that overlap partially are tested pixel by pixel.
+bool SceneNodePixelsCollide(const Box& lhs_aabb, const Box& rhs_aabb,
+                            const CollisionMask& lhs_collision_mask,
+                            const CollisionMask& rhs_collision_mask,
+                            const CollisionMaskPyramid& lhs_pyramid,
+                            const CollisionMaskPyramid& rhs_pyramid);
+
+// Returns true if any pixel is set in both masks within a |width| x |height|
+// region, whose top-left corner is at the given coordinates of each mask.
+// Rows are compared 64 pixels at a time and multiple rows are tested in
+// parallel when SSE2/AVX2 is available.
+bool MaskRegionsOverlap(const CollisionMask& lhs_mask, int lhs_top,
+                        int lhs_left, const CollisionMask& rhs_mask,
+                        int rhs_top, int rhs_left, int width, int height);
 }  // namespace internal
 
 }  // namespace troll
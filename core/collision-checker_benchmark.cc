@@ -0,0 +1,235 @@
+#include "core/collision-checker.h"
+
+#include <random>
+#include <vector>
+
+#include <absl/strings/str_cat.h>
+#include <benchmark/benchmark.h>
+
+#include "action/action-manager.h"
+#include "core/collision-mask.h"
+#include "core/resource-manager.h"
+#include "core/scene-manager.h"
+#include "core/thread-pool.h"
+#include "proto/primitives.pb.h"
+#include "troll-test/test-core.h"
+#include "troll-test/testing-resource-manager.h"
+
+namespace troll {
+namespace {
+
+// Sprite-like masks of the given size: a filled disc, a ring and a platform
+// with gaps.
+std::vector<CollisionMask> MakeMasks(int size) {
+  std::vector<CollisionMask> masks;
+
+  const int centre = size / 2;
+  const int outer = size * 9 / 20;
+  const int inner = size * 7 / 20;
+  CollisionMask disc(size, size);
+  CollisionMask ring(size, size);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const int distance =
+          (x - centre) * (x - centre) + (y - centre) * (y - centre);
+      disc.Set(x, y, distance < outer * outer);
+      ring.Set(x, y, distance < outer * outer && distance >= inner * inner);
+    }
+  }
+  masks.push_back(disc);
+  masks.push_back(ring);
+
+  const int gap = size / 3;
+  CollisionMask platform(size * 3, size / 2);
+  for (int y = size / 4; y < size / 2; ++y) {
+    for (int x = 0; x < size * 3; ++x) {
+      platform.Set(x, y, (x / gap) % 3 != 2);
+    }
+  }
+  masks.push_back(platform);
+
+  return masks;
+}
+
+struct CollisionPair {
+  Box lhs_aabb;
+  Box rhs_aabb;
+  int lhs_index;
+  int rhs_index;
+};
+
+// Returns pairs of masks placed so that their bounding boxes overlap, as they
+// would when reaching the narrow phase.
+std::vector<CollisionPair> MakePairs(const std::vector<CollisionMask>& masks,
+                                     int count) {
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> mask_index(0, masks.size() - 1);
+
+  std::vector<CollisionPair> pairs;
+  while (pairs.size() < count) {
+    CollisionPair pair;
+    pair.lhs_index = mask_index(generator);
+    pair.rhs_index = mask_index(generator);
+    const auto& lhs = masks[pair.lhs_index];
+    const auto& rhs = masks[pair.rhs_index];
+
+    pair.lhs_aabb.set_width(lhs.width());
+    pair.lhs_aabb.set_height(lhs.height());
+    pair.rhs_aabb.set_left(std::uniform_int_distribution<int>(
+        -rhs.width() + 1, lhs.width() - 1)(generator));
+    pair.rhs_aabb.set_top(std::uniform_int_distribution<int>(
+        -rhs.height() + 1, lhs.height() - 1)(generator));
+    pair.rhs_aabb.set_width(rhs.width());
+    pair.rhs_aabb.set_height(rhs.height());
+    pairs.push_back(pair);
+  }
+  return pairs;
+}
+
+constexpr int kPairs = 1024;
+
+void BM_PixelsCollide(benchmark::State& state) {
+  const auto masks = MakeMasks(state.range(0));
+  const auto pairs = MakePairs(masks, kPairs);
+
+  for (auto _ : state) {
+    for (const auto& pair : pairs) {
+      benchmark::DoNotOptimize(internal::SceneNodePixelsCollide(
+          pair.lhs_aabb, pair.rhs_aabb, masks[pair.lhs_index],
+          masks[pair.rhs_index]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+BENCHMARK(BM_PixelsCollide)->RangeMultiplier(2)->Range(16, 256);
+
+void BM_PixelsCollideWithPyramids(benchmark::State& state) {
+  const auto masks = MakeMasks(state.range(0));
+  const auto pairs = MakePairs(masks, kPairs);
+
+  std::vector<CollisionMaskPyramid> pyramids;
+  for (const auto& mask : masks) {
+    pyramids.push_back(CollisionMaskPyramid(mask));
+  }
+
+  for (auto _ : state) {
+    for (const auto& pair : pairs) {
+      benchmark::DoNotOptimize(internal::SceneNodePixelsCollide(
+          pair.lhs_aabb, pair.rhs_aabb, masks[pair.lhs_index],
+          masks[pair.rhs_index], pyramids[pair.lhs_index],
+          pyramids[pair.rhs_index]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+BENCHMARK(BM_PixelsCollideWithPyramids)->RangeMultiplier(2)->Range(16, 256);
+
+// Scene of |size|x|size| nodes scattered over a 1024x1024 area, with a
+// collision rule between all of them. Nodes have ring masks when
+// |ring_masks| is set and are tested on |thread_pool| if it is not null.
+class CollisionScene {
+ public:
+  explicit CollisionScene(int nodes, int size = 16, bool ring_masks = false,
+                          ThreadPool* thread_pool = nullptr) {
+    Sprite sprite;
+    sprite.set_id("sprite_a");
+    sprite.add_film()->set_width(size);
+    sprite.mutable_film(0)->set_height(size);
+    testing_resource_manager_.SetTestSprite(sprite);
+    if (ring_masks) {
+      testing_resource_manager_.SetTestCollisionMask("sprite_a", 0,
+                                                     MakeMasks(size)[1]);
+    }
+
+    core_.set_thread_pool(thread_pool);
+    core_.set_resource_manager(&resource_manager_);
+    core_.set_action_manager(&action_manager_);
+    core_.set_scene_manager(&scene_manager_);
+    core_.set_collision_checker(&collision_checker_);
+
+    CollisionAction collision;
+    collision.add_sprite_id("sprite_a");
+    collision.add_sprite_id("sprite_a");
+    collision.add_action()->mutable_noop();
+    collision_checker_.RegisterCollision(collision);
+
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> coordinate(0, 1024);
+    for (int i = 0; i < nodes; ++i) {
+      SceneNode node;
+      node.set_id(absl::StrCat("node_", i));
+      node.set_sprite_id("sprite_a");
+      node.mutable_position()->set_x(coordinate(generator));
+      node.mutable_position()->set_y(coordinate(generator));
+      handles_.push_back(scene_manager_.AddSceneNode(node));
+    }
+    collision_checker_.CheckCollisions();
+  }
+
+  // Moves |count| nodes back and forth by one pixel.
+  void MoveNodes(int count) {
+    step_ = -step_;
+    for (int i = 0; i < count; ++i) {
+      scene_manager_.Dirty(handles_[i]);
+      auto* node = scene_manager_.GetSceneNode(handles_[i]);
+      node->mutable_position()->set_x(node->position().x() + step_);
+    }
+  }
+
+  CollisionChecker* collision_checker() { return &collision_checker_; }
+
+ private:
+  TestCore core_;
+  ResourceManager resource_manager_;
+  ActionManager action_manager_ = ActionManager(&core_);
+  SceneManager scene_manager_ =
+      SceneManager(&resource_manager_, nullptr, &core_);
+  CollisionChecker collision_checker_ =
+      CollisionChecker(&scene_manager_, &action_manager_, &core_);
+
+  TestingResourceManager testing_resource_manager_ =
+      TestingResourceManager(&resource_manager_);
+
+  std::vector<NodeHandle> handles_;
+  int step_ = 1;
+};
+
+// Arguments are the number of nodes in the scene and the number of them that
+// move every frame.
+void BM_CheckCollisions(benchmark::State& state) {
+  CollisionScene scene(state.range(0));
+  const int dirty_nodes = state.range(1);
+
+  for (auto _ : state) {
+    scene.MoveNodes(dirty_nodes);
+    scene.collision_checker()->CheckCollisions();
+  }
+  state.SetItemsProcessed(state.iterations() * dirty_nodes);
+}
+BENCHMARK(BM_CheckCollisions)
+    ->Args({256, 16})
+    ->Args({256, 256})
+    ->Args({1024, 64})
+    ->Args({1024, 1024})
+    ->Args({4096, 256});
+
+// Arguments are the number of nodes in the scene and the number of worker
+// threads. Large ring-shaped nodes overlap densely, so that most time is spent
+// in the narrow phase.
+void BM_CheckCollisionsParallel(benchmark::State& state) {
+  ThreadPool thread_pool(state.range(1));
+  CollisionScene scene(state.range(0), 48, true, &thread_pool);
+  const int dirty_nodes = state.range(0);
+
+  for (auto _ : state) {
+    scene.MoveNodes(dirty_nodes);
+    scene.collision_checker()->CheckCollisions();
+  }
+  state.SetItemsProcessed(state.iterations() * dirty_nodes);
+}
+BENCHMARK(BM_CheckCollisionsParallel)
+    ->ArgsProduct({{1024, 4096}, {0, 1, 3, 7}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace troll
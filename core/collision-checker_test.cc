@@ -1,12 +1,17 @@
 #include "core/collision-checker.h"
 
 #define CATCH_CONFIG_MAIN
+#include <absl/strings/str_cat.h>
 #include <catch.hpp>
 #include <range/v3/algorithm/count_if.hpp>
 
 #include "action/action-manager.h"
+#include "core/geometry.h"
 #include "core/scene-manager.h"
+#include "core/thread-pool.h"
 #include "proto/scene-node.pb.h"
+#include "sdl/headless-renderer.h"
+#include "sdl/texture.h"
 #include "troll-test/test-core.h"
 #include "troll-test/test-util.h"
 #include "troll-test/testing-resource-manager.h"
@@ -45,12 +50,12 @@ class CollisionCheckerFixture {
 
   void MoveNode(const std::string& id, const std::pair<int, int>& at) {
     auto* node = scene_manager_.GetSceneNodeById(id);
-    node->mutable_position()->set_x(std::get<0>(at));
-    node->mutable_position()->set_y(std::get<1>(at));
 
     // When a node moves it needs to be marked dirty for CollisionChecker to
     // consider.
-    collision_checker_.Dirty(*node);
+    scene_manager_.Dirty(*node);
+    node->mutable_position()->set_x(std::get<0>(at));
+    node->mutable_position()->set_y(std::get<1>(at));
   }
 
   int CountNodesBySprite(const std::string& sprite_id) {
@@ -397,22 +402,336 @@ SCENARIO_METHOD(CollisionCheckerFixture, "Nodes detaching", "[collisions]") {
   }
 }
 
+SCENARIO_METHOD(CollisionCheckerFixture, "Nodes far apart in the scene",
+                "[collisions]") {
+  GIVEN("A collision and a detaching action on a pair of distant nodes") {
+    collision_checker_.RegisterCollision(ParseProto<CollisionAction>(R"(
+            scene_node_id: [ 'node_a', 'node_b' ]
+            action {
+              create_scene_node { scene_node { sprite_id: 'sprite_c' } }
+            })"));
+    collision_checker_.RegisterDetachment(ParseProto<CollisionAction>(R"(
+            scene_node_id: [ 'node_a', 'node_b' ]
+            action {
+              create_scene_node { scene_node { sprite_id: 'sprite_b' } }
+            })"));
+
+    CreateNode("node_a", "sprite_a", {0, 0});
+    CreateNode("node_b", "sprite_a", {500, 500});
+    collision_checker_.CheckCollisions();
+
+    WHEN("a node moves across the scene into collision") {
+      MoveNode("node_b", {5, 5});
+      collision_checker_.CheckCollisions();
+
+      THEN("the collision action is triggered") {
+        REQUIRE(CountNodesBySprite("sprite_c") == 1);
+        REQUIRE(CountNodesBySprite("sprite_b") == 0);
+
+        AND_WHEN("it moves far away again") {
+          MoveNode("node_b", {-500, 300});
+          collision_checker_.CheckCollisions();
+
+          THEN("the detaching action is triggered") {
+            REQUIRE(CountNodesBySprite("sprite_b") == 1);
+          }
+        }
+      }
+    }
+  }
+}
+
+SCENARIO_METHOD(CollisionCheckerFixture, "Collision layers", "[collisions]") {
+  GIVEN("Scenery nodes that are not tested against each other") {
+    testing_resource_manager_.SetTestSprite(ParseProto<Sprite>(R"(
+        id: 'scenery'
+        film { width: 10  height: 10 }
+        collision_layer: 2
+        collision_mask: 1)"));
+    collision_checker_.RegisterCollision(ParseProto<CollisionAction>(R"(
+            sprite_id: [ 'scenery', 'sprite_a' ]
+            action {
+              create_scene_node { scene_node { sprite_id: 'sprite_c' } }
+            })"));
+
+    CreateNode("scenery_a", "scenery", {0, 0});
+    CreateNode("scenery_b", "scenery", {5, 5});
+
+    WHEN("collisions are checked") {
+      collision_checker_.CheckCollisions();
+
+      THEN("overlapping scenery is not tested") {
+        REQUIRE(CountNodesBySprite("sprite_c") == 0);
+        REQUIRE(collision_checker_.pairs_tested() == 0);
+      }
+    }
+
+    WHEN("a node in the default layer collides with scenery") {
+      CreateNode("node_a", "sprite_a", {7, 7});
+      collision_checker_.CheckCollisions();
+
+      THEN("the collision action is triggered") {
+        REQUIRE(CountNodesBySprite("sprite_c") == 2);
+      }
+    }
+
+    WHEN("a node overrides its mask to exclude scenery") {
+      SceneNode node = ParseProto<SceneNode>(R"(
+          id: 'node_a'
+          sprite_id: 'sprite_a'
+          position { x: 7  y: 7 }
+          collision_mask: 4294967293)");
+      scene_manager_.AddSceneNode(node);
+      collision_checker_.CheckCollisions();
+
+      THEN("the collision action is not triggered") {
+        REQUIRE(CountNodesBySprite("sprite_c") == 0);
+      }
+    }
+  }
+}
+
+SCENARIO_METHOD(CollisionCheckerFixture, "Static nodes", "[collisions]") {
+  GIVEN("Static nodes and a dynamic node away from them") {
+    collision_checker_.RegisterCollision(ParseProto<CollisionAction>(R"(
+            sprite_id: [ 'sprite_a', 'sprite_b' ]
+            action {
+              create_scene_node { scene_node { sprite_id: 'sprite_c' } }
+            })"));
+    collision_checker_.RegisterDetachment(ParseProto<CollisionAction>(R"(
+            sprite_id: [ 'sprite_a', 'sprite_b' ]
+            action {
+              create_scene_node { scene_node { sprite_id: 'sprite_b' } }
+            })"));
+
+    scene_manager_.AddSceneNode(ParseProto<SceneNode>(R"(
+        id: 'wall_a'  sprite_id: 'sprite_a'  is_static: true
+        position { x: 0  y: 0 })"));
+    scene_manager_.AddSceneNode(ParseProto<SceneNode>(R"(
+        id: 'wall_b'  sprite_id: 'sprite_a'  is_static: true
+        position { x: 100  y: 100 })"));
+    CreateNode("node_a", "sprite_b", {50, 50});
+    collision_checker_.CheckCollisions();
+
+    WHEN("the dynamic node moves into a static node") {
+      MoveNode("node_a", {5, 5});
+      collision_checker_.CheckCollisions();
+
+      THEN("only the overlapping static node is tested") {
+        REQUIRE(collision_checker_.pairs_tested() == 1);
+        REQUIRE(CountNodesBySprite("sprite_c") == 1);
+
+        AND_WHEN("it moves away again") {
+          MoveNode("node_a", {50, 50});
+          collision_checker_.CheckCollisions();
+
+          THEN("the detaching action is triggered") {
+            REQUIRE(CountNodesBySprite("sprite_b") == 2);
+          }
+        }
+      }
+    }
+  }
+}
+
+SCENARIO_METHOD(CollisionCheckerFixture, "Fast moving nodes", "[collisions]") {
+  GIVEN("A node in front of a wall") {
+    collision_checker_.RegisterCollision(ParseProto<CollisionAction>(R"(
+            scene_node_id: [ 'node_a', 'wall' ]
+            action {
+              create_scene_node { scene_node { sprite_id: 'sprite_c' } }
+            })"));
+    collision_checker_.RegisterDetachment(ParseProto<CollisionAction>(R"(
+            scene_node_id: [ 'node_a', 'wall' ]
+            action {
+              create_scene_node { scene_node { sprite_id: 'sprite_b' } }
+            })"));
+
+    CreateNode("node_a", "sprite_a", {0, 0});
+    CreateNode("wall", "sprite_a", {30, 0});
+    collision_checker_.CheckCollisions();
+
+    WHEN("the node moves through the wall in a single frame") {
+      MoveNode("node_a", {60, 0});
+      collision_checker_.CheckCollisions();
+
+      THEN("the collision action is triggered") {
+        REQUIRE(CountNodesBySprite("sprite_c") == 1);
+
+        AND_WHEN("it moves further away") {
+          MoveNode("node_a", {100, 0});
+          collision_checker_.CheckCollisions();
+
+          THEN("no detaching action is triggered") {
+            REQUIRE(CountNodesBySprite("sprite_c") == 1);
+            REQUIRE(CountNodesBySprite("sprite_b") == 0);
+          }
+        }
+      }
+    }
+
+    WHEN("the wall moves through the node in a single frame") {
+      MoveNode("wall", {-30, 0});
+      collision_checker_.CheckCollisions();
+
+      THEN("the collision action is triggered") {
+        REQUIRE(CountNodesBySprite("sprite_c") == 1);
+      }
+    }
+
+    WHEN("the node jumps over the wall") {
+      MoveNode("node_a", {60, -100});
+      collision_checker_.CheckCollisions();
+
+      THEN("the collision action is not triggered") {
+        REQUIRE(CountNodesBySprite("sprite_c") == 0);
+      }
+    }
+  }
+}
+
+SCENARIO_METHOD(CollisionCheckerFixture, "Parallel narrow phase",
+                "[collisions]") {
+  GIVEN("A row of overlapping nodes and a thread pool") {
+    ThreadPool thread_pool(3);
+    core_.set_thread_pool(&thread_pool);
+
+    collision_checker_.RegisterCollision(ParseProto<CollisionAction>(R"(
+            sprite_id: 'sprite_a'
+            action {
+              create_scene_node { scene_node { sprite_id: 'sprite_c' } }
+            })"));
+    for (int i = 0; i < 100; ++i) {
+      CreateNode(absl::StrCat("node_", i), "sprite_a", {i * 5, 0});
+    }
+
+    WHEN("collisions are checked") {
+      collision_checker_.CheckCollisions();
+
+      THEN("each pair of neighbours collides once") {
+        REQUIRE(CountNodesBySprite("sprite_c") == 99);
+      }
+    }
+  }
+}
+
+// Deleted nodes are only cleaned up after rendering, so this fixture renders in
+// a headless framebuffer.
+class CollisionCheckerRenderFixture : public CollisionCheckerFixture {
+ public:
+  CollisionCheckerRenderFixture() {
+    testing_resource_manager_.SetTestTexture(
+        "", Texture::CreateTextureFromPixels(
+                std::vector<Uint32>(20 * 20, 0xff0000ff), 20, 20));
+
+    renderer_.CreateWindow(64, 64);
+    scene_manager_ = SceneManager(&resource_manager_, &renderer_, &core_);
+    scene_manager_.SetupScene(
+        ParseProto<Scene>("viewport { width: 64  height: 64 }"));
+  }
+
+ protected:
+  HeadlessRenderer renderer_;
+};
+
+SCENARIO_METHOD(CollisionCheckerRenderFixture, "Deleting colliding nodes",
+                "[collisions]") {
+  GIVEN("A detaching action and a pair of colliding nodes") {
+    collision_checker_.RegisterDetachment(ParseProto<CollisionAction>(R"(
+            scene_node_id: [ 'node_a', 'node_b' ]
+            action {
+              create_scene_node { scene_node { sprite_id: 'sprite_c' } }
+            })"));
+
+    CreateNode("node_a", "sprite_a", {0, 0});
+    CreateNode("node_b", "sprite_b", {5, 5});
+    collision_checker_.CheckCollisions();
+
+    WHEN("a node is deleted") {
+      scene_manager_.RemoveSceneNode("node_b");
+      scene_manager_.Render();
+      collision_checker_.CheckCollisions();
+
+      THEN("the detaching action is triggered") {
+        REQUIRE(CountNodesBySprite("sprite_c") == 1);
+
+        AND_WHEN("the node that reused its slot detaches") {
+          MoveNode("node_a", {40, 40});
+          collision_checker_.CheckCollisions();
+
+          THEN("it is not mistaken for the deleted node") {
+            REQUIRE(CountNodesBySprite("sprite_c") == 1);
+          }
+        }
+      }
+    }
+  }
+
+  GIVEN("A detaching action on the nodes of the pair") {
+    collision_checker_.RegisterDetachment(ParseProto<CollisionAction>(R"(
+            scene_node_id: [ 'node_a', 'node_b' ]
+            action {
+              destroy_scene_node {
+                scene_node { id: '$this.{sprite_id: "sprite_b"}' }
+              }
+            })"));
+
+    CreateNode("node_a", "sprite_a", {0, 0});
+    CreateNode("node_b", "sprite_b", {5, 5});
+    collision_checker_.CheckCollisions();
+
+    WHEN("a node is deleted and created again with the same id") {
+      scene_manager_.RemoveSceneNode("node_b");
+      scene_manager_.Render();
+      CreateNode("node_b", "sprite_b", {40, 40});
+      collision_checker_.CheckCollisions();
+      scene_manager_.Render();
+
+      THEN("the action does not apply to the new node") {
+        REQUIRE(CountNodesBySprite("sprite_b") == 1);
+      }
+    }
+  }
+}
+
+namespace {
+// Returns a collision mask of |width| from a string of '0' and '1' pixels in
+// row-major order.
+CollisionMask MakeMask(int width, const std::string& pixels) {
+  CollisionMask mask(width, pixels.size() / width);
+  for (int i = 0; i < pixels.size(); ++i) {
+    mask.Set(i % width, i / width, pixels[i] == '1');
+  }
+  return mask;
+}
+
+// Reference pixel-by-pixel implementation of SceneNodePixelsCollide().
+bool PixelsCollideReference(const Box& lhs_aabb, const Box& rhs_aabb,
+                            const CollisionMask& lhs_mask,
+                            const CollisionMask& rhs_mask) {
+  const auto intersection = geo::Intersection(lhs_aabb, rhs_aabb);
+  for (int y = intersection.top();
+       y < intersection.top() + intersection.height(); ++y) {
+    for (int x = intersection.left();
+         x < intersection.left() + intersection.width(); ++x) {
+      if (lhs_mask.Get(x - lhs_aabb.left(), y - lhs_aabb.top()) &&
+          rhs_mask.Get(x - rhs_aabb.left(), y - rhs_aabb.top())) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+}  // namespace
+
 SCENARIO("Pixel-perfect collision", "[collisions]") {
   GIVEN("two collision masks") {
     //  LHS  -  RHS
     // 10000   11000
     // 10011   01100
     // 11110   11111
-    std::string tmp = "100001001111110";
-    std::vector<bool> lhs_mask;
-    for (auto c : tmp) {
-      lhs_mask.push_back(c == '1' ? true : false);
-    }
-    tmp = "110000110011111";
-    std::vector<bool> rhs_mask;
-    for (auto c : tmp) {
-      rhs_mask.push_back(c == '1' ? true : false);
-    }
+    const auto lhs_mask = MakeMask(5, "100001001111110");
+    const auto rhs_mask = MakeMask(5, "110000110011111");
 
     WHEN("sprites are next to each other") {
       const auto lhs = ParseProto<Box>("left: 0  top: 0  width: 5  height: 3");
@@ -485,4 +804,140 @@ SCENARIO("Pixel-perfect collision", "[collisions]") {
   }
 }
 
+SCENARIO("Pixel-perfect collision of wide masks", "[collisions]") {
+  GIVEN("masks that span multiple words per row") {
+    // A thin platform and a sparse sprite that is wider than a word.
+    CollisionMask platform(150, 4);
+    for (int x = 0; x < 150; x += 3) {
+      platform.Set(x, 0);
+      platform.Set(x, 3);
+    }
+    CollisionMask sprite(70, 9);
+    sprite.Set(0, 0);
+    sprite.Set(69, 8);
+    sprite.Set(64, 4);
+    sprite.Set(31, 6);
+    const CollisionMaskPyramid platform_pyramid(platform);
+    const CollisionMaskPyramid sprite_pyramid(sprite);
+
+    WHEN("they are tested at every relative position") {
+      THEN("the result matches a pixel-by-pixel test") {
+        auto lhs = ParseProto<Box>("left: 0  top: 0  width: 150  height: 4");
+        auto rhs = ParseProto<Box>("width: 70  height: 9");
+        for (int y = -9; y <= 4; ++y) {
+          for (int x = -70; x <= 150; ++x) {
+            rhs.set_left(x);
+            rhs.set_top(y);
+            INFO("rhs at (" << x << ", " << y << ")");
+            REQUIRE(internal::SceneNodePixelsCollide(lhs, rhs, platform,
+                                                     sprite) ==
+                    PixelsCollideReference(lhs, rhs, platform, sprite));
+            REQUIRE(internal::SceneNodePixelsCollide(rhs, lhs, sprite,
+                                                     platform) ==
+                    PixelsCollideReference(rhs, lhs, sprite, platform));
+            REQUIRE(internal::SceneNodePixelsCollide(
+                        lhs, rhs, platform, sprite, platform_pyramid,
+                        sprite_pyramid) ==
+                    PixelsCollideReference(lhs, rhs, platform, sprite));
+          }
+        }
+      }
+    }
+
+    WHEN("a fully set mask overlaps the platform") {
+      const CollisionMask block(64, 2, true);
+      const auto lhs =
+          ParseProto<Box>("left: 0  top: 0  width: 150  height: 4");
+
+      THEN("collision triggers only when a set platform row is covered") {
+        REQUIRE_FALSE(internal::SceneNodePixelsCollide(
+            lhs, ParseProto<Box>("left: 70  top: 1  width: 64  height: 2"),
+            platform, block));
+        REQUIRE(internal::SceneNodePixelsCollide(
+            lhs, ParseProto<Box>("left: 70  top: 2  width: 64  height: 2"),
+            platform, block));
+      }
+    }
+  }
+}
+
+SCENARIO("Mask pyramids", "[collisions]") {
+  GIVEN("a mask with a solid area and a sparse area") {
+    // Solid 20x12 rectangle at the left and a diagonal line at the right.
+    CollisionMask mask(40, 12);
+    for (int y = 0; y < 12; ++y) {
+      for (int x = 0; x < 20; ++x) mask.Set(x, y);
+      mask.Set(20 + y, y);
+    }
+    const CollisionMaskPyramid pyramid(mask);
+
+    THEN("blocks are set according to the pixels they cover") {
+      const auto& coarse = pyramid.coarse();
+      REQUIRE(coarse.any.width() == 5);
+      REQUIRE(coarse.any.height() == 2);
+
+      REQUIRE(coarse.full.Get(0, 0));
+      // Blocks that are partially outside the mask are never full.
+      REQUIRE(coarse.any.Get(1, 1));
+      REQUIRE_FALSE(coarse.full.Get(1, 1));
+      // Block covering both the solid area and the line.
+      REQUIRE(coarse.any.Get(2, 0));
+      REQUIRE_FALSE(coarse.full.Get(2, 0));
+      // Block with no pixels set.
+      REQUIRE_FALSE(coarse.any.Get(4, 0));
+
+      const auto& fine = pyramid.fine();
+      REQUIRE(fine.full.Get(4, 2));
+      REQUIRE_FALSE(fine.any.Get(7, 0));
+      REQUIRE(fine.any.Get(7, 2));
+    }
+  }
+
+  GIVEN("large masks with solid and sparse areas") {
+    // Solid left half and diagonal lines on the right half.
+    CollisionMask lhs_mask(160, 136);
+    for (int y = 0; y < 136; ++y) {
+      for (int x = 0; x < 80; ++x) lhs_mask.Set(x, y);
+      lhs_mask.Set(80 + y % 80, y);
+      lhs_mask.Set(159 - y % 80, y);
+    }
+    // Cross with a solid square in the middle.
+    CollisionMask rhs_mask(130, 130);
+    for (int i = 0; i < 130; ++i) {
+      rhs_mask.Set(i, i);
+      rhs_mask.Set(129 - i, i);
+    }
+    for (int y = 55; y < 75; ++y) {
+      for (int x = 55; x < 75; ++x) rhs_mask.Set(x, y);
+    }
+    const CollisionMaskPyramid lhs_pyramid(lhs_mask);
+    const CollisionMaskPyramid rhs_pyramid(rhs_mask);
+
+    WHEN("they are tested at many relative positions") {
+      THEN("the result matches a pixel-by-pixel test") {
+        const auto lhs =
+            ParseProto<Box>("left: 0  top: 0  width: 160  height: 136");
+        auto rhs = ParseProto<Box>("width: 130  height: 130");
+
+        // A step that is coprime to the block sizes covers all alignments.
+        for (int y = -130; y <= 136; y += 5) {
+          for (int x = -130; x <= 160; x += 5) {
+            rhs.set_left(x);
+            rhs.set_top(y);
+            INFO("rhs at (" << x << ", " << y << ")");
+            const bool expected =
+                PixelsCollideReference(lhs, rhs, lhs_mask, rhs_mask);
+            REQUIRE(internal::SceneNodePixelsCollide(lhs, rhs, lhs_mask,
+                                                     rhs_mask, lhs_pyramid,
+                                                     rhs_pyramid) == expected);
+            REQUIRE(internal::SceneNodePixelsCollide(rhs, lhs, rhs_mask,
+                                                     lhs_mask, rhs_pyramid,
+                                                     lhs_pyramid) == expected);
+          }
+        }
+      }
+    }
+  }
+}
+
 }  // namespace troll
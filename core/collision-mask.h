@@ -0,0 +1,160 @@
+#ifndef TROLL_CORE_COLLISION_MASK_H_
+#define TROLL_CORE_COLLISION_MASK_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace troll {
+
+// Pixel collision mask of a sprite film. Rows are bit-packed in 64-bit words
+// and each row starts at a word boundary, so that overlapping rows of two masks
+// can be tested a word at a time. Bit i of a word is the pixel at column
+// (word_index * 64 + i) of the row.
+class CollisionMask {
+ public:
+  CollisionMask() = default;
+  CollisionMask(int width, int height, bool value = false)
+      : width_(width),
+        height_(height),
+        words_per_row_((width + kWordBits - 1) / kWordBits),
+        words_(static_cast<size_t>(words_per_row_) * height,
+               value ? ~uint64_t(0) : uint64_t(0)) {
+    if (value) ClearPadding();
+  }
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  int words_per_row() const { return words_per_row_; }
+
+  bool Get(int x, int y) const {
+    return (row(y)[x / kWordBits] >> (x % kWordBits)) & 1;
+  }
+
+  void Set(int x, int y, bool value = true) {
+    uint64_t& word = words_[y * words_per_row_ + x / kWordBits];
+    const uint64_t bit = uint64_t(1) << (x % kWordBits);
+    word = value ? word | bit : word & ~bit;
+  }
+
+  const uint64_t* row(int y) const {
+    return words_.data() + y * words_per_row_;
+  }
+
+  // Returns the 64 pixels of row |y| starting at column |x|, with the pixel at
+  // |x| in the lowest bit. Pixels past the end of the row are zero.
+  uint64_t ExtractWord(int y, int x) const {
+    const uint64_t* words = row(y);
+    const int index = x / kWordBits;
+    const int shift = x % kWordBits;
+
+    const uint64_t lo = index < words_per_row_ ? words[index] : 0;
+    if (shift == 0) return lo;
+
+    const uint64_t hi = index + 1 < words_per_row_ ? words[index + 1] : 0;
+    return (lo >> shift) | (hi << (kWordBits - shift));
+  }
+
+  // Returns true if any pixel is set in the |width| x |height| region whose
+  // top-left corner is at (|x|, |y|).
+  bool AnyInRegion(int x, int y, int width, int height) const {
+    for (int row = y; row < y + height; ++row) {
+      for (int column = 0; column < width; column += kWordBits) {
+        if (ExtractWord(row, x + column) & TailMask(width - column)) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // Returns true if all pixels are set in the |width| x |height| region whose
+  // top-left corner is at (|x|, |y|).
+  bool AllInRegion(int x, int y, int width, int height) const {
+    for (int row = y; row < y + height; ++row) {
+      for (int column = 0; column < width; column += kWordBits) {
+        const uint64_t tail_mask = TailMask(width - column);
+        if ((ExtractWord(row, x + column) & tail_mask) != tail_mask) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Returns a word with the lowest |bits| bits set, saturating at a full word.
+  static uint64_t TailMask(int bits) {
+    return bits >= kWordBits ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+  }
+
+  static constexpr int kWordBits = 64;
+
+ private:
+  // Bits past the width of each row must stay zero for word-wise tests.
+  void ClearPadding() {
+    const int tail_bits = width_ % kWordBits;
+    if (tail_bits == 0) return;
+
+    const uint64_t tail_mask = (uint64_t(1) << tail_bits) - 1;
+    for (int y = 0; y < height_; ++y) {
+      words_[(y + 1) * words_per_row_ - 1] &= tail_mask;
+    }
+  }
+
+  int width_ = 0;
+  int height_ = 0;
+  int words_per_row_ = 0;
+  std::vector<uint64_t> words_;
+};
+
+// Coarse occupancy of a CollisionMask at two levels of square blocks. A block
+// is set in |any| if any of its pixels is set in the mask and in |full| if it
+// lies entirely within the mask and all of its pixels are set. The narrow phase
+// uses them to reject or accept a collision before testing individual pixels.
+class CollisionMaskPyramid {
+ public:
+  struct Level {
+    CollisionMask any;
+    CollisionMask full;
+  };
+
+  explicit CollisionMaskPyramid(const CollisionMask& mask)
+      : coarse_(BuildLevel(mask, kCoarseBlockSize)),
+        fine_(BuildLevel(mask, kFineBlockSize)) {}
+
+  const Level& coarse() const { return coarse_; }
+  const Level& fine() const { return fine_; }
+
+  static constexpr int kCoarseBlockSize = 8;
+  static constexpr int kFineBlockSize = 4;
+
+ private:
+  static Level BuildLevel(const CollisionMask& mask, int block_size) {
+    const int width = (mask.width() + block_size - 1) / block_size;
+    const int height = (mask.height() + block_size - 1) / block_size;
+
+    Level level = {CollisionMask(width, height), CollisionMask(width, height)};
+    for (int y = 0; y < height; ++y) {
+      const int top = y * block_size;
+      const int block_height = std::min(block_size, mask.height() - top);
+      for (int x = 0; x < width; ++x) {
+        const int left = x * block_size;
+        const int block_width = std::min(block_size, mask.width() - left);
+        level.any.Set(x, y,
+                      mask.AnyInRegion(left, top, block_width, block_height));
+        level.full.Set(x, y,
+                       block_width == block_size &&
+                           block_height == block_size &&
+                           mask.AllInRegion(left, top, block_size, block_size));
+      }
+    }
+    return level;
+  }
+
+  Level coarse_;
+  Level fine_;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_COLLISION_MASK_H_
@@ -0,0 +1,99 @@
+#include "core/collision-rules.h"
+
+#include <algorithm>
+
+namespace troll {
+
+const CollisionAction& CollisionRules::Register(RuleType type,
+                                                const CollisionAction& rule) {
+  auto& rules = rules_[static_cast<int>(type)];
+  const int rule_index = rules.size();
+  rules.push_back(rule);
+
+  std::vector<int> keys;
+  for (const auto& id : rule.scene_node_id()) {
+    keys.push_back(Intern(id, &node_keys_, &next_key_));
+  }
+  for (const auto& sprite_id : rule.sprite_id()) {
+    keys.push_back(Intern(sprite_id, &sprite_keys_, &next_key_));
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  // Any two nodes that are part of the rule match it, including two nodes of
+  // the same sprite.
+  for (int i = 0; i < keys.size(); ++i) {
+    for (int j = i; j < keys.size(); ++j) {
+      index_[PairKey(keys[i], keys[j])][static_cast<int>(type)].push_back(
+          rule_index);
+    }
+  }
+  ++version_;
+  return rules.back();
+}
+
+CollisionRules::NodeKeys CollisionRules::GetNodeKeys(
+    const SceneNode& node) const {
+  return {Find(node.id(), node_keys_), Find(node.sprite_id(), sprite_keys_)};
+}
+
+bool CollisionRules::HasRules(NodeKeys lhs, NodeKeys rhs) const {
+  for (const int lhs_key : {lhs.id, lhs.sprite}) {
+    if (lhs_key == kNoKey) continue;
+    for (const int rhs_key : {rhs.id, rhs.sprite}) {
+      if (rhs_key == kNoKey) continue;
+      if (index_.find(PairKey(lhs_key, rhs_key)) != index_.end()) return true;
+    }
+  }
+  return false;
+}
+
+void CollisionRules::GetRules(
+    RuleType type, NodeKeys lhs, NodeKeys rhs,
+    std::vector<const CollisionAction*>* rules) const {
+  const int type_index = static_cast<int>(type);
+
+  // A rule may match more than one pair of keys, e.g. both by node id and by
+  // sprite id.
+  std::vector<int> rule_indices;
+  for (const int lhs_key : {lhs.id, lhs.sprite}) {
+    if (lhs_key == kNoKey) continue;
+    for (const int rhs_key : {rhs.id, rhs.sprite}) {
+      if (rhs_key == kNoKey) continue;
+      const auto it = index_.find(PairKey(lhs_key, rhs_key));
+      if (it == index_.end()) continue;
+      const auto& indices = it->second[type_index];
+      rule_indices.insert(rule_indices.end(), indices.begin(), indices.end());
+    }
+  }
+  std::sort(rule_indices.begin(), rule_indices.end());
+  rule_indices.erase(std::unique(rule_indices.begin(), rule_indices.end()),
+                     rule_indices.end());
+
+  for (const int index : rule_indices) {
+    rules->push_back(&rules_[type_index][index]);
+  }
+}
+
+int CollisionRules::Intern(const std::string& id,
+                           std::unordered_map<std::string, int>* keys,
+                           int* next_key) {
+  const auto it = keys->find(id);
+  if (it != keys->end()) return it->second;
+
+  keys->emplace(id, *next_key);
+  return (*next_key)++;
+}
+
+int CollisionRules::Find(const std::string& id,
+                         const std::unordered_map<std::string, int>& keys) {
+  const auto it = keys.find(id);
+  return it != keys.end() ? it->second : kNoKey;
+}
+
+uint64_t CollisionRules::PairKey(int lhs, int rhs) {
+  if (lhs > rhs) std::swap(lhs, rhs);
+  return (static_cast<uint64_t>(lhs) << 32) | static_cast<uint32_t>(rhs);
+}
+
+}  // namespace troll
@@ -0,0 +1,92 @@
+#ifndef TROLL_CORE_COLLISION_RULES_H_
+#define TROLL_CORE_COLLISION_RULES_H_
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "proto/action.pb.h"
+#include "proto/scene-node.pb.h"
+
+namespace troll {
+
+// Directory of registered CollisionActions indexed by the pairs of node ids
+// and sprite ids they refer to. A rule matches a pair of nodes if both of
+// them are part of the rule, directly by scene_node_id or indirectly by
+// sprite_id.
+class CollisionRules {
+ public:
+  enum class RuleType {
+    COLLISION,
+    OVERLAP,
+    DETACHMENT,
+  };
+
+  // Interned ids of a node and its sprite that are used for looking up rules.
+  // Ids that are not referenced by any rule are kNoKey.
+  struct NodeKeys {
+    int id = kNoKey;
+    int sprite = kNoKey;
+  };
+  static constexpr int kNoKey = -1;
+
+  CollisionRules() = default;
+  ~CollisionRules() = default;
+
+  // Returns the registered copy of |rule|, which stays at the same address
+  // while the rules exist.
+  const CollisionAction& Register(RuleType type, const CollisionAction& rule);
+
+  // Returns the keys of |node|. Keys of a node change only when new rules are
+  // registered, which is tracked by version().
+  NodeKeys GetNodeKeys(const SceneNode& node) const;
+
+  // Returns true if any rule matches a pair of nodes.
+  bool HasRules(NodeKeys lhs, NodeKeys rhs) const;
+
+  // Appends rules of |type| matching a pair of nodes to |rules| in their order
+  // of registration. Rules stay valid while new rules are registered.
+  void GetRules(RuleType type, NodeKeys lhs, NodeKeys rhs,
+                std::vector<const CollisionAction*>* rules) const;
+
+  bool empty(RuleType type) const {
+    return rules_[static_cast<int>(type)].empty();
+  }
+
+  // Incremented every time a rule is registered.
+  int version() const { return version_; }
+
+  CollisionRules(const CollisionRules&) = delete;
+  CollisionRules& operator=(const CollisionRules&) = delete;
+
+ private:
+  static constexpr int kNumRuleTypes = 3;
+
+  // Returns the key of an id, interning it if needed.
+  static int Intern(const std::string& id,
+                    std::unordered_map<std::string, int>* keys, int* next_key);
+  static int Find(const std::string& id,
+                  const std::unordered_map<std::string, int>& keys);
+
+  static uint64_t PairKey(int lhs, int rhs);
+
+  // Registered rules by type. A deque keeps references to rules valid when
+  // actions register new rules while triggered.
+  std::array<std::deque<CollisionAction>, kNumRuleTypes> rules_;
+
+  // Indices of rules of each type by the pair of keys they match.
+  std::unordered_map<uint64_t, std::array<std::vector<int>, kNumRuleTypes>>
+      index_;
+
+  std::unordered_map<std::string, int> node_keys_;
+  std::unordered_map<std::string, int> sprite_keys_;
+  int next_key_ = 0;
+  int version_ = 0;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_COLLISION_RULES_H_
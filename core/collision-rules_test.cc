@@ -0,0 +1,78 @@
+#include "core/collision-rules.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include "proto/action.pb.h"
+#include "proto/scene-node.pb.h"
+#include "troll-test/test-util.h"
+
+namespace troll {
+
+SCENARIO("Looking up collision rules", "[CollisionRules.GetRules]") {
+  GIVEN("rules by node id and by sprite id") {
+    CollisionRules rules;
+    rules.Register(CollisionRules::RuleType::COLLISION,
+                   ParseProto<CollisionAction>(R"(
+                       scene_node_id: [ 'node_a', 'node_b' ]
+                       action { noop {} })"));
+    rules.Register(CollisionRules::RuleType::OVERLAP,
+                   ParseProto<CollisionAction>(R"(
+                       sprite_id: [ 'sprite_a' ]
+                       action { noop {} })"));
+    rules.Register(CollisionRules::RuleType::COLLISION,
+                   ParseProto<CollisionAction>(R"(
+                       scene_node_id: [ 'node_a' ]
+                       sprite_id: [ 'sprite_b' ]
+                       action { quit {} })"));
+
+    const auto node_a = rules.GetNodeKeys(ParseProto<SceneNode>(
+        "id: 'node_a'  sprite_id: 'sprite_a'"));
+    const auto node_b = rules.GetNodeKeys(ParseProto<SceneNode>(
+        "id: 'node_b'  sprite_id: 'sprite_b'"));
+    const auto node_c = rules.GetNodeKeys(ParseProto<SceneNode>(
+        "id: 'node_c'  sprite_id: 'sprite_a'"));
+    const auto node_d = rules.GetNodeKeys(ParseProto<SceneNode>(
+        "id: 'node_d'  sprite_id: 'sprite_d'"));
+
+    WHEN("rules of a pair of nodes are looked up") {
+      std::vector<const CollisionAction*> collisions;
+      rules.GetRules(CollisionRules::RuleType::COLLISION, node_b, node_a,
+                     &collisions);
+
+      THEN("rules matching in any order are returned once in their order") {
+        REQUIRE(collisions.size() == 2);
+        REQUIRE(collisions[0]->action(0).has_noop());
+        REQUIRE(collisions[1]->action(0).has_quit());
+      }
+    }
+
+    WHEN("two nodes of the same sprite are looked up") {
+      std::vector<const CollisionAction*> overlaps;
+      rules.GetRules(CollisionRules::RuleType::OVERLAP, node_a, node_c,
+                     &overlaps);
+
+      THEN("rules by sprite match") {
+        REQUIRE(overlaps.size() == 1);
+        REQUIRE(rules.HasRules(node_a, node_c));
+      }
+    }
+
+    THEN("pairs that no rule refers to have no rules") {
+      REQUIRE_FALSE(rules.HasRules(node_b, node_c));
+      REQUIRE_FALSE(rules.HasRules(node_a, node_d));
+      REQUIRE(node_d.id == CollisionRules::kNoKey);
+      REQUIRE(node_d.sprite == CollisionRules::kNoKey);
+    }
+
+    THEN("registering rules changes the version") {
+      const int version = rules.version();
+      rules.Register(CollisionRules::RuleType::DETACHMENT,
+                     ParseProto<CollisionAction>("sprite_id: 'sprite_d'"));
+      REQUIRE(rules.version() != version);
+      REQUIRE_FALSE(rules.empty(CollisionRules::RuleType::DETACHMENT));
+    }
+  }
+}
+
+}  // namespace troll
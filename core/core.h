@@ -10,6 +10,7 @@ class AnimatorManager;
 class AudioMixer;
 class CollisionChecker;
 class EventDispatcher;
+class FrameProfiler;
 class InputBackend;
 class InputManager;
 class QueryManager;
@@ -18,6 +19,9 @@ class ResourceManager;
 class SceneManager;
 class ScriptingEngine;
 class SoundLoader;
+class ThreadPool;
+
+enum class AnimationBackend;
 
 class Core {
  public:
@@ -26,12 +30,19 @@ class Core {
 
   virtual void Halt() = 0;
   virtual void LoadScene(const Scene& scene) = 0;
+  // Sets the number of worker threads of thread_pool(). It must not be called
+  // while a parallel stage of the frame runs.
+  virtual void SetWorkerThreads(int num_threads) = 0;
+  // Sets the backend that animations of scenes which are loaded after the
+  // call run on.
+  virtual void SetAnimationBackend(AnimationBackend backend) = 0;
 
   virtual ActionManager* action_manager() = 0;
   virtual AnimatorManager* animator_manager() = 0;
   virtual AudioMixer* audio_mixer() = 0;
   virtual CollisionChecker* collision_checker() = 0;
   virtual EventDispatcher* event_dispatcher() = 0;
+  virtual FrameProfiler* frame_profiler() = 0;
   virtual InputBackend* input_backend() = 0;
   virtual InputManager* input_manager() = 0;
   virtual QueryManager* query_manager() = 0;
@@ -41,6 +52,10 @@ class Core {
   virtual ScriptingEngine* scripting_engine() = 0;
   virtual SoundLoader* sound_loader() = 0;
 
+  // Workers for parallel stages of the frame. It may be nullptr, in which case
+  // stages run on the main loop thread.
+  virtual ThreadPool* thread_pool() = 0;
+
   Core(const Core&) = delete;
   Core& operator=(const Core&) = delete;
 };
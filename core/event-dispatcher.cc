@@ -50,6 +50,7 @@ void EventDispatcher::Emit(const Event& event) {
 
 void EventDispatcher::ProcessTriggeredEvents() {
   std::vector<std::tuple<EventHandler, Event>> handlers;
+  events_fired_ = triggered_events_.size();
   for (const auto& event : triggered_events_) {
     auto it = event_registry_.find(event.event_id());
     if (it == event_registry_.end()) continue;
@@ -46,6 +46,9 @@ class EventDispatcher {
   // Activates all fired events.
   void ProcessTriggeredEvents();
 
+  // Number of events processed by the last ProcessTriggeredEvents() call.
+  int events_fired() const { return events_fired_; }
+
   EventDispatcher(const EventDispatcher&) = delete;
   EventDispatcher& operator=(const EventDispatcher&) = delete;
 
@@ -58,6 +61,7 @@ class EventDispatcher {
 
   std::unordered_map<std::string, std::vector<HandlerInfo>> event_registry_;
   std::vector<Event> triggered_events_;
+  int events_fired_ = 0;
 };
 
 }  // namespace troll
@@ -0,0 +1,46 @@
+#include "core/event-dispatcher.h"
+
+#include <vector>
+
+#include <absl/strings/str_cat.h>
+#include <benchmark/benchmark.h>
+
+#include "proto/event.pb.h"
+
+namespace troll {
+namespace {
+
+// Arguments are the number of events emitted every frame and the number of
+// permanent handlers registered on each of them.
+void BM_ProcessTriggeredEvents(benchmark::State& state) {
+  const int events = state.range(0);
+  const int handlers = state.range(1);
+
+  EventDispatcher event_dispatcher;
+  int handled = 0;
+  std::vector<Event> emitted(events);
+  for (int i = 0; i < events; ++i) {
+    emitted[i].set_event_id(absl::StrCat("node_", i, ".script.done"));
+    for (int j = 0; j < handlers; ++j) {
+      event_dispatcher.RegisterPermanent(
+          emitted[i].event_id(), [&handled](const Event&) { ++handled; });
+    }
+  }
+
+  for (auto _ : state) {
+    for (const auto& event : emitted) {
+      event_dispatcher.Emit(event);
+    }
+    event_dispatcher.ProcessTriggeredEvents();
+  }
+  benchmark::DoNotOptimize(handled);
+  state.SetItemsProcessed(state.iterations() * events * handlers);
+}
+BENCHMARK(BM_ProcessTriggeredEvents)
+    ->Args({1, 256})
+    ->Args({16, 16})
+    ->Args({256, 1})
+    ->Args({256, 16});
+
+}  // namespace
+}  // namespace troll
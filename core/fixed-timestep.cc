@@ -0,0 +1,29 @@
+#include "core/fixed-timestep.h"
+
+#include <glog/logging.h>
+
+namespace troll {
+
+FixedTimestep::FixedTimestep(int step_time, int max_steps_per_frame)
+    : step_time_(step_time), max_steps_per_frame_(max_steps_per_frame) {
+  LOG_IF(FATAL, step_time <= 0)
+      << "Fixed timestep needs a positive step time, got " << step_time << ".";
+  LOG_IF(FATAL, max_steps_per_frame <= 0)
+      << "Fixed timestep needs at least one step per frame, got "
+      << max_steps_per_frame << ".";
+}
+
+int FixedTimestep::Advance(int time_since_last_frame) {
+  accumulator_ += time_since_last_frame;
+
+  int steps = accumulator_ / step_time_;
+  if (steps > max_steps_per_frame_) {
+    steps = max_steps_per_frame_;
+    accumulator_ = 0;
+  } else {
+    accumulator_ -= steps * step_time_;
+  }
+  return steps;
+}
+
+}  // namespace troll
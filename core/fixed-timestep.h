@@ -0,0 +1,36 @@
+#ifndef TROLL_CORE_FIXED_TIMESTEP_H_
+#define TROLL_CORE_FIXED_TIMESTEP_H_
+
+namespace troll {
+
+// Accumulates frame times and splits them in simulation steps of fixed
+// duration, so that simulation does not depend on the frame rate.
+class FixedTimestep {
+ public:
+  // Steps are |step_time| milliseconds long. At most |max_steps_per_frame| run
+  // for a single frame and time beyond that is dropped, so that a long frame
+  // slows simulation down instead of stalling rendering with catch-up steps.
+  FixedTimestep(int step_time, int max_steps_per_frame);
+  ~FixedTimestep() = default;
+
+  // Adds |time_since_last_frame| milliseconds and returns the number of steps
+  // that should be simulated for this frame.
+  int Advance(int time_since_last_frame);
+
+  // Returns the fraction of a step that accumulated but was not simulated yet,
+  // in the range [0, 1).
+  double alpha() const {
+    return static_cast<double>(accumulator_) / step_time_;
+  }
+
+  int step_time() const { return step_time_; }
+
+ private:
+  int step_time_;
+  int max_steps_per_frame_;
+  int accumulator_ = 0;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_FIXED_TIMESTEP_H_
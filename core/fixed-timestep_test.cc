@@ -0,0 +1,44 @@
+#include "core/fixed-timestep.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace troll {
+
+SCENARIO("Splitting frame times in fixed steps", "[FixedTimestep.Advance]") {
+  GIVEN("a fixed timestep of 10ms") {
+    FixedTimestep timestep(10, 5);
+
+    WHEN("frames are shorter than a step") {
+      THEN("steps run once enough time accumulates") {
+        REQUIRE(timestep.Advance(4) == 0);
+        REQUIRE(timestep.alpha() == Approx(0.4));
+        REQUIRE(timestep.Advance(4) == 0);
+        REQUIRE(timestep.Advance(4) == 1);
+        REQUIRE(timestep.alpha() == Approx(0.2));
+      }
+    }
+
+    WHEN("a frame spans multiple steps") {
+      const int steps = timestep.Advance(35);
+
+      THEN("the remainder is kept for the next frame") {
+        REQUIRE(steps == 3);
+        REQUIRE(timestep.alpha() == Approx(0.5));
+        REQUIRE(timestep.Advance(5) == 1);
+      }
+    }
+
+    WHEN("a frame is longer than the maximum catch-up") {
+      const int steps = timestep.Advance(1000);
+
+      THEN("steps are capped and the excess time is dropped") {
+        REQUIRE(steps == 5);
+        REQUIRE(timestep.alpha() == 0);
+        REQUIRE(timestep.Advance(10) == 1);
+      }
+    }
+  }
+}
+
+}  // namespace troll
@@ -0,0 +1,93 @@
+#include "core/frame-profiler.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace troll {
+
+namespace {
+constexpr const char* kStageNames[] = {
+    "input", "animation", "collision", "events", "render",
+};
+constexpr const char* kCounterNames[] = {
+    "collision_pairs", "nodes_blitted", "events_fired", "actions_executed",
+};
+
+// Returns the histogram bucket of a time in microseconds, which is the
+// position of its highest set bit.
+int HistogramBucket(int64_t microseconds, int buckets) {
+  int bucket = 0;
+  while (microseconds > 1 && bucket < buckets - 1) {
+    microseconds >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+}  // namespace
+
+const char* FrameProfiler::StageName(Stage stage) {
+  return kStageNames[static_cast<int>(stage)];
+}
+
+FrameProfiler::FrameProfiler(int window_size) : window_(window_size) {
+  LOG_IF(FATAL, window_size <= 0)
+      << "FrameProfiler window must hold at least one frame.";
+}
+
+void FrameProfiler::EndFrame() {
+  window_[next_frame_] = current_;
+  next_frame_ = (next_frame_ + 1) % window_.size();
+  frames_ = std::min<int>(frames_ + 1, window_.size());
+  current_ = FrameSample();
+}
+
+FrameProfile FrameProfiler::GetProfile() const {
+  FrameProfile profile;
+  profile.set_frames(frames_);
+  if (frames_ == 0) return profile;
+
+  std::vector<int64_t> times(frames_);
+  for (int stage = 0; stage < kNumStages; ++stage) {
+    auto* stage_profile = profile.add_stage();
+    stage_profile->set_name(StageName(static_cast<Stage>(stage)));
+    stage_profile->set_last_us(GetFrame(0).stage_times[stage]);
+
+    std::vector<int> histogram(kHistogramBuckets);
+    int64_t total = 0;
+    for (int age = 0; age < frames_; ++age) {
+      times[age] = GetFrame(age).stage_times[stage];
+      total += times[age];
+      ++histogram[HistogramBucket(times[age], kHistogramBuckets)];
+    }
+    stage_profile->set_mean_us(total / frames_);
+    for (const int count : histogram) {
+      stage_profile->add_histogram(count);
+    }
+
+    const int p95 = frames_ * 95 / 100;
+    std::nth_element(times.begin(), times.begin() + p95, times.end());
+    stage_profile->set_p95_us(times[p95]);
+    stage_profile->set_max_us(*std::max_element(times.begin(), times.end()));
+  }
+
+  for (int counter = 0; counter < kNumCounters; ++counter) {
+    auto* counter_profile = profile.add_counter();
+    counter_profile->set_name(kCounterNames[counter]);
+    counter_profile->set_last(GetFrame(0).counters[counter]);
+
+    int64_t total = 0;
+    for (int age = 0; age < frames_; ++age) {
+      total += GetFrame(age).counters[counter];
+    }
+    counter_profile->set_mean(static_cast<double>(total) / frames_);
+  }
+  return profile;
+}
+
+const FrameProfiler::FrameSample& FrameProfiler::GetFrame(int age) const {
+  const int size = window_.size();
+  return window_[(next_frame_ - 1 - age + size) % size];
+}
+
+}  // namespace troll
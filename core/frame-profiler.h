@@ -0,0 +1,105 @@
+#ifndef TROLL_CORE_FRAME_PROFILER_H_
+#define TROLL_CORE_FRAME_PROFILER_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "core/trace-recorder.h"
+#include "proto/query.pb.h"
+
+namespace troll {
+
+// Collects per-frame timings of the main loop stages and counters of the work
+// they did. The last frames are kept in a rolling window that can be
+// summarised with GetProfile().
+class FrameProfiler {
+ public:
+  enum class Stage {
+    INPUT,
+    ANIMATION,
+    COLLISION,
+    EVENTS,
+    RENDER,
+  };
+  static constexpr int kNumStages = 5;
+
+  enum class Counter {
+    COLLISION_PAIRS,
+    NODES_BLITTED,
+    EVENTS_FIRED,
+    ACTIONS_EXECUTED,
+  };
+  static constexpr int kNumCounters = 4;
+
+  // Adds the time from its construction to its destruction to a stage of the
+  // current frame. The stage is also recorded as a trace event when tracing.
+  class ScopedTimer {
+   public:
+    ScopedTimer(FrameProfiler* profiler, Stage stage)
+        : profiler_(profiler),
+          stage_(stage),
+          trace_event_("stage", StageName(stage)),
+          start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+      profiler_->AddTime(
+          stage_, std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - start_)
+                      .count());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+   private:
+    FrameProfiler* profiler_;
+    Stage stage_;
+    TraceRecorder::ScopedEvent trace_event_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  explicit FrameProfiler(int window_size = kDefaultWindowSize);
+  ~FrameProfiler() = default;
+
+  void AddTime(Stage stage, int64_t microseconds) {
+    current_.stage_times[static_cast<int>(stage)] += microseconds;
+  }
+  void AddCount(Counter counter, int count) {
+    current_.counters[static_cast<int>(counter)] += count;
+  }
+
+  static const char* StageName(Stage stage);
+
+  // Closes the current frame and adds it to the rolling window, replacing the
+  // oldest frame when the window is full.
+  void EndFrame();
+
+  // Returns a summary of the frames in the window.
+  FrameProfile GetProfile() const;
+
+  FrameProfiler(const FrameProfiler&) = delete;
+  FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+ private:
+  static constexpr int kDefaultWindowSize = 120;
+  static constexpr int kHistogramBuckets = 16;
+
+  struct FrameSample {
+    std::array<int64_t, kNumStages> stage_times = {};
+    std::array<int, kNumCounters> counters = {};
+  };
+
+  // Returns the frame that ended |age| frames ago, where 0 is the last one.
+  const FrameSample& GetFrame(int age) const;
+
+  std::vector<FrameSample> window_;
+  int next_frame_ = 0;
+  int frames_ = 0;
+
+  FrameSample current_;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_FRAME_PROFILER_H_
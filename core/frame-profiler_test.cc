@@ -0,0 +1,75 @@
+#include "core/frame-profiler.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace troll {
+
+SCENARIO("Profiling frames in a rolling window", "[FrameProfiler.Profile]") {
+  GIVEN("a profiler with a window of 4 frames") {
+    FrameProfiler profiler(4);
+
+    THEN("an empty profile is returned") {
+      const auto profile = profiler.GetProfile();
+      REQUIRE(profile.frames() == 0);
+      REQUIRE(profile.stage().empty());
+    }
+
+    WHEN("some frames are profiled") {
+      for (int frame = 1; frame <= 3; ++frame) {
+        profiler.AddTime(FrameProfiler::Stage::RENDER, frame * 100);
+        profiler.AddTime(FrameProfiler::Stage::RENDER, 10);
+        profiler.AddCount(FrameProfiler::Counter::NODES_BLITTED, frame);
+        profiler.EndFrame();
+      }
+      const auto profile = profiler.GetProfile();
+
+      THEN("stage times are summarised") {
+        REQUIRE(profile.frames() == 3);
+        REQUIRE(profile.stage_size() == FrameProfiler::kNumStages);
+
+        const auto& render = profile.stage(4);
+        REQUIRE(render.name() == "render");
+        REQUIRE(render.last_us() == 310);
+        REQUIRE(render.mean_us() == 210);
+        REQUIRE(render.max_us() == 310);
+        REQUIRE(render.p95_us() == 310);
+      }
+
+      THEN("stage times are bucketed in a histogram") {
+        const auto& render = profile.stage(4);
+        // 110us falls in [64, 128), 210us and 310us in [128, 256) and
+        // [256, 512) respectively.
+        REQUIRE(render.histogram(6) == 1);
+        REQUIRE(render.histogram(7) == 1);
+        REQUIRE(render.histogram(8) == 1);
+
+        // Stages that took no time fall in the first bucket.
+        REQUIRE(profile.stage(0).histogram(0) == 3);
+      }
+
+      THEN("counters are summarised") {
+        const auto& nodes_blitted = profile.counter(1);
+        REQUIRE(nodes_blitted.name() == "nodes_blitted");
+        REQUIRE(nodes_blitted.last() == 3);
+        REQUIRE(nodes_blitted.mean() == Approx(2.0));
+      }
+
+      AND_WHEN("more frames than the window holds are profiled") {
+        for (int frame = 0; frame < 4; ++frame) {
+          profiler.AddTime(FrameProfiler::Stage::RENDER, 50);
+          profiler.EndFrame();
+        }
+
+        THEN("only the latest frames are summarised") {
+          const auto profile = profiler.GetProfile();
+          REQUIRE(profile.frames() == 4);
+          REQUIRE(profile.stage(4).max_us() == 50);
+          REQUIRE(profile.counter(1).mean() == 0);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace troll
@@ -2,6 +2,8 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 namespace troll {
 namespace geo {
 
@@ -36,6 +38,75 @@ Box Intersection(const Box& lhs, const Box& rhs) {
   return box;
 }
 
+bool Contains(const Rect& rect, const Vector& v) {
+  return !((v.x() < rect.left) || (v.x() >= rect.left + rect.width) ||
+           (v.y() <= rect.top) || (v.y() > rect.top + rect.height));
+}
+
+bool Collide(const Rect& lhs, const Rect& rhs) {
+  return abs(2 * lhs.left - 2 * rhs.left + lhs.width - rhs.width) <
+             lhs.width + rhs.width &&
+         abs(2 * lhs.top - 2 * rhs.top + lhs.height - rhs.height) <
+             lhs.height + rhs.height;
+}
+
+namespace {
+// Narrows the open interval of times (|enter|, |exit|) to the times when an
+// offset moving by |delta| per unit of time is strictly between |lower| and
+// |upper|. Returns false if the result is empty.
+bool ClipSlab(int lower, int upper, int delta, double* enter, double* exit) {
+  if (delta == 0) return lower < 0 && 0 < upper;
+
+  double t0 = static_cast<double>(lower) / delta;
+  double t1 = static_cast<double>(upper) / delta;
+  if (t0 > t1) std::swap(t0, t1);
+  *enter = std::max(*enter, t0);
+  *exit = std::min(*exit, t1);
+  return *enter < *exit;
+}
+}  // namespace
+
+bool SweptCollide(const Rect& lhs, int dx, int dy, const Rect& rhs) {
+  // Offsets of lhs from its position that overlap rhs.
+  double enter = -1.0, exit = 2.0;
+  return ClipSlab(rhs.left - lhs.width - lhs.left,
+                  rhs.left + rhs.width - lhs.left, dx, &enter, &exit) &&
+         ClipSlab(rhs.top - lhs.height - lhs.top,
+                  rhs.top + rhs.height - lhs.top, dy, &enter, &exit) &&
+         enter < 1.0 && exit > 0.0;
+}
+
+Rect Intersection(const Rect& lhs, const Rect& rhs) {
+  Rect rect;
+  rect.left = std::max(lhs.left, rhs.left);
+  rect.top = std::max(lhs.top, rhs.top);
+  rect.width = std::min(lhs.left + lhs.width, rhs.left + rhs.width) - rect.left;
+  rect.height = std::min(lhs.top + lhs.height, rhs.top + rhs.height) - rect.top;
+  return rect;
+}
+
+Rect Union(const Rect& lhs, const Rect& rhs) {
+  Rect rect;
+  rect.left = std::min(lhs.left, rhs.left);
+  rect.top = std::min(lhs.top, rhs.top);
+  rect.width = std::max(lhs.left + lhs.width, rhs.left + rhs.width) - rect.left;
+  rect.height = std::max(lhs.top + lhs.height, rhs.top + rhs.height) - rect.top;
+  return rect;
+}
+
+Box ToBox(const Rect& rect) {
+  Box box;
+  box.set_left(rect.left);
+  box.set_top(rect.top);
+  box.set_width(rect.width);
+  box.set_height(rect.height);
+  return box;
+}
+
+Rect ToRect(const Box& box) {
+  return {box.left(), box.top(), box.width(), box.height()};
+}
+
 double VectorLength(const Vector& v) {
   return std::sqrt(VectorSquaredLength(v));
 }
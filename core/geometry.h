@@ -5,17 +5,47 @@
 #include "proto/scene-node.pb.h"
 
 namespace troll {
+
+// Plain axis-aligned rectangle with the same semantics as Box. It is used
+// instead of Box protos on per-frame paths.
+struct Rect {
+  int left = 0;
+  int top = 0;
+  int width = 0;
+  int height = 0;
+
+  bool operator==(const Rect& other) const {
+    return left == other.left && top == other.top && width == other.width &&
+           height == other.height;
+  }
+  bool operator!=(const Rect& other) const { return !(*this == other); }
+};
+
 namespace geo {
 
 // Returns true if |box| contains point |v|. Border points are not contained.
 bool Contains(const Box& box, const Vector& v);
+bool Contains(const Rect& rect, const Vector& v);
 
 // Returns true if the two input boxes overlap. Touching sides is no collision.
 bool Collide(const Box& lhs, const Box& rhs);
+bool Collide(const Rect& lhs, const Rect& rhs);
+
+// Returns true if |lhs| collides with |rhs| at any point while it is translated
+// by (dx, dy) from its position. Touching sides is no collision.
+bool SweptCollide(const Rect& lhs, int dx, int dy, const Rect& rhs);
 
 // Returns the box defined by the intersection of input boxes. If the boxes do
 // not collide, the returned box is invalid.
 Box Intersection(const Box& lhs, const Box& rhs);
+Rect Intersection(const Rect& lhs, const Rect& rhs);
+
+// Returns the smallest rect that contains both input rects.
+Rect Union(const Rect& lhs, const Rect& rhs);
+
+// Conversions between Box protos and Rects.
+Box ToBox(const Rect& rect);
+Rect ToRect(const Box& box);
 
 double VectorLength(const Vector& v);
 double VectorSquaredLength(const Vector& v);
@@ -115,6 +115,43 @@ SCENARIO("Box collides with other boxes", "[GeometryTest.Collide]") {
   }
 }
 
+SCENARIO("Moving rects collide with other rects",
+         "[GeometryTest.SweptCollide]") {
+  GIVEN("a rect and a thin wall ahead of it") {
+    const Rect rect = {0, 0, 10, 10};
+    const Rect wall = {30, -20, 2, 50};
+
+    WHEN("it moves through the wall") {
+      THEN("they collide") {
+        REQUIRE(SweptCollide(rect, 60, 0, wall));
+        REQUIRE(SweptCollide(rect, 60, 20, wall));
+      }
+    }
+
+    WHEN("it stops short of the wall") {
+      THEN("they do not collide") {
+        REQUIRE_FALSE(SweptCollide(rect, 20, 0, wall));
+        REQUIRE_FALSE(SweptCollide(rect, -60, 0, wall));
+      }
+    }
+
+    WHEN("it passes by the end of the wall") {
+      THEN("they do not collide") {
+        REQUIRE_FALSE(SweptCollide(rect, 60, 150, wall));
+        REQUIRE_FALSE(SweptCollide(rect, 60, -120, wall));
+      }
+    }
+
+    WHEN("it does not move") {
+      THEN("it collides only with overlapping rects") {
+        REQUIRE_FALSE(SweptCollide(rect, 0, 0, wall));
+        REQUIRE(SweptCollide(rect, 0, 0, Rect{5, 5, 10, 10}));
+        REQUIRE_FALSE(SweptCollide(rect, 0, 0, Rect{10, 0, 10, 10}));
+      }
+    }
+  }
+}
+
 SCENARIO("Box intersects with other boxes", "[GeometryTest.Intersection") {
   GIVEN("a box") {
     const auto lhs =
@@ -207,5 +244,44 @@ SCENARIO("Box intersects with other boxes", "[GeometryTest.Intersection") {
   }
 }
 
+SCENARIO("Rects behave like boxes", "[GeometryTest.Rect]") {
+  GIVEN("a rect and its equivalent box") {
+    const auto box =
+        ParseProto<Box>(R"(left: 10  top: 10  width: 10  height: 20)");
+    const auto rect = ToRect(box);
+
+    THEN("they convert to each other") {
+      REQUIRE(rect == Rect{10, 10, 10, 20});
+      REQUIRE_THAT(ToBox(rect), EqualsProto(box));
+    }
+
+    WHEN("tested against other rects around it") {
+      THEN("results match the ones of boxes") {
+        for (int top = 0; top <= 30; top += 5) {
+          for (int left = 0; left <= 20; left += 2) {
+            const Rect other = {left, top, 5, 5};
+            const auto other_box = ToBox(other);
+            REQUIRE(Collide(rect, other) == Collide(box, other_box));
+            REQUIRE(Intersection(rect, other) ==
+                    ToRect(Intersection(box, other_box)));
+
+            auto point = ParseProto<Vector>("");
+            point.set_x(left);
+            point.set_y(top);
+            REQUIRE(Contains(rect, point) == Contains(box, point));
+          }
+        }
+      }
+    }
+
+    WHEN("merged with another rect") {
+      THEN("the union contains both of them") {
+        REQUIRE(Union(rect, Rect{0, 25, 5, 10}) == Rect{0, 10, 20, 25});
+        REQUIRE(Union(rect, Rect{12, 12, 2, 2}) == rect);
+      }
+    }
+  }
+}
+
 }  // namespace geo
 }  // namespace troll
@@ -0,0 +1,32 @@
+#ifndef TROLL_CORE_NODE_HANDLE_H_
+#define TROLL_CORE_NODE_HANDLE_H_
+
+#include <cstdint>
+
+namespace troll {
+
+// Dense reference to a SceneNode allocated by the SceneManager. Slots of
+// deleted nodes are reused, so a handle also carries the generation of its
+// slot. A handle to a deleted node never resolves to a node that was added
+// later in the same slot.
+struct NodeHandle {
+  uint32_t index = kInvalidIndex;
+  uint32_t generation = 0;
+
+  bool valid() const { return index != kInvalidIndex; }
+
+  bool operator==(const NodeHandle& other) const {
+    return index == other.index && generation == other.generation;
+  }
+  bool operator!=(const NodeHandle& other) const { return !(*this == other); }
+  bool operator<(const NodeHandle& other) const {
+    return index != other.index ? index < other.index
+                                : generation < other.generation;
+  }
+
+  static constexpr uint32_t kInvalidIndex = ~uint32_t(0);
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_NODE_HANDLE_H_
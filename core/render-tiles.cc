@@ -0,0 +1,144 @@
+#include "core/render-tiles.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace troll {
+
+namespace {
+// Integer division that rounds towards negative infinity, so that negative
+// coordinates map to the correct tile.
+int FloorDiv(int value, int divisor) {
+  const int quotient = value / divisor;
+  return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1
+                                                                : quotient;
+}
+}  // namespace
+
+void RenderTiles::UpdateNode(uint32_t index, const Rect& aabb) {
+  const auto range = GetTileRange(aabb);
+  if (index < indexed_.size() && indexed_[index]) {
+    if (node_tiles_[index] == range) return;
+    RemoveNode(index);
+  }
+
+  if (index >= indexed_.size()) {
+    indexed_.resize(index + 1);
+    node_tiles_.resize(index + 1);
+  }
+  indexed_[index] = true;
+  node_tiles_[index] = range;
+
+  for (int y = range.top; y <= range.bottom; ++y) {
+    for (int x = range.left; x <= range.right; ++x) {
+      tiles_[TileKey(x, y)].push_back(index);
+    }
+  }
+}
+
+void RenderTiles::RemoveNode(uint32_t index) {
+  if (index >= indexed_.size() || !indexed_[index]) return;
+  indexed_[index] = false;
+
+  const auto& range = node_tiles_[index];
+  for (int y = range.top; y <= range.bottom; ++y) {
+    for (int x = range.left; x <= range.right; ++x) {
+      const auto it = tiles_.find(TileKey(x, y));
+      if (it == tiles_.end()) continue;
+
+      auto& tile = it->second;
+      const auto node_it = std::find(tile.begin(), tile.end(), index);
+      if (node_it != tile.end()) {
+        *node_it = tile.back();
+        tile.pop_back();
+      }
+      if (tile.empty()) {
+        tiles_.erase(it);
+      }
+    }
+  }
+}
+
+void RenderTiles::MarkDirty(const Rect& rect, std::vector<uint32_t>* nodes) {
+  if (rect.width <= 0 || rect.height <= 0) return;
+
+  const auto range = GetTileRange(rect);
+  for (int y = range.top; y <= range.bottom; ++y) {
+    for (int x = range.left; x <= range.right; ++x) {
+      const auto key = TileKey(x, y);
+      if (!dirty_tiles_.insert(key).second) continue;
+
+      const auto it = tiles_.find(key);
+      if (it != tiles_.end()) {
+        nodes->insert(nodes->end(), it->second.begin(), it->second.end());
+      }
+    }
+  }
+}
+
+std::vector<Rect> RenderTiles::TakeDirtyRects() {
+  // Sort dirty tiles in row-major order.
+  std::vector<std::pair<int, int>> tiles;
+  tiles.reserve(dirty_tiles_.size());
+  for (const auto key : dirty_tiles_) {
+    tiles.emplace_back(static_cast<int32_t>(static_cast<uint32_t>(key)),
+                       static_cast<int32_t>(key >> 32));
+  }
+  dirty_tiles_.clear();
+  std::sort(tiles.begin(), tiles.end());
+
+  // Rects are built in tile coordinates. Runs of the previous row are kept by
+  // their [left, right] tile span, so that an identical run below extends them.
+  std::vector<Rect> rects;
+  std::map<std::pair<int, int>, int> open_runs;
+  std::map<std::pair<int, int>, int> next_runs;
+  for (int i = 0; i < tiles.size();) {
+    const int row = tiles[i].first;
+    const int left = tiles[i].second;
+    int right = left;
+    for (++i; i < tiles.size() && tiles[i].first == row &&
+              tiles[i].second == right + 1;
+         ++i) {
+      ++right;
+    }
+
+    const auto span = std::make_pair(left, right);
+    const auto it = open_runs.find(span);
+    if (it != open_runs.end() &&
+        rects[it->second].top + rects[it->second].height == row) {
+      ++rects[it->second].height;
+      next_runs[span] = it->second;
+    } else {
+      rects.push_back({left, row, right - left + 1, 1});
+      next_runs[span] = rects.size() - 1;
+    }
+
+    if (i == tiles.size() || tiles[i].first != row) {
+      open_runs.swap(next_runs);
+      next_runs.clear();
+    }
+  }
+
+  for (auto& rect : rects) {
+    rect.left *= tile_size_;
+    rect.top *= tile_size_;
+    rect.width *= tile_size_;
+    rect.height *= tile_size_;
+  }
+  return rects;
+}
+
+RenderTiles::TileRange RenderTiles::GetTileRange(const Rect& rect) const {
+  // Degenerate rects still occupy the tile of their top-left corner.
+  const int right = rect.left + std::max(rect.width - 1, 0);
+  const int bottom = rect.top + std::max(rect.height - 1, 0);
+  return {
+      FloorDiv(rect.left, tile_size_),
+      FloorDiv(rect.top, tile_size_),
+      FloorDiv(right, tile_size_),
+      FloorDiv(bottom, tile_size_),
+  };
+}
+
+}  // namespace troll
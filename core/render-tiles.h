@@ -0,0 +1,77 @@
+#ifndef TROLL_CORE_RENDER_TILES_H_
+#define TROLL_CORE_RENDER_TILES_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "core/geometry.h"
+
+namespace troll {
+
+// Screen-space bookkeeping for incremental rendering. Space is split in square
+// tiles. Scene nodes are indexed by the tiles that their bounding box overlaps
+// and dirty rectangles are snapped to tiles, so that overlapping rectangles are
+// merged and each tile is redrawn once per frame.
+class RenderTiles {
+ public:
+  explicit RenderTiles(int tile_size = kDefaultTileSize)
+      : tile_size_(tile_size) {}
+  ~RenderTiles() = default;
+
+  // Indexes node |index| at the tiles overlapped by |aabb|, replacing any
+  // previous placement of the node.
+  void UpdateNode(uint32_t index, const Rect& aabb);
+
+  // Removes node |index| from the index. It is a noop if the node is not
+  // indexed.
+  void RemoveNode(uint32_t index);
+
+  // Marks tiles overlapped by |rect| as dirty. Nodes indexed in tiles that were
+  // not dirty before are appended to |nodes|. A node spanning multiple tiles
+  // may be appended more than once.
+  void MarkDirty(const Rect& rect, std::vector<uint32_t>* nodes);
+
+  // Returns disjoint rectangles that exactly cover all dirty tiles and clears
+  // them. Horizontal runs of tiles are merged in a row and identical runs of
+  // consecutive rows are merged in a single rectangle.
+  std::vector<Rect> TakeDirtyRects();
+
+  int tile_size() const { return tile_size_; }
+
+ private:
+  static constexpr int kDefaultTileSize = 32;
+
+  // Inclusive range of tile coordinates covered by a rectangle.
+  struct TileRange {
+    int left;
+    int top;
+    int right;
+    int bottom;
+
+    bool operator==(const TileRange& other) const {
+      return left == other.left && top == other.top && right == other.right &&
+             bottom == other.bottom;
+    }
+  };
+
+  TileRange GetTileRange(const Rect& rect) const;
+
+  static int64_t TileKey(int x, int y) {
+    return (static_cast<int64_t>(x) << 32) ^ static_cast<uint32_t>(y);
+  }
+
+  int tile_size_;
+
+  std::unordered_map<int64_t, std::vector<uint32_t>> tiles_;
+  std::unordered_set<int64_t> dirty_tiles_;
+
+  // Tile placement of nodes by index. Unindexed nodes have no range.
+  std::vector<TileRange> node_tiles_;
+  std::vector<uint8_t> indexed_;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_RENDER_TILES_H_
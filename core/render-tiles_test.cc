@@ -0,0 +1,122 @@
+#include "core/render-tiles.h"
+
+#include <algorithm>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace troll {
+
+SCENARIO("Coalescing dirty rects in tiles", "[RenderTiles.DirtyRects]") {
+  GIVEN("an empty tile index") {
+    RenderTiles tiles(10);
+    std::vector<uint32_t> nodes;
+
+    WHEN("overlapping rects are marked dirty") {
+      tiles.MarkDirty({0, 0, 15, 15}, &nodes);
+      tiles.MarkDirty({5, 5, 10, 10}, &nodes);
+      tiles.MarkDirty({1, 1, 2, 2}, &nodes);
+
+      THEN("they are merged in a single rect") {
+        const auto rects = tiles.TakeDirtyRects();
+        REQUIRE(rects.size() == 1);
+        REQUIRE(rects[0] == Rect{0, 0, 20, 20});
+      }
+    }
+
+    WHEN("rects forming a staircase are marked dirty") {
+      tiles.MarkDirty({0, 0, 15, 15}, &nodes);
+      tiles.MarkDirty({15, 15, 10, 10}, &nodes);
+
+      THEN("tiles are filled once in disjoint rects") {
+        const auto rects = tiles.TakeDirtyRects();
+        REQUIRE(rects.size() == 3);
+        REQUIRE(rects[0] == Rect{0, 0, 20, 10});
+        REQUIRE(rects[1] == Rect{0, 10, 30, 10});
+        REQUIRE(rects[2] == Rect{10, 20, 20, 10});
+      }
+
+      THEN("dirty tiles are cleared once taken") {
+        tiles.TakeDirtyRects();
+        REQUIRE(tiles.TakeDirtyRects().empty());
+      }
+    }
+
+    WHEN("rects with negative coordinates are marked dirty") {
+      tiles.MarkDirty({-5, -5, 10, 3}, &nodes);
+
+      THEN("they are snapped to tiles below zero") {
+        const auto rects = tiles.TakeDirtyRects();
+        REQUIRE(rects.size() == 1);
+        REQUIRE(rects[0] == Rect{-10, -10, 20, 10});
+      }
+    }
+
+    WHEN("disjoint rects are marked dirty") {
+      tiles.MarkDirty({0, 0, 10, 10}, &nodes);
+      tiles.MarkDirty({30, 0, 10, 10}, &nodes);
+      tiles.MarkDirty({0, 20, 10, 10}, &nodes);
+
+      THEN("they are not merged") {
+        REQUIRE(tiles.TakeDirtyRects().size() == 3);
+      }
+    }
+
+    WHEN("empty rects are marked dirty") {
+      tiles.MarkDirty({0, 0, 0, 10}, &nodes);
+
+      THEN("no tile is dirty") { REQUIRE(tiles.TakeDirtyRects().empty()); }
+    }
+  }
+}
+
+SCENARIO("Finding nodes in dirty tiles", "[RenderTiles.Nodes]") {
+  GIVEN("a tile index with some nodes") {
+    RenderTiles tiles(10);
+    tiles.UpdateNode(0, {0, 0, 5, 5});
+    tiles.UpdateNode(1, {50, 50, 5, 5});
+    tiles.UpdateNode(2, {5, 5, 20, 20});
+
+    std::vector<uint32_t> nodes;
+
+    WHEN("a rect is marked dirty") {
+      tiles.MarkDirty({1, 1, 2, 2}, &nodes);
+
+      THEN("nodes in its tiles are returned") {
+        REQUIRE(nodes.size() == 2);
+        REQUIRE(std::count(nodes.begin(), nodes.end(), 0) == 1);
+        REQUIRE(std::count(nodes.begin(), nodes.end(), 2) == 1);
+      }
+
+      AND_WHEN("the same tiles are marked dirty again") {
+        nodes.clear();
+        tiles.MarkDirty({0, 0, 10, 10}, &nodes);
+
+        THEN("no nodes are returned") { REQUIRE(nodes.empty()); }
+      }
+    }
+
+    WHEN("a node moves to another tile") {
+      tiles.UpdateNode(0, {52, 52, 5, 5});
+      tiles.MarkDirty({50, 50, 2, 2}, &nodes);
+      tiles.MarkDirty({0, 0, 2, 2}, &nodes);
+
+      THEN("it is found only in its new tile") {
+        REQUIRE(std::count(nodes.begin(), nodes.end(), 0) == 1);
+        REQUIRE(std::count(nodes.begin(), nodes.end(), 1) == 1);
+        REQUIRE(std::count(nodes.begin(), nodes.end(), 2) == 1);
+      }
+    }
+
+    WHEN("a node is removed") {
+      tiles.RemoveNode(2);
+      tiles.MarkDirty({0, 0, 30, 30}, &nodes);
+
+      THEN("it is not found anymore") {
+        REQUIRE(nodes == std::vector<uint32_t>({0}));
+      }
+    }
+  }
+}
+
+}  // namespace troll
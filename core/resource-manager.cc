@@ -1,18 +1,19 @@
 #include "core/resource-manager.h"
 
+#include <algorithm>
 #include <experimental/filesystem>
 #include <fstream>
+#include <functional>
 
 #include <absl/strings/str_cat.h>
 #include <glog/logging.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/text_format.h>
-#include <range/v3/action/insert.hpp>
 #include <range/v3/view/filter.hpp>
 #include <range/v3/view/map.hpp>
 #include <range/v3/view/transform.hpp>
-#include <range/v3/view/unique.hpp>
 
+#include "core/trace-recorder.h"
 #include "proto/animation.pb.h"
 #include "proto/key-binding.pb.h"
 #include "proto/scene.pb.h"
@@ -27,6 +28,7 @@ namespace {
 template <class Message>
 Message LoadTextProto(const std::string& uri) {
   DLOG(INFO) << "Loading proto text file '" << uri << "'...";
+  TraceRecorder::ScopedEvent trace_event("resource", uri);
   std::fstream istream(uri, std::ios::in);
   google::protobuf::io::IstreamInputStream pbstream(&istream);
 
@@ -55,12 +57,30 @@ std::vector<Message> LoadTextProtoFromPath(const std::string& path,
 void ResourceManager::LoadResources(const std::string& base_path,
                                     const Renderer* renderer,
                                     const SoundLoader* sound_loader) {
-  LoadAnimations(base_path);
-  LoadKeyBindings(base_path);
-  LoadSprites(base_path, renderer);
-  LoadTextures(base_path, renderer);
-  LoadFonts(base_path);
-  LoadSounds(base_path, sound_loader);
+  {
+    TraceRecorder::ScopedEvent trace_event("resource", "animations");
+    LoadAnimations(base_path);
+  }
+  {
+    TraceRecorder::ScopedEvent trace_event("resource", "key_bindings");
+    LoadKeyBindings(base_path);
+  }
+  {
+    TraceRecorder::ScopedEvent trace_event("resource", "sprites");
+    LoadSprites(base_path, renderer);
+  }
+  {
+    TraceRecorder::ScopedEvent trace_event("resource", "textures");
+    LoadTextures(base_path, renderer);
+  }
+  {
+    TraceRecorder::ScopedEvent trace_event("resource", "fonts");
+    LoadFonts(base_path);
+  }
+  {
+    TraceRecorder::ScopedEvent trace_event("resource", "sounds");
+    LoadSounds(base_path, sound_loader);
+  }
 }
 
 Scene ResourceManager::LoadScene(const std::string& filename) {
@@ -78,24 +98,103 @@ const Sprite& ResourceManager::GetSprite(const std::string& sprite_id) const {
   return it->second;
 }
 
-const std::vector<bool>& ResourceManager::GetSpriteCollisionMask(
-    const std::string& sprite_id, int frame_index) const {
+const std::vector<CollisionMask>& ResourceManager::GetSpriteCollisionMasks(
+    const std::string& sprite_id) const {
   const auto it = sprite_collision_masks_.find(sprite_id);
   LOG_IF(FATAL, it == sprite_collision_masks_.end())
       << "Sprite collision mask with id='" << sprite_id << "' was not found.";
+  return it->second;
+}
 
-  LOG_IF(FATAL, frame_index >= it->second.size())
-      << "Frame index " << frame_index << " out of bounds for sprite '"
-      << sprite_id << "'.";
-  return it->second[frame_index];
+const std::vector<CollisionMaskPyramid>&
+ResourceManager::GetSpriteCollisionPyramids(
+    const std::string& sprite_id) const {
+  const auto it = sprite_collision_pyramids_.find(sprite_id);
+  LOG_IF(FATAL, it == sprite_collision_pyramids_.end())
+      << "Sprite collision pyramid with id='" << sprite_id
+      << "' was not found.";
+  return it->second;
 }
 
 const AnimationScript& ResourceManager::GetAnimationScript(
     const std::string& script_id) const {
-  const auto it = scripts_.find(script_id);
-  LOG_IF(FATAL, it == scripts_.end())
+  return GetAnimationProgram(script_id).script();
+}
+
+const AnimationProgram& ResourceManager::GetAnimationProgram(
+    const std::string& script_id) const {
+  const auto* program = FindAnimationProgram(script_id);
+  LOG_IF(FATAL, program == nullptr)
       << "AnimationScript with id='" << script_id << "' was not found.";
-  return it->second;
+  return *program;
+}
+
+const AnimationProgram& ResourceManager::CompileAnimationScript(
+    const AnimationScript& script) {
+  const auto pinned = pinned_programs_.find(&script);
+  if (pinned != pinned_programs_.end()) {
+    return *pinned->second;
+  }
+
+  // The buffer keeps its capacity between calls, so hashing a script only
+  // allocates for scripts larger than the ones before it.
+  script.SerializeToString(&serialized_script_);
+  const uint64_t hash = std::hash<std::string>()(serialized_script_);
+  const auto [begin, end] = inline_programs_.equal_range(hash);
+  for (auto it = begin; it != end; ++it) {
+    if (it->second.serialized_script == serialized_script_) {
+      return *it->second.program;
+    }
+  }
+
+  auto& program =
+      inline_programs_
+          .emplace(hash, InlineProgram{serialized_script_,
+                                       std::make_unique<AnimationProgram>(
+                                           script)})
+          ->second.program;
+  program->Link([this](const std::string& script_id) {
+    return FindAnimationProgram(script_id);
+  });
+  return *program;
+}
+
+void ResourceManager::PinAnimationScript(const AnimationScript& script) {
+  if (pinned_programs_.count(&script) > 0) return;
+
+  const auto& program = CompileAnimationScript(script);
+  program.Retain();
+  pinned_programs_.emplace(&script, &program);
+}
+
+void ResourceManager::UnpinAnimationScript(const AnimationScript& script) {
+  const auto it = pinned_programs_.find(&script);
+  if (it == pinned_programs_.end()) return;
+
+  it->second->Release();
+  pinned_programs_.erase(it);
+}
+
+void ResourceManager::EvictInlinePrograms() {
+  // Scripts of nodes that are gone do not accumulate, while programs of
+  // scripts that are played again soon are likely still memoized.
+  if (inline_programs_.size() < inline_programs_limit_) return;
+
+  for (auto it = inline_programs_.begin(); it != inline_programs_.end();) {
+    if (it->second.program->users() == 0) {
+      it = inline_programs_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  inline_programs_limit_ =
+      std::max<int>(kMinInlineProgramsLimit, 2 * inline_programs_.size());
+}
+
+const AnimationProgram* ResourceManager::FindAnimationProgram(
+    const std::string& script_id) const {
+  const auto it = programs_.find(script_id);
+  return it != programs_.end() ? it->second.get() : nullptr;
 }
 
 const Texture& ResourceManager::GetTexture(
@@ -131,12 +230,25 @@ void ResourceManager::LoadAnimations(const std::string& base_path) {
   const auto animations = LoadTextProtoFromPath<SpriteAnimation>(
       absl::StrCat(base_path, "sprites/"), ".animation");
   for (const auto& animation : animations) {
-    ranges::action::insert(
-        scripts_,
-        animation.script() |
-            ranges::view::transform([](const AnimationScript& script) {
-              return std::make_pair(script.id(), script);
-            }));
+    for (const auto& script : animation.script()) {
+      auto& program = programs_[script.id()];
+      if (program == nullptr) {
+        program = std::make_unique<AnimationProgram>(script);
+      }
+    }
+  }
+  LinkAnimationPrograms();
+}
+
+void ResourceManager::LinkAnimationPrograms() {
+  const auto resolve_script = [this](const std::string& script_id) {
+    return FindAnimationProgram(script_id);
+  };
+  for (auto& program : programs_ | ranges::view::values) {
+    program->Link(resolve_script);
+  }
+  for (auto& inline_program : inline_programs_ | ranges::view::values) {
+    inline_program.program->Link(resolve_script);
   }
 }
 
@@ -156,13 +268,11 @@ void ResourceManager::LoadSprites(const std::string& base_path,
   sprites_ = sprites | ranges::view::transform([](const Sprite& sprite) {
                return std::make_pair(sprite.id(), sprite);
              });
-  sprite_collision_masks_ =
-      sprites_ | ranges::view::values |
-      ranges::view::transform([&base_path, renderer](const Sprite& sprite) {
-        return std::make_pair(
-            sprite.id(), renderer->GenerateCollisionMasks(
-                             absl::StrCat(base_path, "resources/"), sprite));
-      });
+  for (const auto& sprite : sprites_ | ranges::view::values) {
+    sprite_collision_masks_[sprite.id()] = renderer->GenerateCollisionMasks(
+        absl::StrCat(base_path, "resources/"), sprite,
+        &sprite_collision_pyramids_[sprite.id()]);
+  }
 }
 
 void ResourceManager::LoadTextures(const std::string& base_path,
@@ -174,18 +284,21 @@ void ResourceManager::LoadTextures(const std::string& base_path,
                               sprite.colour_key().SerializeAsString());
       });
   std::sort(resources.begin(), resources.end());
+  resources.erase(std::unique(resources.begin(), resources.end()),
+                  resources.end());
 
-  textures_ =
-      resources | ranges::view::unique |
-      ranges::view::transform([&base_path, renderer](const auto& resource) {
-        RGBa colour_key;
-        colour_key.ParseFromString(resource.second);
-        return std::make_pair(
-            resource.first,
-            Texture::CreateTextureFromFile(
-                absl::StrCat(base_path, "resources/", resource.first),
-                colour_key, renderer));
-      });
+  std::vector<std::pair<std::string, RGBa>> images;
+  for (const auto& resource : resources) {
+    RGBa colour_key;
+    colour_key.ParseFromString(resource.second);
+    images.emplace_back(absl::StrCat(base_path, "resources/", resource.first),
+                        colour_key);
+  }
+
+  auto textures = renderer->CreateTextures(images);
+  for (int i = 0; i < resources.size(); ++i) {
+    textures_[resources[i].first] = std::move(textures[i]);
+  }
 }
 
 namespace {
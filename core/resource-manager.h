@@ -1,11 +1,14 @@
 #ifndef TROLL_CORE_RESOURCE_MANAGER_H_
 #define TROLL_CORE_RESOURCE_MANAGER_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "core/animation-program.h"
+#include "core/collision-mask.h"
 #include "proto/animation.pb.h"
 #include "proto/key-binding.pb.h"
 #include "proto/scene.pb.h"
@@ -31,10 +34,32 @@ class ResourceManager {
   const KeyBindings& GetKeyBindings() const;
 
   const Sprite& GetSprite(const std::string& sprite_id) const;
-  const std::vector<bool>& GetSpriteCollisionMask(const std::string& sprite_id,
-                                                  int frame_index) const;
+  // Collision masks and their pyramids of the frames of a sprite.
+  const std::vector<CollisionMask>& GetSpriteCollisionMasks(
+      const std::string& sprite_id) const;
+  const std::vector<CollisionMaskPyramid>& GetSpriteCollisionPyramids(
+      const std::string& sprite_id) const;
 
   const AnimationScript& GetAnimationScript(const std::string& script_id) const;
+  const AnimationProgram& GetAnimationProgram(
+      const std::string& script_id) const;
+
+  // Returns the program of a script that is not loaded as a resource, e.g. an
+  // inline script of an action. Pinned scripts are looked up by address, others
+  // are compiled once and memoized by their contents. The program stays valid
+  // at least until the next EvictInlinePrograms().
+  const AnimationProgram& CompileAnimationScript(const AnimationScript& script);
+
+  // Compiles an inline script of an action that is executed many times, e.g.
+  // of a collision rule, so that later compilations of |script| skip hashing
+  // it. The script must not change or go away until it is unpinned.
+  void PinAnimationScript(const AnimationScript& script);
+  void UnpinAnimationScript(const AnimationScript& script);
+
+  // Evicts programs of inline scripts that no script runs (see
+  // AnimationProgram::Retain()) once the memo doubles in size since the last
+  // eviction. Called at the end of a frame.
+  void EvictInlinePrograms();
 
   const Texture& GetTexture(const std::string& texture_id) const;
   const Font& GetFont(const std::string& font_id) const;
@@ -47,6 +72,11 @@ class ResourceManager {
 
  private:
   void LoadAnimations(const std::string& base_path);
+  // Returns the program of a loaded script or null if there is none.
+  const AnimationProgram* FindAnimationProgram(
+      const std::string& script_id) const;
+  // Resolves scripts that are run by other scripts in all programs.
+  void LinkAnimationPrograms();
   void LoadKeyBindings(const std::string& base_path);
   void LoadSprites(const std::string& base_path, const Renderer* renderer);
   void LoadTextures(const std::string& base_path, const Renderer* renderer);
@@ -57,10 +87,30 @@ class ResourceManager {
   KeyBindings key_bindings_;
 
   std::unordered_map<std::string, Sprite> sprites_;
-  std::unordered_map<std::string, std::vector<std::vector<bool>>>
+  std::unordered_map<std::string, std::vector<CollisionMask>>
       sprite_collision_masks_;
-
-  std::unordered_map<std::string, AnimationScript> scripts_;
+  std::unordered_map<std::string, std::vector<CollisionMaskPyramid>>
+      sprite_collision_pyramids_;
+
+  std::unordered_map<std::string, std::unique_ptr<AnimationProgram>>
+      programs_;
+
+  // Programs of inline scripts keyed by a hash of their serialised script,
+  // which is kept to tell apart scripts whose hashes collide.
+  struct InlineProgram {
+    std::string serialized_script;
+    std::unique_ptr<AnimationProgram> program;
+  };
+  std::unordered_multimap<uint64_t, InlineProgram> inline_programs_;
+  // Size of |inline_programs_| that programs no script runs are evicted at.
+  int inline_programs_limit_ = kMinInlineProgramsLimit;
+  static constexpr int kMinInlineProgramsLimit = 64;
+  // Buffer that scripts are serialised in for hashing.
+  std::string serialized_script_;
+  // Programs of pinned scripts keyed by their address. They are retained while
+  // pinned, so they are never evicted.
+  std::unordered_map<const AnimationScript*, const AnimationProgram*>
+      pinned_programs_;
 
   std::unordered_map<std::string, std::unique_ptr<Texture>> textures_;
   std::unordered_map<std::string, std::unique_ptr<Font>> fonts_;
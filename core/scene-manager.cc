@@ -1,12 +1,15 @@
 #include "core/scene-manager.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <glog/logging.h>
 #include <range/v3/action/push_back.hpp>
 #include <range/v3/action/sort.hpp>
 #include <range/v3/view/filter.hpp>
-#include <range/v3/view/map.hpp>
 #include <range/v3/view/transform.hpp>
 
+#include "animation/animator-manager.h"
 #include "core/collision-checker.h"
 #include "core/geometry.h"
 #include "core/resource-manager.h"
@@ -16,35 +19,121 @@ namespace troll {
 
 void SceneManager::SetupScene(const Scene& scene) {
   scene_ = scene;
+  static_bvh_stale_ = true;
+  GetStaticBvh();
   RenderAll();
 }
 
-void SceneManager::AddSceneNode(const SceneNode& node) {
-  const auto res = scene_nodes_.emplace(node.id(), node);
-  LOG_IF(ERROR, !res.second) << "AddSceneNode() SceneNode with id='"
-                             << node.id() << "' already exists.";
+NodeHandle SceneManager::AddSceneNode(const SceneNode& node) {
+  const auto it = node_handles_.find(node.id());
+  if (it != node_handles_.end()) {
+    LOG(ERROR) << "AddSceneNode() SceneNode with id='" << node.id()
+               << "' already exists.";
+    Dirty(it->second);
+    return it->second;
+  }
+
+  NodeHandle handle;
+  if (free_slots_.empty()) {
+    handle.index = slots_.size();
+    slots_.emplace_back();
+  } else {
+    handle.index = free_slots_.back();
+    free_slots_.pop_back();
+  }
 
-  const auto it = res.first;
-  Dirty(it->second);
+  auto& slot = slots_[handle.index];
+  slot.node = node;
+  slot.occupied = true;
+  handle.generation = slot.generation;
+  node_handles_.emplace(node.id(), handle);
+
+  UpdateStore(handle.index);
+  render_tiles_.UpdateNode(handle.index, store_.aabb(handle.index));
+  dirty_boxes_.push_back(store_.aabb(handle.index));
+  if (node.is_static()) static_bvh_stale_ = true;
+  core_->collision_checker()->Dirty(handle);
+  return handle;
 }
 
 void SceneManager::RemoveSceneNode(const std::string& id) {
-  const auto it = scene_nodes_.find(id);
-  LOG_IF(ERROR, it == scene_nodes_.end())
-      << "RemoveSceneNode() cannot find SceneNode with id='" << id << "'.";
+  const auto handle = GetSceneNodeHandle(id);
+  if (!handle.valid()) {
+    LOG(ERROR) << "RemoveSceneNode() cannot find SceneNode with id='" << id
+               << "'.";
+    return;
+  }
+  RemoveSceneNode(handle);
+}
 
-  dirty_boxes_.push_back(GetSceneNodeBoundingBox(it->second));
-  dead_scene_nodes_.insert(id);
+void SceneManager::RemoveSceneNode(NodeHandle handle) {
+  auto* slot = const_cast<NodeSlot*>(GetSlot(handle));
+  if (slot == nullptr) {
+    LOG(ERROR) << "RemoveSceneNode() SceneNode handle is not valid.";
+    return;
+  }
+  if (slot->dead) return;
+
+  dirty_boxes_.push_back(store_.aabb(handle.index));
+  const auto it = drawn_rects_.find(handle.index);
+  if (it != drawn_rects_.end()) {
+    dirty_boxes_.push_back(it->second);
+  }
+  slot->dead = true;
+  dead_scene_nodes_.push_back(handle);
+}
+
+void SceneManager::Dirty(NodeHandle handle) {
+  auto* slot = const_cast<NodeSlot*>(GetSlot(handle));
+  if (slot == nullptr) return;
+
+  // The first time a node is marked in a frame, the store still holds it as
+  // it was last rendered. Later positions in the same frame were never
+  // rendered and need no clearing.
+  if (!slot->stale) {
+    dirty_boxes_.push_back(store_.aabb(handle.index));
+    slot->stale = true;
+    stale_nodes_.push_back(handle.index);
+  }
+  if (track_step_origins_) {
+    step_origins_.emplace(handle.index,
+                          StepOrigin{slot->node.position().x(),
+                                     slot->node.position().y()});
+  }
+  store_.Invalidate(handle.index);
+  if (slot->node.is_static()) static_bvh_stale_ = true;
+  core_->collision_checker()->Dirty(handle);
 }
 
 void SceneManager::Dirty(const SceneNode& scene_node) {
+  const auto handle = GetSceneNodeHandle(scene_node.id());
+  if (GetSceneNode(handle) == &scene_node) {
+    Dirty(handle);
+    return;
+  }
+
+  // Nodes that are not part of the scene are not stored or checked for
+  // collisions.
   dirty_boxes_.push_back(GetSceneNodeBoundingBox(scene_node));
-  core_->collision_checker()->Dirty(scene_node);
+}
+
+NodeHandle SceneManager::GetSceneNodeHandle(const std::string& id) const {
+  const auto it = node_handles_.find(id);
+  return it != node_handles_.end() ? it->second : NodeHandle();
+}
+
+const SceneNode* SceneManager::GetSceneNode(NodeHandle handle) const {
+  const auto* slot = GetSlot(handle);
+  return slot != nullptr ? &slot->node : nullptr;
+}
+
+SceneNode* SceneManager::GetSceneNode(NodeHandle handle) {
+  return const_cast<SceneNode*>(
+      static_cast<const SceneManager*>(this)->GetSceneNode(handle));
 }
 
 const SceneNode* SceneManager::GetSceneNodeById(const std::string& id) const {
-  const auto it = scene_nodes_.find(id);
-  return it != scene_nodes_.end() ? &it->second : nullptr;
+  return GetSceneNode(GetSceneNodeHandle(id));
 }
 
 SceneNode* SceneManager::GetSceneNodeById(const std::string& id) {
@@ -53,21 +142,35 @@ SceneNode* SceneManager::GetSceneNodeById(const std::string& id) {
 }
 
 std::vector<std::string> SceneManager::GetSceneNodesAt(const Vector& at) const {
+  std::vector<NodeHandle> handles;
+  GetStaticBvh().QueryPoint(at, &handles);
+  for (uint32_t index = 0; index < slots_.size(); ++index) {
+    const auto& slot = slots_[index];
+    if (slot.occupied && !slot.node.is_static() &&
+        geo::Contains(GetBoundingBox(index), at)) {
+      handles.push_back({index, slot.generation});
+    }
+  }
+
+  // Nodes are returned in slot order regardless of where they were found.
+  std::sort(handles.begin(), handles.end());
   std::vector<std::string> filtered_nodes;
-  filtered_nodes |= ranges::push_back(
-      scene_nodes_ | ranges::view::values |
-      ranges::view::filter([this, &at](const SceneNode& node) {
-        return geo::Contains(GetSceneNodeBoundingBox(node), at);
-      }) |
-      ranges::view::transform([](const SceneNode& node) { return node.id(); }));
+  for (const auto handle : handles) {
+    filtered_nodes.push_back(slots_[handle.index].node.id());
+  }
   return filtered_nodes;
 }
 
+void SceneManager::GetStaticSceneNodes(const Rect& aabb,
+                                       std::vector<NodeHandle>* nodes) const {
+  GetStaticBvh().Query(aabb, nodes);
+}
+
 std::vector<std::string> SceneManager::GetSceneNodesBySpriteId(
     const std::string& sprite_id) const {
   std::vector<std::string> filtered_nodes;
   filtered_nodes |= ranges::push_back(
-      scene_nodes_ | ranges::view::values |
+      GetSceneNodes() |
       ranges::view::filter([&sprite_id](const SceneNode& node) {
         return node.sprite_id() == sprite_id;
       }) |
@@ -79,8 +182,7 @@ std::vector<std::string> SceneManager::GetSceneNodesByPattern(
     const SceneNode& pattern) const {
   std::vector<std::string> filtered_nodes;
   filtered_nodes |= ranges::push_back(
-      scene_nodes_ | ranges::view::values |
-      ranges::view::filter([pattern](const SceneNode& node) {
+      GetSceneNodes() | ranges::view::filter([pattern](const SceneNode& node) {
         return SceneManager::NodePatternMatching(pattern, node);
       }) |
       ranges::view::transform([](const SceneNode& node) { return node.id(); }));
@@ -103,6 +205,30 @@ std::vector<std::string> SceneManager::GetSceneNodesByPattern(
   return filtered_nodes;
 }
 
+std::vector<NodeHandle> SceneManager::GetSceneNodeHandlesByPattern(
+    const SceneNode& pattern) const {
+  std::vector<NodeHandle> filtered_nodes;
+  for (uint32_t i = 0; i < slots_.size(); ++i) {
+    const auto& slot = slots_[i];
+    if (slot.occupied && NodePatternMatching(pattern, slot.node)) {
+      filtered_nodes.push_back({i, slot.generation});
+    }
+  }
+  return filtered_nodes;
+}
+
+std::vector<NodeHandle> SceneManager::GetSceneNodeHandlesByPattern(
+    const SceneNode& pattern, const std::vector<NodeHandle>& handles) const {
+  std::vector<NodeHandle> filtered_nodes;
+  filtered_nodes |= ranges::push_back(
+      handles | ranges::view::filter([this, &pattern](NodeHandle handle) {
+        const auto* node = GetSceneNode(handle);
+        return node != nullptr &&
+               SceneManager::NodePatternMatching(pattern, *node);
+      }));
+  return filtered_nodes;
+}
+
 void SceneManager::SetViewport(const Box& view) {
   viewport_ = view;
   // TODO(bourdenas): Render everything.
@@ -114,53 +240,58 @@ void SceneManager::ScrollViewport(const Vector& by) {
 }
 
 void SceneManager::Render() {
-  // Collect scene nodes that overlap with dirty bounding boxes.
-  std::unordered_set<const SceneNode*> dirty_nodes;
-  for (int i = 0; i < dirty_boxes_.size(); ++i) {
-    const std::vector<const SceneNode*> overlap_nodes =
-        scene_nodes_ | ranges::view::values |
-        ranges::view::filter([&dirty_nodes](const SceneNode& node) {
-          return dirty_nodes.find(&node) == dirty_nodes.end();
-        }) |
-        ranges::view::filter([this, i](const SceneNode& node) {
-          return geo::Collide(dirty_boxes_[i], GetSceneNodeBoundingBox(node));
-        }) |
-        ranges::view::transform([](const SceneNode& node) { return &node; });
-
-    for (const SceneNode* node : overlap_nodes) {
-      dirty_nodes.insert(node);
-      dirty_boxes_.push_back(GetSceneNodeBoundingBox(*node));
-    }
-  }
+  SyncSceneNodes();
+  InterpolateSceneNodes();
 
-  // Render behind bounding boxes.
+  // Collect scene nodes in dirty tiles. Each of them is redrawn entirely, so
+  // the tiles under it become dirty as well.
+  std::vector<uint32_t> candidates;
   for (const auto& box : dirty_boxes_) {
-    renderer_->FillColour(scene_.bitmap_config().background_colour(), box);
+    render_tiles_.MarkDirty(box, &candidates);
   }
   dirty_boxes_.clear();
 
+  std::vector<uint8_t> is_dirty(store_.size(), false);
+  std::vector<uint32_t> dirty_nodes;
+  while (!candidates.empty()) {
+    const auto index = candidates.back();
+    candidates.pop_back();
+    if (is_dirty[index]) continue;
+
+    is_dirty[index] = true;
+    if (!store_.visible(index) || slots_[index].dead) continue;
+
+    dirty_nodes.push_back(index);
+    render_tiles_.MarkDirty(store_.aabb(index), &candidates);
+  }
+
+  // Render behind dirty tiles.
+  const auto dirty_rects = render_tiles_.TakeDirtyRects();
+  for (const auto& rect : dirty_rects) {
+    renderer_->FillColour(scene_.bitmap_config().background_colour(),
+                          geo::ToBox(rect));
+  }
+
   // Render dirty nodes.
-  std::vector<const SceneNode*> z_ordered_nodes =
-      dirty_nodes | ranges::view::filter([](const SceneNode* node) {
-        return node->visible();
-      }) |
-      ranges::view::filter([this](const SceneNode* node) {
-        return dead_scene_nodes_.find(node->id()) == dead_scene_nodes_.end();
-      });
-  z_ordered_nodes |=
-      ranges::action::sort([](const SceneNode* lhs, const SceneNode* rhs) {
-        return lhs->position().z() < rhs->position().z();
-      });
-  for (const auto* node : z_ordered_nodes) {
-    BlitSceneNode(*node);
+  dirty_nodes |= ranges::action::sort([this](uint32_t lhs, uint32_t rhs) {
+    return store_.z(lhs) < store_.z(rhs);
+  });
+  for (const auto index : dirty_nodes) {
+    BlitSceneNode(index);
   }
 
   renderer_->Flip();
 
+  render_stats_.rects_filled = dirty_rects.size();
+  render_stats_.nodes_blitted = dirty_nodes.size();
+
   CleanUpDeletedSceneNodes();
 }
 
 void SceneManager::RenderAll() {
+  SyncSceneNodes();
+  InterpolateSceneNodes();
+
   renderer_->ClearScreen();
   renderer_->FillColour(scene_.bitmap_config().background_colour(),
                         scene_.viewport());
@@ -172,56 +303,191 @@ void SceneManager::RenderAll() {
   }
 
   // Render all nodes based on their z-ordering.
-  std::vector<const SceneNode*> z_ordered_nodes =
-      scene_nodes_ | ranges::view::values |
-      ranges::view::filter(
-          [](const SceneNode& node) { return node.visible(); }) |
-      ranges::view::filter([this](const SceneNode& node) {
-        return dead_scene_nodes_.find(node.id()) == dead_scene_nodes_.end();
-      }) |
-      ranges::view::transform([](const SceneNode& node) { return &node; });
-  z_ordered_nodes |=
-      ranges::action::sort([](const SceneNode* lhs, const SceneNode* rhs) {
-        return lhs->position().z() < rhs->position().z();
-      });
-  for (const auto* node : z_ordered_nodes) {
-    BlitSceneNode(*node);
+  std::vector<uint32_t> z_ordered_nodes;
+  for (uint32_t index = 0; index < store_.size(); ++index) {
+    if (store_.active(index) && store_.visible(index) && !slots_[index].dead) {
+      z_ordered_nodes.push_back(index);
+    }
+  }
+  z_ordered_nodes |= ranges::action::sort([this](uint32_t lhs, uint32_t rhs) {
+    return store_.z(lhs) < store_.z(rhs);
+  });
+  for (const auto index : z_ordered_nodes) {
+    BlitSceneNode(index);
   }
 
   renderer_->Flip();
 
+  render_stats_.rects_filled = 1;
+  render_stats_.nodes_blitted = z_ordered_nodes.size();
+
   CleanUpDeletedSceneNodes();
 }
 
-Box SceneManager::GetSceneNodeBoundingBox(const SceneNode& node) const {
-  const auto& sprite = resource_manager_->GetSprite(node.sprite_id());
+void SceneManager::StartSimulationStep() {
+  track_step_origins_ = true;
+  step_origins_.clear();
+}
+
+Rect SceneManager::GetSceneNodeBoundingBox(NodeHandle handle) const {
+  return GetSlot(handle) != nullptr ? GetBoundingBox(handle.index) : Rect();
+}
 
-  auto bounding_box = sprite.film(node.frame_index());
-  bounding_box.set_left(node.position().x());
-  bounding_box.set_top(node.position().y());
-  return bounding_box;
+Rect SceneManager::GetSceneNodeBoundingBox(const SceneNode& node) const {
+  const auto& film =
+      resource_manager_->GetSprite(node.sprite_id()).film(node.frame_index());
+  return {static_cast<int>(node.position().x()),
+          static_cast<int>(node.position().y()), film.width(), film.height()};
 }
 
-void SceneManager::BlitSceneNode(const SceneNode& node) const {
-  const auto& sprite = resource_manager_->GetSprite(node.sprite_id());
+void SceneManager::SyncSceneNodes() {
+  RefreshStaleNodes();
+  for (const auto index : stale_nodes_) {
+    auto& slot = slots_[index];
+    slot.stale = false;
+    if (!slot.occupied) continue;
+
+    const auto& aabb = store_.aabb(index);
+    render_tiles_.UpdateNode(index, aabb);
+    dirty_boxes_.push_back(aabb);
+  }
+  stale_nodes_.clear();
+}
+
+const SceneNodeStore& SceneManager::GetSceneNodeStore() const {
+  RefreshStaleNodes();
+  return store_;
+}
+
+void SceneManager::RefreshStaleNodes() const {
+  for (const auto index : stale_nodes_) {
+    if (slots_[index].occupied && !store_.valid(index)) UpdateStore(index);
+  }
+}
+
+Rect SceneManager::GetBoundingBox(uint32_t index) const {
+  // Nodes are modified after they are marked dirty, so their entries are not
+  // refreshed from queries that may come in between.
+  return store_.valid(index) ? store_.aabb(index)
+                             : GetSceneNodeBoundingBox(slots_[index].node);
+}
+
+void SceneManager::UpdateStore(uint32_t index) const {
+  const auto& node = slots_[index].node;
+
+  // Avoid the sprite and mask lookups unless the node changed sprite.
+  if (index < store_.size() && store_.active(index) &&
+      store_.sprite(index).id() == node.sprite_id()) {
+    store_.Update(index, node);
+    return;
+  }
+  const auto& sprite_id = node.sprite_id();
+  store_.Update(index, node, resource_manager_->GetSprite(sprite_id),
+                resource_manager_->GetSpriteCollisionMasks(sprite_id),
+                resource_manager_->GetSpriteCollisionPyramids(sprite_id));
+}
 
-  const auto& bounding_box = sprite.film(node.frame_index());
-  Box destination = bounding_box;
-  destination.set_left(node.position().x());
-  destination.set_top(node.position().y());
+const StaticBvh& SceneManager::GetStaticBvh() const {
+  if (!static_bvh_stale_) return static_bvh_;
 
+  std::vector<StaticBvh::Leaf> leaves;
+  for (uint32_t index = 0; index < slots_.size(); ++index) {
+    const auto& slot = slots_[index];
+    if (slot.occupied && slot.node.is_static()) {
+      leaves.push_back({{index, slot.generation}, GetBoundingBox(index)});
+    }
+  }
+  static_bvh_.Build(std::move(leaves));
+  static_bvh_stale_ = false;
+  return static_bvh_;
+}
+
+void SceneManager::InterpolateSceneNodes() {
+  // Nodes that stopped moving are drawn at their position again.
+  for (auto it = drawn_rects_.begin(); it != drawn_rects_.end();) {
+    const auto index = it->first;
+    if (step_origins_.count(index) != 0) {
+      ++it;
+      continue;
+    }
+
+    dirty_boxes_.push_back(it->second);
+    if (slots_[index].occupied) {
+      const auto aabb = GetBoundingBox(index);
+      render_tiles_.UpdateNode(index, aabb);
+      dirty_boxes_.push_back(aabb);
+    }
+    it = drawn_rects_.erase(it);
+  }
+
+  const double remaining = 1.0 - interpolation_alpha_;
+  for (const auto& [index, origin] : step_origins_) {
+    const auto& slot = slots_[index];
+    if (!slot.occupied || slot.dead) continue;
+
+    const auto aabb = GetBoundingBox(index);
+    Rect rect = aabb;
+    rect.left += std::lround((origin.x - store_.x(index)) * remaining);
+    rect.top += std::lround((origin.y - store_.y(index)) * remaining);
+
+    const auto it = drawn_rects_.find(index);
+    if (it != drawn_rects_.end()) {
+      if (it->second == rect) continue;
+      dirty_boxes_.push_back(it->second);
+    }
+    drawn_rects_[index] = rect;
+    dirty_boxes_.push_back(rect);
+
+    // Index the node by both areas, so that it is redrawn when either of them
+    // is dirty.
+    render_tiles_.UpdateNode(index, geo::Union(aabb, rect));
+  }
+}
+
+void SceneManager::BlitSceneNode(uint32_t index) const {
+  const Rect* rect = &store_.aabb(index);
+  if (!drawn_rects_.empty()) {
+    const auto it = drawn_rects_.find(index);
+    if (it != drawn_rects_.end()) {
+      rect = &it->second;
+    }
+  }
+
+  const auto& sprite = store_.sprite(index);
   renderer_->BlitTexture(resource_manager_->GetTexture(sprite.resource()),
-                         bounding_box, destination);
+                         sprite.film(store_.frame_index(index)),
+                         geo::ToBox(*rect));
 }
 
-void SceneManager::CleanUpDeletedSceneNodes() {
-  for (const auto& id : dead_scene_nodes_) {
-    const auto it = scene_nodes_.find(id);
-    LOG_IF(ERROR, it == scene_nodes_.end())
-        << "CleanUpDeletedSceneNodes() SceneNode with id='" << id
-        << "' was not found.";
+const SceneManager::NodeSlot* SceneManager::GetSlot(NodeHandle handle) const {
+  if (handle.index >= slots_.size()) return nullptr;
+
+  const auto& slot = slots_[handle.index];
+  return slot.occupied && slot.generation == handle.generation ? &slot
+                                                                : nullptr;
+}
 
-    scene_nodes_.erase(it);
+void SceneManager::CleanUpDeletedSceneNodes() {
+  for (const auto handle : dead_scene_nodes_) {
+    auto& slot = slots_[handle.index];
+    if (slot.node.is_static()) static_bvh_stale_ = true;
+    core_->collision_checker()->RemoveSceneNode(handle);
+    // Scripts of the node would otherwise wait for their timers to expire.
+    if (core_->animator_manager() != nullptr) {
+      core_->animator_manager()->StopNodeAnimations(handle);
+    }
+    node_handles_.erase(slot.node.id());
+
+    // Bumping the generation invalidates outstanding handles to the node.
+    store_.Clear(handle.index);
+    render_tiles_.RemoveNode(handle.index);
+    step_origins_.erase(handle.index);
+    drawn_rects_.erase(handle.index);
+    slot.node.Clear();
+    slot.occupied = false;
+    slot.dead = false;
+    ++slot.generation;
+    free_slots_.push_back(handle.index);
   }
   dead_scene_nodes_.clear();
 }
@@ -1,14 +1,20 @@
 #ifndef TROLL_CORE_SCENE_MANAGER_H_
 #define TROLL_CORE_SCENE_MANAGER_H_
 
+#include <deque>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
-#include <range/v3/view/map.hpp>
+#include <range/v3/view/filter.hpp>
+#include <range/v3/view/transform.hpp>
 
 #include "core/core.h"
+#include "core/geometry.h"
+#include "core/node-handle.h"
+#include "core/render-tiles.h"
+#include "core/scene-node-store.h"
+#include "core/static-bvh.h"
 #include "proto/primitives.pb.h"
 #include "proto/scene-node.pb.h"
 #include "proto/scene.pb.h"
@@ -27,22 +33,54 @@ class SceneManager {
 
   void SetupScene(const Scene& scene);
 
-  void AddSceneNode(const SceneNode& node);
+  // Adds a copy of |node| in the scene and returns its handle.
+  NodeHandle AddSceneNode(const SceneNode& node);
   void RemoveSceneNode(const std::string& id);
+  void RemoveSceneNode(NodeHandle handle);
 
   // Marks a scene node that needs to be queued for rendering during this frame.
+  // It must be called before the node is modified.
+  void Dirty(NodeHandle handle);
   void Dirty(const SceneNode& scene_node);
 
+  // Returns the handle of the SceneNode with |id| or an invalid handle if it
+  // does not exist. Ids should be resolved once when entering the engine, e.g.
+  // from actions or scripts, and handles used from there on.
+  NodeHandle GetSceneNodeHandle(const std::string& id) const;
+
+  // Returns the SceneNode referenced by |handle| or nullptr if it was deleted.
+  const SceneNode* GetSceneNode(NodeHandle handle) const;
+  SceneNode* GetSceneNode(NodeHandle handle);
+
+  // Returns true if |handle| references a node of the scene.
+  bool HasSceneNode(NodeHandle handle) const {
+    return GetSlot(handle) != nullptr;
+  }
+
   const SceneNode* GetSceneNodeById(const std::string& id) const;
   SceneNode* GetSceneNodeById(const std::string& id);
 
   // Returns a view of active SceneNodes.
-  auto GetSceneNodes() const { return scene_nodes_ | ranges::view::values; }
+  auto GetSceneNodes() const {
+    return slots_ |
+           ranges::view::filter(
+               [](const NodeSlot& slot) { return slot.occupied; }) |
+           ranges::view::transform(
+               [](const NodeSlot& slot) -> const SceneNode& {
+                 return slot.node;
+               });
+  }
 
   // Returns a view of active SceneNodes that contain the point |at|. This is an
-  // O(N) operation to the number of ScenNodes.
+  // O(N) operation to the number of dynamic ScenNodes, static ones are found
+  // through a bounding volume hierarchy.
   std::vector<std::string> GetSceneNodesAt(const Vector& at) const;
 
+  // Appends to |nodes| the handles of active static SceneNodes whose bounding
+  // box collides with |aabb|.
+  void GetStaticSceneNodes(const Rect& aabb,
+                           std::vector<NodeHandle>* nodes) const;
+
   // Returns a view of active SceneNodes of a specific sprite. This is an O(N)
   // operation to the number of ScenNodes.
   std::vector<std::string> GetSceneNodesBySpriteId(
@@ -60,20 +98,90 @@ class SceneManager {
   std::vector<std::string> GetSceneNodesByPattern(
       const SceneNode& pattern, const std::vector<std::string>& node_ids) const;
 
+  // Same as above but return handles of matching SceneNodes.
+  std::vector<NodeHandle> GetSceneNodeHandlesByPattern(
+      const SceneNode& pattern) const;
+  std::vector<NodeHandle> GetSceneNodeHandlesByPattern(
+      const SceneNode& pattern, const std::vector<NodeHandle>& handles) const;
+
   void SetViewport(const Box& view);
   void ScrollViewport(const Vector& by);
 
   void Render();
   void RenderAll();
 
+  // Interpolation of rendered positions between fixed simulation steps.
+  // StartSimulationStep() is called before each step. Nodes that moved during
+  // the last step are rendered |alpha| of the way from their position before
+  // the step to their current one.
+  void StartSimulationStep();
+  void SetRenderInterpolation(double alpha) { interpolation_alpha_ = alpha; }
+
+  // Counters of the work done by the last Render() or RenderAll() call.
+  struct RenderStats {
+    int rects_filled = 0;
+    int nodes_blitted = 0;
+  };
+  const RenderStats& render_stats() const { return render_stats_; }
+
   const Scene& scene() const { return scene_; }
   const Box& viewport() const { return viewport_; }
 
-  // Returns a bounding box describing the position of input node in the scene.
-  Box GetSceneNodeBoundingBox(const SceneNode& node) const;
+  // Returns a bounding box describing the position of a node in the scene. It
+  // is cached, except for nodes marked dirty since collisions were last
+  // checked or the scene rendered. An empty rect is returned for invalid
+  // handles.
+  Rect GetSceneNodeBoundingBox(NodeHandle handle) const;
+
+  // Returns the bounding box of |node| computed from its fields. Unlike the
+  // above, |node| does not need to be part of the scene.
+  Rect GetSceneNodeBoundingBox(const SceneNode& node) const;
+
+  // Returns the per-frame fields of scene nodes by NodeHandle::index, with the
+  // entries of nodes that were marked dirty refreshed. It is called once the
+  // nodes were modified, e.g. by the collision checker after animations ran.
+  // Entries stay up to date until a node is marked dirty again.
+  const SceneNodeStore& GetSceneNodeStore() const;
 
  private:
-  void BlitSceneNode(const SceneNode& node) const;
+  struct NodeSlot {
+    SceneNode node;
+    uint32_t generation = 0;
+    bool occupied = false;
+
+    // Marked nodes need their entry in the SceneNodeStore refreshed.
+    bool stale = false;
+
+    // Removed nodes are kept in the scene until the end of the frame.
+    bool dead = false;
+  };
+
+  // Returns the slot referenced by |handle| or nullptr if the handle is stale.
+  const NodeSlot* GetSlot(NodeHandle handle) const;
+
+  // Refreshes store entries of nodes modified since the last frame and queues
+  // their new bounding boxes for rendering.
+  void SyncSceneNodes();
+
+  // Refreshes the out of date store entries of nodes marked dirty.
+  void RefreshStaleNodes() const;
+
+  // Returns the bounding box of the node in slot |index|. It is read from the
+  // store unless the node was marked dirty since its entry was refreshed.
+  Rect GetBoundingBox(uint32_t index) const;
+
+  // Copies the node in slot |index| to its store entry.
+  void UpdateStore(uint32_t index) const;
+
+  // Returns the hierarchy of static nodes, rebuilding it if any of them was
+  // added, modified or removed since it was last built.
+  const StaticBvh& GetStaticBvh() const;
+
+  // Updates where nodes that moved during the last simulation step are drawn
+  // and queues the affected areas for rendering.
+  void InterpolateSceneNodes();
+
+  void BlitSceneNode(uint32_t index) const;
   void CleanUpDeletedSceneNodes();
 
   // Returns true if |node| matches all fields present in the |pattern|.
@@ -88,10 +196,40 @@ class SceneManager {
   Box world_bounds_;
   Box viewport_;
 
-  std::unordered_map<std::string, SceneNode> scene_nodes_;
-  std::unordered_set<std::string> dead_scene_nodes_;
-
-  std::vector<Box> dirty_boxes_;
+  // SceneNodes are stored in slots indexed by NodeHandle. A deque keeps
+  // references to nodes valid when new slots are added.
+  std::deque<NodeSlot> slots_;
+  std::vector<uint32_t> free_slots_;
+  std::unordered_map<std::string, NodeHandle> node_handles_;
+  std::vector<NodeHandle> dead_scene_nodes_;
+
+  // Per-frame node data in the same slot order, used by rendering and
+  // collision loops. It also caches bounding boxes. Entries of nodes marked
+  // dirty are refreshed when collisions are checked and when rendering.
+  mutable SceneNodeStore store_;
+  std::vector<uint32_t> stale_nodes_;
+
+  // Bounding volume hierarchy of static nodes. It is built on SetupScene() and
+  // rebuilt lazily from const queries after static nodes change.
+  mutable StaticBvh static_bvh_;
+  mutable bool static_bvh_stale_ = false;
+
+  std::vector<Rect> dirty_boxes_;
+  RenderTiles render_tiles_;
+  RenderStats render_stats_;
+
+  // Position of nodes before they moved in the current simulation step, by
+  // slot index. It is only tracked after StartSimulationStep() is called.
+  struct StepOrigin {
+    double x;
+    double y;
+  };
+  bool track_step_origins_ = false;
+  std::unordered_map<uint32_t, StepOrigin> step_origins_;
+  double interpolation_alpha_ = 1.0;
+
+  // Where interpolated nodes were drawn by the last Render(), by slot index.
+  std::unordered_map<uint32_t, Rect> drawn_rects_;
 };
 
 }  // namespace troll
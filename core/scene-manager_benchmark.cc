@@ -0,0 +1,135 @@
+#include "core/scene-manager.h"
+
+#include <random>
+#include <vector>
+
+#include <absl/strings/str_cat.h>
+#include <benchmark/benchmark.h>
+
+#include "core/collision-checker.h"
+#include "core/resource-manager.h"
+#include "proto/scene-node.pb.h"
+#include "sdl/headless-renderer.h"
+#include "sdl/texture.h"
+#include "troll-test/test-core.h"
+#include "troll-test/testing-resource-manager.h"
+
+namespace troll {
+namespace {
+
+// Scene of 16x16 nodes scattered over a 640x480 viewport rendered in a
+// headless framebuffer. Nodes alternate between two sprites and ten z levels.
+class RenderScene {
+ public:
+  explicit RenderScene(int nodes) {
+    for (const auto& sprite_id : {"sprite_a", "sprite_b"}) {
+      Sprite sprite;
+      sprite.set_id(sprite_id);
+      sprite.set_resource(absl::StrCat(sprite_id, ".png"));
+      auto* film = sprite.add_film();
+      film->set_width(16);
+      film->set_height(16);
+      testing_resource_manager_.SetTestSprite(sprite);
+      testing_resource_manager_.SetTestTexture(
+          sprite.resource(), Texture::CreateTextureFromPixels(
+                                 std::vector<Uint32>(16 * 16, 0xff0000ff),
+                                 16, 16));
+    }
+
+    core_.set_resource_manager(&resource_manager_);
+    core_.set_scene_manager(&scene_manager_);
+    core_.set_collision_checker(&collision_checker_);
+
+    renderer_.CreateWindow(640, 480);
+    Scene scene;
+    scene.mutable_viewport()->set_width(640);
+    scene.mutable_viewport()->set_height(480);
+    scene_manager_.SetupScene(scene);
+
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> x(0, 624);
+    std::uniform_int_distribution<int> y(0, 464);
+    for (int i = 0; i < nodes; ++i) {
+      SceneNode node;
+      node.set_id(absl::StrCat("node_", i));
+      node.set_sprite_id(i % 2 ? "sprite_b" : "sprite_a");
+      node.mutable_position()->set_x(x(generator));
+      node.mutable_position()->set_y(y(generator));
+      node.mutable_position()->set_z(i % 10);
+      handles_.push_back(scene_manager_.AddSceneNode(node));
+    }
+    scene_manager_.Render();
+    collision_checker_.CheckCollisions();
+  }
+
+  // Moves |count| nodes back and forth by one pixel.
+  void MoveNodes(int count) {
+    step_ = -step_;
+    for (int i = 0; i < count; ++i) {
+      scene_manager_.Dirty(handles_[i]);
+      auto* node = scene_manager_.GetSceneNode(handles_[i]);
+      node->mutable_position()->set_x(node->position().x() + step_);
+    }
+  }
+
+  SceneManager* scene_manager() { return &scene_manager_; }
+  CollisionChecker* collision_checker() { return &collision_checker_; }
+
+ private:
+  TestCore core_;
+  ResourceManager resource_manager_;
+  HeadlessRenderer renderer_;
+  SceneManager scene_manager_ =
+      SceneManager(&resource_manager_, &renderer_, &core_);
+  CollisionChecker collision_checker_ =
+      CollisionChecker(&scene_manager_, nullptr, &core_);
+
+  TestingResourceManager testing_resource_manager_ =
+      TestingResourceManager(&resource_manager_);
+
+  std::vector<NodeHandle> handles_;
+  int step_ = 1;
+};
+
+// Arguments are the number of nodes in the scene and the number of them that
+// move every frame.
+void BM_Render(benchmark::State& state) {
+  RenderScene scene(state.range(0));
+  const int dirty_nodes = state.range(1);
+
+  for (auto _ : state) {
+    scene.MoveNodes(dirty_nodes);
+    scene.scene_manager()->Render();
+
+    // Moving nodes also marks them for collision checking, which is not part
+    // of rendering.
+    state.PauseTiming();
+    scene.collision_checker()->CheckCollisions();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * dirty_nodes);
+}
+BENCHMARK(BM_Render)
+    ->Args({256, 0})
+    ->Args({256, 16})
+    ->Args({256, 256})
+    ->Args({2048, 64})
+    ->Args({2048, 2048});
+
+void BM_GetSceneNodesByPattern(benchmark::State& state) {
+  RenderScene scene(state.range(0));
+
+  SceneNode pattern;
+  pattern.set_sprite_id("sprite_b");
+  pattern.mutable_position()->set_z(3);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        scene.scene_manager()->GetSceneNodesByPattern(pattern));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetSceneNodesByPattern)->RangeMultiplier(4)->Range(64, 4096);
+
+}  // namespace
+}  // namespace troll
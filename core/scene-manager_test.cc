@@ -9,6 +9,7 @@
 #include "core/resource-manager.h"
 #include "proto/animation.pb.h"
 #include "proto/scene-node.pb.h"
+#include "sdl/headless-renderer.h"
 #include "troll-test/test-core.h"
 #include "troll-test/test-util.h"
 #include "troll-test/testing-resource-manager.h"
@@ -45,6 +46,400 @@ class SceneManagerFixture {
       TestingResourceManager(&resource_manager_);
 };
 
+SCENARIO_METHOD(SceneManagerFixture, "Referencing scene nodes by handle",
+                "[SceneManager.NodeHandle]") {
+  GIVEN("a scene with some nodes") {
+    const auto handle_a = scene_manager_.AddSceneNode(
+        ParseProto<SceneNode>("id: 'node_a' sprite_id: 'sprite_a'"));
+    const auto handle_b = scene_manager_.AddSceneNode(
+        ParseProto<SceneNode>("id: 'node_b' sprite_id: 'sprite_a'"));
+
+    THEN("handles are valid and distinct") {
+      REQUIRE(handle_a.valid());
+      REQUIRE(handle_b.valid());
+      REQUIRE(handle_a != handle_b);
+    }
+
+    THEN("handles resolve to their scene nodes") {
+      REQUIRE(scene_manager_.GetSceneNode(handle_a)->id() == "node_a");
+      REQUIRE(scene_manager_.GetSceneNode(handle_b)->id() == "node_b");
+    }
+
+    THEN("ids resolve to the same handles") {
+      REQUIRE(scene_manager_.GetSceneNodeHandle("node_a") == handle_a);
+      REQUIRE(scene_manager_.GetSceneNodeHandle("node_b") == handle_b);
+    }
+
+    THEN("unknown ids resolve to invalid handles") {
+      const auto handle = scene_manager_.GetSceneNodeHandle("node_c");
+      REQUIRE_FALSE(handle.valid());
+      REQUIRE(scene_manager_.GetSceneNode(handle) == nullptr);
+    }
+
+    THEN("handles can be found by pattern") {
+      const auto handles = scene_manager_.GetSceneNodeHandlesByPattern(
+          ParseProto<SceneNode>("id: 'node_b'"));
+      REQUIRE(handles.size() == 1);
+      REQUIRE(handles[0] == handle_b);
+    }
+
+    WHEN("a node with an existing id is added") {
+      const auto handle = scene_manager_.AddSceneNode(
+          ParseProto<SceneNode>("id: 'node_a' sprite_id: 'sprite_a'"));
+
+      THEN("the handle of the existing node is returned") {
+        REQUIRE(handle == handle_a);
+      }
+    }
+
+    WHEN("a node is removed") {
+      scene_manager_.RemoveSceneNode(handle_a);
+
+      THEN("it is still accessible until the end of the frame") {
+        REQUIRE(scene_manager_.GetSceneNode(handle_a) != nullptr);
+        REQUIRE(scene_manager_.GetSceneNodeById("node_a") != nullptr);
+      }
+    }
+
+    WHEN("the scene nodes are destroyed") {
+      // Create a new scene manager as a hacky way to destory the nodes.
+      scene_manager_ = SceneManager(&resource_manager_, nullptr, &core_);
+
+      THEN("old handles do not resolve") {
+        REQUIRE(scene_manager_.GetSceneNode(handle_a) == nullptr);
+        REQUIRE(scene_manager_.GetSceneNode(handle_b) == nullptr);
+      }
+    }
+  }
+}
+
+SCENARIO_METHOD(SceneManagerFixture, "Caching scene node bounding boxes",
+                "[SceneManager.BoundingBox]") {
+  GIVEN("a scene node") {
+    const auto handle = scene_manager_.AddSceneNode(ParseProto<SceneNode>(R"(
+        id: 'node_a' sprite_id: 'sprite_a'  frame_index: 1
+        position { x: 5  y: 7 })"));
+    auto* node = scene_manager_.GetSceneNode(handle);
+
+    THEN("its bounding box is placed at its position") {
+      REQUIRE(scene_manager_.GetSceneNodeBoundingBox(handle) ==
+              Rect{5, 7, 20, 20});
+    }
+
+    WHEN("it is marked dirty and moved") {
+      scene_manager_.Dirty(handle);
+      node->mutable_position()->set_x(50);
+
+      THEN("its bounding box follows") {
+        REQUIRE(scene_manager_.GetSceneNodeBoundingBox(handle) ==
+                Rect{50, 7, 20, 20});
+      }
+
+      AND_WHEN("it is marked dirty and changes frame") {
+        scene_manager_.Dirty(handle);
+        node->set_frame_index(2);
+
+        THEN("its bounding box is resized") {
+          REQUIRE(scene_manager_.GetSceneNodeBoundingBox(handle) ==
+                  Rect{50, 7, 30, 30});
+        }
+      }
+    }
+
+    WHEN("it is queried between being marked dirty and moved") {
+      scene_manager_.Dirty(handle);
+      REQUIRE(scene_manager_.GetSceneNodeBoundingBox(handle) ==
+              Rect{5, 7, 20, 20});
+      node->mutable_position()->set_x(50);
+
+      THEN("its bounding box follows") {
+        REQUIRE(scene_manager_.GetSceneNodeBoundingBox(handle) ==
+                Rect{50, 7, 20, 20});
+      }
+
+      THEN("its store entry follows") {
+        const auto& store = scene_manager_.GetSceneNodeStore();
+        REQUIRE(store.x(handle.index) == 50);
+        REQUIRE(store.aabb(handle.index) == Rect{50, 7, 20, 20});
+      }
+    }
+
+    WHEN("it is modified without being marked dirty") {
+      node->mutable_position()->set_x(50);
+
+      THEN("the cached bounding box is returned") {
+        REQUIRE(scene_manager_.GetSceneNodeBoundingBox(handle) ==
+                Rect{5, 7, 20, 20});
+      }
+
+      THEN("the bounding box of the node itself is up to date") {
+        REQUIRE(scene_manager_.GetSceneNodeBoundingBox(*node) ==
+                Rect{50, 7, 20, 20});
+      }
+    }
+
+    THEN("it is found at points in its bounding box") {
+      REQUIRE(scene_manager_.GetSceneNodesAt(
+                  ParseProto<Vector>("x: 10  y: 10")) ==
+              std::vector<std::string>({"node_a"}));
+      REQUIRE(scene_manager_.GetSceneNodesAt(ParseProto<Vector>("x: 1  y: 1"))
+                  .empty());
+    }
+  }
+}
+
+class SceneManagerRenderFixture : public SceneManagerFixture {
+ public:
+  SceneManagerRenderFixture() {
+    testing_resource_manager_.SetTestSprite(ParseProto<Sprite>(R"(
+        id: 'sprite_b'  resource: 'sprite_b.png'
+        film { left: 0  top: 0  width: 4  height: 4 }
+        film { left: 4  top: 0  width: 4  height: 4 })"));
+
+    // Left frame is red and right frame is green.
+    std::vector<Uint32> pixels;
+    for (int i = 0; i < 4; ++i) {
+      pixels.insert(pixels.end(), 4, kRed);
+      pixels.insert(pixels.end(), 4, kGreen);
+    }
+    testing_resource_manager_.SetTestTexture(
+        "sprite_b.png",
+        Texture::CreateTextureFromPixels(std::move(pixels), 8, 4));
+
+    renderer_.CreateWindow(64, 64);
+    scene_manager_ = SceneManager(&resource_manager_, &renderer_, &core_);
+    scene_manager_.SetupScene(scene_);
+  }
+
+ protected:
+  // Renders the current scene nodes from scratch in a separate framebuffer.
+  std::vector<Uint32> RenderFromScratch() {
+    HeadlessRenderer renderer;
+    renderer.CreateWindow(64, 64);
+    SceneManager scene_manager(&resource_manager_, &renderer, &core_);
+    scene_manager.SetupScene(scene_);
+    for (const auto& node : scene_manager_.GetSceneNodes()) {
+      scene_manager.AddSceneNode(node);
+    }
+    scene_manager.Render();
+    return renderer.framebuffer();
+  }
+
+  static constexpr Uint32 kBackground = 0x000040ff;
+  static constexpr Uint32 kRed = 0xff0000ff;
+  static constexpr Uint32 kGreen = 0x00ff00ff;
+
+  const Scene scene_ = ParseProto<Scene>(R"(
+      viewport { width: 64  height: 64 }
+      bitmap_config { background_colour { blue: 64  alpha: 255 } })");
+  HeadlessRenderer renderer_;
+};
+
+SCENARIO_METHOD(SceneManagerRenderFixture, "Rendering scene nodes",
+                "[SceneManager.Render]") {
+  GIVEN("a scene with overlapping nodes") {
+    const auto handle_a = scene_manager_.AddSceneNode(ParseProto<SceneNode>(R"(
+        id: 'node_a' sprite_id: 'sprite_b'
+        position { x: 2  y: 2  z: 1 })"));
+    scene_manager_.AddSceneNode(ParseProto<SceneNode>(R"(
+        id: 'node_b' sprite_id: 'sprite_b'  frame_index: 1
+        position { x: 4  y: 4  z: 0 })"));
+    scene_manager_.Render();
+
+    THEN("nodes are drawn in z-order") {
+      REQUIRE(renderer_.GetPixel(2, 2) == kRed);
+      REQUIRE(renderer_.GetPixel(5, 5) == kRed);
+      REQUIRE(renderer_.GetPixel(7, 7) == kGreen);
+      REQUIRE(renderer_.GetPixel(8, 8) == kBackground);
+    }
+
+    WHEN("a node moves") {
+      scene_manager_.Dirty(handle_a);
+      scene_manager_.GetSceneNode(handle_a)->mutable_position()->set_x(40);
+      scene_manager_.Render();
+
+      THEN("it is drawn at its new position") {
+        REQUIRE(renderer_.GetPixel(2, 2) == kBackground);
+        REQUIRE(renderer_.GetPixel(5, 5) == kGreen);
+        REQUIRE(renderer_.GetPixel(40, 2) == kRed);
+      }
+
+      THEN("the frame matches a frame rendered from scratch") {
+        REQUIRE(renderer_.framebuffer() == RenderFromScratch());
+      }
+
+      THEN("only nodes in dirty tiles are drawn") {
+        REQUIRE(scene_manager_.render_stats().nodes_blitted == 2);
+      }
+    }
+
+    WHEN("a node is removed") {
+      scene_manager_.RemoveSceneNode(handle_a);
+      scene_manager_.Render();
+
+      THEN("it is erased from the frame") {
+        REQUIRE(renderer_.GetPixel(2, 2) == kBackground);
+        REQUIRE(renderer_.GetPixel(5, 5) == kGreen);
+        REQUIRE(renderer_.framebuffer() == RenderFromScratch());
+      }
+
+      AND_WHEN("another node is added") {
+        const auto handle_c =
+            scene_manager_.AddSceneNode(ParseProto<SceneNode>(R"(
+                id: 'node_c' sprite_id: 'sprite_b'
+                position { x: 20  y: 20 })"));
+        scene_manager_.Render();
+
+        THEN("it reuses the slot of the removed node") {
+          REQUIRE(handle_c.index == handle_a.index);
+          REQUIRE(handle_c.generation != handle_a.generation);
+          REQUIRE(scene_manager_.GetSceneNode(handle_a) == nullptr);
+        }
+
+        THEN("the frame matches a frame rendered from scratch") {
+          REQUIRE(renderer_.GetPixel(20, 20) == kRed);
+          REQUIRE(renderer_.framebuffer() == RenderFromScratch());
+        }
+      }
+    }
+  }
+}
+
+SCENARIO_METHOD(SceneManagerRenderFixture, "Removing animated scene nodes",
+                "[SceneManager.RemoveAnimated]") {
+  GIVEN("a node with a script that waits on a timer") {
+    const auto script = ParseProto<AnimationScript>(R"(
+        id: 'script_a'
+        animation { timer { delay: 1000 } })");
+    const auto& program = resource_manager_.CompileAnimationScript(script);
+    const auto handle = scene_manager_.AddSceneNode(
+        ParseProto<SceneNode>("id: 'node_a' sprite_id: 'sprite_b'"));
+    animator_manager_.Play(program, handle);
+    animator_manager_.Progress(10);
+    REQUIRE(program.users() == 1);
+
+    WHEN("the node is removed") {
+      scene_manager_.RemoveSceneNode(handle);
+      scene_manager_.Render();
+      animator_manager_.Progress(10);
+
+      THEN("its scripts are stopped") {
+        REQUIRE(program.users() == 0);
+      }
+    }
+  }
+}
+
+SCENARIO_METHOD(SceneManagerRenderFixture,
+                "Interpolating positions between simulation steps",
+                "[SceneManager.Interpolation]") {
+  GIVEN("a node that moves during a simulation step") {
+    const auto handle = scene_manager_.AddSceneNode(ParseProto<SceneNode>(R"(
+        id: 'node_a' sprite_id: 'sprite_b'
+        position { x: 2  y: 2 })"));
+    scene_manager_.Render();
+
+    scene_manager_.StartSimulationStep();
+    scene_manager_.Dirty(handle);
+    scene_manager_.GetSceneNode(handle)->mutable_position()->set_x(12);
+
+    WHEN("it is rendered half way through the next step") {
+      scene_manager_.SetRenderInterpolation(0.5);
+      scene_manager_.Render();
+
+      THEN("it is drawn between its old and new position") {
+        REQUIRE(renderer_.GetPixel(2, 2) == kBackground);
+        REQUIRE(renderer_.GetPixel(7, 2) == kRed);
+        REQUIRE(renderer_.GetPixel(10, 2) == kRed);
+        REQUIRE(renderer_.GetPixel(11, 2) == kBackground);
+      }
+
+      THEN("its bounding box is at its new position") {
+        REQUIRE(scene_manager_.GetSceneNodeBoundingBox(handle) ==
+                Rect{12, 2, 4, 4});
+      }
+
+      AND_WHEN("it is rendered at the end of the step") {
+        scene_manager_.SetRenderInterpolation(1.0);
+        scene_manager_.Render();
+
+        THEN("it is drawn at its new position") {
+          REQUIRE(renderer_.GetPixel(7, 2) == kBackground);
+          REQUIRE(renderer_.GetPixel(12, 2) == kRed);
+          REQUIRE(renderer_.framebuffer() == RenderFromScratch());
+        }
+      }
+
+      AND_WHEN("a step passes without it moving") {
+        scene_manager_.StartSimulationStep();
+        scene_manager_.SetRenderInterpolation(0.5);
+        scene_manager_.Render();
+
+        THEN("it is drawn at its new position") {
+          REQUIRE(renderer_.GetPixel(12, 2) == kRed);
+          REQUIRE(renderer_.framebuffer() == RenderFromScratch());
+        }
+      }
+    }
+  }
+}
+
+SCENARIO_METHOD(SceneManagerRenderFixture, "Querying static scene nodes",
+                "[SceneManager.Static]") {
+  GIVEN("static and dynamic scene nodes") {
+    scene_manager_.AddSceneNode(ParseProto<SceneNode>(R"(
+        id: 'dynamic' sprite_id: 'sprite_b'
+        position { x: 0  y: 0 })"));
+    const auto handle = scene_manager_.AddSceneNode(ParseProto<SceneNode>(R"(
+        id: 'static_a' sprite_id: 'sprite_b'  is_static: true
+        position { x: 2  y: 2 })"));
+    scene_manager_.AddSceneNode(ParseProto<SceneNode>(R"(
+        id: 'static_b' sprite_id: 'sprite_b'  is_static: true
+        position { x: 40  y: 40 })"));
+
+    THEN("both are found at points in their bounding boxes") {
+      REQUIRE(scene_manager_.GetSceneNodesAt(
+                  ParseProto<Vector>("x: 3  y: 3")) ==
+              std::vector<std::string>({"dynamic", "static_a"}));
+      REQUIRE(scene_manager_.GetSceneNodesAt(
+                  ParseProto<Vector>("x: 41  y: 41")) ==
+              std::vector<std::string>({"static_b"}));
+    }
+
+    THEN("only static nodes are returned by overlap queries") {
+      std::vector<NodeHandle> nodes;
+      scene_manager_.GetStaticSceneNodes({0, 0, 4, 4}, &nodes);
+      REQUIRE(nodes == std::vector<NodeHandle>({handle}));
+    }
+
+    WHEN("a static node is moved") {
+      scene_manager_.Dirty(handle);
+      scene_manager_.GetSceneNode(handle)->mutable_position()->set_x(20);
+
+      THEN("it is found at its new position") {
+        REQUIRE(scene_manager_.GetSceneNodesAt(
+                    ParseProto<Vector>("x: 3  y: 3")) ==
+                std::vector<std::string>({"dynamic"}));
+        REQUIRE(scene_manager_.GetSceneNodesAt(
+                    ParseProto<Vector>("x: 21  y: 3")) ==
+                std::vector<std::string>({"static_a"}));
+      }
+    }
+
+    WHEN("a static node is removed") {
+      scene_manager_.RemoveSceneNode(handle);
+      scene_manager_.RenderAll();
+
+      THEN("it is not found anymore") {
+        std::vector<NodeHandle> nodes;
+        scene_manager_.GetStaticSceneNodes({0, 0, 64, 64}, &nodes);
+        REQUIRE(nodes.size() == 1);
+        REQUIRE(scene_manager_.GetSceneNode(nodes[0])->id() == "static_b");
+      }
+    }
+  }
+}
+
 SCENARIO_METHOD(SceneManagerFixture, "Running animation scripts on scene nodes",
                 "[SceneManager.RunScript") {
   GIVEN("An animation script that is repeatable indefinitely") {
@@ -0,0 +1,57 @@
+#include "core/scene-node-store.h"
+
+namespace troll {
+
+void SceneNodeStore::Update(uint32_t index, const SceneNode& node,
+                            const Sprite& sprite,
+                            const std::vector<CollisionMask>& masks,
+                            const std::vector<CollisionMaskPyramid>& pyramids) {
+  if (index >= size()) {
+    const auto size = index + 1;
+    active_.resize(size);
+    valid_.resize(size);
+    x_.resize(size);
+    y_.resize(size);
+    z_.resize(size);
+    frame_index_.resize(size);
+    visible_.resize(size);
+    is_static_.resize(size);
+    sprite_.resize(size);
+    collision_masks_.resize(size);
+    collision_pyramids_.resize(size);
+    aabb_.resize(size);
+  }
+
+  active_[index] = true;
+  sprite_[index] = &sprite;
+  collision_masks_[index] = &masks;
+  collision_pyramids_[index] = &pyramids;
+  Update(index, node);
+}
+
+void SceneNodeStore::Update(uint32_t index, const SceneNode& node) {
+  valid_[index] = true;
+  x_[index] = node.position().x();
+  y_[index] = node.position().y();
+  z_[index] = node.position().z();
+  frame_index_[index] = node.frame_index();
+  visible_[index] = node.visible();
+  is_static_[index] = node.is_static();
+
+  const auto& film = sprite_[index]->film(node.frame_index());
+  aabb_[index] = {static_cast<int>(node.position().x()),
+                  static_cast<int>(node.position().y()), film.width(),
+                  film.height()};
+}
+
+void SceneNodeStore::Clear(uint32_t index) {
+  if (index < size()) {
+    active_[index] = false;
+    valid_[index] = false;
+    sprite_[index] = nullptr;
+    collision_masks_[index] = nullptr;
+    collision_pyramids_[index] = nullptr;
+  }
+}
+
+}  // namespace troll
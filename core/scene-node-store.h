@@ -0,0 +1,81 @@
+#ifndef TROLL_CORE_SCENE_NODE_STORE_H_
+#define TROLL_CORE_SCENE_NODE_STORE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "core/collision-mask.h"
+#include "core/geometry.h"
+#include "proto/scene-node.pb.h"
+#include "proto/sprite.pb.h"
+
+namespace troll {
+
+// Structure-of-arrays copy of the SceneNode fields that are read every frame.
+// Entries are indexed by NodeHandle::index. SceneNode protos remain the source
+// of truth and the SceneManager refreshes entries from them, so that rendering
+// and the collision broad phase can scan contiguous arrays instead of going
+// through protobuf accessors and sprite or mask lookups for each node.
+class SceneNodeStore {
+ public:
+  SceneNodeStore() = default;
+  ~SceneNodeStore() = default;
+
+  // Copies the fields of |node|, which is rendered with |sprite| and collides
+  // with the |masks| and |pyramids| of its frames, into entry |index|. The
+  // store grows as needed.
+  void Update(uint32_t index, const SceneNode& node, const Sprite& sprite,
+              const std::vector<CollisionMask>& masks,
+              const std::vector<CollisionMaskPyramid>& pyramids);
+
+  // Same as above for a node that kept the sprite of its active entry.
+  void Update(uint32_t index, const SceneNode& node);
+
+  // Marks entry |index| as unused.
+  void Clear(uint32_t index);
+
+  // Marks entry |index| as out of date with its SceneNode until the next
+  // Update().
+  void Invalidate(uint32_t index) { valid_[index] = false; }
+
+  // Returns the number of entries, including unused ones.
+  uint32_t size() const { return active_.size(); }
+
+  bool active(uint32_t index) const { return active_[index]; }
+  bool valid(uint32_t index) const { return valid_[index]; }
+  double x(uint32_t index) const { return x_[index]; }
+  double y(uint32_t index) const { return y_[index]; }
+  double z(uint32_t index) const { return z_[index]; }
+  int frame_index(uint32_t index) const { return frame_index_[index]; }
+  bool visible(uint32_t index) const { return visible_[index]; }
+  bool is_static(uint32_t index) const { return is_static_[index]; }
+  const Sprite& sprite(uint32_t index) const { return *sprite_[index]; }
+  const Rect& aabb(uint32_t index) const { return aabb_[index]; }
+
+  // Collision mask and pyramid of the current frame of entry |index|.
+  const CollisionMask& collision_mask(uint32_t index) const {
+    return (*collision_masks_[index])[frame_index_[index]];
+  }
+  const CollisionMaskPyramid& collision_pyramid(uint32_t index) const {
+    return (*collision_pyramids_[index])[frame_index_[index]];
+  }
+
+ private:
+  // Flags are stored in bytes instead of std::vector<bool> for cheap access.
+  std::vector<uint8_t> active_;
+  std::vector<uint8_t> valid_;
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> z_;
+  std::vector<int> frame_index_;
+  std::vector<uint8_t> visible_;
+  std::vector<uint8_t> is_static_;
+  std::vector<const Sprite*> sprite_;
+  std::vector<const std::vector<CollisionMask>*> collision_masks_;
+  std::vector<const std::vector<CollisionMaskPyramid>*> collision_pyramids_;
+  std::vector<Rect> aabb_;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_SCENE_NODE_STORE_H_
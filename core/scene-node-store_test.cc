@@ -0,0 +1,96 @@
+#include "core/scene-node-store.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <vector>
+
+#include "troll-test/test-util.h"
+
+namespace troll {
+
+SCENARIO("Storing scene nodes in arrays", "[SceneNodeStore]") {
+  GIVEN("a store with a scene node") {
+    const auto sprite = ParseProto<Sprite>(R"(
+        id: 'sprite_a'
+        film { width: 10  height: 10 }
+        film { left: 10  width: 20  height: 15 })");
+    const std::vector<CollisionMask> masks = {CollisionMask(10, 10, true),
+                                              CollisionMask(20, 15, false)};
+    const std::vector<CollisionMaskPyramid> pyramids = {
+        CollisionMaskPyramid(masks[0]), CollisionMaskPyramid(masks[1])};
+
+    SceneNodeStore store;
+    store.Update(2, ParseProto<SceneNode>(R"(
+        id: 'node_a' sprite_id: 'sprite_a'  frame_index: 1  is_static: true
+        position { x: 5  y: 7  z: 3 })"),
+                 sprite, masks, pyramids);
+
+    THEN("the store grows to fit the node") {
+      REQUIRE(store.size() == 3);
+      REQUIRE_FALSE(store.active(0));
+      REQUIRE_FALSE(store.active(1));
+      REQUIRE(store.active(2));
+      REQUIRE(store.valid(2));
+    }
+
+    THEN("the node fields are copied") {
+      REQUIRE(store.x(2) == 5);
+      REQUIRE(store.y(2) == 7);
+      REQUIRE(store.z(2) == 3);
+      REQUIRE(store.frame_index(2) == 1);
+      REQUIRE(store.visible(2));
+      REQUIRE(store.is_static(2));
+      REQUIRE(&store.sprite(2) == &sprite);
+    }
+
+    THEN("the collision masks of the current frame are found") {
+      REQUIRE(&store.collision_mask(2) == &masks[1]);
+      REQUIRE(&store.collision_pyramid(2) == &pyramids[1]);
+    }
+
+    THEN("the bounding box is placed at the node position") {
+      REQUIRE(store.aabb(2) == Rect{5, 7, 20, 15});
+    }
+
+    WHEN("the node is updated") {
+      store.Update(2, ParseProto<SceneNode>(R"(
+          id: 'node_a' sprite_id: 'sprite_a'  frame_index: 0
+          position { x: 1  y: 2 }  visible: false)"));
+
+      THEN("its fields are refreshed") {
+        REQUIRE(store.x(2) == 1);
+        REQUIRE(store.y(2) == 2);
+        REQUIRE_FALSE(store.visible(2));
+        REQUIRE_FALSE(store.is_static(2));
+        REQUIRE(store.aabb(2) == Rect{1, 2, 10, 10});
+      }
+
+      THEN("it keeps its sprite and follows its frame") {
+        REQUIRE(&store.sprite(2) == &sprite);
+        REQUIRE(&store.collision_mask(2) == &masks[0]);
+        REQUIRE(&store.collision_pyramid(2) == &pyramids[0]);
+      }
+    }
+
+    WHEN("the node is invalidated") {
+      store.Invalidate(2);
+
+      THEN("it is still active but not valid") {
+        REQUIRE(store.active(2));
+        REQUIRE_FALSE(store.valid(2));
+      }
+    }
+
+    WHEN("the node is cleared") {
+      store.Clear(2);
+
+      THEN("its entry is no longer active") {
+        REQUIRE(store.size() == 3);
+        REQUIRE_FALSE(store.active(2));
+      }
+    }
+  }
+}
+
+}  // namespace troll
@@ -0,0 +1,124 @@
+#include "core/spatial-grid.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace troll {
+
+namespace {
+// Integer division that rounds towards negative infinity, so that negative
+// coordinates map to the correct cell.
+int FloorDiv(int value, int divisor) {
+  const int quotient = value / divisor;
+  return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1
+                                                                : quotient;
+}
+}  // namespace
+
+void SpatialGrid::Update(NodeHandle node, const Box& aabb) {
+  const auto range = GetCellRange(aabb);
+
+  const auto it = nodes_.find(node.index);
+  if (it == nodes_.end()) {
+    nodes_.emplace(node.index, NodeEntry{node, aabb, range});
+    InsertInCells(node, range);
+    return;
+  }
+
+  auto& entry = it->second;
+  entry.aabb = aabb;
+  if (entry.handle == node && entry.cells == range) return;
+
+  RemoveFromCells(entry.handle, entry.cells);
+  InsertInCells(node, range);
+  entry.handle = node;
+  entry.cells = range;
+}
+
+void SpatialGrid::Remove(NodeHandle node) {
+  const auto it = nodes_.find(node.index);
+  if (it == nodes_.end() || it->second.handle != node) return;
+
+  RemoveFromCells(node, it->second.cells);
+  nodes_.erase(it);
+}
+
+bool SpatialGrid::Contains(NodeHandle node) const {
+  const auto it = nodes_.find(node.index);
+  return it != nodes_.end() && it->second.handle == node;
+}
+
+const Box& SpatialGrid::GetBoundingBox(NodeHandle node) const {
+  const auto it = nodes_.find(node.index);
+  LOG_IF(FATAL, it == nodes_.end() || it->second.handle != node)
+      << "SpatialGrid::GetBoundingBox() SceneNode in slot " << node.index
+      << " with generation " << node.generation << " is not indexed.";
+  return it->second.aabb;
+}
+
+std::vector<NodeHandle> SpatialGrid::Query(const Box& aabb) const {
+  const auto range = GetCellRange(aabb);
+
+  std::vector<NodeHandle> result;
+  for (int y = range.top; y <= range.bottom; ++y) {
+    for (int x = range.left; x <= range.right; ++x) {
+      const auto it = cells_.find(CellKey(x, y));
+      if (it == cells_.end()) continue;
+      result.insert(result.end(), it->second.begin(), it->second.end());
+    }
+  }
+
+  // Nodes spanning multiple cells are found more than once.
+  if (range.left != range.right || range.top != range.bottom) {
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+  }
+  return result;
+}
+
+void SpatialGrid::Clear() {
+  cells_.clear();
+  nodes_.clear();
+}
+
+SpatialGrid::CellRange SpatialGrid::GetCellRange(const Box& aabb) const {
+  // Degenerate boxes still occupy the cell of their top-left corner.
+  const int right = aabb.left() + std::max(aabb.width() - 1, 0);
+  const int bottom = aabb.top() + std::max(aabb.height() - 1, 0);
+  return {
+      FloorDiv(aabb.left(), cell_size_),
+      FloorDiv(aabb.top(), cell_size_),
+      FloorDiv(right, cell_size_),
+      FloorDiv(bottom, cell_size_),
+  };
+}
+
+void SpatialGrid::InsertInCells(NodeHandle node, const CellRange& range) {
+  for (int y = range.top; y <= range.bottom; ++y) {
+    for (int x = range.left; x <= range.right; ++x) {
+      cells_[CellKey(x, y)].push_back(node);
+    }
+  }
+}
+
+void SpatialGrid::RemoveFromCells(NodeHandle node, const CellRange& range) {
+  for (int y = range.top; y <= range.bottom; ++y) {
+    for (int x = range.left; x <= range.right; ++x) {
+      const auto it = cells_.find(CellKey(x, y));
+      if (it == cells_.end()) continue;
+
+      auto& cell = it->second;
+      const auto node_it = std::find(cell.begin(), cell.end(), node);
+      if (node_it != cell.end()) {
+        *node_it = cell.back();
+        cell.pop_back();
+      }
+      if (cell.empty()) {
+        cells_.erase(it);
+      }
+    }
+  }
+}
+
+}  // namespace troll
@@ -0,0 +1,87 @@
+#ifndef TROLL_CORE_SPATIAL_GRID_H_
+#define TROLL_CORE_SPATIAL_GRID_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "core/node-handle.h"
+#include "proto/primitives.pb.h"
+
+namespace troll {
+
+// Uniform grid that buckets scene nodes by the cells their bounding box
+// overlaps. It is used as a broad phase for finding nodes that may overlap a
+// box without scanning all nodes of the scene.
+class SpatialGrid {
+ public:
+  explicit SpatialGrid(int cell_size = kDefaultCellSize)
+      : cell_size_(cell_size) {}
+  ~SpatialGrid() = default;
+
+  // Inserts |node| in the grid or moves it to the cells overlapped by |aabb|
+  // if it already exists. A node of an older generation in the same slot is
+  // replaced.
+  void Update(NodeHandle node, const Box& aabb);
+
+  // Removes |node| from the grid. It is a noop if the node does not exist.
+  void Remove(NodeHandle node);
+
+  // Returns true if |node| is indexed in the grid.
+  bool Contains(NodeHandle node) const;
+
+  // Returns the bounding box that |node| was last updated with. The node must
+  // exist in the grid.
+  const Box& GetBoundingBox(NodeHandle node) const;
+
+  // Returns nodes that share at least one cell with |aabb|. Each node appears
+  // once in the result, but it is not guaranteed that its bounding box
+  // actually collides with |aabb|.
+  std::vector<NodeHandle> Query(const Box& aabb) const;
+
+  void Clear();
+
+  SpatialGrid(const SpatialGrid&) = delete;
+  SpatialGrid& operator=(const SpatialGrid&) = delete;
+
+ private:
+  static constexpr int kDefaultCellSize = 64;
+
+  // Inclusive range of cell coordinates covered by a bounding box.
+  struct CellRange {
+    int left;
+    int top;
+    int right;
+    int bottom;
+
+    bool operator==(const CellRange& other) const {
+      return left == other.left && top == other.top && right == other.right &&
+             bottom == other.bottom;
+    }
+  };
+
+  struct NodeEntry {
+    NodeHandle handle;
+    Box aabb;
+    CellRange cells;
+  };
+
+  CellRange GetCellRange(const Box& aabb) const;
+  void InsertInCells(NodeHandle node, const CellRange& range);
+  void RemoveFromCells(NodeHandle node, const CellRange& range);
+
+  static int64_t CellKey(int x, int y) {
+    return (static_cast<int64_t>(x) << 32) ^ static_cast<uint32_t>(y);
+  }
+
+  int cell_size_;
+
+  std::unordered_map<int64_t, std::vector<NodeHandle>> cells_;
+
+  // Indexed nodes by slot index.
+  std::unordered_map<uint32_t, NodeEntry> nodes_;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_SPATIAL_GRID_H_
@@ -0,0 +1,123 @@
+#include "core/spatial-grid.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include "core/node-handle.h"
+#include "troll-test/test-util.h"
+
+namespace troll {
+
+SCENARIO("Querying nodes in a spatial grid", "[SpatialGrid.Query]") {
+  GIVEN("a grid with nodes in different cells") {
+    SpatialGrid grid(10);
+
+    const NodeHandle node_a{0, 0}, node_b{1, 0}, node_c{2, 0};
+    grid.Update(node_a,
+                ParseProto<Box>("left: 0  top: 0  width: 5  height: 5"));
+    grid.Update(node_b,
+                ParseProto<Box>("left: 50  top: 50  width: 5  height: 5"));
+    grid.Update(node_c,
+                ParseProto<Box>("left: 5  top: 5  width: 20  height: 20"));
+
+    WHEN("a box overlapping a single cell is queried") {
+      const auto nodes =
+          grid.Query(ParseProto<Box>("left: 1  top: 1  width: 2  height: 2"));
+
+      THEN("only nodes in that cell are returned") {
+        REQUIRE(nodes.size() == 2);
+        REQUIRE(std::count(nodes.begin(), nodes.end(), node_a) == 1);
+        REQUIRE(std::count(nodes.begin(), nodes.end(), node_c) == 1);
+      }
+    }
+
+    WHEN("a box spanning multiple cells is queried") {
+      const auto nodes = grid.Query(
+          ParseProto<Box>("left: 0  top: 0  width: 30  height: 30"));
+
+      THEN("nodes spanning multiple cells are returned once") {
+        REQUIRE(nodes.size() == 2);
+        REQUIRE(std::count(nodes.begin(), nodes.end(), node_c) == 1);
+      }
+    }
+
+    WHEN("a node moves to a different cell") {
+      grid.Update(node_a,
+                  ParseProto<Box>("left: 52  top: 52  width: 5  height: 5"));
+
+      THEN("it is found only in its new cell") {
+        const auto old_cell = grid.Query(
+            ParseProto<Box>("left: 1  top: 1  width: 2  height: 2"));
+        REQUIRE(std::count(old_cell.begin(), old_cell.end(), node_a) == 0);
+
+        const auto new_cell = grid.Query(
+            ParseProto<Box>("left: 51  top: 51  width: 2  height: 2"));
+        REQUIRE(new_cell.size() == 2);
+        REQUIRE(std::count(new_cell.begin(), new_cell.end(), node_a) == 1);
+      }
+
+      THEN("its bounding box is updated") {
+        REQUIRE_THAT(grid.GetBoundingBox(node_a),
+                     EqualsProto(ParseProto<Box>(
+                         "left: 52  top: 52  width: 5  height: 5")));
+      }
+    }
+
+    WHEN("a node is removed") {
+      grid.Remove(node_c);
+
+      THEN("it is not found anymore") {
+        const auto nodes = grid.Query(
+            ParseProto<Box>("left: 0  top: 0  width: 30  height: 30"));
+        REQUIRE(nodes.size() == 1);
+        REQUIRE(nodes[0] == node_a);
+      }
+    }
+
+    WHEN("the slot of a removed node is reused by a new generation") {
+      grid.Remove(node_c);
+      const NodeHandle node_d{2, 1};
+      grid.Update(node_d,
+                  ParseProto<Box>("left: 5  top: 5  width: 5  height: 5"));
+
+      THEN("only the new node is found") {
+        const auto nodes =
+            grid.Query(ParseProto<Box>("left: 6  top: 6  width: 2  height: 2"));
+        REQUIRE(nodes.size() == 2);
+        REQUIRE(std::count(nodes.begin(), nodes.end(), node_c) == 0);
+        REQUIRE(std::count(nodes.begin(), nodes.end(), node_d) == 1);
+      }
+
+      THEN("removing the old handle is a noop") {
+        grid.Remove(node_c);
+        const auto nodes =
+            grid.Query(ParseProto<Box>("left: 6  top: 6  width: 2  height: 2"));
+        REQUIRE(std::count(nodes.begin(), nodes.end(), node_d) == 1);
+      }
+    }
+  }
+
+  GIVEN("a grid with nodes in negative coordinates") {
+    SpatialGrid grid(10);
+
+    const NodeHandle node_a{0, 0};
+    grid.Update(node_a,
+                ParseProto<Box>("left: -5  top: -5  width: 4  height: 4"));
+
+    WHEN("a box next to the origin is queried") {
+      const auto nodes =
+          grid.Query(ParseProto<Box>("left: 0  top: 0  width: 5  height: 5"));
+
+      THEN("the node is not in the same cell") { REQUIRE(nodes.empty()); }
+    }
+
+    WHEN("a box in the same negative cell is queried") {
+      const auto nodes = grid.Query(
+          ParseProto<Box>("left: -10  top: -10  width: 2  height: 2"));
+
+      THEN("the node is found") { REQUIRE(nodes.size() == 1); }
+    }
+  }
+}
+
+}  // namespace troll
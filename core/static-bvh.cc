@@ -0,0 +1,92 @@
+#include "core/static-bvh.h"
+
+#include <algorithm>
+
+namespace troll {
+
+void StaticBvh::Build(std::vector<Leaf> leaves) {
+  leaves_ = std::move(leaves);
+  tree_.clear();
+  if (leaves_.empty()) return;
+
+  tree_.reserve(2 * leaves_.size() / kMaxLeafSize + 1);
+  BuildSubtree(0, leaves_.size());
+}
+
+void StaticBvh::Clear() {
+  leaves_.clear();
+  tree_.clear();
+}
+
+int StaticBvh::BuildSubtree(int first, int last) {
+  const int index = tree_.size();
+  tree_.emplace_back();
+
+  Rect aabb = leaves_[first].aabb;
+  for (int i = first + 1; i < last; ++i) {
+    aabb = geo::Union(aabb, leaves_[i].aabb);
+  }
+  tree_[index].aabb = aabb;
+
+  if (last - first <= kMaxLeafSize) {
+    tree_[index].first = first;
+    tree_[index].count = last - first;
+    return index;
+  }
+
+  // Split at the median of leaf centres along the longest axis. Centres are
+  // compared doubled to stay in integers.
+  const bool split_x = aabb.width >= aabb.height;
+  const auto centre = [split_x](const Leaf& leaf) {
+    return split_x ? 2 * leaf.aabb.left + leaf.aabb.width
+                   : 2 * leaf.aabb.top + leaf.aabb.height;
+  };
+  const int middle = first + (last - first) / 2;
+  std::nth_element(leaves_.begin() + first, leaves_.begin() + middle,
+                   leaves_.begin() + last,
+                   [&centre](const Leaf& lhs, const Leaf& rhs) {
+                     return centre(lhs) < centre(rhs);
+                   });
+
+  BuildSubtree(first, middle);
+  const int right = BuildSubtree(middle, last);
+  tree_[index].right = right;
+  return index;
+}
+
+template <class Overlaps>
+void StaticBvh::Traverse(const Overlaps& overlaps,
+                         std::vector<NodeHandle>* nodes) const {
+  if (tree_.empty()) return;
+
+  int stack[64];
+  int size = 0;
+  stack[size++] = 0;
+  while (size > 0) {
+    const auto& node = tree_[stack[--size]];
+    if (!overlaps(node.aabb)) continue;
+
+    if (node.count > 0) {
+      for (int i = node.first; i < node.first + node.count; ++i) {
+        if (overlaps(leaves_[i].aabb)) nodes->push_back(leaves_[i].handle);
+      }
+      continue;
+    }
+
+    // The left child follows its parent.
+    stack[size++] = node.right;
+    stack[size++] = &node - tree_.data() + 1;
+  }
+}
+
+void StaticBvh::Query(const Rect& aabb, std::vector<NodeHandle>* nodes) const {
+  Traverse([&aabb](const Rect& rect) { return geo::Collide(rect, aabb); },
+           nodes);
+}
+
+void StaticBvh::QueryPoint(const Vector& at,
+                           std::vector<NodeHandle>* nodes) const {
+  Traverse([&at](const Rect& rect) { return geo::Contains(rect, at); }, nodes);
+}
+
+}  // namespace troll
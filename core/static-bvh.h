@@ -0,0 +1,67 @@
+#ifndef TROLL_CORE_STATIC_BVH_H_
+#define TROLL_CORE_STATIC_BVH_H_
+
+#include <vector>
+
+#include "core/geometry.h"
+#include "core/node-handle.h"
+#include "proto/primitives.pb.h"
+
+namespace troll {
+
+// Bounding volume hierarchy over scene nodes that do not move. It is built
+// once from all nodes and answers overlap and point queries in logarithmic
+// time. Nodes cannot be updated individually; the hierarchy is rebuilt
+// instead.
+class StaticBvh {
+ public:
+  struct Leaf {
+    NodeHandle handle;
+    Rect aabb;
+  };
+
+  StaticBvh() = default;
+  ~StaticBvh() = default;
+
+  // Replaces the contents of the hierarchy with |leaves|.
+  void Build(std::vector<Leaf> leaves);
+
+  // Appends to |nodes| the nodes whose bounding box collides with |aabb|.
+  void Query(const Rect& aabb, std::vector<NodeHandle>* nodes) const;
+
+  // Appends to |nodes| the nodes whose bounding box contains |at|.
+  void QueryPoint(const Vector& at, std::vector<NodeHandle>* nodes) const;
+
+  void Clear();
+
+  int size() const { return leaves_.size(); }
+  bool empty() const { return leaves_.empty(); }
+
+ private:
+  // Maximum number of leaves under a tree node that is not split further.
+  static constexpr int kMaxLeafSize = 4;
+
+  // Tree nodes are stored in depth-first order, so the left child of an inner
+  // node follows it and |right| points to its right child. Leaf nodes refer
+  // to the range [first, first + count) of |leaves_|.
+  struct TreeNode {
+    Rect aabb;
+    int first = 0;
+    int count = 0;
+    int right = 0;
+  };
+
+  // Builds the subtree over leaves_[first, last) and returns its index.
+  int BuildSubtree(int first, int last);
+
+  template <class Overlaps>
+  void Traverse(const Overlaps& overlaps,
+                std::vector<NodeHandle>* nodes) const;
+
+  std::vector<Leaf> leaves_;
+  std::vector<TreeNode> tree_;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_STATIC_BVH_H_
@@ -0,0 +1,102 @@
+#include "core/static-bvh.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <algorithm>
+
+#include "troll-test/test-util.h"
+
+namespace troll {
+
+namespace {
+// Returns the leaves of a |size| x |size| grid of 10x10 nodes spaced 20 pixels
+// apart.
+std::vector<StaticBvh::Leaf> MakeGrid(int size) {
+  std::vector<StaticBvh::Leaf> leaves;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      leaves.push_back({{static_cast<uint32_t>(y * size + x), 0},
+                        {x * 20, y * 20, 10, 10}});
+    }
+  }
+  return leaves;
+}
+
+std::vector<NodeHandle> Sorted(std::vector<NodeHandle> nodes) {
+  std::sort(nodes.begin(), nodes.end());
+  return nodes;
+}
+}  // namespace
+
+SCENARIO("Querying a static bounding volume hierarchy", "[StaticBvh]") {
+  GIVEN("a hierarchy over a grid of nodes") {
+    StaticBvh bvh;
+    bvh.Build(MakeGrid(16));
+
+    THEN("it contains all nodes") { REQUIRE(bvh.size() == 256); }
+
+    WHEN("a box overlapping a few nodes is queried") {
+      std::vector<NodeHandle> nodes;
+      bvh.Query({25, 25, 20, 10}, &nodes);
+
+      THEN("exactly the overlapping nodes are returned") {
+        REQUIRE(Sorted(nodes) ==
+                std::vector<NodeHandle>({{17, 0}, {18, 0}}));
+      }
+    }
+
+    WHEN("a box touching the side of a node is queried") {
+      std::vector<NodeHandle> nodes;
+      bvh.Query({10, 0, 10, 10}, &nodes);
+
+      THEN("no nodes are returned") { REQUIRE(nodes.empty()); }
+    }
+
+    WHEN("a box covering the whole grid is queried") {
+      std::vector<NodeHandle> nodes;
+      bvh.Query({-10, -10, 400, 400}, &nodes);
+
+      THEN("each node is returned once") {
+        REQUIRE(nodes.size() == 256);
+        nodes = Sorted(nodes);
+        REQUIRE(std::adjacent_find(nodes.begin(), nodes.end()) ==
+                nodes.end());
+      }
+    }
+
+    WHEN("points are queried") {
+      std::vector<NodeHandle> inside, between;
+      bvh.QueryPoint(ParseProto<Vector>("x: 305  y: 45"), &inside);
+      bvh.QueryPoint(ParseProto<Vector>("x: 315  y: 45"), &between);
+
+      THEN("only nodes containing them are returned") {
+        REQUIRE(inside == std::vector<NodeHandle>({{2 * 16 + 15, 0}}));
+        REQUIRE(between.empty());
+      }
+    }
+
+    WHEN("it is rebuilt with different nodes") {
+      bvh.Build({{{300, 1}, {0, 0, 5, 5}}});
+
+      THEN("only the new nodes are found") {
+        std::vector<NodeHandle> nodes;
+        bvh.Query({-10, -10, 400, 400}, &nodes);
+        REQUIRE(nodes == std::vector<NodeHandle>({{300, 1}}));
+      }
+    }
+  }
+
+  GIVEN("an empty hierarchy") {
+    StaticBvh bvh;
+
+    THEN("queries return no nodes") {
+      std::vector<NodeHandle> nodes;
+      bvh.Query({0, 0, 100, 100}, &nodes);
+      bvh.QueryPoint(ParseProto<Vector>("x: 1  y: 1"), &nodes);
+      REQUIRE(nodes.empty());
+    }
+  }
+}
+
+}  // namespace troll
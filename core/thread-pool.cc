@@ -0,0 +1,113 @@
+#include "core/thread-pool.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace troll {
+
+ThreadPool::ThreadPool(int num_threads) {
+  LOG_IF(FATAL, num_threads < 0)
+      << "ThreadPool cannot have " << num_threads << " threads.";
+
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_ready_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+int ThreadPool::DefaultNumThreads() {
+  // hardware_concurrency() returns zero when it is unknown.
+  return std::max<int>(std::thread::hardware_concurrency(), 1) - 1;
+}
+
+void ThreadPool::ParallelFor(int size, int grain,
+                             const std::function<void(int, int)>& fn) {
+  LOG_IF(FATAL, grain <= 0)
+      << "ThreadPool::ParallelFor() grain must be positive, got " << grain
+      << ".";
+  if (size <= 0) return;
+
+  // Loops that fit in a single range are not worth waking up workers for.
+  if (workers_.empty() || size <= grain) {
+    fn(0, size);
+    return;
+  }
+
+  Loop loop;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loop_.fn = &fn;
+    loop_.size = size;
+    loop_.grain = grain;
+    loop_.num_ranges = (size + grain - 1) / grain;
+    ++loop_.generation;
+    loop = loop_;
+    done_ranges_.store(0, std::memory_order_relaxed);
+    next_range_.store(uint64_t{loop.generation} << 32,
+                      std::memory_order_relaxed);
+  }
+  const int helpers = std::min<int>(workers_.size(), loop.num_ranges - 1);
+  for (int i = 0; i < helpers; ++i) {
+    work_ready_.notify_one();
+  }
+
+  RunRanges(loop);
+
+  // Workers that claimed no range are not waited for.
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_done_.wait(lock, [this, &loop]() {
+    return done_ranges_.load(std::memory_order_acquire) == loop.num_ranges;
+  });
+  loop_.fn = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+  uint32_t generation = 0;
+  while (true) {
+    Loop loop;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_ready_.wait(lock, [this, generation]() {
+        return stop_ || loop_.generation != generation;
+      });
+      if (stop_) return;
+      loop = loop_;
+      generation = loop.generation;
+    }
+
+    RunRanges(loop);
+  }
+}
+
+void ThreadPool::RunRanges(const Loop& loop) {
+  uint64_t next = next_range_.load(std::memory_order_relaxed);
+  while (true) {
+    const int begin = next & 0xffffffff;
+    if (next >> 32 != loop.generation || begin >= loop.size) return;
+    if (!next_range_.compare_exchange_weak(next, next + loop.grain,
+                                           std::memory_order_relaxed)) {
+      continue;
+    }
+
+    (*loop.fn)(begin, std::min(begin + loop.grain, loop.size));
+    next = next_range_.load(std::memory_order_relaxed);
+    if (done_ranges_.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+        loop.num_ranges) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      work_done_.notify_one();
+    }
+  }
+}
+
+}  // namespace troll
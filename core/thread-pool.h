@@ -0,0 +1,79 @@
+#ifndef TROLL_CORE_THREAD_POOL_H_
+#define TROLL_CORE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace troll {
+
+// Fixed set of worker threads that run data-parallel loops for the main loop
+// thread. Work is handed out one loop at a time and ParallelFor() blocks until
+// it is done, so workers never run concurrently with engine state changes.
+class ThreadPool {
+ public:
+  // Starts |num_threads| worker threads. A pool without workers runs all work
+  // on the calling thread.
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  // Returns the number of workers that keeps all hardware threads busy along
+  // with the main loop thread.
+  static int DefaultNumThreads();
+
+  // Calls |fn| on consecutive ranges [begin, end) that partition [0, size)
+  // and returns when all calls are done. Ranges hold up to |grain| indices
+  // and run on workers and the calling thread, so |fn| must be safe to call
+  // concurrently on different ranges. Only as many workers as there are
+  // ranges besides the one of the calling thread are woken up. It must be
+  // called from a single thread at a time.
+  void ParallelFor(int size, int grain,
+                   const std::function<void(int begin, int end)>& fn);
+
+  int num_threads() const { return workers_.size(); }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+ private:
+  // A loop that is handed out to workers.
+  struct Loop {
+    const std::function<void(int, int)>* fn = nullptr;
+    int size = 0;
+    int grain = 1;
+    int num_ranges = 0;
+    uint32_t generation = 0;
+  };
+
+  void WorkerLoop();
+
+  // Claims and runs ranges of |loop| until none are left.
+  void RunRanges(const Loop& loop);
+
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+  bool stop_ = false;
+
+  // The current loop, which is published to workers by bumping its
+  // generation under |mutex_|. Workers copy it before claiming ranges.
+  Loop loop_;
+
+  // Generation of the current loop in the upper half and the first index of
+  // the next range to claim in the lower half. Workers that wake up after a
+  // loop is done fail to claim ranges of it and never see later loops
+  // through it.
+  std::atomic<uint64_t> next_range_ = 0;
+  // Number of ranges of the current loop that are done.
+  std::atomic<int> done_ranges_ = 0;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_THREAD_POOL_H_
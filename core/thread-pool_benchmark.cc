@@ -0,0 +1,28 @@
+#include "core/thread-pool.h"
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace troll {
+namespace {
+
+// Arguments are the number of worker threads and the number of ranges of the
+// loop. Ranges do no work, so the time is the cost of handing out a loop.
+void BM_ParallelForOverhead(benchmark::State& state) {
+  ThreadPool thread_pool(state.range(0));
+  const int ranges = state.range(1);
+  std::vector<int> visits(ranges);
+
+  for (auto _ : state) {
+    thread_pool.ParallelFor(ranges, 1, [&visits](int begin, int end) {
+      benchmark::DoNotOptimize(++visits[begin]);
+    });
+  }
+}
+BENCHMARK(BM_ParallelForOverhead)
+    ->ArgsProduct({{1, 3, 7}, {2, 64}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace troll
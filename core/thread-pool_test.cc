@@ -0,0 +1,72 @@
+#include "core/thread-pool.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace troll {
+
+SCENARIO("Running parallel loops on a thread pool", "[ThreadPool]") {
+  GIVEN("a pool with worker threads") {
+    ThreadPool pool(3);
+
+    WHEN("a loop runs on it") {
+      std::vector<int> visits(1000, 0);
+      pool.ParallelFor(visits.size(), 7, [&visits](int begin, int end) {
+        for (int i = begin; i < end; ++i) ++visits[i];
+      });
+
+      THEN("each index is visited exactly once") {
+        REQUIRE(visits == std::vector<int>(1000, 1));
+      }
+    }
+
+    WHEN("many loops run on it one after the other") {
+      std::atomic<int> sum = 0;
+      for (int i = 0; i < 100; ++i) {
+        pool.ParallelFor(64, 4, [&sum](int begin, int end) {
+          sum += end - begin;
+        });
+      }
+
+      THEN("all of them complete") { REQUIRE(sum == 6400); }
+    }
+
+    WHEN("loops with fewer ranges than workers run on it") {
+      std::atomic<int> sum = 0;
+      for (int i = 0; i < 100; ++i) {
+        pool.ParallelFor(8, 4, [&sum](int begin, int end) {
+          sum += end - begin;
+        });
+      }
+
+      THEN("all of them complete") { REQUIRE(sum == 800); }
+    }
+
+    WHEN("an empty loop runs on it") {
+      bool called = false;
+      pool.ParallelFor(0, 4, [&called](int, int) { called = true; });
+
+      THEN("the function is not called") { REQUIRE_FALSE(called); }
+    }
+  }
+
+  GIVEN("a pool without worker threads") {
+    ThreadPool pool(0);
+
+    WHEN("a loop runs on it") {
+      std::vector<std::pair<int, int>> ranges;
+      pool.ParallelFor(10, 3, [&ranges](int begin, int end) {
+        ranges.emplace_back(begin, end);
+      });
+
+      THEN("it runs as a single range on the calling thread") {
+        REQUIRE(ranges == std::vector<std::pair<int, int>>({{0, 10}}));
+      }
+    }
+  }
+}
+
+}  // namespace troll
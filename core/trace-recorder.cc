@@ -0,0 +1,108 @@
+#include "core/trace-recorder.h"
+
+#include <algorithm>
+
+#include <absl/strings/str_cat.h>
+#include <glog/logging.h>
+
+namespace troll {
+
+namespace {
+// Appends |str| to |json| as a quoted JSON string.
+void AppendJsonString(std::string_view str, std::string* json) {
+  json->push_back('"');
+  for (const char c : str) {
+    switch (c) {
+      case '"':
+        json->append("\\\"");
+        break;
+      case '\\':
+        json->append("\\\\");
+        break;
+      case '\n':
+        json->append("\\n");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        json->push_back(c);
+    }
+  }
+  json->push_back('"');
+}
+}  // namespace
+
+TraceRecorder* TraceRecorder::Get() {
+  static TraceRecorder recorder;
+  return &recorder;
+}
+
+void TraceRecorder::Start(int capacity) {
+  LOG_IF(FATAL, capacity <= 0)
+      << "TraceRecorder must hold at least one event, got " << capacity << ".";
+
+  events_.resize(capacity);
+  next_event_ = 0;
+  size_ = 0;
+  start_time_ = std::chrono::steady_clock::now();
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void TraceRecorder::Stop() { enabled_.store(false, std::memory_order_relaxed); }
+
+void TraceRecorder::Begin(const char* category, std::string_view name) {
+  TraceEvent* event = NextEvent(category, 'B');
+  if (event != nullptr) event->name.assign(name.data(), name.size());
+}
+
+void TraceRecorder::End(const char* category) { NextEvent(category, 'E'); }
+
+TraceRecorder::TraceEvent* TraceRecorder::NextEvent(const char* category,
+                                                    char phase) {
+  if (!enabled()) return nullptr;
+
+  TraceEvent* event = &events_[next_event_];
+  event->category = category;
+  event->phase = phase;
+  event->timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - start_time_)
+                            .count();
+
+  next_event_ = (next_event_ + 1) % events_.size();
+  size_ = std::min<int>(size_ + 1, events_.size());
+  return event;
+}
+
+std::string TraceRecorder::ExportJson() const {
+  std::string json = "{\"traceEvents\":[";
+
+  const int capacity = events_.size();
+  int depth = 0;
+  bool first = true;
+  for (int i = 0; i < size_; ++i) {
+    const TraceEvent& event =
+        events_[(next_event_ - size_ + i + capacity) % capacity];
+    if (event.phase == 'E') {
+      if (depth == 0) continue;
+      --depth;
+    } else {
+      ++depth;
+    }
+
+    if (!first) json.push_back(',');
+    first = false;
+
+    json.append("{\"cat\":");
+    AppendJsonString(event.category, &json);
+    if (event.phase == 'B') {
+      json.append(",\"name\":");
+      AppendJsonString(event.name, &json);
+    }
+    absl::StrAppend(&json, ",\"ph\":\"", std::string(1, event.phase),
+                    "\",\"ts\":", event.timestamp_us, ",\"pid\":1,\"tid\":1}");
+  }
+
+  json.append("]}");
+  return json;
+}
+
+}  // namespace troll
@@ -0,0 +1,90 @@
+#ifndef TROLL_CORE_TRACE_RECORDER_H_
+#define TROLL_CORE_TRACE_RECORDER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace troll {
+
+// Records begin/end trace events in a ring buffer that can be exported in the
+// Chrome trace_event JSON format, loadable in chrome://tracing and Perfetto.
+//
+// There is a single process-wide recorder. Recording is disabled by default
+// and a disabled recorder costs a relaxed atomic load per ScopedEvent, so
+// instrumentation can stay compiled in. Events are recorded only from the main
+// loop thread. Recording can start before TrollCore::Init(), so that loading
+// of resources is recorded.
+class TraceRecorder {
+ public:
+  static constexpr int kDefaultCapacity = 1 << 16;
+
+  // Records a begin event on construction and the matching end event on
+  // destruction, if recording was enabled on construction. |category| must
+  // outlive the recording, |name| is copied.
+  class ScopedEvent {
+   public:
+    ScopedEvent(const char* category, std::string_view name) {
+      if (!TraceRecorder::enabled()) return;
+      category_ = category;
+      TraceRecorder::Get()->Begin(category, name);
+    }
+    ~ScopedEvent() {
+      if (category_ != nullptr) TraceRecorder::Get()->End(category_);
+    }
+
+    ScopedEvent(const ScopedEvent&) = delete;
+    ScopedEvent& operator=(const ScopedEvent&) = delete;
+
+   private:
+    const char* category_ = nullptr;
+  };
+
+  static TraceRecorder* Get();
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Clears previously recorded events and starts recording. Once |capacity|
+  // events are recorded the oldest ones are overwritten.
+  void Start(int capacity = kDefaultCapacity);
+
+  // Stops recording. Recorded events are kept until the next Start().
+  void Stop();
+
+  void Begin(const char* category, std::string_view name);
+  void End(const char* category);
+
+  // Returns recorded events as a Chrome trace_event JSON document. End events
+  // whose begin event was overwritten in the ring buffer are dropped.
+  std::string ExportJson() const;
+
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+ private:
+  TraceRecorder() = default;
+  ~TraceRecorder() = default;
+
+  struct TraceEvent {
+    const char* category = nullptr;
+    std::string name;
+    char phase = 'B';
+    int64_t timestamp_us = 0;
+  };
+
+  TraceEvent* NextEvent(const char* category, char phase);
+
+  inline static std::atomic<bool> enabled_ = false;
+
+  std::vector<TraceEvent> events_;
+  int next_event_ = 0;
+  int size_ = 0;
+  std::chrono::steady_clock::time_point start_time_;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_CORE_TRACE_RECORDER_H_
@@ -0,0 +1,73 @@
+#include "core/trace-recorder.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace troll {
+
+SCENARIO("Recording trace events", "[TraceRecorder.ExportJson]") {
+  TraceRecorder* recorder = TraceRecorder::Get();
+
+  GIVEN("a disabled recorder") {
+    recorder->Start();
+    recorder->Stop();
+
+    WHEN("scoped events run") {
+      { TraceRecorder::ScopedEvent trace_event("test", "ignored"); }
+
+      THEN("nothing is recorded") {
+        REQUIRE(recorder->ExportJson() == "{\"traceEvents\":[]}");
+      }
+    }
+  }
+
+  GIVEN("an enabled recorder") {
+    recorder->Start();
+
+    WHEN("nested scoped events run") {
+      {
+        TraceRecorder::ScopedEvent outer("frame", "frame");
+        TraceRecorder::ScopedEvent inner("action", "emit \"x\"");
+      }
+      recorder->Stop();
+      const std::string json = recorder->ExportJson();
+
+      THEN("begin and end events are exported in order") {
+        const auto frame = json.find("\"name\":\"frame\",\"ph\":\"B\"");
+        const auto action =
+            json.find("\"name\":\"emit \\\"x\\\"\",\"ph\":\"B\"");
+        REQUIRE(frame != std::string::npos);
+        REQUIRE(action != std::string::npos);
+        REQUIRE(frame < action);
+
+        const auto first_end = json.find("\"ph\":\"E\"");
+        REQUIRE(first_end > action);
+        REQUIRE(json.find("\"ph\":\"E\"", first_end + 1) != std::string::npos);
+      }
+    }
+  }
+
+  GIVEN("a recorder with a small ring buffer") {
+    recorder->Start(3);
+
+    WHEN("more events than it holds are recorded") {
+      {
+        TraceRecorder::ScopedEvent outer("test", "outer");
+        TraceRecorder::ScopedEvent inner("test", "inner");
+      }
+      recorder->Stop();
+      const std::string json = recorder->ExportJson();
+
+      THEN("end events of overwritten begin events are dropped") {
+        REQUIRE(json.find("outer") == std::string::npos);
+        REQUIRE(json.find("inner") != std::string::npos);
+
+        const auto first_end = json.find("\"ph\":\"E\"");
+        REQUIRE(first_end != std::string::npos);
+        REQUIRE(json.find("\"ph\":\"E\"", first_end + 1) == std::string::npos);
+      }
+    }
+  }
+}
+
+}  // namespace troll
@@ -1,24 +1,52 @@
 #include "core/troll-core.h"
 
+#include <cstdlib>
+#include <fstream>
+
 #include <absl/memory/memory.h>
 #include <absl/strings/str_cat.h>
 #include <glog/logging.h>
 
+#include "core/trace-recorder.h"
 #include "proto/input-event.pb.h"
 #include "proto/scene.pb.h"
 #include "proto/sprite.pb.h"
 
 namespace troll {
 
+TrollCore::~TrollCore() {
+  // Performers unregister their event handlers when they are destroyed, so
+  // animations go before the event dispatcher.
+  animator_manager_.reset();
+  // Collision rules unpin their inline scripts from the resource manager.
+  collision_checker_.reset();
+}
+
 void TrollCore::Init(const std::string& name,
                      const std::string& resource_base_path,
-                     ScriptingEngine* engine) {
+                     ScriptingEngine* engine,
+                     RenderBackend render_backend) {
   GOOGLE_PROTOBUF_VERIFY_VERSION;
   google::InitGoogleLogging(name.c_str());
 
-  renderer_ = std::make_unique<Renderer>();
+  // Tracing starts before anything is loaded, so that loading is recorded.
+  if (const char* trace_path = std::getenv("TROLL_TRACE")) {
+    trace_path_ = trace_path;
+    TraceRecorder::Get()->Start();
+  }
+  TraceRecorder::ScopedEvent trace_event("init", "init");
+
+  if (render_backend == RenderBackend::HEADLESS) {
+    renderer_ = std::make_unique<HeadlessRenderer>();
+  } else {
+    renderer_ = std::make_unique<SdlRenderer>();
+  }
   renderer_->CreateWindow(640, 480);
 
+  frame_profiler_ = std::make_unique<FrameProfiler>();
+  thread_pool_ =
+      std::make_unique<ThreadPool>(ThreadPool::DefaultNumThreads());
+
   sound_loader_ = std::make_unique<SoundLoader>();
   sound_loader_->Init();
 
@@ -36,19 +64,64 @@ void TrollCore::Init(const std::string& name,
       resource_manager_->GetKeyBindings(), action_manager_.get());
 }
 
+void TrollCore::SetLoopConfig(const LoopConfig& config) {
+  loop_config_ = config;
+  fixed_timestep_ =
+      config.step_time > 0
+          ? std::make_unique<FixedTimestep>(config.step_time,
+                                            config.max_steps_per_frame)
+          : nullptr;
+}
+
+void TrollCore::SetWorkerThreads(int num_threads) {
+  thread_pool_ = std::make_unique<ThreadPool>(num_threads);
+}
+
+void TrollCore::SetAnimationBackend(AnimationBackend backend) {
+  animation_backend_ = backend;
+}
+
 void TrollCore::Run() {
   int curr_time = SDL_GetTicks();
   int prev_time = curr_time;
 
-  while (InputHandling()) {
+  while (true) {
+    TraceRecorder::ScopedEvent trace_event("frame", "frame");
+    if (!InputHandling()) break;
+
     curr_time = SDL_GetTicks();
 
-    FrameStarted(curr_time - prev_time);
-    scene_manager_->Render();
+    if (fixed_timestep_ == nullptr) {
+      FrameStarted(curr_time - prev_time);
+    } else {
+      const int steps = fixed_timestep_->Advance(curr_time - prev_time);
+      for (int i = 0; i < steps; ++i) {
+        if (loop_config_.interpolate) {
+          scene_manager_->StartSimulationStep();
+        }
+        FrameStarted(fixed_timestep_->step_time());
+      }
+      if (loop_config_.interpolate) {
+        scene_manager_->SetRenderInterpolation(fixed_timestep_->alpha());
+      }
+    }
+    {
+      FrameProfiler::ScopedTimer timer(frame_profiler_.get(),
+                                       FrameProfiler::Stage::RENDER);
+      scene_manager_->Render();
+    }
     FrameEnded(curr_time - prev_time);
 
     prev_time = curr_time;
   }
+
+  // Traces that were stopped by scripts are theirs to export.
+  if (!trace_path_.empty() && TraceRecorder::enabled()) {
+    TraceRecorder::Get()->Stop();
+    std::ofstream trace_file(trace_path_);
+    trace_file << TraceRecorder::Get()->ExportJson();
+    LOG_IF(ERROR, !trace_file) << "Failed to write trace in " << trace_path_;
+  }
 }
 
 void TrollCore::Halt() { halt_ = true; }
@@ -56,7 +129,8 @@ void TrollCore::Halt() { halt_ = true; }
 void TrollCore::LoadScene(const Scene& scene) {
   scene_manager_ = std::make_unique<SceneManager>(resource_manager_.get(),
                                                   renderer_.get(), this);
-  animator_manager_ = std::make_unique<AnimatorManager>(this);
+  animator_manager_ =
+      std::make_unique<AnimatorManager>(this, animation_backend_);
   collision_checker_ = std::make_unique<CollisionChecker>(
       scene_manager_.get(), action_manager_.get(), this);
   event_dispatcher_ = std::make_unique<EventDispatcher>();
@@ -65,6 +139,8 @@ void TrollCore::LoadScene(const Scene& scene) {
 }
 
 bool TrollCore::InputHandling() {
+  FrameProfiler::ScopedTimer timer(frame_profiler_.get(),
+                                   FrameProfiler::Stage::INPUT);
   if (halt_) {
     return false;
   }
@@ -80,12 +156,38 @@ bool TrollCore::InputHandling() {
 }
 
 void TrollCore::FrameStarted(int time_since_last_frame) {
-  animator_manager_->Progress(time_since_last_frame);
-  collision_checker_->CheckCollisions();
-  event_dispatcher_->ProcessTriggeredEvents();
+  {
+    FrameProfiler::ScopedTimer timer(frame_profiler_.get(),
+                                     FrameProfiler::Stage::ANIMATION);
+    animator_manager_->Progress(time_since_last_frame);
+  }
+  {
+    FrameProfiler::ScopedTimer timer(frame_profiler_.get(),
+                                     FrameProfiler::Stage::COLLISION);
+    collision_checker_->CheckCollisions();
+  }
+  frame_profiler_->AddCount(FrameProfiler::Counter::COLLISION_PAIRS,
+                            collision_checker_->pairs_tested());
+  {
+    FrameProfiler::ScopedTimer timer(frame_profiler_.get(),
+                                     FrameProfiler::Stage::EVENTS);
+    event_dispatcher_->ProcessTriggeredEvents();
+  }
+  frame_profiler_->AddCount(FrameProfiler::Counter::EVENTS_FIRED,
+                            event_dispatcher_->events_fired());
+
+  resource_manager_->EvictInlinePrograms();
 }
 
 void TrollCore::FrameEnded(int time_since_last_frame) {
+  frame_profiler_->AddCount(FrameProfiler::Counter::NODES_BLITTED,
+                            scene_manager_->render_stats().nodes_blitted);
+  frame_profiler_->AddCount(
+      FrameProfiler::Counter::ACTIONS_EXECUTED,
+      action_manager_->actions_executed() - actions_executed_);
+  actions_executed_ = action_manager_->actions_executed();
+  frame_profiler_->EndFrame();
+
   ++fps_counter_.fp_count;
   fps_counter_.elapsed_time += time_since_last_frame;
 
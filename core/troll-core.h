@@ -10,22 +10,70 @@
 #include "core/collision-checker.h"
 #include "core/core.h"
 #include "core/event-dispatcher.h"
+#include "core/fixed-timestep.h"
+#include "core/frame-profiler.h"
 #include "core/resource-manager.h"
 #include "core/scene-manager.h"
 #include "core/scripting-engine.h"
+#include "core/thread-pool.h"
 #include "input/input-manager.h"
+#include "sdl/headless-renderer.h"
 #include "sdl/input-backend.h"
 #include "sdl/renderer.h"
+#include "sdl/sdl-renderer.h"
 #include "sound/audio-mixer.h"
 #include "sound/sound-loader.h"
 
 namespace troll {
 
+// Backends for rendering frames.
+enum class RenderBackend {
+  // Renders on an SDL window.
+  SDL,
+  // Renders in an in-memory framebuffer without a display or vsync.
+  HEADLESS,
+};
+
+// Timing of the main loop.
+struct LoopConfig {
+  // Duration of fixed simulation steps in milliseconds. When it is zero, each
+  // frame progresses simulation by the time since the last frame.
+  int step_time = 0;
+
+  // Maximum number of steps that run in a single frame to catch up with a slow
+  // frame. Time beyond that is dropped.
+  int max_steps_per_frame = 5;
+
+  // Render moving nodes at positions interpolated between the last two steps.
+  bool interpolate = false;
+};
+
 class TrollCore : public Core {
  public:
-  // Takes ownership of ScriptingEngine.
+  TrollCore() = default;
+  ~TrollCore() override;
+
+  // Takes ownership of ScriptingEngine. If the TROLL_TRACE environment
+  // variable is set, events are recorded from the start of Init(), which
+  // includes loading of resources, and written as a Chrome trace in the file
+  // it names when Run() returns. Tracing can also be started before Init()
+  // through TraceRecorder.
   void Init(const std::string& name, const std::string& resource_base_path,
-            ScriptingEngine* engine);
+            ScriptingEngine* engine,
+            RenderBackend render_backend = RenderBackend::SDL);
+
+  // Simulation runs in fixed steps when |config| has a step time, while
+  // frames are rendered once per loop iteration at the renderer's own pace.
+  void SetLoopConfig(const LoopConfig& config);
+
+  // Sets the number of worker threads that run parallel stages of the frame,
+  // such as the collision narrow phase, next to the main loop thread. It
+  // defaults to ThreadPool::DefaultNumThreads().
+  void SetWorkerThreads(int num_threads) override;
+
+  // Animations of the next scene that is loaded run on |backend|, see
+  // AnimationBackend for which suits a scene. It defaults to PERFORMERS.
+  void SetAnimationBackend(AnimationBackend backend) override;
 
   void Run();
   void Halt() override;
@@ -42,6 +90,7 @@ class TrollCore : public Core {
   EventDispatcher* event_dispatcher() override {
     return event_dispatcher_.get();
   }
+  FrameProfiler* frame_profiler() override { return frame_profiler_.get(); }
   InputBackend* input_backend() override { return input_backend_.get(); }
   InputManager* input_manager() override { return input_manager_.get(); }
   QueryManager* query_manager() override { return query_manager_.get(); }
@@ -54,6 +103,7 @@ class TrollCore : public Core {
     return scripting_engine_.get();
   }
   SoundLoader* sound_loader() override { return sound_loader_.get(); }
+  ThreadPool* thread_pool() override { return thread_pool_.get(); }
 
  private:
   bool InputHandling();
@@ -66,6 +116,7 @@ class TrollCore : public Core {
   std::unique_ptr<AudioMixer> audio_mixer_;
   std::unique_ptr<CollisionChecker> collision_checker_;
   std::unique_ptr<EventDispatcher> event_dispatcher_;
+  std::unique_ptr<FrameProfiler> frame_profiler_;
   std::unique_ptr<InputBackend> input_backend_;
   std::unique_ptr<InputManager> input_manager_;
   std::unique_ptr<QueryManager> query_manager_;
@@ -74,6 +125,7 @@ class TrollCore : public Core {
   std::unique_ptr<SceneManager> scene_manager_;
   std::unique_ptr<ScriptingEngine> scripting_engine_;
   std::unique_ptr<SoundLoader> sound_loader_;
+  std::unique_ptr<ThreadPool> thread_pool_;
 
   struct FpsCounter {
     int elapsed_time = 0;
@@ -82,7 +134,17 @@ class TrollCore : public Core {
   };
   FpsCounter fps_counter_;
 
+  // Value of the cumulative action counter at the end of the last frame.
+  int actions_executed_ = 0;
+
+  AnimationBackend animation_backend_ = AnimationBackend::PERFORMERS;
+  LoopConfig loop_config_;
+  std::unique_ptr<FixedTimestep> fixed_timestep_;
+
   bool halt_ = false;
+
+  // File that the trace is written in when Run() returns, if not empty.
+  std::string trace_path_;
 };
 
 }  // namespace troll
@@ -4,6 +4,7 @@
 #include <glog/logging.h>
 
 #include "core/event-dispatcher.h"
+#include "core/trace-recorder.h"
 #include "core/troll-core.h"
 #include "dart_troll/dart_utils.h"
 #include "input/input-manager.h"
@@ -73,6 +74,7 @@ struct DartCallbackWrapper {
       : handler_(std::make_shared<PersistentHandle>(handler)) {}
 
   void operator()(const Event& event) const {
+    TraceRecorder::ScopedEvent trace_event("dart", event.event_id());
     Dart_Handle arguments[] = {
         HandleError(UploadProtoValue(event)),
     };
@@ -80,6 +82,7 @@ struct DartCallbackWrapper {
   }
 
   void operator()(const InputEvent& input_event) const {
+    TraceRecorder::ScopedEvent trace_event("dart", "input");
     Dart_Handle arguments[] = {
         HandleError(UploadProtoValue(input_event)),
     };
@@ -168,6 +171,35 @@ void NativeUnregisterInputHandler(Dart_NativeArguments arguments) {
   core->input_manager()->UnregisterHandler(DownloadInt(handler_id));
 }
 
+// Sets the number of worker threads of parallel stages of the frame.
+void NativeSetWorkerThreads(Dart_NativeArguments arguments) {
+  const Dart_Handle num_threads =
+      HandleError(Dart_GetNativeArgument(arguments, 0));
+
+  core->SetWorkerThreads(DownloadInt(num_threads));
+}
+
+// Sets the animation backend of the scenes that are loaded next.
+void NativeSetAnimationBackend(Dart_NativeArguments arguments) {
+  const Dart_Handle backend = HandleError(Dart_GetNativeArgument(arguments, 0));
+
+  core->SetAnimationBackend(
+      static_cast<AnimationBackend>(DownloadInt(backend)));
+}
+
+// Starts recording trace events. It may be called before NativeInit(), so that
+// loading of resources is recorded.
+void NativeStartTrace(Dart_NativeArguments arguments) {
+  TraceRecorder::Get()->Start();
+}
+
+// Stops recording trace events and returns them as a Chrome trace JSON.
+void NativeStopTrace(Dart_NativeArguments arguments) {
+  TraceRecorder::Get()->Stop();
+  Dart_SetReturnValue(
+      arguments, HandleError(UploadString(TraceRecorder::Get()->ExportJson())));
+}
+
 // Resolves Darts calls to native functions by name.
 Dart_NativeFunction ResolveName(Dart_Handle name, int argc,
                                 bool* auto_setup_scope) {
@@ -198,6 +230,18 @@ Dart_NativeFunction ResolveName(Dart_Handle name, int argc,
   if (func_name == "NativeUnregisterInputHandler") {
     return NativeUnregisterInputHandler;
   }
+  if (func_name == "NativeSetWorkerThreads") {
+    return NativeSetWorkerThreads;
+  }
+  if (func_name == "NativeSetAnimationBackend") {
+    return NativeSetAnimationBackend;
+  }
+  if (func_name == "NativeStartTrace") {
+    return NativeStartTrace;
+  }
+  if (func_name == "NativeStopTrace") {
+    return NativeStopTrace;
+  }
 
   return nullptr;
 }
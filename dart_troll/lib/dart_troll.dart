@@ -43,3 +43,36 @@ int registerInputHandler(void Function(Uint8List) handler)
 /// Removes the input handler corresponding to [handlerId].
 void unregisterInputHandler(int handlerId)
     native "NativeUnregisterInputHandler";
+
+/// Sets the number of threads that run parallel stages of the frame, such as
+/// the collision narrow phase, next to the main loop thread.
+///
+/// With [numThreads] set to 0 all stages run on the main loop thread.
+void setWorkerThreads(int numThreads) native "NativeSetWorkerThreads";
+
+/// Implementations that animations run on, in the order of the engine's
+/// AnimationBackend.
+enum AnimationBackend {
+  /// Each animation runs on performers, which suits mostly idle animations.
+  performers,
+
+  /// Animations are compiled into tracks, which suits scenes of up to a few
+  /// thousand nodes that move every frame, each by a single script.
+  tracks,
+}
+
+/// Sets the backend that animations run on, from the next scene that is
+/// loaded.
+void setAnimationBackend(AnimationBackend backend) =>
+    _setAnimationBackend(backend.index);
+
+void _setAnimationBackend(int backend) native "NativeSetAnimationBackend";
+
+/// Starts recording trace events of the game engine.
+///
+/// It may be called before [init], so that loading of resources is recorded.
+void startTrace() native "NativeStartTrace";
+
+/// Stops recording trace events and returns them as a Chrome trace_event JSON
+/// document.
+String stopTrace() native "NativeStopTrace";
@@ -0,0 +1,24 @@
+import 'dart:io';
+
+import 'package:dart_troll/dart_troll.dart' as troll;
+import 'package:dart_troll/src/proto/query.pb.dart';
+
+/// Returns the stage timings and counters of the recent frames of the game
+/// engine.
+FrameProfile frameProfile() {
+  final query = Query()..frameProfile = FrameProfileQuery();
+  final responseBuffer = troll.eval(query.writeToBuffer());
+  final response = Response()..mergeFromBuffer(responseBuffer);
+  return response.frameProfile;
+}
+
+/// Starts recording trace events of the game engine.
+///
+/// It may be called before `troll.init()`, so that loading of resources is
+/// recorded.
+void startTrace() => troll.startTrace();
+
+/// Stops tracing and writes a Chrome trace_event JSON file.
+void stopTrace(String filename) {
+  File(filename).writeAsStringSync(troll.stopTrace());
+}
@@ -0,0 +1,38 @@
+import proto.query_pb2
+import troll
+
+# Backends of animations, see SetAnimationBackend().
+PERFORMERS = 0
+TRACKS = 1
+
+
+def FrameProfile():
+    query = proto.query_pb2.Query()
+    query.frame_profile.SetInParent()
+
+    response = proto.query_pb2.Response()
+    response.ParseFromString(troll.query(query.SerializeToString()))
+    return response.frame_profile
+
+
+def SetWorkerThreads(num_threads):
+    """Sets the number of threads that run parallel stages of the frame next
+    to the main loop thread, e.g. 0 to run everything on the main thread."""
+    troll.set_worker_threads(num_threads)
+
+
+def SetAnimationBackend(backend):
+    """Sets the backend that animations run on from the next scene, i.e.
+    PERFORMERS or TRACKS. TRACKS suits scenes of up to a few thousand nodes
+    that move every frame, each by a single script."""
+    troll.set_animation_backend(backend)
+
+
+def StartTrace():
+    troll.start_trace()
+
+
+def StopTrace(filename):
+    """Stops tracing and writes a Chrome trace_event JSON file."""
+    with open(filename, 'w') as trace_file:
+        trace_file.write(troll.stop_trace())
@@ -7,10 +7,14 @@
 #include <pybind11/functional.h>
 
 #include "action/action-manager.h"
+#include "action/query-manager.h"
+#include "animation/animator-manager.h"
 #include "core/event-dispatcher.h"
+#include "core/trace-recorder.h"
 #include "input/input-manager.h"
 #include "proto/action.pb.h"
 #include "proto/input-event.pb.h"
+#include "proto/query.pb.h"
 
 namespace troll {
 
@@ -24,6 +28,7 @@ Core* core_instance;
 EventHandler PythonEventHandlerWrapper(
     const std::function<void(const pybind11::bytes&)>& python_handler) {
   return [python_handler](const Event& event) {
+    TraceRecorder::ScopedEvent trace_event("python", event.event_id());
     std::string encoded_event;
     event.SerializeToString(&encoded_event);
 
@@ -41,6 +46,7 @@ EventHandler PythonEventHandlerWrapper(
 InputManager::InputHandler PythonInputHandlerWrapper(
     const std::function<void(const pybind11::bytes&)>& python_handler) {
   return [python_handler](const InputEvent& event) {
+    TraceRecorder::ScopedEvent trace_event("python", "input");
     std::string encoded_input_event;
     event.SerializeToString(&encoded_input_event);
 
@@ -60,6 +66,31 @@ PYBIND11_EMBEDDED_MODULE(troll, m) {
     core_instance->action_manager()->Execute(action);
   });
 
+  m.def("query", [](const std::string& encoded_query) {
+    Query query;
+    query.ParseFromString(encoded_query);
+
+    std::string encoded_response;
+    core_instance->query_manager()->Eval(query).SerializeToString(
+        &encoded_response);
+    return pybind11::bytes(encoded_response);
+  });
+
+  m.def("set_worker_threads", [](int num_threads) {
+    core_instance->SetWorkerThreads(num_threads);
+  });
+
+  m.def("set_animation_backend", [](int backend) {
+    core_instance->SetAnimationBackend(static_cast<AnimationBackend>(backend));
+  });
+
+  m.def("start_trace", []() { TraceRecorder::Get()->Start(); });
+
+  m.def("stop_trace", []() {
+    TraceRecorder::Get()->Stop();
+    return TraceRecorder::Get()->ExportJson();
+  });
+
   m.def("transition_scene", [](const pybind11::object& scene) {
     static_cast<PythonEngine*>(core_instance->scripting_engine())
         ->ChangeScene(scene);
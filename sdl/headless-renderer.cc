@@ -0,0 +1,205 @@
+#include "sdl/headless-renderer.h"
+
+#include <algorithm>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <absl/strings/str_cat.h>
+#include <glog/logging.h>
+
+namespace troll {
+
+namespace {
+constexpr Uint32 kOpaqueBlack = 0x000000ff;
+
+// Loads an image in RGBA8888 pixels, where colour keyed pixels are
+// transparent. Returns no pixels if the image failed to load.
+std::vector<Uint32> LoadImagePixels(const std::string& filename,
+                                    const RGBa& colour_key, int* width,
+                                    int* height) {
+  *width = *height = 0;
+
+  SDL_Surface* image = IMG_Load(filename.c_str());
+  if (image == nullptr) {
+    LOG(ERROR) << SDL_GetError();
+    return {};
+  }
+  SDL_SetColorKey(image, SDL_TRUE,
+                  SDL_MapRGB(image->format, colour_key.red(),
+                             colour_key.green(), colour_key.blue()));
+
+  SDL_Surface* surface =
+      SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA8888, 0);
+  SDL_FreeSurface(image);
+  if (surface == nullptr) {
+    LOG(ERROR) << SDL_GetError();
+    return {};
+  }
+
+  std::vector<Uint32> pixels(surface->w * surface->h);
+  SDL_LockSurface(surface);
+  for (int y = 0; y < surface->h; ++y) {
+    const Uint32* row = reinterpret_cast<const Uint32*>(
+        static_cast<const Uint8*>(surface->pixels) + y * surface->pitch);
+    std::copy(row, row + surface->w, pixels.begin() + y * surface->w);
+  }
+  SDL_UnlockSurface(surface);
+
+  *width = surface->w;
+  *height = surface->h;
+  SDL_FreeSurface(surface);
+  return pixels;
+}
+
+Uint32 ToPixel(const RGBa& colour) {
+  return static_cast<Uint32>(colour.red() & 0xff) << 24 |
+         static_cast<Uint32>(colour.green() & 0xff) << 16 |
+         static_cast<Uint32>(colour.blue() & 0xff) << 8 |
+         static_cast<Uint32>(colour.alpha() & 0xff);
+}
+
+// Blends |src| over |dst| using the alpha of |src|.
+Uint32 Blend(Uint32 src, Uint32 dst) {
+  const Uint32 alpha = src & 0xff;
+  if (alpha == 0xff) return src;
+  if (alpha == 0) return dst;
+
+  const Uint32 inverse = 0xff - alpha;
+  Uint32 result = alpha + (dst & 0xff) * inverse / 0xff;
+  for (int shift = 8; shift < 32; shift += 8) {
+    const Uint32 channel =
+        (((src >> shift) & 0xff) * alpha + ((dst >> shift) & 0xff) * inverse) /
+        0xff;
+    result |= channel << shift;
+  }
+  return result;
+}
+}  // namespace
+
+bool HeadlessRenderer::CreateWindow(int width, int height) {
+  width_ = width;
+  height_ = height;
+  framebuffer_.assign(width * height, kOpaqueBlack);
+  return true;
+}
+
+std::vector<CollisionMask> HeadlessRenderer::GenerateCollisionMasks(
+    const std::string& base_path, const Sprite& sprite,
+    std::vector<CollisionMaskPyramid>* pyramids) const {
+  int width = 0;
+  int height = 0;
+  const auto pixels =
+      LoadImagePixels(absl::StrCat(base_path, sprite.resource()),
+                      sprite.colour_key(), &width, &height);
+
+  std::vector<CollisionMask> collision_masks;
+  for (const auto& film : sprite.film()) {
+    collision_masks.push_back(CollisionMask(film.width(), film.height()));
+    auto& collision_mask = collision_masks.back();
+
+    for (int i = film.top(); i < std::min(film.top() + film.height(), height);
+         ++i) {
+      for (int j = film.left(); j < std::min(film.left() + film.width(), width);
+           ++j) {
+        collision_mask.Set(j - film.left(), i - film.top(),
+                           (pixels[i * width + j] & 0xff) != 0);
+      }
+    }
+    pyramids->push_back(CollisionMaskPyramid(collision_mask));
+  }
+  return collision_masks;
+}
+
+std::vector<std::unique_ptr<Texture>> HeadlessRenderer::CreateTextures(
+    const std::vector<std::pair<std::string, RGBa>>& images) const {
+  std::vector<std::unique_ptr<Texture>> textures;
+  for (const auto& [filename, colour_key] : images) {
+    int width = 0;
+    int height = 0;
+    auto pixels = LoadImagePixels(filename, colour_key, &width, &height);
+    textures.push_back(
+        Texture::CreateTextureFromPixels(std::move(pixels), width, height));
+  }
+  return textures;
+}
+
+void HeadlessRenderer::BlitTexture(const Texture& src, const Box& src_box,
+                                   const Box& dst_box) const {
+  const auto* pixels = src.pixels();
+  if (pixels == nullptr) {
+    LOG_FIRST_N(ERROR, 1) << "Headless renderer cannot blit textures that are "
+                             "not kept in memory.";
+    return;
+  }
+
+  const SDL_Rect& region = src.region();
+  const SDL_Rect src_rect =
+      src_box.width() == 0
+          ? region
+          : SDL_Rect{region.x + src_box.left(), region.y + src_box.top(),
+                     src_box.width(), src_box.height()};
+  const SDL_Rect dst_rect =
+      dst_box.width() == 0 ? SDL_Rect{0, 0, width_, height_}
+                           : SDL_Rect{dst_box.left(), dst_box.top(),
+                                      dst_box.width(), dst_box.height()};
+  if (src_rect.w <= 0 || src_rect.h <= 0 || dst_rect.w <= 0 ||
+      dst_rect.h <= 0) {
+    return;
+  }
+  if (src_rect.x < 0 || src_rect.y < 0 ||
+      src_rect.x + src_rect.w > src.texture_width() ||
+      src_rect.y + src_rect.h > src.texture_height()) {
+    LOG(ERROR) << "Blit source area is outside of the texture.";
+    return;
+  }
+
+  // Clip destination to the framebuffer.
+  const int left = std::max(dst_rect.x, 0);
+  const int top = std::max(dst_rect.y, 0);
+  const int right = std::min(dst_rect.x + dst_rect.w, width_);
+  const int bottom = std::min(dst_rect.y + dst_rect.h, height_);
+
+  // Source pixels are sampled with nearest neighbour when the blit scales.
+  const bool scaled = src_rect.w != dst_rect.w || src_rect.h != dst_rect.h;
+  for (int y = top; y < bottom; ++y) {
+    const int src_y = src_rect.y + (y - dst_rect.y) * src_rect.h / dst_rect.h;
+    const Uint32* src_row = pixels->data() + src_y * src.texture_width();
+    Uint32* dst_row = framebuffer_.data() + y * width_;
+
+    if (!scaled) {
+      const Uint32* src_pixel = src_row + src_rect.x + left - dst_rect.x;
+      for (int x = left; x < right; ++x, ++src_pixel) {
+        dst_row[x] = Blend(*src_pixel, dst_row[x]);
+      }
+      continue;
+    }
+
+    for (int x = left; x < right; ++x) {
+      const int src_x = src_rect.x + (x - dst_rect.x) * src_rect.w / dst_rect.w;
+      dst_row[x] = Blend(src_row[src_x], dst_row[x]);
+    }
+  }
+}
+
+void HeadlessRenderer::FillColour(const RGBa& colour,
+                                  const Box& dst_box) const {
+  const int left = std::max(dst_box.left(), 0);
+  const int top = std::max(dst_box.top(), 0);
+  const int right = std::min(dst_box.left() + dst_box.width(), width_);
+  const int bottom = std::min(dst_box.top() + dst_box.height(), height_);
+  if (left >= right) return;
+
+  const Uint32 pixel = ToPixel(colour);
+  for (int y = top; y < bottom; ++y) {
+    std::fill(framebuffer_.begin() + y * width_ + left,
+              framebuffer_.begin() + y * width_ + right, pixel);
+  }
+}
+
+void HeadlessRenderer::Flip() const { ++frame_count_; }
+
+void HeadlessRenderer::ClearScreen() const {
+  std::fill(framebuffer_.begin(), framebuffer_.end(), kOpaqueBlack);
+}
+
+}  // namespace troll
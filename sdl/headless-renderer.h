@@ -0,0 +1,69 @@
+#ifndef TROLL_SDL_HEADLESS_RENDERER_H_
+#define TROLL_SDL_HEADLESS_RENDERER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "core/collision-mask.h"
+#include "proto/primitives.pb.h"
+#include "proto/sprite.pb.h"
+#include "sdl/renderer.h"
+#include "sdl/texture.h"
+
+namespace troll {
+
+// Renderer that rasterizes frames in an in-memory framebuffer. It needs no
+// display and it is not throttled by vsync, so that it can be used to measure
+// frame throughput and to compare rendered frames in tests.
+//
+// Pixels are in RGBA8888 format. Textures are blended with their alpha, while
+// colour fills overwrite the destination pixels, as with the SDL renderer.
+class HeadlessRenderer : public Renderer {
+ public:
+  HeadlessRenderer() = default;
+  ~HeadlessRenderer() override = default;
+
+  // Allocates a framebuffer of specified dimensions.
+  bool CreateWindow(int width, int height) override;
+
+  std::vector<CollisionMask> GenerateCollisionMasks(
+      const std::string& base_path, const Sprite& sprite,
+      std::vector<CollisionMaskPyramid>* pyramids) const override;
+
+  // Images are loaded in textures that keep their pixels in memory.
+  std::vector<std::unique_ptr<Texture>> CreateTextures(
+      const std::vector<std::pair<std::string, RGBa>>& images) const override;
+
+  void BlitTexture(const Texture& src, const Box& src_box,
+                   const Box& dst_box) const override;
+  void FillColour(const RGBa& colour, const Box& dst_box) const override;
+
+  void Flip() const override;
+
+  void ClearScreen() const override;
+
+  // Returns the colour of a pixel in the framebuffer.
+  Uint32 GetPixel(int x, int y) const { return framebuffer_[y * width_ + x]; }
+
+  const std::vector<Uint32>& framebuffer() const { return framebuffer_; }
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  // Number of frames that were flipped.
+  int frame_count() const { return frame_count_; }
+
+ private:
+  int width_ = 0;
+  int height_ = 0;
+
+  mutable std::vector<Uint32> framebuffer_;
+  mutable int frame_count_ = 0;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_SDL_HEADLESS_RENDERER_H_
@@ -0,0 +1,141 @@
+#include "sdl/headless-renderer.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace troll {
+
+namespace {
+constexpr Uint32 kBlack = 0x000000ff;
+constexpr Uint32 kRed = 0xff0000ff;
+constexpr Uint32 kGreen = 0x00ff00ff;
+constexpr Uint32 kTransparent = 0x00000000;
+
+Box MakeBox(int left, int top, int width, int height) {
+  Box box;
+  box.set_left(left);
+  box.set_top(top);
+  box.set_width(width);
+  box.set_height(height);
+  return box;
+}
+
+RGBa MakeColour(int red, int green, int blue, int alpha) {
+  RGBa colour;
+  colour.set_red(red);
+  colour.set_green(green);
+  colour.set_blue(blue);
+  colour.set_alpha(alpha);
+  return colour;
+}
+}  // namespace
+
+SCENARIO("Filling colour in the framebuffer", "[HeadlessRenderer.Fill]") {
+  GIVEN("an empty framebuffer") {
+    HeadlessRenderer renderer;
+    renderer.CreateWindow(8, 8);
+
+    THEN("it is cleared to black") {
+      REQUIRE(renderer.framebuffer() == std::vector<Uint32>(64, kBlack));
+    }
+
+    WHEN("an area is filled") {
+      renderer.FillColour(MakeColour(255, 0, 0, 255), MakeBox(2, 2, 3, 2));
+
+      THEN("only pixels in the area change") {
+        REQUIRE(renderer.GetPixel(2, 2) == kRed);
+        REQUIRE(renderer.GetPixel(4, 3) == kRed);
+        REQUIRE(renderer.GetPixel(5, 3) == kBlack);
+        REQUIRE(renderer.GetPixel(4, 4) == kBlack);
+        REQUIRE(renderer.GetPixel(1, 2) == kBlack);
+      }
+
+      AND_WHEN("the screen is cleared") {
+        renderer.ClearScreen();
+
+        THEN("all pixels are black") {
+          REQUIRE(renderer.framebuffer() == std::vector<Uint32>(64, kBlack));
+        }
+      }
+    }
+
+    WHEN("an area partly outside the framebuffer is filled") {
+      renderer.FillColour(MakeColour(255, 0, 0, 255), MakeBox(-2, 6, 4, 4));
+
+      THEN("it is clipped") {
+        REQUIRE(renderer.GetPixel(0, 6) == kRed);
+        REQUIRE(renderer.GetPixel(1, 7) == kRed);
+        REQUIRE(renderer.GetPixel(2, 7) == kBlack);
+      }
+    }
+  }
+}
+
+SCENARIO("Blitting textures in the framebuffer", "[HeadlessRenderer.Blit]") {
+  GIVEN("a texture with transparent pixels") {
+    HeadlessRenderer renderer;
+    renderer.CreateWindow(8, 8);
+
+    // A 4x2 texture made of two 2x2 frames.
+    const auto texture = Texture::CreateTextureFromPixels(
+        {
+            kRed, kTransparent, kGreen, kGreen,  //
+            kRed, kRed, kGreen, kGreen,          //
+        },
+        4, 2);
+
+    WHEN("a frame of it is blitted") {
+      renderer.BlitTexture(*texture, MakeBox(0, 0, 2, 2), MakeBox(3, 3, 2, 2));
+
+      THEN("opaque pixels are copied and transparent ones are skipped") {
+        REQUIRE(renderer.GetPixel(3, 3) == kRed);
+        REQUIRE(renderer.GetPixel(4, 3) == kBlack);
+        REQUIRE(renderer.GetPixel(3, 4) == kRed);
+        REQUIRE(renderer.GetPixel(4, 4) == kRed);
+      }
+    }
+
+    WHEN("another frame of it is blitted") {
+      renderer.BlitTexture(*texture, MakeBox(2, 0, 2, 2), MakeBox(0, 0, 2, 2));
+
+      THEN("pixels of that frame are copied") {
+        REQUIRE(renderer.GetPixel(0, 0) == kGreen);
+        REQUIRE(renderer.GetPixel(1, 1) == kGreen);
+        REQUIRE(renderer.GetPixel(2, 0) == kBlack);
+      }
+    }
+
+    WHEN("it is blitted on a larger area") {
+      renderer.BlitTexture(*texture, MakeBox(2, 0, 2, 2), MakeBox(0, 0, 4, 4));
+
+      THEN("it is scaled") {
+        REQUIRE(renderer.GetPixel(3, 3) == kGreen);
+        REQUIRE(renderer.GetPixel(4, 4) == kBlack);
+      }
+    }
+
+    WHEN("it is blitted partly outside the framebuffer") {
+      renderer.BlitTexture(*texture, MakeBox(0, 0, 2, 2),
+                           MakeBox(-1, 6, 2, 2));
+
+      THEN("it is clipped") {
+        REQUIRE(renderer.GetPixel(0, 6) == kBlack);
+        REQUIRE(renderer.GetPixel(0, 7) == kRed);
+        REQUIRE(renderer.GetPixel(1, 7) == kBlack);
+      }
+    }
+
+    WHEN("it is blitted over a colour with partial alpha") {
+      const auto half_red =
+          Texture::CreateTextureFromPixels({0xff000080}, 1, 1);
+      renderer.FillColour(MakeColour(0, 0, 255, 255), MakeBox(0, 0, 1, 1));
+      renderer.BlitTexture(*half_red, Box(), MakeBox(0, 0, 1, 1));
+
+      THEN("colours are blended") {
+        REQUIRE(renderer.GetPixel(0, 0) == 0x80007fff);
+      }
+    }
+  }
+}
+
+}  // namespace troll
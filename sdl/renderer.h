@@ -3,49 +3,54 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
-#include <SDL2/SDL.h>
-
+#include "core/collision-mask.h"
 #include "proto/primitives.pb.h"
 #include "proto/sprite.pb.h"
 #include "sdl/texture.h"
 
 namespace troll {
 
+// Interface of rendering backends.
 class Renderer {
  public:
-  Renderer() = default;
-  ~Renderer();
+  virtual ~Renderer() = default;
 
-  bool CreateWindow(int width, int height);
+  virtual bool CreateWindow(int width, int height) = 0;
 
   // Returns collision masks for each film in the sprite. Masks are auto-
-  // generated from the sprite's image and colour key
-  std::vector<std::vector<bool>> GenerateCollisionMasks(
-      const std::string& base_path, const Sprite& sprite) const;
+  // generated from the sprite's image and colour key. The occupancy pyramid of
+  // each mask is appended to |pyramids|.
+  virtual std::vector<CollisionMask> GenerateCollisionMasks(
+      const std::string& base_path, const Sprite& sprite,
+      std::vector<CollisionMaskPyramid>* pyramids) const = 0;
+
+  // Create textures that the renderer can blit from image files with their
+  // colour keys. Returns a texture for each image in the input order.
+  virtual std::vector<std::unique_ptr<Texture>> CreateTextures(
+      const std::vector<std::pair<std::string, RGBa>>& images) const = 0;
 
   // Blit a texture area to the screen.
-  void BlitTexture(const Texture& src, const Box& src_box,
-                   const Box& dst_box) const;
+  virtual void BlitTexture(const Texture& src, const Box& src_box,
+                           const Box& dst_box) const = 0;
   // Fill the destination area with specified colour.
-  void FillColour(const RGBa& colour, const Box& dst_box) const;
+  virtual void FillColour(const RGBa& colour, const Box& dst_box) const = 0;
 
   // Commit all changes to the screen.
-  void Flip() const;
+  virtual void Flip() const = 0;
 
-  void ShowCursor(bool show) const {}
+  virtual void ShowCursor(bool show) const {}
 
-  void PrintText(const std::string& text, const Vector& at) const {}
-  void ClearScreen() const;
+  virtual void PrintText(const std::string& text, const Vector& at) const {}
+  virtual void ClearScreen() const = 0;
+
+ protected:
+  Renderer() = default;
 
   Renderer(const Renderer&) = delete;
   Renderer& operator=(const Renderer&) = delete;
-
- private:
-  SDL_Window* window_ = nullptr;
-  SDL_Renderer* sdl_renderer_ = nullptr;
-
-  friend class Texture;
 };
 
 }  // namespace troll
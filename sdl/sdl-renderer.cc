@@ -0,0 +1,225 @@
+#include "sdl/sdl-renderer.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include <absl/strings/str_cat.h>
+#include <glog/logging.h>
+
+#include "sdl/texture.h"
+
+namespace troll {
+
+SdlRenderer::~SdlRenderer() {
+  SDL_DestroyRenderer(sdl_renderer_);
+  SDL_DestroyWindow(window_);
+  IMG_Quit();
+  SDL_Quit();
+}
+
+bool SdlRenderer::CreateWindow(int width, int height) {
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0) {
+    LOG(ERROR) << "SDL_Init error: " << SDL_GetError();
+    return false;
+  }
+
+  if (TTF_Init() != 0) {
+    LOG(ERROR) << "TTF_Init: " << SDL_GetError();
+    return false;
+  }
+
+  window_ = SDL_CreateWindow("Troll the World!", 100, 100, width, height,
+                             SDL_WINDOW_SHOWN);
+  if (window_ == nullptr) {
+    LOG(ERROR) << "SDL_CreateWindow Error: " << SDL_GetError();
+    return false;
+  }
+
+  sdl_renderer_ = SDL_CreateRenderer(
+      window_, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+  if (sdl_renderer_ == nullptr) {
+    LOG(ERROR) << "SDL_CreateRenderer Error: " << SDL_GetError();
+    return false;
+  }
+
+  return true;
+}
+
+std::vector<CollisionMask> SdlRenderer::GenerateCollisionMasks(
+    const std::string& base_path, const Sprite& sprite,
+    std::vector<CollisionMaskPyramid>* pyramids) const {
+  SDL_Surface* sprite_surface =
+      IMG_Load(absl::StrCat(base_path, sprite.resource()).c_str());
+  if (sprite_surface == nullptr) {
+    LOG(ERROR) << SDL_GetError();
+  }
+
+  SDL_Surface* surface = SDL_ConvertSurfaceFormat(
+      sprite_surface, SDL_GetWindowPixelFormat(window_), NULL);
+  SDL_FreeSurface(sprite_surface);
+
+  const int bpp = surface->format->BytesPerPixel;
+  LOG_IF(FATAL, bpp != 4)
+      << "Surface format should be 4 bytes per pixel. Format is " << bpp
+      << " bytes per pixels instead.";
+
+  const Uint32 format = SDL_GetWindowPixelFormat(window_);
+  SDL_PixelFormat* mapping_format = SDL_AllocFormat(format);
+  const Uint32 colour_key =
+      SDL_MapRGB(mapping_format, sprite.colour_key().red(),
+                 sprite.colour_key().green(), sprite.colour_key().blue());
+  SDL_FreeFormat(mapping_format);
+
+  const int surface_width = surface->pitch / bpp;
+
+  std::vector<CollisionMask> collision_masks;
+  SDL_LockSurface(surface);
+  for (const auto& film : sprite.film()) {
+    collision_masks.push_back(CollisionMask(film.width(), film.height()));
+    auto& collision_mask = collision_masks.back();
+
+    const Uint32* pixels = static_cast<const Uint32*>(surface->pixels);
+    for (int i = film.top(); i < film.top() + film.height(); ++i) {
+      for (int j = film.left(); j < film.left() + film.width(); ++j) {
+        const int surface_index = i * surface_width + j;
+        collision_mask.Set(j - film.left(), i - film.top(),
+                           pixels[surface_index] != colour_key);
+      }
+    }
+    pyramids->push_back(CollisionMaskPyramid(collision_mask));
+  }
+  SDL_UnlockSurface(surface);
+
+  SDL_FreeSurface(surface);
+  return collision_masks;
+}
+
+std::vector<std::unique_ptr<Texture>> SdlRenderer::CreateTextures(
+    const std::vector<std::pair<std::string, RGBa>>& images) const {
+  return Texture::CreateTextureAtlas(images, this);
+}
+
+void SdlRenderer::BlitTexture(const Texture& src, const Box& src_box,
+                           const Box& dst_box) const {
+  // Source boxes are relative to the texture's region in its atlas.
+  const SDL_Rect& region = src.region();
+  SDL_Rect src_rect = {
+      region.x + src_box.left(),
+      region.y + src_box.top(),
+      src_box.width(),
+      src_box.height(),
+  };
+  if (src_box.width() == 0) {
+    src_rect = region;
+  }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  if (src.texture_width() == 0 || src.texture_height() == 0) return;
+
+  SDL_FRect dst_rect = {
+      static_cast<float>(dst_box.left()),
+      static_cast<float>(dst_box.top()),
+      static_cast<float>(dst_box.width()),
+      static_cast<float>(dst_box.height()),
+  };
+  if (dst_box.width() == 0) {
+    int width = 0;
+    int height = 0;
+    SDL_GetRendererOutputSize(sdl_renderer_, &width, &height);
+    dst_rect = {0.f, 0.f, static_cast<float>(width),
+                static_cast<float>(height)};
+  }
+
+  const float texture_width = src.texture_width();
+  const float texture_height = src.texture_height();
+  AppendQuad(src.texture(), dst_rect,
+             {src_rect.x / texture_width, src_rect.y / texture_height},
+             {(src_rect.x + src_rect.w) / texture_width,
+              (src_rect.y + src_rect.h) / texture_height},
+             {255, 255, 255, 255});
+#else
+  SDL_Rect dst_rect = {
+      dst_box.left(),
+      dst_box.top(),
+      dst_box.width(),
+      dst_box.height(),
+  };
+  SDL_RenderCopy(sdl_renderer_, src.texture(), &src_rect,
+                 dst_box.width() == 0 ? nullptr : &dst_rect);
+#endif
+}
+
+void SdlRenderer::FillColour(const RGBa& colour, const Box& dst_box) const {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  AppendQuad(nullptr,
+             {static_cast<float>(dst_box.left()),
+              static_cast<float>(dst_box.top()),
+              static_cast<float>(dst_box.width()),
+              static_cast<float>(dst_box.height())},
+             {0.f, 0.f}, {0.f, 0.f},
+             {static_cast<Uint8>(colour.red()),
+              static_cast<Uint8>(colour.green()),
+              static_cast<Uint8>(colour.blue()),
+              static_cast<Uint8>(colour.alpha())});
+#else
+  SDL_SetRenderDrawColor(sdl_renderer_, colour.red(), colour.green(),
+                         colour.blue(), colour.alpha());
+  SDL_Rect dst_rect = {
+      dst_box.left(),
+      dst_box.top(),
+      dst_box.width(),
+      dst_box.height(),
+  };
+  SDL_RenderFillRect(sdl_renderer_, &dst_rect);
+#endif
+}
+
+void SdlRenderer::Flip() const {
+  FlushBatch();
+  SDL_RenderPresent(sdl_renderer_);
+}
+
+void SdlRenderer::ClearScreen() const {
+  FlushBatch();
+  SDL_RenderClear(sdl_renderer_);
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+void SdlRenderer::AppendQuad(SDL_Texture* texture, const SDL_FRect& dst,
+                          const SDL_FPoint& uv_min, const SDL_FPoint& uv_max,
+                          const SDL_Color& colour) const {
+  if (texture != batch_texture_) {
+    FlushBatch();
+    batch_texture_ = texture;
+  }
+
+  const int base = batch_vertices_.size();
+  batch_vertices_.push_back({{dst.x, dst.y}, colour, {uv_min.x, uv_min.y}});
+  batch_vertices_.push_back(
+      {{dst.x + dst.w, dst.y}, colour, {uv_max.x, uv_min.y}});
+  batch_vertices_.push_back(
+      {{dst.x + dst.w, dst.y + dst.h}, colour, {uv_max.x, uv_max.y}});
+  batch_vertices_.push_back(
+      {{dst.x, dst.y + dst.h}, colour, {uv_min.x, uv_max.y}});
+
+  for (const int offset : {0, 1, 2, 0, 2, 3}) {
+    batch_indices_.push_back(base + offset);
+  }
+}
+#endif
+
+void SdlRenderer::FlushBatch() const {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  if (batch_indices_.empty()) return;
+
+  if (SDL_RenderGeometry(sdl_renderer_, batch_texture_, batch_vertices_.data(),
+                         batch_vertices_.size(), batch_indices_.data(),
+                         batch_indices_.size()) != 0) {
+    LOG(ERROR) << "SDL_RenderGeometry Error: " << SDL_GetError();
+  }
+  batch_vertices_.clear();
+  batch_indices_.clear();
+#endif
+}
+
+}  // namespace troll
@@ -0,0 +1,71 @@
+#ifndef TROLL_SDL_SDL_RENDERER_H_
+#define TROLL_SDL_SDL_RENDERER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "core/collision-mask.h"
+#include "proto/primitives.pb.h"
+#include "proto/sprite.pb.h"
+#include "sdl/renderer.h"
+#include "sdl/texture.h"
+
+namespace troll {
+
+// Renderer that draws on an SDL window with hardware acceleration.
+class SdlRenderer : public Renderer {
+ public:
+  SdlRenderer() = default;
+  ~SdlRenderer() override;
+
+  bool CreateWindow(int width, int height) override;
+
+  std::vector<CollisionMask> GenerateCollisionMasks(
+      const std::string& base_path, const Sprite& sprite,
+      std::vector<CollisionMaskPyramid>* pyramids) const override;
+
+  // Sprite sheets are packed in texture atlases.
+  std::vector<std::unique_ptr<Texture>> CreateTextures(
+      const std::vector<std::pair<std::string, RGBa>>& images) const override;
+
+  void BlitTexture(const Texture& src, const Box& src_box,
+                   const Box& dst_box) const override;
+  void FillColour(const RGBa& colour, const Box& dst_box) const override;
+
+  // Pending batches are drawn before the screen is updated.
+  void Flip() const override;
+
+  void ClearScreen() const override;
+
+ private:
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  // Appends a quad to the current batch. The batch is drawn when a quad with a
+  // different texture is appended, so that quads are drawn in the order they
+  // were submitted. A null |texture| draws quads with their vertex colour.
+  void AppendQuad(SDL_Texture* texture, const SDL_FRect& dst,
+                  const SDL_FPoint& uv_min, const SDL_FPoint& uv_max,
+                  const SDL_Color& colour) const;
+#endif
+
+  // Draws quads of the current batch in a single call.
+  void FlushBatch() const;
+
+  SDL_Window* window_ = nullptr;
+  SDL_Renderer* sdl_renderer_ = nullptr;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  mutable SDL_Texture* batch_texture_ = nullptr;
+  mutable std::vector<SDL_Vertex> batch_vertices_;
+  mutable std::vector<int> batch_indices_;
+#endif
+
+  friend class Texture;
+};
+
+}  // namespace troll
+
+#endif  // TROLL_SDL_SDL_RENDERER_H_
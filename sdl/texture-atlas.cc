@@ -0,0 +1,70 @@
+#include "sdl/texture-atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+
+namespace troll {
+
+namespace {
+int NextPowerOfTwo(int value) {
+  int power = 1;
+  while (power < value) power *= 2;
+  return power;
+}
+}  // namespace
+
+std::vector<AtlasPlacement> PackAtlas(const std::vector<AtlasSize>& sizes,
+                                      const AtlasSize& max_size, int padding,
+                                      AtlasSize* atlas_size) {
+  std::vector<AtlasPlacement> placements(sizes.size());
+  *atlas_size = AtlasSize();
+
+  // Taller images first keep shelves tight.
+  std::vector<int> order(sizes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&sizes](int lhs, int rhs) {
+    return sizes[lhs].height != sizes[rhs].height
+               ? sizes[lhs].height > sizes[rhs].height
+               : sizes[lhs].width > sizes[rhs].width;
+  });
+
+  // Aim for a square atlas, but never narrower than the widest image.
+  int64_t area = 0;
+  int widest = 0;
+  for (const auto& size : sizes) {
+    area += static_cast<int64_t>(size.width + padding) *
+            (size.height + padding);
+    widest = std::max(widest, size.width);
+  }
+  const int width =
+      std::min(max_size.width,
+               std::max(widest, NextPowerOfTwo(std::sqrt(area) + 1)));
+
+  int x = 0;
+  int y = 0;
+  int shelf_height = 0;
+  for (const int i : order) {
+    const auto& size = sizes[i];
+    if (size.width > width || size.height > max_size.height) continue;
+
+    if (x + size.width > width) {
+      y += shelf_height + padding;
+      x = 0;
+      shelf_height = 0;
+    }
+    if (y + size.height > max_size.height) continue;
+
+    placements[i] = {x, y, true};
+    x += size.width + padding;
+    shelf_height = std::max(shelf_height, size.height);
+
+    atlas_size->width = std::max(atlas_size->width, x - padding);
+    atlas_size->height = std::max(atlas_size->height, y + size.height);
+  }
+
+  return placements;
+}
+
+}  // namespace troll
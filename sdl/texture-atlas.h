@@ -0,0 +1,32 @@
+#ifndef TROLL_SDL_TEXTURE_ATLAS_H_
+#define TROLL_SDL_TEXTURE_ATLAS_H_
+
+#include <vector>
+
+namespace troll {
+
+// Position of an image in a texture atlas.
+struct AtlasPlacement {
+  int x = 0;
+  int y = 0;
+
+  // False if the image did not fit in the atlas.
+  bool packed = false;
+};
+
+struct AtlasSize {
+  int width = 0;
+  int height = 0;
+};
+
+// Packs images of |sizes| in shelves of an atlas that is no larger than
+// |max_size|. Images are separated by |padding| pixels to avoid bleeding when
+// textures are filtered. Returns the placement of each image in the order of
+// |sizes| and sets |atlas_size| to the dimensions actually used.
+std::vector<AtlasPlacement> PackAtlas(const std::vector<AtlasSize>& sizes,
+                                      const AtlasSize& max_size, int padding,
+                                      AtlasSize* atlas_size);
+
+}  // namespace troll
+
+#endif  // TROLL_SDL_TEXTURE_ATLAS_H_
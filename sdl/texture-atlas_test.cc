@@ -0,0 +1,83 @@
+#include "sdl/texture-atlas.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace troll {
+
+namespace {
+bool Overlap(const AtlasPlacement& lhs, const AtlasSize& lhs_size,
+             const AtlasPlacement& rhs, const AtlasSize& rhs_size,
+             int padding) {
+  return lhs.x < rhs.x + rhs_size.width + padding &&
+         rhs.x < lhs.x + lhs_size.width + padding &&
+         lhs.y < rhs.y + rhs_size.height + padding &&
+         rhs.y < lhs.y + lhs_size.height + padding;
+}
+}  // namespace
+
+SCENARIO("Packing images in an atlas", "[TextureAtlas.Pack]") {
+  GIVEN("images of various sizes") {
+    const std::vector<AtlasSize> sizes = {
+        {64, 32}, {16, 16}, {100, 50}, {8, 60}, {32, 32}, {40, 10},
+    };
+
+    WHEN("they are packed in a large atlas") {
+      AtlasSize atlas_size;
+      const auto placements = PackAtlas(sizes, {1024, 1024}, 1, &atlas_size);
+
+      THEN("all images are packed") {
+        REQUIRE(placements.size() == sizes.size());
+        for (const auto& placement : placements) {
+          REQUIRE(placement.packed);
+        }
+      }
+
+      THEN("images are separated by the padding") {
+        for (int i = 0; i < sizes.size(); ++i) {
+          for (int j = i + 1; j < sizes.size(); ++j) {
+            REQUIRE_FALSE(Overlap(placements[i], sizes[i], placements[j],
+                                  sizes[j], 1));
+          }
+        }
+      }
+
+      THEN("images are inside the atlas") {
+        for (int i = 0; i < sizes.size(); ++i) {
+          REQUIRE(placements[i].x >= 0);
+          REQUIRE(placements[i].y >= 0);
+          REQUIRE(placements[i].x + sizes[i].width <= atlas_size.width);
+          REQUIRE(placements[i].y + sizes[i].height <= atlas_size.height);
+        }
+      }
+    }
+
+    WHEN("they are packed in an atlas too small for all of them") {
+      AtlasSize atlas_size;
+      const auto placements = PackAtlas(sizes, {80, 64}, 1, &atlas_size);
+
+      THEN("images larger than the atlas are not packed") {
+        REQUIRE_FALSE(placements[2].packed);
+        REQUIRE(placements[0].packed);
+      }
+
+      THEN("the atlas does not exceed the maximum size") {
+        REQUIRE(atlas_size.width <= 80);
+        REQUIRE(atlas_size.height <= 64);
+      }
+    }
+  }
+
+  GIVEN("no images") {
+    AtlasSize atlas_size;
+    const auto placements = PackAtlas({}, {1024, 1024}, 1, &atlas_size);
+
+    THEN("the atlas is empty") {
+      REQUIRE(placements.empty());
+      REQUIRE(atlas_size.width == 0);
+      REQUIRE(atlas_size.height == 0);
+    }
+  }
+}
+
+}  // namespace troll
@@ -1,11 +1,14 @@
 #include "sdl/texture.h"
 
+#include <algorithm>
+
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include <glog/logging.h>
 
-#include "sdl/renderer.h"
+#include "sdl/sdl-renderer.h"
+#include "sdl/texture-atlas.h"
 
 namespace troll {
 
@@ -20,7 +23,7 @@ std::unique_ptr<Font> Font::CreateFontFromFile(const std::string& filename,
 
 std::unique_ptr<Texture> Texture::CreateTextureFromFile(
     const std::string& filename, const RGBa& colour_key,
-    const Renderer* renderer) {
+    const SdlRenderer* renderer) {
   SDL_Surface* surface = IMG_Load(filename.c_str());
   if (surface == nullptr) {
     LOG(ERROR) << SDL_GetError();
@@ -39,9 +42,108 @@ std::unique_ptr<Texture> Texture::CreateTextureFromFile(
   return std::unique_ptr<Texture>(new Texture(texture));
 }
 
+namespace {
+// Images in an atlas are separated, so that filtering does not blend pixels of
+// neighbouring images.
+constexpr int kAtlasPadding = 1;
+constexpr int kMaxAtlasSize = 4096;
+
+// Loads an image converted to a format with alpha, where colour keyed pixels
+// are transparent.
+SDL_Surface* LoadImageWithAlpha(const std::string& filename,
+                                const RGBa& colour_key) {
+  SDL_Surface* image = IMG_Load(filename.c_str());
+  if (image == nullptr) {
+    LOG(ERROR) << SDL_GetError();
+    return nullptr;
+  }
+  SDL_SetColorKey(image, SDL_TRUE,
+                  SDL_MapRGB(image->format, colour_key.red(),
+                             colour_key.green(), colour_key.blue()));
+
+  SDL_Surface* surface =
+      SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA32, 0);
+  if (surface == nullptr) {
+    LOG(ERROR) << SDL_GetError();
+  }
+  SDL_FreeSurface(image);
+  return surface;
+}
+}  // namespace
+
+std::vector<std::unique_ptr<Texture>> Texture::CreateTextureAtlas(
+    const std::vector<std::pair<std::string, RGBa>>& images,
+    const SdlRenderer* renderer) {
+  std::vector<SDL_Surface*> surfaces;
+  std::vector<AtlasSize> sizes;
+  for (const auto& [filename, colour_key] : images) {
+    surfaces.push_back(LoadImageWithAlpha(filename, colour_key));
+    sizes.push_back(surfaces.back() != nullptr
+                        ? AtlasSize{surfaces.back()->w, surfaces.back()->h}
+                        : AtlasSize());
+  }
+
+  SDL_RendererInfo info;
+  AtlasSize max_size = {kMaxAtlasSize, kMaxAtlasSize};
+  if (SDL_GetRendererInfo(renderer->sdl_renderer_, &info) == 0) {
+    if (info.max_texture_width > 0) {
+      max_size.width = std::min(max_size.width, info.max_texture_width);
+    }
+    if (info.max_texture_height > 0) {
+      max_size.height = std::min(max_size.height, info.max_texture_height);
+    }
+  }
+
+  AtlasSize atlas_size;
+  const auto placements =
+      PackAtlas(sizes, max_size, kAtlasPadding, &atlas_size);
+
+  std::shared_ptr<SDL_Texture> atlas;
+  if (atlas_size.width > 0 && atlas_size.height > 0) {
+    SDL_Surface* atlas_surface = SDL_CreateRGBSurfaceWithFormat(
+        0, atlas_size.width, atlas_size.height, 32, SDL_PIXELFORMAT_RGBA32);
+    for (int i = 0; i < surfaces.size(); ++i) {
+      if (surfaces[i] == nullptr || !placements[i].packed) continue;
+
+      // Copy alpha as is instead of blending on the empty atlas.
+      SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+      SDL_Rect destination = {placements[i].x, placements[i].y,
+                              surfaces[i]->w, surfaces[i]->h};
+      SDL_BlitSurface(surfaces[i], nullptr, atlas_surface, &destination);
+    }
+
+    atlas.reset(
+        SDL_CreateTextureFromSurface(renderer->sdl_renderer_, atlas_surface),
+        SDL_DestroyTexture);
+    if (atlas == nullptr) {
+      LOG(ERROR) << SDL_GetError();
+    }
+    SDL_SetTextureBlendMode(atlas.get(), SDL_BLENDMODE_BLEND);
+    SDL_FreeSurface(atlas_surface);
+  }
+
+  std::vector<std::unique_ptr<Texture>> textures;
+  for (int i = 0; i < surfaces.size(); ++i) {
+    if (surfaces[i] != nullptr && placements[i].packed && atlas != nullptr) {
+      textures.push_back(std::unique_ptr<Texture>(
+          new Texture(atlas, {placements[i].x, placements[i].y, surfaces[i]->w,
+                              surfaces[i]->h})));
+    } else {
+      SDL_Texture* texture =
+          surfaces[i] != nullptr ? SDL_CreateTextureFromSurface(
+                                       renderer->sdl_renderer_, surfaces[i])
+                                 : nullptr;
+      SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+      textures.push_back(std::unique_ptr<Texture>(new Texture(texture)));
+    }
+    SDL_FreeSurface(surfaces[i]);
+  }
+  return textures;
+}
+
 std::unique_ptr<Texture> Texture::CreateTextureText(
     const std::string& text, const Font& font, const RGBa& colour,
-    const RGBa& background_colour, const Renderer* renderer) {
+    const RGBa& background_colour, const SdlRenderer* renderer) {
   SDL_Surface* surface = TTF_RenderText_Blended(
       font.font(), text.c_str(),
       {static_cast<Uint8>(colour.red()), static_cast<Uint8>(colour.green()),
@@ -61,18 +163,45 @@ std::unique_ptr<Texture> Texture::CreateTextureText(
   return std::unique_ptr<Texture>(new Texture(texture));
 }
 
+std::unique_ptr<Texture> Texture::CreateTextureFromPixels(
+    std::vector<Uint32> pixels, int width, int height) {
+  LOG_IF(FATAL, pixels.size() != static_cast<size_t>(width) * height)
+      << "Texture of " << width << "x" << height << " pixels has "
+      << pixels.size() << " pixels.";
+  return std::unique_ptr<Texture>(
+      new Texture(std::move(pixels), width, height));
+}
+
 std::unique_ptr<Texture> Texture::CreateTexture(const RGBa& colour, int width,
                                                 int height) {
   return {};
 }
 
-Box Texture::GetBoundingBox() const {
-  SDL_Rect rect;
-  SDL_QueryTexture(texture_, NULL, NULL, &rect.w, &rect.h);
+Texture::Texture(SDL_Texture* texture)
+    : texture_(texture, SDL_DestroyTexture) {
+  if (texture != nullptr) {
+    SDL_QueryTexture(texture, nullptr, nullptr, &texture_width_,
+                     &texture_height_);
+  }
+  region_ = {0, 0, texture_width_, texture_height_};
+}
 
+Texture::Texture(std::shared_ptr<SDL_Texture> texture, const SDL_Rect& region)
+    : texture_(std::move(texture)), region_(region) {
+  SDL_QueryTexture(texture_.get(), nullptr, nullptr, &texture_width_,
+                   &texture_height_);
+}
+
+Texture::Texture(std::vector<Uint32> pixels, int width, int height)
+    : pixels_(std::make_shared<const std::vector<Uint32>>(std::move(pixels))),
+      region_({0, 0, width, height}),
+      texture_width_(width),
+      texture_height_(height) {}
+
+Box Texture::GetBoundingBox() const {
   Box bounding_box;
-  bounding_box.set_width(rect.w);
-  bounding_box.set_height(rect.h);
+  bounding_box.set_width(region_.w);
+  bounding_box.set_height(region_.h);
   return bounding_box;
 }
 
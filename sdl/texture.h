@@ -3,6 +3,8 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
@@ -11,7 +13,7 @@
 
 namespace troll {
 
-class Renderer;
+class SdlRenderer;
 
 class Font {
  public:
@@ -35,28 +37,59 @@ class Texture {
   // Create a texture from an image file.
   static std::unique_ptr<Texture> CreateTextureFromFile(
       const std::string& filename, const RGBa& colour_key,
-      const Renderer* renderer);
+      const SdlRenderer* renderer);
+
+  // Create textures from image files with their colour keys. Images are packed
+  // in a shared atlas, so that they can be drawn in the same batch. Returns a
+  // texture for each image in the input order. Images that do not fit in the
+  // atlas get a texture of their own.
+  static std::vector<std::unique_ptr<Texture>> CreateTextureAtlas(
+      const std::vector<std::pair<std::string, RGBa>>& images,
+      const SdlRenderer* renderer);
 
   // Create a texture with a text from a font asset.
   static std::unique_ptr<Texture> CreateTextureText(
       const std::string& text, const Font& font, const RGBa& colour,
-      const RGBa& background_colour, const Renderer* renderer);
+      const RGBa& background_colour, const SdlRenderer* renderer);
+
+  // Create a texture from RGBA8888 pixels in row-major order that is kept in
+  // memory, for renderers that rasterize in software.
+  static std::unique_ptr<Texture> CreateTextureFromPixels(
+      std::vector<Uint32> pixels, int width, int height);
 
   // Create a texture of specified colour and dimensions.
   static std::unique_ptr<Texture> CreateTexture(const RGBa& colour, int width,
                                                 int height);
 
-  ~Texture() { SDL_DestroyTexture(texture_); }
+  ~Texture() = default;
+
+  SDL_Texture* texture() const { return texture_.get(); }
+
+  // Area of texture() that this texture covers. Textures in an atlas share the
+  // same SDL_Texture.
+  const SDL_Rect& region() const { return region_; }
+
+  // Pixels of textures that are kept in memory or nullptr if the texture lives
+  // in an SDL_Texture.
+  const std::vector<Uint32>* pixels() const { return pixels_.get(); }
 
-  SDL_Texture* texture() const { return texture_; }
+  // Dimensions of the whole SDL_Texture or pixel buffer.
+  int texture_width() const { return texture_width_; }
+  int texture_height() const { return texture_height_; }
 
   Box GetBoundingBox() const;
 
  private:
-  Texture(SDL_Texture* texture) : texture_(texture) {}
+  explicit Texture(SDL_Texture* texture);
+  Texture(std::shared_ptr<SDL_Texture> texture, const SDL_Rect& region);
+  Texture(std::vector<Uint32> pixels, int width, int height);
   Texture(const Texture&) = delete;
 
-  SDL_Texture* texture_;
+  std::shared_ptr<SDL_Texture> texture_;
+  std::shared_ptr<const std::vector<Uint32>> pixels_;
+  SDL_Rect region_ = {0, 0, 0, 0};
+  int texture_width_ = 0;
+  int texture_height_ = 0;
 };
 
 }  // namespace troll
@@ -9,12 +9,15 @@ class TestCore : public Core {
  public:
   void Halt() override {}
   void LoadScene(const Scene& scene) override {}
+  void SetWorkerThreads(int num_threads) override {}
+  void SetAnimationBackend(AnimationBackend backend) override {}
 
   ActionManager* action_manager() override { return action_manager_; }
   AnimatorManager* animator_manager() override { return animator_manager_; }
   AudioMixer* audio_mixer() override { return audio_mixer_; }
   CollisionChecker* collision_checker() override { return collision_checker_; }
   EventDispatcher* event_dispatcher() override { return event_dispatcher_; }
+  FrameProfiler* frame_profiler() override { return frame_profiler_; }
   InputBackend* input_backend() override { return input_backend_; }
   InputManager* input_manager() override { return input_manager_; }
   QueryManager* query_manager() override { return query_manager_; }
@@ -23,6 +26,7 @@ class TestCore : public Core {
   SceneManager* scene_manager() override { return scene_manager_; }
   ScriptingEngine* scripting_engine() override { return scripting_engine_; }
   SoundLoader* sound_loader() override { return sound_loader_; }
+  ThreadPool* thread_pool() override { return thread_pool_; }
 
   void set_action_manager(ActionManager* action_manager) {
     action_manager_ = action_manager;
@@ -37,6 +41,9 @@ class TestCore : public Core {
   void set_event_dispatcher(EventDispatcher* event_dispatcher) {
     event_dispatcher_ = event_dispatcher;
   }
+  void set_frame_profiler(FrameProfiler* frame_profiler) {
+    frame_profiler_ = frame_profiler;
+  }
   void set_input_backend(InputBackend* input_backend) {
     input_backend_ = input_backend;
   }
@@ -59,6 +66,7 @@ class TestCore : public Core {
   void set_sound_loader(SoundLoader* sound_loader) {
     sound_loader_ = sound_loader;
   }
+  void set_thread_pool(ThreadPool* thread_pool) { thread_pool_ = thread_pool; }
 
  private:
   ActionManager* action_manager_ = nullptr;
@@ -66,6 +74,7 @@ class TestCore : public Core {
   AudioMixer* audio_mixer_ = nullptr;
   CollisionChecker* collision_checker_ = nullptr;
   EventDispatcher* event_dispatcher_ = nullptr;
+  FrameProfiler* frame_profiler_ = nullptr;
   InputBackend* input_backend_ = nullptr;
   InputManager* input_manager_ = nullptr;
   QueryManager* query_manager_ = nullptr;
@@ -74,6 +83,7 @@ class TestCore : public Core {
   SceneManager* scene_manager_ = nullptr;
   ScriptingEngine* scripting_engine_ = nullptr;
   SoundLoader* sound_loader_ = nullptr;
+  ThreadPool* thread_pool_ = nullptr;
 };
 
 }  // namespace troll
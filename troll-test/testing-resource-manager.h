@@ -1,8 +1,13 @@
 #ifndef TROLL_TROLL_TEST_TESTING_RESOURCE_MANAGER_H_
 #define TROLL_TROLL_TEST_TESTING_RESOURCE_MANAGER_H_
 
+#include <memory>
+#include <string>
+#include <utility>
+
 #include "core/resource-manager.h"
 #include "proto/sprite.pb.h"
+#include "sdl/texture.h"
 
 namespace troll {
 
@@ -14,13 +19,35 @@ class TestingResourceManager {
   void SetTestSprite(const Sprite& sprite) {
     resource_manager_->sprites_[sprite.id()] = sprite;
     auto& masks = resource_manager_->sprite_collision_masks_[sprite.id()];
+    auto& pyramids =
+        resource_manager_->sprite_collision_pyramids_[sprite.id()];
     for (const auto& film : sprite.film()) {
-      masks.push_back(std::vector<bool>(film.width() * film.height(), true));
+      masks.push_back(CollisionMask(film.width(), film.height(), true));
+      pyramids.push_back(CollisionMaskPyramid(masks.back()));
     }
   }
 
+  // Replaces the collision mask of a frame of a test sprite.
+  void SetTestCollisionMask(const std::string& sprite_id, int frame_index,
+                            const CollisionMask& mask) {
+    resource_manager_->sprite_collision_masks_[sprite_id][frame_index] = mask;
+    resource_manager_->sprite_collision_pyramids_[sprite_id][frame_index] =
+        CollisionMaskPyramid(mask);
+  }
+
+  void SetTestTexture(const std::string& texture_id,
+                      std::unique_ptr<Texture> texture) {
+    resource_manager_->textures_[texture_id] = std::move(texture);
+  }
+
   void SetTestAnimationScript(const AnimationScript& script) {
-    resource_manager_->scripts_[script.id()] = script;
+    resource_manager_->programs_[script.id()] =
+        std::make_unique<AnimationProgram>(script);
+    resource_manager_->LinkAnimationPrograms();
+  }
+
+  int inline_program_count() const {
+    return resource_manager_->inline_programs_.size();
   }
 
  private: